@@ -18,6 +18,7 @@
 #include <vector>
 #include "motive/init.h"
 #include "motive/math/compact_spline.h"
+#include "motive/util/memory_usage.h"
 
 namespace motive {
 
@@ -57,6 +58,9 @@ class MatrixAnim {
   /// Return the op array. Const version is to initialize a MatrixMotivator.
   const MatrixOpArray& ops() const { return ops_; }
 
+  /// Heap memory held by the op array and splines.
+  MotiveMemoryUsage MemoryUsage() const;
+
  private:
   /// Initialization structure for a MatrixMotivator.
   /// When initialized with this struct, the MatrixMotivator will play back
@@ -163,6 +167,10 @@ class RigAnim {
   /// Only valid if `record_names` is true in `Init()`.
   const std::string& anim_name() const { return anim_name_; }
 
+  /// Heap memory held by this animation: the splines and operations of every
+  /// bone, the bone hierarchy, and the bone names, if recorded.
+  MotiveMemoryUsage MemoryUsage() const;
+
  private:
   std::vector<MatrixAnim> anims_;
   std::vector<BoneIndex> bone_parents_;
@@ -133,6 +133,11 @@ class AnimTable {
   /// Internally, we avoid duplicating animations.
   int NumUniqueAnims() const { return static_cast<int>(anims_.size()); }
 
+  /// Heap memory held by all the animations, the defining animations, and
+  /// the lookup tables. Animations that are shared between objects are only
+  /// counted once.
+  MotiveMemoryUsage MemoryUsage() const;
+
  private:
   typedef uint16_t AnimIndex;
   typedef std::vector<AnimIndex> AnimList;
@@ -17,6 +17,8 @@
 
 #include <map>
 #include <set>
+#include <string>
+#include <vector>
 
 #include "motive/common.h"
 #include "motive/processor.h"
@@ -25,6 +27,65 @@ namespace motive {
 
 struct MotiveVersion;
 
+/// @class MotiveCounterReport
+/// @brief Counts of the work done by one MotiveProcessor.
+///
+/// See MotiveEngine::Counters().
+struct MotiveCounterReport {
+  /// The type of Motivator driven by the processor. `*type` is its name.
+  MotivatorType type;
+
+  /// Work done since the processor was created.
+  MotiveProcessorCounters totals;
+
+  /// Work done between the previous two calls to AdvanceFrame(), including
+  /// any targets set between those frames. Only valid when frame counters
+  /// are enabled with MotiveEngine::EnableFrameCounters().
+  MotiveProcessorCounters frame;
+};
+
+/// @class MotiveSpikeReport
+/// @brief What happened in a frame where a processor's AdvanceFrame() took
+///        longer than the spike watchdog's threshold.
+///
+/// See MotiveEngine::EnableSpikeWatchdog().
+struct MotiveSpikeReport {
+  MotiveSpikeReport()
+      : type(nullptr),
+        frame(0),
+        seconds(0.0),
+        threshold_seconds(0.0),
+        num_indices(0) {}
+
+  /// Return the report as a single line of JSON, suitable for logging.
+  std::string ToJson() const;
+
+  /// The type of Motivator driven by the slow processor. `*type` is its name.
+  MotivatorType type;
+
+  /// Number of calls to MotiveEngine::AdvanceFrame() before this one.
+  uint64_t frame;
+
+  /// Wall-clock time spent in the processor's AdvanceFrame().
+  double seconds;
+
+  /// The watchdog threshold that `seconds` exceeded.
+  double threshold_seconds;
+
+  /// Total number of indices processed, including holes.
+  MotiveIndex num_indices;
+
+  /// Work done inside the processor's AdvanceFrame(). Segment transitions,
+  /// defragment moves, and reallocations caused by defragmenting are
+  /// reported here.
+  MotiveProcessorCounters advance_frame;
+
+  /// Work done since the previous call to MotiveEngine::AdvanceFrame(),
+  /// including `advance_frame`. Motivators initialized, blends started, and
+  /// targets set by the game between frames are reported here.
+  MotiveProcessorCounters frame_work;
+};
+
 /// @class MotiveEngine
 /// @brief Hold and update all animation data.
 ///
@@ -62,6 +123,65 @@ class MotiveEngine {
   ///                   the x-axis.
   void AdvanceFrame(MotiveTime delta_time);
 
+  /// Gather the counters of every processor, in the order that they are
+  /// updated. Cheap enough to call every frame, so that telemetry can
+  /// correlate slow frames with animation activity.
+  void Counters(std::vector<MotiveCounterReport>* reports) const;
+
+  /// Sum of the counters of every processor.
+  MotiveProcessorCounters TotalCounters() const;
+
+  /// When enabled, AdvanceFrame() records the work done by each processor
+  /// since the previous frame. Reported in MotiveCounterReport::frame.
+  void EnableFrameCounters(bool enable);
+  bool frame_counters_enabled() const { return frame_counters_enabled_; }
+
+  /// When enabled, processors that evaluate splines precompute the segment
+  /// after each spline's current one, spread over the frames before it's
+  /// needed. Segment transitions then swap in the precomputed segment,
+  /// instead of decoding spline nodes that are often not in the cache.
+  /// Applies to every spline Motivator in this engine, including the ones
+  /// that drive rigs and matrices. Results are identical either way.
+  /// Disabled by default, since it costs an extra cubic per spline index,
+  /// and the precomputation is wasted on segments that a blend or a new
+  /// target replaces. Hits are counted in
+  /// MotiveProcessorCounters::look_ahead_hits.
+  void EnableLookAhead(bool enable);
+  bool look_ahead_enabled() const { return look_ahead_enabled_; }
+
+  /// When enabled, every processor periodically reorders its Motivators so
+  /// that ones sharing data, such as spline Motivators that play the same
+  /// spline, have neighboring indices. Applies to processors created before
+  /// and after the call. See MotiveProcessor::set_sort_indices().
+  /// Disabled by default, since the sort moves data.
+  void EnableIndexSorting(bool enable);
+  bool index_sorting_enabled() const { return index_sorting_enabled_; }
+
+  /// Sum of the heap memory held by every processor. To see the memory held
+  /// by a single processor, call MotiveProcessor::MemoryUsage() on it.
+  /// Animation data, such as an AnimTable, is owned by the caller, so it's
+  /// not included.
+  MotiveMemoryUsage MemoryUsage() const;
+
+  /// Called with a MotiveSpikeReport for every processor that was slow.
+  typedef void SpikeCallback(const MotiveSpikeReport& report,
+                             void* user_data);
+
+  /// Opt-in watchdog for intermittent hitches. When a processor's
+  /// AdvanceFrame() takes longer than `threshold_seconds`, `callback` is
+  /// called at the end of MotiveEngine::AdvanceFrame() with a report of the
+  /// work the processor did that frame. Costs two clock reads and two
+  /// counter snapshots per processor, per frame.
+  /// @param threshold_seconds Wall-clock time above which a processor's
+  ///                          AdvanceFrame() is considered a spike.
+  /// @param callback Receives the reports. Usually logs them, with
+  ///                 MotiveSpikeReport::ToJson(), to telemetry.
+  /// @param user_data Passed through to `callback`.
+  void EnableSpikeWatchdog(double threshold_seconds, SpikeCallback* callback,
+                           void* user_data);
+  void DisableSpikeWatchdog() { spike_callback_ = nullptr; }
+  bool spike_watchdog_enabled() const { return spike_callback_ != nullptr; }
+
   /// @private For internal use only.
   MotiveProcessor* Processor(MotivatorType type);
 
@@ -83,6 +203,29 @@ class MotiveEngine {
   /// Current version of the Motive Animation System.
   const MotiveVersion* version_;
 
+  /// If true, record per-frame counters in AdvanceFrame().
+  bool frame_counters_enabled_;
+
+  /// If true, processors are told to look ahead. See EnableLookAhead().
+  bool look_ahead_enabled_;
+
+  /// If true, processors sort their indices. See EnableIndexSorting().
+  bool index_sorting_enabled_;
+
+  /// Number of calls to AdvanceFrame(). Used to identify spikes.
+  uint64_t frame_;
+
+  /// Spike watchdog settings. The watchdog is disabled when `spike_callback_`
+  /// is nullptr.
+  double spike_threshold_seconds_;
+  SpikeCallback* spike_callback_;
+  void* spike_user_data_;
+
+  /// Spikes detected in the current frame. Reported once every processor has
+  /// updated, so that the reports can include the whole frame's work.
+  /// Kept between frames to avoid reallocating.
+  std::vector<MotiveSpikeReport> spikes_;
+
   /// ProcessorMap from the MotivatorType to the factory that creates the
   /// MotiveProcessor. We only create an MotiveProcessor when one is needed.
   static FunctionMap function_map_;
@@ -15,9 +15,13 @@
 #ifndef MOTIVE_IO_FLATBUFFERS_H_
 #define MOTIVE_IO_FLATBUFFERS_H_
 
+#include "flatbuffers/flatbuffers.h"
+
 namespace motive {
 
 class AnimTable;
+class CompactSpline;
+struct CompactSplineFb;
 class MatrixAnim;
 struct MatrixAnimFb;
 class OvershootInit;
@@ -48,6 +52,13 @@ void MatrixAnimFromFlatBuffers(const MatrixAnimFb& params, bool repeat,
 /// Convert from FlatBuffer params to Motive MatrixAnim.
 void RigAnimFromFlatBuffers(const RigAnimFb& params, RigAnim* anim);
 
+/// Convert from Motive CompactSpline to FlatBuffer, the inverse of the spline
+/// loading in MatrixAnimFromFlatBuffers(). If `packed` is true, the nodes are
+/// written in the packed format, unless that would be larger.
+flatbuffers::Offset<CompactSplineFb> CompactSplineToFlatBuffers(
+    const CompactSpline& spline, bool packed,
+    flatbuffers::FlatBufferBuilder& fbb);
+
 }  // namespace motive
 
 #endif  // MOTIVE_IO_FLATBUFFERS_H_
@@ -16,10 +16,35 @@
 #define MOTIVE_MATH_BULK_SPLINE_EVALUATOR_H_
 
 #include "motive/math/compact_spline.h"
+#include "motive/util/memory_usage.h"
+#include "motive/math/float.h"
 #include "motive/util/optimizations.h"
 
 namespace motive {
 
+/// True if BulkSplineEvaluator's half-precision mode is compiled in. The mode
+/// is only a win when the conversions are single F16C instructions, so it is
+/// only compiled in when MOTIVE_F16C is defined, by the motive_f16c CMake
+/// option. Same as ProcessorOptimizationAvailable(kF16cOptimizations).
+bool HalfPrecisionAvailable();
+
+/// Half-precision mode used by BulkSplineEvaluators when they are created.
+/// Initially false. See BulkSplineEvaluator::set_half_precision().
+bool DefaultHalfPrecision();
+
+/// Change the half-precision mode of BulkSplineEvaluators created from now on.
+/// Like SetDefaultProcessorOptimization(), call this before creating a
+/// MotiveEngine's Motivators. Not thread safe.
+void SetDefaultHalfPrecision(bool half_precision);
+
+/// Output caching mode used by BulkSplineEvaluators when they are created.
+/// Initially false. See BulkSplineEvaluator::set_cache_outputs().
+bool DefaultCacheOutputs();
+
+/// Change the output caching mode of BulkSplineEvaluators created from now on.
+/// Call this before creating a MotiveEngine's Motivators. Not thread safe.
+void SetDefaultCacheOutputs(bool cache_outputs);
+
 /// @class BulkSplineEvaluator
 /// @brief Traverse through a set of splines in a performant way.
 ///
@@ -38,10 +63,18 @@ class BulkSplineEvaluator {
  public:
   typedef int Index;
 
-  // TODO: Call BestProcessorOptimization() to initialize `optimizations_`.
-  BulkSplineEvaluator() : optimization_(kNoOptimizations) {
-    // Avoid "private member variable unused" warning on OSX.
-    (void)optimization_;
+  BulkSplineEvaluator()
+      : num_segment_transitions_(0),
+        num_blends_(0),
+        num_look_ahead_hits_(0),
+        look_ahead_cursor_(0),
+        look_ahead_(false),
+        half_precision_(false),
+        cache_outputs_(false),
+        optimization_(DefaultProcessorOptimization()) {
+    set_half_precision(DefaultHalfPrecision() ||
+                       optimization_ == kF16cOptimizations);
+    set_cache_outputs(DefaultCacheOutputs());
   }
 
   /// Return the number of indices currently allocated. Each index is one
@@ -121,6 +154,13 @@ class BulkSplineEvaluator {
     return NormalizeY(index, ys_[index]);
   }
 
+  /// Return the current y values for the `count` splines starting at `index`,
+  /// normalized to be within their valid y_ranges.
+  /// `out` is an array of length `count`.
+  void NormalizedYs(const Index index, const Index count, float* out) const {
+    Range::NormalizeCloseValues(&y_ranges_[index], &ys_[index], count, out);
+  }
+
   /// Return the current y value for splines, from index onward.
   /// Since this is the most commonly called function, we keep it fast by
   /// returning a pointer to the pre-calculated array. Note that we don't
@@ -135,9 +175,14 @@ class BulkSplineEvaluator {
 
   /// Return the slopes for the `count` splines starting at `index`.
   /// `out` is an array of length `count`.
-  /// TODO OPT: Write assembly versions of this function.
   void Derivatives(const Index index, const Index count, float* out) const {
     assert(Valid(index) && Valid(index + count - 1));
+    if (cache_outputs_) {
+      for (Index i = 0; i < count; ++i) {
+        out[i] = PlaybackRate(index + i) * derivatives_[index + i];
+      }
+      return;
+    }
     for (Index i = 0; i < count; ++i) {
       out[i] = Derivative(index + i);
     }
@@ -153,17 +198,20 @@ class BulkSplineEvaluator {
   /// Return the slopes for the `count` splines starting at `index`, ignoring
   /// the playback rate.
   /// `out` is an array of length `count`.
-  /// TODO OPT: Write assembly versions of this function.
   void DerivativesWithoutPlayback(const Index index, Index count,
                                   float* out) const {
     assert(Valid(index) && Valid(index + count - 1));
+    if (cache_outputs_) {
+      memcpy(out, &derivatives_[index], count * sizeof(out[0]));
+      return;
+    }
     for (Index i = 0; i < count; ++i) {
       out[i] = DerivativeWithoutPlayback(index + i);
     }
   }
 
   /// Return the current playback rate of the spline at `index`.
-  float PlaybackRate(const Index index) const { return sources_[index].rate; }
+  float PlaybackRate(const Index index) const { return rates_[index]; }
 
   /// Return the spline that is currently being traversed at `index`.
   const CompactSpline* SourceSpline(const Index index) const {
@@ -190,9 +238,14 @@ class BulkSplineEvaluator {
   /// Return y-value at the end of the spline.
   float EndY(const Index index) const { return sources_[index].spline->EndY(); }
 
-  /// TODO OPT: Write assembly versions of this function.
+  /// Return the y-values at the end of the `count` splines starting at
+  /// `index`. `out` is an array of length `count`.
   void EndYs(const Index index, const Index count, float* out) const {
     assert(Valid(index) && Valid(index + count - 1));
+    if (cache_outputs_) {
+      memcpy(out, &end_ys_[index], count * sizeof(out[0]));
+      return;
+    }
     for (Index i = 0; i < count; ++i) {
       out[i] = EndY(index + i);
     }
@@ -203,9 +256,16 @@ class BulkSplineEvaluator {
     return PlaybackRate(index) * sources_[index].spline->EndDerivative();
   }
 
-  /// TODO OPT: Write assembly versions of this function.
+  /// Return the slopes at the end of the `count` splines starting at `index`.
+  /// `out` is an array of length `count`.
   void EndDerivatives(const Index index, const Index count, float* out) const {
     assert(Valid(index) && Valid(index + count - 1));
+    if (cache_outputs_) {
+      for (Index i = 0; i < count; ++i) {
+        out[i] = PlaybackRate(index + i) * end_derivatives_[index + i];
+      }
+      return;
+    }
     for (Index i = 0; i < count; ++i) {
       out[i] = EndDerivative(index + i);
     }
@@ -225,19 +285,25 @@ class BulkSplineEvaluator {
     return NormalizeY(index, EndY(index) - Y(index));
   }
 
-  /// TODO OPT: Write assembly versions of this function.
   void YDifferencesToEnd(const Index index, const Index count,
                          float* out) const {
     assert(Valid(index) && Valid(index + count - 1));
-    for (Index i = 0; i < count; ++i) {
-      out[i] = YDifferenceToEnd(index + i);
+    if (cache_outputs_) {
+      for (Index i = 0; i < count; ++i) {
+        out[i] = end_ys_[index + i] - ys_[index + i];
+      }
+    } else {
+      for (Index i = 0; i < count; ++i) {
+        out[i] = EndY(index + i) - Y(index + i);
+      }
     }
+    Range::NormalizeCloseValues(&y_ranges_[index], out, count, out);
   }
 
   /// Apply modular arithmetic to ensure that `y` is within the valid y_range.
   float NormalizeY(const Index index, const float y) const {
-    const YRange& r = y_ranges_[index];
-    return r.modular_range.Valid() ? r.modular_range.NormalizeCloseValue(y) : y;
+    const Range& r = y_ranges_[index];
+    return r.Valid() ? r.NormalizeCloseValue(y) : y;
   }
 
   /// Helper function to calculate the next y-value in a series of y-values
@@ -246,11 +312,11 @@ class BulkSplineEvaluator {
   /// one.
   float NextY(const Index index, const float current_y, const float target_y,
               const ModularDirection direction) const {
-    const YRange& r = y_ranges_[index];
-    if (!r.modular_range.Valid()) return target_y;
+    const Range& r = y_ranges_[index];
+    if (!r.Valid()) return target_y;
 
     /// Calculate the difference from the current-y value for `direction`.
-    const float diff = r.modular_range.ModDiff(current_y, target_y, direction);
+    const float diff = r.ModDiff(current_y, target_y, direction);
     return current_y + diff;
   }
 
@@ -258,18 +324,120 @@ class BulkSplineEvaluator {
   /// used for types such as angles, which are equivalent modulo 2pi
   /// (e.g. -pi and +pi represent the same angle).
   bool ModularArithmetic(const Index index) const {
-    return y_ranges_[index].modular_range.Valid() != 0;
+    return y_ranges_[index].Valid() != 0;
   }
 
   /// The modular range for values that use ModularArithmetic(). Note that Y()
   /// can be outside of this range. However, we always normalize to this range
   /// before blending to a new spline.
   const Range& ModularRange(const Index index) const {
-    return y_ranges_[index].modular_range;
+    return y_ranges_[index];
+  }
+
+  /// Total number of times AdvanceFrame() has moved an index onto the next
+  /// segment of its spline. Each transition reinitializes a cubic, which is
+  /// much more expensive than evaluating one.
+  uint64_t NumSegmentTransitions() const { return num_segment_transitions_; }
+
+  /// Total number of calls to BlendToSpline().
+  uint64_t NumBlends() const { return num_blends_; }
+
+  /// Kernels used by AdvanceFrame(). Initialized to
+  /// DefaultProcessorOptimization(). Every optimization produces the same
+  /// results, to within floating point tolerances, except that
+  /// kF16cOptimizations also turns on half-precision mode. Switching to another
+  /// optimization leaves half-precision mode as it is.
+  ProcessorOptimization optimization() const { return optimization_; }
+  void set_optimization(ProcessorOptimization optimization) {
+    assert(ProcessorOptimizationAvailable(optimization));
+    optimization_ = optimization;
+    if (optimization == kF16cOptimizations) set_half_precision(true);
   }
 
+  /// Total number of segment transitions that used a segment precomputed by
+  /// PrecomputeNextSegments(), instead of initializing a new cubic.
+  uint64_t NumLookAheadHits() const { return num_look_ahead_hits_; }
+
+  /// When enabled, each index can hold the cubic for the segment after its
+  /// current one. A segment transition then swaps in the precomputed cubic
+  /// instead of decoding spline nodes, which are often not in the cache.
+  /// Precomputed segments are only created by PrecomputeNextSegments().
+  /// Disabled by default, since it costs an extra cubic per index.
+  bool look_ahead() const { return look_ahead_; }
+  void set_look_ahead(bool look_ahead);
+
+  /// Precompute the next segment for up to `max_count` indices that don't
+  /// have one, and return the number precomputed. Call this in frames with
+  /// spare time, to move the work of segment transitions out of the frames
+  /// in which they happen. Indices are visited round-robin, so repeated calls
+  /// with a small `max_count` eventually cover every index.
+  /// Only valid when look_ahead() is true.
+  Index PrecomputeNextSegments(Index max_count);
+
+  /// When enabled, the end of the current segment, which every index reads
+  /// every frame to advance x, is stored as a half-precision float instead
+  /// of a float. This reduces the memory read to advance x from 12 bytes per
+  /// index (x, rate, and segment end) to 10, and the per-index arrays by
+  /// 2 bytes per index.
+  /// Ignored unless HalfPrecisionAvailable(), in which case the mode stays
+  /// disabled.
+  ///
+  /// Accuracy limits:
+  ///   - Segment ends are rounded down, by less than 2^-10 of their length.
+  ///     So a segment is never evaluated past its end, but the next segment
+  ///     may be initialized a little early. When that happens, the current
+  ///     segment is initialized again, so the result is unchanged, except
+  ///     that blends end up to 2^-10 of their length early.
+  ///   - Segments, and blends, must be at most kHalfMax (65504) long. Longer
+  ///     ones assert. Without asserts their ends are clamped to kHalfMax, so
+  ///     past that point they are initialized again every frame, and blends
+  ///     end early.
+  /// Playback rates, cubic coefficients, and x values remain full precision,
+  /// since half precision is not enough for any of them. A rounded rate
+  /// would make x drift further from the spline every frame. Disabling the
+  /// mode keeps the rounded segment ends.
+  bool half_precision() const { return half_precision_; }
+  void set_half_precision(bool half_precision);
+
+  /// When enabled, AdvanceFrame() also calculates the derivative of every
+  /// index, in the same pass that calculates Y(), and the end value and
+  /// end derivative of each spline are stored when the spline is set.
+  /// Derivatives(), DerivativesWithoutPlayback(), EndYs(), EndDerivatives(),
+  /// and YDifferencesToEnd() then read these arrays instead of evaluating
+  /// cubics and following spline pointers, at the cost of 12 bytes per index
+  /// and slightly more work in AdvanceFrame().
+  /// Worthwhile when velocities are read for most indices every frame.
+  /// Results are identical with and without caching.
+  bool cache_outputs() const { return cache_outputs_; }
+  void set_cache_outputs(bool cache_outputs);
+
+  /// Heap memory held by the per-index arrays. The splines being evaluated
+  /// are not owned by this class, so they're not counted.
+  MotiveMemoryUsage MemoryUsage() const;
+
  private:
   void InitCubic(const Index index, const float start_x);
+  void InitSegment(const Index index, const float start_x);
+  void InitSegmentCubic(const Index index);
+  void SetRate(const Index index, const float rate) { rates_[index] = rate; }
+  void SetCubicXEnd(const Index index, const float x_end) {
+    if (half_precision_) {
+      assert(x_end <= HalfToFloat(kHalfMax) ||
+             x_end == std::numeric_limits<float>::infinity());
+      half_x_ends_[index] = HalfFromFloatRoundDown(x_end);
+    } else {
+      cubic_x_ends_[index] = x_end;
+    }
+  }
+  void CacheEndValues(const Index index) {
+    if (cache_outputs_) {
+      const CompactSpline* spline = sources_[index].spline;
+      end_ys_[index] = spline->EndY();
+      end_derivatives_[index] = spline->EndDerivative();
+    }
+  }
+  bool PrecomputeNextSegment(const Index index);
+  bool SwapInNextSegment(const Index index);
   float SplineStartX(const Index index) const {
     return sources_[index].spline->StartX();
   }
@@ -278,10 +446,17 @@ class BulkSplineEvaluator {
     assert(s.spline != nullptr);
     return s.spline->NodeX(s.x_index);
   }
+  struct BlendLookup;
+  void LookUpBlend(const CompactSpline& spline, const SplinePlayback& playback,
+                   BlendLookup* lookup) const;
   CubicInit CalculateBlendInit(const Index index, const CompactSpline& spline,
-                               const SplinePlayback& playback) const;
+                               const SplinePlayback& playback,
+                               const BlendLookup& lookup) const;
   void BlendToSpline(const Index index, const CompactSpline& spline,
-                     const SplinePlayback& playback);
+                     const SplinePlayback& playback,
+                     const BlendLookup& lookup);
+  // Sets the source and looks up the segment, but leaves the cubic to
+  // InitSegmentCubic().
   void JumpToSpline(const Index index, const CompactSpline& spline,
                     const SplinePlayback& playback);
 
@@ -291,34 +466,28 @@ class BulkSplineEvaluator {
   size_t UpdateCubicXs(const float delta_x, Index* indices_to_init);
   size_t UpdateCubicXs_TwoSteps(const float delta_x, Index* indices_to_init);
   size_t UpdateCubicXs_OneStep(const float delta_x, Index* indices_to_init);
+  size_t UpdateCubicXs_Half(const float delta_x, Index* indices_to_init);
   void EvaluateIndex(const Index index);
+  void EvaluateIndices(const Index index, const Index count);
   void EvaluateCubics();
   void EvaluateCubics_C();
+  void EvaluateCubicsAndDerivatives_C();
 
   struct Source {
     Source()
-        : rate(1.0f),
-          y_offset(0.0f),
+        : y_offset(0.0f),
           y_scale(1.0f),
           spline(nullptr),
           x_index(kInvalidSplineIndex),
           repeat(false) {}
 
-    Source(float rate, float y_offset, float y_scale)
-        : rate(rate),
-          y_offset(y_offset),
+    Source(float y_offset, float y_scale)
+        : y_offset(y_offset),
           y_scale(y_scale),
           spline(nullptr),
           x_index(kInvalidSplineIndex),
           repeat(false) {}
 
-    /// Speed at which time flows, relative to the spline's authored rate.
-    ///     0   ==> paused
-    ///     0.5 ==> half speed (slow motion)
-    ///     1   ==> authored speed
-    ///     2   ==> double speed (fast forward)
-    float rate;
-
     /// Offset that we add to spline to shift it along the y-axis.
     float y_offset;
 
@@ -339,19 +508,63 @@ class BulkSplineEvaluator {
     bool repeat;
   };
 
-  struct YRange {
-    /// If using modular arithmetic, hold the min and max extents of the
-    /// modular range. Modular ranges are used for things like angles,
-    /// which wrap around from -pi to +pi.
-    /// By default, invalid. If invalid, do not use modular arithmetic.
-    Range modular_range;
+  /// Segments of a new spline found by the first pass of SetSplines(), for
+  /// its second pass. See LookUpBlend().
+  struct BlendLookup {
+    BlendLookup()
+        : start_x(0.0f),
+          end_x(0.0f),
+          start_index(kInvalidSplineIndex),
+          end_index(kInvalidSplineIndex),
+          blend(false) {}
+
+    /// x where the blend starts and ends, wrapped if the spline repeats.
+    float start_x;
+    float end_x;
+
+    /// Segments containing `start_x` and `end_x`.
+    CompactSplineIndex start_index;
+    CompactSplineIndex end_index;
+
+    /// False if the index jumps to the new spline instead of blending. The
+    /// other fields are then unused.
+    bool blend;
+  };
+
+  /// The segment after the current one, for look-ahead mode.
+  struct NextSegment {
+    NextSegment()
+        : start_x(0.0f),
+          width_x(0.0f),
+          start_grain(0),
+          end_grain(0),
+          x_index(kInvalidSplineIndex) {}
+
+    /// Cubic for the segment, already scaled and shifted by the Source's
+    /// y_scale and y_offset.
+    CubicCurve cubic;
+
+    /// x-range of the segment, as returned by CompactSpline::RangeX().
+    float start_x;
+    float width_x;
+
+    /// x-range of the segment in quantized units. The segment is used only if
+    /// the quantized x is in [start_grain, end_grain), which is exactly when
+    /// CompactSpline::IndexForX() would return `x_index`.
+    int start_grain;
+    int end_grain;
+
+    /// Index of the segment in Source::spline. If not Source::x_index + 1,
+    /// the segment has not been precomputed.
+    CompactSplineIndex x_index;
   };
 
   // Data is organized in struct-of-arrays format to match the algorithm`s
   // consumption of the data.
   // - The algorithm that updates x values, and detects when we must transition
-  //   to the next segment of the spline looks only at data in `cubic_xs_` and
-  //   `cubic_x_ends_`.
+  //   to the next segment of the spline looks only at data in `rates_`,
+  //   `cubic_xs_`, and `cubic_x_ends_`.
+  // - `sources_` is touched only when a segment ends or a new spline is set.
   // - The algorithm that updates `ys_` looks only at the data in `cubic_xs_`,
   //   `cubics_`, and `y_ranges_`. It writes to `ys_`.
   // These vectors grow when SetNumIndices() is called, but they never shrink.
@@ -362,15 +575,28 @@ class BulkSplineEvaluator {
   /// Source spline nodes and our current index into these splines.
   std::vector<Source> sources_;
 
-  /// Define the valid output values. We can clamp to a range, or wrap around to
-  /// a range using modular arithmetic (two modes of operation).
-  std::vector<YRange> y_ranges_;
+  /// If using modular arithmetic, hold the min and max extents of the
+  /// modular range. Modular ranges are used for things like angles,
+  /// which wrap around from -pi to +pi.
+  /// By default, invalid. If invalid, do not use modular arithmetic.
+  /// Kept as a plain array of Range so that it can be passed directly to
+  /// Range::NormalizeCloseValues().
+  std::vector<Range> y_ranges_;
+
+  /// Speed at which time flows, relative to the spline's authored rate.
+  ///     0   ==> paused
+  ///     0.5 ==> half speed (slow motion)
+  ///     1   ==> authored speed
+  ///     2   ==> double speed (fast forward)
+  /// Kept out of `sources_` since it's read for every index every frame.
+  std::vector<float> rates_;
 
   /// The current `x` value at which `cubics_` are evaluated.
   ///   ys_[i] = cubics_[i].Evaluate(cubic_xs_[i])
   std::vector<float> cubic_xs_;
 
   /// The last valid x value in `cubics_`.
+  /// Empty in half-precision mode, when `half_x_ends_` is used instead.
   std::vector<float> cubic_x_ends_;
 
   /// Currently active segment of sources_.spline.
@@ -385,6 +611,42 @@ class BulkSplineEvaluator {
   /// Stratch buffer used for internal calculations.
   std::vector<Index> scratch_;
 
+  /// Scratch buffer used by SetSplines(). Grows to the largest `count`.
+  std::vector<BlendLookup> blend_lookups_;
+
+  /// Half-precision replacement for `cubic_x_ends_`, rounded down, read by
+  /// UpdateCubicXs_Half(). Empty unless half_precision_ is true.
+  std::vector<uint16_t> half_x_ends_;
+
+  /// Cached outputs. Empty unless cache_outputs_ is true.
+  /// `derivatives_` and `end_derivatives_` do not include the playback rate,
+  /// so they remain valid when the rate changes.
+  std::vector<float> derivatives_;
+  std::vector<float> end_ys_;
+  std::vector<float> end_derivatives_;
+
+  /// Precomputed next segments. Empty unless look_ahead_ is true.
+  std::vector<NextSegment> next_segments_;
+
+  /// Running totals, reported by NumSegmentTransitions() and NumBlends().
+  uint64_t num_segment_transitions_;
+  uint64_t num_blends_;
+  uint64_t num_look_ahead_hits_;
+
+  /// Index at which the next call to PrecomputeNextSegments() starts.
+  Index look_ahead_cursor_;
+
+  /// True if next_segments_ is maintained. See set_look_ahead().
+  bool look_ahead_;
+
+  /// True if half_x_ends_ is used instead of cubic_x_ends_.
+  /// See set_half_precision().
+  bool half_precision_;
+
+  /// True if derivatives_, end_ys_, and end_derivatives_ are maintained and
+  /// used. See set_cache_outputs().
+  bool cache_outputs_;
+
   /// Call the specified optimized functions, when available, instead of the
   /// plain C++ functions. Note that we must perform this check at runtime,
   /// not compile time: some platforms may or may not support all the
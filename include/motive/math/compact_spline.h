@@ -79,20 +79,36 @@ class CompactSpline {
   static const CompactSplineIndex kDefaultMaxNodes = 7;
 
   CompactSpline()
-      : x_granularity_(0.0f), num_nodes_(0), max_nodes_(kDefaultMaxNodes) {}
+      : x_granularity_(0.0f),
+        num_nodes_(0),
+        max_nodes_(kDefaultMaxNodes),
+        max_x_lookup_cells_(0),
+        x_lookup_shift_(kNoXLookup),
+        packed_(0) {}
   CompactSpline(const Range& y_range, const float x_granularity)
-      : max_nodes_(kDefaultMaxNodes) {
+      : max_nodes_(kDefaultMaxNodes), max_x_lookup_cells_(0), packed_(0) {
     Init(y_range, x_granularity);
   }
-  CompactSpline(const CompactSpline& rhs) : max_nodes_(kDefaultMaxNodes) {
+  CompactSpline(const CompactSpline& rhs)
+      : max_nodes_(kDefaultMaxNodes), max_x_lookup_cells_(0), packed_(0) {
     *this = rhs;
   }
+  /// The x lookup grid of `rhs` is not copied. Call InitXLookup() again if
+  /// this spline has room for one. If `rhs` is packed, its nodes are unpacked
+  /// into this spline.
   CompactSpline& operator=(const CompactSpline& rhs) {
-    assert(rhs.num_nodes_ <= max_nodes_);
+    assert(rhs.num_nodes_ <= max_nodes_ && !packed_);
     y_range_ = rhs.y_range_;
     x_granularity_ = rhs.x_granularity_;
     num_nodes_ = rhs.num_nodes_;
-    memcpy(nodes_, rhs.nodes_, rhs.num_nodes_ * sizeof(nodes_[0]));
+    ClearXLookup();
+    if (rhs.packed_) {
+      for (CompactSplineIndex i = 0; i < num_nodes_; ++i) {
+        nodes_[i] = rhs.Node(i);
+      }
+    } else {
+      memcpy(nodes_, rhs.nodes_, rhs.num_nodes_ * sizeof(nodes_[0]));
+    }
     return *this;
   }
 
@@ -115,9 +131,11 @@ class CompactSpline {
   ///                      x_granularity near 33 / 50. For ease of debugging,
   ///                      an x_granularity of 0.5 or 1 is probably best.
   void Init(const Range& y_range, const float x_granularity) {
+    assert(!packed_);
     num_nodes_ = 0;
     y_range_ = y_range;
     x_granularity_ = x_granularity;
+    ClearXLookup();
   }
 
   /// Initialize the CompactSpline and add curve in the `nodes` array.
@@ -150,6 +168,13 @@ class CompactSpline {
   void AddNode(const float x, const float y, const float derivative,
                const CompactSplineAddMethod method = kEnsureCubicWellBehaved);
 
+  /// Add `num_nodes` nodes to the end of the spline. Same as calling AddNode()
+  /// on each node in turn, but when `method` is kEnsureCubicWellBehaved, the
+  /// segments are checked for uniform curvature, and their mid-nodes are
+  /// calculated, in bulk.
+  void AddNodes(const UncompressedNode* nodes, size_t num_nodes,
+                const CompactSplineAddMethod method = kEnsureCubicWellBehaved);
+
   /// Add values without converting them. Useful when initializing from
   /// precalculated data.
   void AddNodeVerbatim(const CompactSplineXGrain x, const CompactSplineYRung y,
@@ -201,13 +226,51 @@ class CompactSpline {
   }
 
   /// Remove all nodes from the spline.
-  void Clear() { num_nodes_ = 0; }
+  void Clear() {
+    num_nodes_ = 0;
+    ClearXLookup();
+  }
+
+  /// Build a grid of uniform x intervals, each holding the index of the
+  /// segment at the start of its interval, so that IndexForX() can find
+  /// any x in constant time instead of with a binary search. Useful for
+  /// long splines that are often seeked at random, for example when blending
+  /// between animations. Short splines are searched quickly anyway.
+  ///
+  /// The grid is stored after the nodes, so the spline must have been created
+  /// with room for it. See the `max_x_lookup_cells` parameter of Create().
+  /// Packed splines have no room for a grid.
+  ///
+  /// Call after all nodes have been added. Adding nodes, or calling Init() or
+  /// Clear(), removes the grid.
+  void InitXLookup();
+
+  /// Stop using the grid built by InitXLookup().
+  void ClearXLookup() { x_lookup_shift_ = kNoXLookup; }
+
+  /// Return true if InitXLookup() has been called, and the grid is in use.
+  bool HasXLookup() const { return x_lookup_shift_ != kNoXLookup; }
+
+  /// Maximum number of cells in the x lookup grid. Zero unless the spline was
+  /// created with room for a grid.
+  CompactSplineIndex max_x_lookup_cells() const { return max_x_lookup_cells_; }
+
+  /// Return a good value for the `max_x_lookup_cells` parameter of Create(),
+  /// for a spline of `max_nodes` nodes. Gives about one segment per cell.
+  static CompactSplineIndex RecommendXLookupCells(
+      CompactSplineIndex max_nodes) {
+    return max_nodes < 2 ? 1 : static_cast<CompactSplineIndex>(max_nodes - 1);
+  }
 
   /// Returns the memory occupied by this spline.
-  size_t Size() const { return Size(max_nodes_); }
+  size_t Size() const {
+    return packed_ ? PackedSize(packed_data_size())
+                   : Size(max_nodes_, max_x_lookup_cells_);
+  }
 
   /// Use on an array of splines created by CreateArrayInPlace().
-  /// Returns the next spline in the array.
+  /// Returns the next spline in the array. Packed splines vary in size, so
+  /// can't be held in an array.
   CompactSpline* Next() { return NextAtIdx(1); }
   const CompactSpline* Next() const { return NextAtIdx(1); }
 
@@ -235,6 +298,8 @@ class CompactSpline {
   /// @param guess_index Best guess at what the index for `x` will be.
   ///                    Often the caller will be traversing from low to high x,
   ///                    so a good guess is the index after the current index.
+  ///                    The few segments after `guess_index` are also checked
+  ///                    before searching, so the guess can be a little behind.
   ///                    If you have no idea, set to 0.
   CompactSplineIndex IndexForX(const float x,
                                const CompactSplineIndex guess_index) const;
@@ -254,7 +319,7 @@ class CompactSpline {
   // First and last x, y, and derivatives in the spline.
   float StartX() const { return Front().X(x_granularity_); }
   float StartY() const { return Front().Y(y_range_); }
-  float StartDerivative() const { return nodes_[0].Derivative(); }
+  float StartDerivative() const { return Front().Derivative(); }
 
   float EndX() const { return Back().X(x_granularity_); }
   float EndY() const { return Back().Y(y_range_); }
@@ -262,8 +327,7 @@ class CompactSpline {
   float NodeX(const CompactSplineIndex index) const;
   float NodeY(const CompactSplineIndex index) const;
   float NodeDerivative(const CompactSplineIndex index) const {
-    assert(index < num_nodes_);
-    return nodes_[index].Derivative();
+    return Node(index).Derivative();
   }
   float LengthX() const { return EndX() - StartX(); }
   Range RangeX() const { return Range(StartX(), EndX()); }
@@ -311,8 +375,22 @@ class CompactSpline {
   CompactSplineIndex num_nodes() const { return num_nodes_; }
   CompactSplineIndex max_nodes() const { return max_nodes_; }
 
+  /// Return the node at `index`, unpacking it if necessary.
+  detail::CompactSplineNode Node(const CompactSplineIndex index) const {
+    assert(index < num_nodes_);
+    return packed_ ? PackedNode(index) : nodes_[index];
+  }
+
+  /// Return true if the nodes are stored in the packed format. See
+  /// CreatePacked().
+  bool packed() const { return packed_ != 0; }
+
   /// Return const versions of internal values. For serialization.
-  const detail::CompactSplineNode* nodes() const { return nodes_; }
+  /// nodes() is only valid for splines that are not packed.
+  const detail::CompactSplineNode* nodes() const {
+    assert(!packed_);
+    return nodes_;
+  }
   const Range& y_range() const { return y_range_; }
   float x_granularity() const { return x_granularity_; }
 
@@ -321,19 +399,26 @@ class CompactSpline {
   ///                  can hold. Memory is allocated so that these nodes are
   ///                  held contiguously in memory with the rest of the
   ///                  class.
-  static CompactSpline* Create(CompactSplineIndex max_nodes) {
-    uint8_t* buffer = new uint8_t[Size(max_nodes)];
-    return CreateInPlace(max_nodes, buffer);
+  /// @param max_x_lookup_cells Room for an x lookup grid of this many cells,
+  ///                           after the nodes. See InitXLookup(). Each cell
+  ///                           adds sizeof(CompactSplineIndex) bytes.
+  static CompactSpline* Create(CompactSplineIndex max_nodes,
+                               CompactSplineIndex max_x_lookup_cells = 0) {
+    uint8_t* buffer = new uint8_t[Size(max_nodes, max_x_lookup_cells)];
+    return CreateInPlace(max_nodes, buffer, max_x_lookup_cells);
   }
 
   /// Create a CompactSpline in the memory provided by `buffer`.
-  /// @param buffer chunk of memory of size CompactSpline::Size(max_nodes)
+  /// @param buffer chunk of memory of size
+  ///               CompactSpline::Size(max_nodes, max_x_lookup_cells)
   ///
   /// Useful for creating small splines on the stack.
-  static CompactSpline* CreateInPlace(CompactSplineIndex max_nodes,
-                                      void* buffer) {
+  static CompactSpline* CreateInPlace(
+      CompactSplineIndex max_nodes, void* buffer,
+      CompactSplineIndex max_x_lookup_cells = 0) {
     CompactSpline* spline = new (buffer) CompactSpline();
     spline->max_nodes_ = max_nodes;
+    spline->max_x_lookup_cells_ = max_x_lookup_cells;
     return spline;
   }
 
@@ -398,9 +483,56 @@ class CompactSpline {
     return spline;
   }
 
+  /// Allocate memory using global `new`, and fill it with the nodes of
+  /// `source`, packed into as few bits as possible.
+  ///
+  /// Each node is normally stored in 48 bits. In the packed format, every
+  /// node of a spline uses the same number of bits, but that number is chosen
+  /// per spline:
+  ///   - x is stored as the difference from evenly spaced x's, so evenly
+  ///     spaced nodes need no bits for x at all.
+  ///   - y is stored relative to the lowest y, in as many bits as the
+  ///     spline's range of y's needs.
+  ///   - angles are stored relative to the lowest angle, or as indices into
+  ///     a table of the spline's distinct angles, whichever is smaller.
+  ///
+  /// Packing is lossless: the nodes of the packed spline are identical to
+  /// those of `source`, so it evaluates identically. Nodes are unpacked when
+  /// they are needed, for instance when a BulkSplineEvaluator reaches a new
+  /// segment. Packed splines are read-only.
+  static CompactSpline* CreatePacked(const CompactSpline& source) {
+    uint8_t* buffer = new uint8_t[PackedSize(source)];
+    return CreatePackedInPlace(source, buffer);
+  }
+
+  /// Same as CreatePacked(), but uses the memory provided by `buffer`.
+  /// @param buffer chunk of memory of size CompactSpline::PackedSize(source).
+  static CompactSpline* CreatePackedInPlace(const CompactSpline& source,
+                                            void* buffer);
+
+  /// Allocate memory using global `new`, and copy in packed data, as returned
+  /// by packed_data() and packed_data_size(). Useful for deserialization.
+  static CompactSpline* CreateFromPackedData(const Range& y_range,
+                                             float x_granularity,
+                                             CompactSplineIndex num_nodes,
+                                             const uint8_t* data,
+                                             size_t data_size);
+
+  /// Returns the size, in bytes, of a packed copy of `source`. Small splines
+  /// may be larger when packed, since the packed format has a header.
+  static size_t PackedSize(const CompactSpline& source);
+
+  /// The packed representation of the nodes. For serialization.
+  /// Only valid for packed splines.
+  const uint8_t* packed_data() const {
+    assert(packed_);
+    return reinterpret_cast<const uint8_t*>(nodes_);
+  }
+  size_t packed_data_size() const;
+
   /// Deallocate the splines memory using global `delete`.
   /// Be sure to call this for every spline returned from @ref Create(),
-  /// @ref CreateFromNodes(), @ref CreateFromSpline().
+  /// @ref CreateFromNodes(), @ref CreateFromSpline(), @ref CreatePacked().
   static void Destroy(CompactSpline* spline) {
     if (spline == nullptr) return;
     // By design, spline does not have a destructor.
@@ -448,18 +580,20 @@ class CompactSpline {
   }
 
   /// Returns the size, in bytes, of a CompactSpline class with `max_nodes`
-  /// nodes.
+  /// nodes, and room for an x lookup grid of `max_x_lookup_cells` cells.
   ///
   /// This function is useful when you want to provide your own memory buffer
   /// for splines, and then pass that buffer into CreateInPlace(). Your memory
   /// buffer must be at least Size().
-  static size_t Size(CompactSplineIndex max_nodes) {
+  static size_t Size(CompactSplineIndex max_nodes,
+                     CompactSplineIndex max_x_lookup_cells = 0) {
     // Total size of the class must be rounded up to the nearest alignment
     // so that arrays of the class are properly aligned.
     // Largest type in the class is a float.
     const size_t kAlignMask = sizeof(float) - 1;
-    const size_t size =
-        kBaseSize + max_nodes * sizeof(detail::CompactSplineNode);
+    const size_t size = kBaseSize +
+                        max_nodes * sizeof(detail::CompactSplineNode) +
+                        max_x_lookup_cells * sizeof(CompactSplineIndex);
     const size_t aligned = (size + kAlignMask) & ~kAlignMask;
     return aligned;
   }
@@ -525,13 +659,85 @@ class CompactSpline {
            reinterpret_cast<float*>(ys));
   }
 
+  /// Output arrays for ParallelBulkYs(). Sample `p` of spline `s` is written
+  /// to `ys[p * point_stride + s * spline_stride]`, and likewise for
+  /// `derivatives`. Either array may be null.
+  /// The default strides are zero; set them before use. For the layout of
+  /// BulkYs(), use point_stride = num_splines and spline_stride = 1.
+  struct BulkYsOutput {
+    BulkYsOutput()
+        : ys(nullptr), derivatives(nullptr), point_stride(0), spline_stride(0) {}
+    float* ys;
+    float* derivatives;
+    size_t point_stride;
+    size_t spline_stride;
+  };
+
+  /// Same samples as BulkYs(), but evaluated on `num_threads` threads, one of
+  /// which is the calling thread. If `num_threads` is 0, use one thread per
+  /// core. Intended for tools that sample many splines at high rates.
+  ///
+  /// Threads are only used when Motive is compiled with MOTIVE_THREADS
+  /// defined, by the motive_threads CMake option. Otherwise, all the work is
+  /// done on the calling thread. To use your own threads instead, call
+  /// BulkYsBlocks() from each of them.
+  ///
+  /// The work is split into blocks of splines and of points. Each block
+  /// starts evaluating at its first point, so results do not depend on
+  /// `num_threads`, but may differ from BulkYs() by floating point rounding
+  /// in x after the first block of points.
+  static void ParallelBulkYs(const CompactSpline* const splines,
+                             const size_t num_splines, const float start_x,
+                             const float delta_x, const size_t num_points,
+                             const BulkYsOutput& out,
+                             unsigned int num_threads = 0);
+
+  /// Number of blocks that the work of ParallelBulkYs() is split into.
+  static size_t NumBulkYsBlocks(const size_t num_splines,
+                                const size_t num_points);
+
+  /// Evaluate blocks `first_block`, `first_block + block_step`,
+  /// `first_block + 2 * block_step`, etc. of ParallelBulkYs(). To spread the
+  /// work over N threads, call with `first_block` = 0 to N - 1 on each thread,
+  /// and `block_step` = N. Blocks write to separate outputs, so calls need no
+  /// synchronization.
+  static void BulkYsBlocks(const CompactSpline* const splines,
+                           const size_t num_splines, const float start_x,
+                           const float delta_x, const size_t num_points,
+                           const BulkYsOutput& out, const size_t first_block,
+                           const size_t block_step);
+
  private:
   static const size_t kBaseSize;
 
+  /// Value of `x_lookup_shift_` when the x lookup grid is not in use.
+  static const uint8_t kNoXLookup = 0xFF;
+
+  /// Append `new_node`, preceded by `mid_node` if it is non-null. The x of
+  /// `mid_node` is relative to the current last node.
+  void AddNodeWithMidNode(const detail::CompactSplineNode& new_node,
+                          const UncompressedNode* mid_node);
+
   /// All other AddNode() functions end up calling this one.
   void AddNodeVerbatim(const detail::CompactSplineNode& node) {
-    assert(num_nodes_ < max_nodes_);
+    assert(num_nodes_ < max_nodes_ && !packed_);
     nodes_[num_nodes_++] = node;
+    ClearXLookup();
+  }
+
+  /// Size of a packed spline whose packed data is `data_size` bytes.
+  static size_t PackedSize(size_t data_size);
+
+  /// Unpack the node at `index`. Only valid for packed splines.
+  detail::CompactSplineNode PackedNode(const CompactSplineIndex index) const;
+
+  /// Unpack only the x of the node at `index`. Only valid for packed splines.
+  CompactSplineXGrain PackedX(const CompactSplineIndex index) const;
+
+  /// Quantized x of the node at `index`. Faster than Node(index).x() for
+  /// packed splines.
+  CompactSplineXGrain NodeXGrain(const CompactSplineIndex index) const {
+    return packed_ ? PackedX(index) : nodes_[index].x();
   }
 
   /// Return true iff `x` is between the the nodes at `index` and `index` + 1.
@@ -542,6 +748,18 @@ class CompactSpline {
   CompactSplineIndex BinarySearchIndexForX(
       const CompactSplineXGrain compact_x) const;
 
+  /// The x lookup grid is stored immediately after the `nodes_` array.
+  CompactSplineIndex* XLookupCells() {
+    return reinterpret_cast<CompactSplineIndex*>(nodes_ + max_nodes_);
+  }
+  const CompactSplineIndex* XLookupCells() const {
+    return reinterpret_cast<const CompactSplineIndex*>(nodes_ + max_nodes_);
+  }
+
+  /// Same result as BinarySearchIndexForX(), but found by scanning forward
+  /// from the grid cell that holds `compact_x`. Requires HasXLookup().
+  CompactSplineIndex LookupIndexForX(const CompactSplineXGrain compact_x) const;
+
   /// Return e.x - s.x, converted from quantized to external units.
   float WidthX(const detail::CompactSplineNode& s,
                const detail::CompactSplineNode& e) const {
@@ -552,14 +770,14 @@ class CompactSpline {
   CubicInit CreateCubicInit(const detail::CompactSplineNode& s,
                             const detail::CompactSplineNode& e) const;
 
-  const detail::CompactSplineNode& Front() const {
+  detail::CompactSplineNode Front() const {
     assert(num_nodes_ > 0);
-    return nodes_[0];
+    return Node(0);
   }
 
-  const detail::CompactSplineNode& Back() const {
+  detail::CompactSplineNode Back() const {
     assert(num_nodes_ > 0);
-    return nodes_[num_nodes_ - 1];
+    return Node(num_nodes_ - 1);
   }
 
   /// Extreme values for y. See comments on Init() for details.
@@ -575,6 +793,18 @@ class CompactSpline {
   /// `kDefaultMaxNodes` if CreateInPlace() was called.
   CompactSplineIndex max_nodes_;
 
+  /// Length of the x lookup grid array, which follows the `nodes_` array.
+  /// See InitXLookup().
+  CompactSplineIndex max_x_lookup_cells_;
+
+  /// log2 of the width of a cell in the x lookup grid, in quantized x units,
+  /// or kNoXLookup if the grid is not in use.
+  uint8_t x_lookup_shift_;
+
+  /// Non-zero if `nodes_` holds packed data instead of an array of nodes.
+  /// See CreatePacked().
+  uint8_t packed_;
+
   /// Array of key points (x, y, derivative) that describe the curve.
   /// The curve is interpolated smoothly between these key points.
   /// Key points are stored in quantized form, and converted back to world
@@ -582,6 +812,8 @@ class CompactSpline {
   /// Note: This array can be longer or shorter than kDefaultMaxNodes if
   ///       the class was created with CreateInPlace(). The actual length of
   ///       this array is stored in max_nodes_.
+  /// Note: If `packed_`, this memory holds the packed data instead, and its
+  ///       length in bytes is packed_data_size().
   detail::CompactSplineNode nodes_[kDefaultMaxNodes];
 };
 
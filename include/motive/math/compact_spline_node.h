@@ -16,6 +16,7 @@
 #define MOTIVE_MATH_COMPACT_SPLINE_NODE_H_
 
 #include "motive/common.h"
+#include "motive/math/angle.h"
 #include "motive/math/curve.h"
 
 namespace motive {
@@ -88,7 +89,7 @@ class CompactSplineNode {
     return static_cast<float>(x_) * x_granularity;
   }
   float Y(const Range& y_range) const { return y_range.Lerp(YPercent()); }
-  float Derivative() const { return tan(Angle()); }
+  float Derivative() const { return TanOfAngle(angle_); }
 
   // Get the quantized values. Useful for serializing a series of nodes.
   CompactSplineXGrain x() const { return x_; }
@@ -126,14 +127,61 @@ class CompactSplineNode {
   }
 
   static CompactSplineAngle CompactDerivative(const float derivative) {
-    const float angle_radians = atan(derivative);
-    const CompactSplineAngle angle =
-        static_cast<CompactSplineAngle>(angle_radians / kAngleScale);
-    return angle;
+    const float angle_radians = Atan(derivative);
+
+    // atan(+-infinity) is a quarter turn, whose tangent is infinite. Clamp to
+    // the steepest finite slopes, in both directions.
+    const int angle = std::max(
+        std::min(static_cast<int>(angle_radians / kAngleScale),
+                 kQuarterTurn - 1),
+        1 - kQuarterTurn);
+    return static_cast<CompactSplineAngle>(angle);
+  }
+
+  // tan() of a quantized angle. The tangent is sin(a) / cos(a), where
+  // cos(a) = sin(quarter turn - a). Both sines are evaluated by polynomial
+  // from the exact integer angles, so the relative error stays below 3e-7
+  // even near +-90 degrees, far below the error from quantizing the angle.
+  static float TanOfAngle(const CompactSplineAngle angle) {
+    const int magnitude = angle < 0 ? -angle : angle;
+
+    // Avoid dividing by zero at -90 degrees. Clamp to the next angle in.
+    const int complement = std::max(kQuarterTurn - magnitude, 1);
+    const float tangent =
+        Sin(static_cast<float>(magnitude) * kAngleScale) /
+        Sin(static_cast<float>(complement) * kAngleScale);
+    return angle < 0 ? -tangent : tangent;
+  }
+
+  // atan(), accurate to about 2e-7 radians. That's much less than one
+  // CompactSplineAngle, so the quantized angle only differs from atan()'s,
+  // by one, when the angle lands almost exactly on a quantization boundary.
+  static float Atan(const float x) {
+    // Polynomial from Abramowitz and Stegun 4.4.49, valid for [0, 1]. Use
+    // atan(x) = pi/2 - atan(1/x) for x > 1.
+    const float magnitude = fabsf(x);
+    const bool invert = magnitude > 1.0f;
+    const float t = invert ? 1.0f / magnitude : magnitude;
+    const float t2 = t * t;
+    float p = 0.0028662257f;
+    p = p * t2 - 0.0161657367f;
+    p = p * t2 + 0.0429096138f;
+    p = p * t2 - 0.0752896400f;
+    p = p * t2 + 0.1065626393f;
+    p = p * t2 - 0.1420889944f;
+    p = p * t2 + 0.1999355085f;
+    p = p * t2 - 0.3333314528f;
+    const float atan_t = t * (p * t2 + 1.0f);
+    const float angle = invert ? kHalfPi - atan_t : atan_t;
+    return x < 0.0f ? -angle : angle;
   }
 
   static CompactSplineXGrain MaxX() { return kMaxX; }
 
+  // Number of CompactSplineAngle units in 90 degrees. Only angles in
+  // [-kQuarterTurn, kQuarterTurn] are used.
+  static const int kQuarterTurn = 0x4000;
+
  private:
   static const CompactSplineXGrain kMaxX;
   static const CompactSplineYRung kMaxY;
@@ -142,7 +190,18 @@ class CompactSplineNode {
   static const float kAngleScale;
 
   float YPercent() const { return static_cast<float>(y_) * kYScale; }
-  float Angle() const { return static_cast<float>(angle_) * kAngleScale; }
+
+  // sin() for x in [0, pi/2], as a Taylor polynomial. Relative error is less
+  // than 1e-7 over that range.
+  static float Sin(const float x) {
+    const float x2 = x * x;
+    return x * (1.0f +
+                x2 * (-1.0f / 6.0f +
+                      x2 * (1.0f / 120.0f +
+                            x2 * (-1.0f / 5040.0f +
+                                  x2 * (1.0f / 362880.0f +
+                                        x2 * (-1.0f / 39916800.0f))))));
+  }
 
   // Position along x-axis. Multiplied by x-granularity to get actual domain.
   // 0 ==> start. kMaxX ==> end, we should never reach the end. If we do,
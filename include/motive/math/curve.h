@@ -266,6 +266,26 @@ class QuadraticCurve {
     RangesMatchingSign(x_limits, -1.0f, matching);
   }
 
+  /// Bulk version of Roots(). Calculates the roots of `count` quadratics,
+  /// writing the roots of `curves[i]` into `roots[i]`. With SSE2 kernels (see
+  /// UseSse2Kernels()), several curves are solved at once. Results match
+  /// Roots(), including the sign of zero roots, unless the compiler fuses
+  /// multiplies and adds.
+  static void BulkRoots(const QuadraticCurve* curves, size_t count,
+                        RootsArray* roots);
+
+  /// Bulk version of RootsInRange(). All curves share `x_limits`.
+  static void BulkRootsInRange(const QuadraticCurve* curves, size_t count,
+                               const Range& x_limits, RootsArray* roots);
+
+  /// Bulk version of RangesMatchingSign(). `curves[i]` is compared against
+  /// the sign of `signs[i]`, and its ranges are written to `matching[i]`.
+  /// All curves share `x_limits`.
+  static void BulkRangesMatchingSign(const QuadraticCurve* curves,
+                                     const float* signs, size_t count,
+                                     const Range& x_limits,
+                                     RangeArray* matching);
+
   /// Returns the coefficient for x-to-the-ith -power.
   float Coeff(int i) const { return c_[i]; }
 
@@ -312,6 +332,9 @@ class QuadraticCurve {
   size_t RootsInRange(const Range& x_limits, float roots[2]) const;
   size_t RangesMatchingSign(const Range& x_limits, const float sign,
                             Range matching[2]) const;
+  size_t RangesMatchingSignWithRoots(const Range& x_limits, const float sign,
+                                     const float roots[2], size_t num_roots,
+                                     Range matching[2]) const;
 
   float c_[kNumCoeff];  /// c_[2] * x^2  +  c_[1] * x  +  c_[0]
 };
@@ -417,6 +440,13 @@ class CubicCurve {
   /// all of x_limits.
   bool UniformCurvature(const Range& x_limits) const;
 
+  /// Bulk version of UniformCurvature(). Sets `uniform[i]` to
+  /// `curves[i].UniformCurvature(x_limits[i])`. With SSE2 kernels (see
+  /// UseSse2Kernels()), several curves are checked at once.
+  static void BulkUniformCurvature(const CubicCurve* curves,
+                                   const Range* x_limits, size_t count,
+                                   bool* uniform);
+
   /// Return a value below which floating point precision is unreliable.
   /// If we're testing for zero, for instance, we should test against this
   /// Epsilon().
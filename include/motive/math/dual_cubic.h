@@ -32,6 +32,25 @@ namespace motive {
 void CalculateDualCubicMidNode(const CubicInit &init, float *x, float *y,
                                float *derivative);
 
+/// Bulk version of CalculateDualCubicMidNode(). Calculates the mid node of
+/// each of the `count` cubics in `inits`, and writes it to `xs[i]`, `ys[i]`,
+/// and `derivatives[i]`. The quadratics that determine where each mid node is
+/// valid are solved together, in SIMD lanes when available. Results match
+/// CalculateDualCubicMidNode() exactly.
+void CalculateDualCubicMidNodes(const CubicInit *inits, size_t count,
+                                float *xs, float *ys, float *derivatives);
+
+/// Check whether the cubics created by `inits` are well behaved, that is,
+/// have uniform curvature over x = 0 ~ width_x. Well behaved cubics do not
+/// need a mid node.
+///
+/// @param inits Array of length `count`.
+/// @param count Number of cubics to check.
+/// @param well_behaved Output array of length `count`.
+/// @return The number of cubics that are not well behaved.
+size_t ClassifyWellBehavedCubics(const CubicInit *inits, size_t count,
+                                 bool *well_behaved);
+
 }  // namespace motive
 
 #endif  // MOTIVE_MATH_DUAL_CUBIC_H_
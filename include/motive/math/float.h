@@ -15,9 +15,14 @@
 #ifndef MOTIVE_MATH_FLOAT_H_
 #define MOTIVE_MATH_FLOAT_H_
 
+#include <stdint.h>
 #include <algorithm>
 #include <cmath>
 
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif  // defined(__F16C__)
+
 #include "motive/math/range.h"
 
 namespace motive {
@@ -104,6 +109,118 @@ inline float MaxPowerOf2Scale(const float f, const int max_exponent) {
       std::min(kMaxFloatExponent, max_exponent - ExponentAsInt(f)));
 }
 
+// Internal constants for half-precision (IEEE 754 binary16) floats, which
+// have 1 sign bit, 5 exponent bits, and 10 mantissa bits.
+static const uint16_t kHalfSignBit = 0x8000;
+static const uint16_t kHalfInfinity = 0x7C00;
+static const uint16_t kHalfMax = 0x7BFF;  // 65504
+static const uint16_t kHalfQuietNaN = 0x7E00;
+static const int kHalfExponentOffset = 15;
+static const int kHalfMantissaBits = 10;
+
+/// @brief Convert a half-precision float, stored in a uint16_t, to a float.
+/// Every half-precision value is exactly representable as a float.
+inline float HalfToFloat(const uint16_t h) {
+#if defined(__F16C__)
+  return _cvtsh_ss(h);
+#else
+  const uint32_t sign = static_cast<uint32_t>(h & kHalfSignBit) << 16;
+  const uint32_t exponent = (h >> kHalfMantissaBits) & 0x1F;
+  const uint32_t mantissa = h & 0x3FF;
+  IntFloatUnion u;
+  if (exponent == 0) {
+    // Zero or denormal. The value is mantissa * 2^-24.
+    u.f = static_cast<float>(mantissa) * 5.9604644775390625e-8f;
+    u.i |= sign;
+  } else if (exponent == 0x1F) {
+    // Infinity or NaN.
+    u.i = sign | (kExponentMask << kExponentShift) | (mantissa << 13);
+  } else {
+    u.i = sign |
+          ((exponent + kExponentOffset - kHalfExponentOffset)
+           << kExponentShift) |
+          (mantissa << 13);
+  }
+  return u.f;
+#endif  // defined(__F16C__)
+}
+
+// Used internally by HalfFromFloat() and HalfFromFloatRoundDown().
+// Software version of the F16C float to half conversion.
+inline uint16_t HalfFromFloatSoftware(const float f, const bool round_down) {
+  IntFloatUnion u;
+  u.f = f;
+  const uint16_t sign = static_cast<uint16_t>((u.i >> 16) & kHalfSignBit);
+  const uint32_t abs_bits = u.i & 0x7FFFFFFF;
+  const bool negative = sign != 0;
+
+  // Infinity and NaN.
+  if (abs_bits >= (kExponentMask << kExponentShift)) {
+    return sign | (abs_bits == (kExponentMask << kExponentShift)
+                       ? kHalfInfinity
+                       : kHalfQuietNaN);
+  }
+  if (abs_bits == 0) return sign;
+
+  // Too big for a half. Rounding down saturates positive values at the
+  // largest half, and takes negative values to -infinity.
+  int exponent = static_cast<int>(abs_bits >> kExponentShift);
+  const int half_exponent = exponent - kExponentOffset + kHalfExponentOffset;
+  if (half_exponent >= 0x1F) {
+    return round_down && !negative ? kHalfMax : (sign | kHalfInfinity);
+  }
+
+  // Float mantissa with the implicit leading bit, if there is one.
+  uint32_t mantissa = abs_bits & 0x7FFFFF;
+  if (exponent == 0) {
+    exponent = 1;
+  } else {
+    mantissa |= 0x800000;
+  }
+
+  // Halves with exponent < 1 are denormal, and lose more mantissa bits.
+  const int shift =
+      std::min(31, kExponentShift - kHalfMantissaBits +
+                       std::max(0, 1 - half_exponent));
+  uint32_t result = mantissa >> shift;
+  if (half_exponent >= 1) {
+    result = (static_cast<uint32_t>(half_exponent) << kHalfMantissaBits) +
+             (result & 0x3FF);
+  }
+
+  // Round the magnitude. An increment that carries out of the mantissa bumps
+  // the exponent, which is the correct result.
+  const uint32_t remainder = mantissa & ((1u << shift) - 1);
+  const uint32_t halfway = 1u << (shift - 1);
+  if (round_down) {
+    if (negative && remainder != 0) result++;
+  } else if (remainder > halfway || (remainder == halfway && (result & 1))) {
+    result++;
+  }
+  return sign | static_cast<uint16_t>(result);
+}
+
+/// @brief Convert `f` to the nearest half-precision float, with ties rounded
+/// to even. Values too big for a half become infinity. Results are identical
+/// with and without F16C instructions.
+inline uint16_t HalfFromFloat(const float f) {
+#if defined(__F16C__)
+  return static_cast<uint16_t>(_cvtss_sh(f, _MM_FROUND_TO_NEAREST_INT));
+#else
+  return HalfFromFloatSoftware(f, false);
+#endif  // defined(__F16C__)
+}
+
+/// @brief Convert `f` to the largest half-precision float that is <= `f`.
+/// Useful when a value must not be overestimated, such as a limit.
+inline uint16_t HalfFromFloatRoundDown(const float f) {
+#if defined(__F16C__)
+  return static_cast<uint16_t>(_cvtss_sh(f, _MM_FROUND_TO_NEG_INF));
+#else
+  return HalfFromFloatSoftware(f, true);
+#endif  // defined(__F16C__)
+}
+
 /// @brief If the absolute value of `x` is less than epsilon, return zero.
 ///        Otherwise, return `x`.
 /// This function is useful in situations where the mathematical result depends
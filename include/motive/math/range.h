@@ -18,6 +18,10 @@
 #include <vector>
 #include "mathfu/utilities.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif  // defined(__SSE2__)
+
 namespace motive {
 
 // If using modular arithmetic, there are two paths to the target: one that
@@ -168,6 +172,33 @@ class RangeT {
     return normalized;
   }
 
+  /// Normalize the `count` values in `xs` and write them to `out`. Same
+  /// result as NormalizeCloseValue() on each value, but the loop has no
+  /// branches, so it runs on four values at a time when compiled with SSE2.
+  /// Values more than one Length() outside the range may differ from
+  /// NormalizeCloseValue() by floating point rounding.
+  /// `xs` and `out` may be the same array.
+  void NormalizeCloseValues(const T* xs, size_t count, T* out) const {
+    NormalizeValuesInRanges(this, 0, xs, count, out);
+  }
+
+  /// Same as above, but `xs[i]` is normalized into `ranges[i]`. Values whose
+  /// range has no length (including invalid ranges) are copied unchanged,
+  /// so a mix of modular and non-modular channels can be processed at once.
+  static void NormalizeCloseValues(const RangeT* ranges, const T* xs,
+                                   size_t count, T* out) {
+    NormalizeValuesInRanges(ranges, 1, xs, count, out);
+  }
+
+  /// Branch-free normalization of a single value. See NormalizeCloseValues().
+  T NormalizeWithoutBranches(const T x) const {
+    const T length = Length();
+    const T units = ceil((x - end_) / length);
+    const T close = x - units * length;
+    const T normalized = close + ModularAdjustment(close);
+    return length > static_cast<T>(0) ? normalized : x;
+  }
+
   /// Returns:
   ///   Length() if `x` is below the valid range
   ///   -Length() if `x` is above the valid range
@@ -501,10 +532,93 @@ class RangeT {
   }
 
  private:
+  // Normalize `xs[i]` into `ranges[i * range_stride]`. A `range_stride` of 0
+  // uses the same range for every value.
+  static void NormalizeValuesInRanges(const RangeT* ranges, size_t range_stride,
+                                      const T* xs, size_t count, T* out) {
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = ranges[i * range_stride].NormalizeWithoutBranches(xs[i]);
+    }
+  }
+
   T start_;  // Start of the range. Range is valid if start_ <= end_.
   T end_;    // End of the range. Range is inclusive of start_ and end_.
 };
 
+#if defined(__SSE2__)
+namespace detail {
+
+// Four lanes of RangeT<float>::NormalizeWithoutBranches().
+inline __m128 NormalizeWithoutBranches4(const __m128 x, const __m128 start,
+                                        const __m128 end) {
+  const __m128 length = _mm_sub_ps(end, start);
+  const __m128 units = _mm_div_ps(_mm_sub_ps(x, end), length);
+
+  // ceil(units). Clamp first so that the conversion to int32 can't overflow.
+  // Floats this large are already whole numbers, so clamping doesn't matter.
+  const __m128 kMaxUnits = _mm_set1_ps(8388608.0f);
+  const __m128 units_clamped =
+      _mm_min_ps(_mm_max_ps(units, _mm_sub_ps(_mm_setzero_ps(), kMaxUnits)),
+                 kMaxUnits);
+  const __m128 truncated =
+      _mm_cvtepi32_ps(_mm_cvttps_epi32(units_clamped));
+  const __m128 rounded_down = _mm_cmplt_ps(truncated, units_clamped);
+  const __m128 whole_units =
+      _mm_add_ps(truncated, _mm_and_ps(rounded_down, _mm_set1_ps(1.0f)));
+
+  // Subtract whole lengths, then fix up floating point error at the bounds,
+  // as in ModularAdjustment().
+  const __m128 close = _mm_sub_ps(x, _mm_mul_ps(whole_units, length));
+  const __m128 below = _mm_and_ps(_mm_cmple_ps(close, start), length);
+  const __m128 above = _mm_and_ps(_mm_cmpgt_ps(close, end), length);
+  const __m128 normalized = _mm_add_ps(close, _mm_sub_ps(below, above));
+
+  // Leave values with non-modular ranges untouched.
+  const __m128 modular = _mm_cmpgt_ps(length, _mm_setzero_ps());
+  return _mm_or_ps(_mm_and_ps(modular, normalized),
+                   _mm_andnot_ps(modular, x));
+}
+
+}  // namespace detail
+
+template <>
+inline void RangeT<float>::NormalizeValuesInRanges(const RangeT* ranges,
+                                                   size_t range_stride,
+                                                   const float* xs,
+                                                   size_t count, float* out) {
+  static_assert(sizeof(RangeT) == 2 * sizeof(float),
+                "Ranges are loaded as pairs of floats");
+  size_t i = 0;
+  if (range_stride == 0) {
+    const __m128 start = _mm_set1_ps(ranges->start_);
+    const __m128 end = _mm_set1_ps(ranges->end_);
+    for (; i + 4 <= count; i += 4) {
+      const __m128 x = _mm_loadu_ps(&xs[i]);
+      _mm_storeu_ps(&out[i],
+                    detail::NormalizeWithoutBranches4(x, start, end));
+    }
+  } else {
+    assert(range_stride == 1);
+    for (; i + 4 <= count; i += 4) {
+      // Deinterleave four (start, end) pairs.
+      const float* pairs = &ranges[i].start_;
+      const __m128 lo = _mm_loadu_ps(pairs);
+      const __m128 hi = _mm_loadu_ps(pairs + 4);
+      const __m128 start = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+      const __m128 end = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+      const __m128 x = _mm_loadu_ps(&xs[i]);
+      _mm_storeu_ps(&out[i],
+                    detail::NormalizeWithoutBranches4(x, start, end));
+    }
+  }
+
+  // Remaining values, one at a time.
+  for (; i < count; ++i) {
+    out[i] = ranges[i * range_stride].NormalizeWithoutBranches(xs[i]);
+  }
+}
+#endif  // defined(__SSE2__)
+
 /// Given two numbers, create a range that has the lower one as min,
 /// and the higher one as max.
 template <class T>
@@ -15,6 +15,7 @@
 #ifndef MOTIVE_PROCESSOR_H_
 #define MOTIVE_PROCESSOR_H_
 
+#include <stdint.h>
 #include <vector>
 
 #include "fplutil/index_allocator.h"
@@ -22,6 +23,7 @@
 #include "motive/math/compact_spline.h"
 #include "motive/math/vector_converter.h"
 #include "motive/target.h"
+#include "motive/util/memory_usage.h"
 
 namespace motive {
 
@@ -30,6 +32,71 @@ class Motivator;
 class MotiveEngine;
 class RigAnim;
 
+/// @class MotiveProcessorCounters
+/// @brief Counts of the work done by a MotiveProcessor.
+///
+/// These are cheap to maintain, so they're always available, even in release
+/// builds. Use them to correlate slow frames with animation activity.
+///
+/// `active_indices` and `holes` describe the processor's current state. All
+/// other members are running totals.
+struct MotiveProcessorCounters {
+  MotiveProcessorCounters()
+      : active_indices(0),
+        holes(0),
+        motivators_initialized(0),
+        defragment_moves(0),
+        segment_transitions(0),
+        look_ahead_hits(0),
+        blends_started(0),
+        set_target_calls(0),
+        reallocations(0) {}
+
+  /// Return the running totals accumulated since `earlier` was gathered.
+  /// The current state members are copied from `this`.
+  MotiveProcessorCounters Delta(const MotiveProcessorCounters& earlier) const;
+
+  /// Add every member of `rhs` to this. Useful for summing over processors.
+  void Add(const MotiveProcessorCounters& rhs);
+
+  /// Number of indices currently driven by Motivators.
+  MotiveIndex active_indices;
+
+  /// Number of indices that have been freed but not yet removed by
+  /// Defragment(). These are processed every frame, but do no useful work.
+  MotiveIndex holes;
+
+  /// Number of Motivators initialized to use this processor.
+  uint64_t motivators_initialized;
+
+  /// Number of indices moved by Defragment().
+  uint64_t defragment_moves;
+
+  /// Number of times a spline finished a segment and had to initialize the
+  /// next one. These are the most expensive per-index operations in a frame.
+  uint64_t segment_transitions;
+
+  /// Number of segment transitions that swapped in a segment precomputed
+  /// ahead of time, instead of initializing it in the frame of the
+  /// transition. Always zero unless look-ahead is enabled. See
+  /// MotiveEngine::EnableLookAhead().
+  uint64_t look_ahead_hits;
+
+  /// Number of curves blended from one animation to another. Counted only by
+  /// the processor that evaluates the curve, so that TotalCounters() counts
+  /// each blend once. Blending a rig or matrix counts one for every
+  /// animated channel, in the processor driving those channels.
+  uint64_t blends_started;
+
+  /// Number of indices that have been given new targets, with or without a
+  /// curve shape. Setting the target of a 3D Motivator counts as three.
+  uint64_t set_target_calls;
+
+  /// Number of times the processor's per-index arrays grew beyond their
+  /// capacity and had to be reallocated.
+  uint64_t reallocations;
+};
+
 /// @class MotiveProcessor
 /// @brief A MotiveProcessor processes *all* instances of one type of Motivator.
 ///
@@ -60,7 +127,12 @@ class MotiveProcessor {
   MotiveProcessor()
       : index_allocator_(allocator_callbacks_),
         benchmark_id_for_advance_frame_(-1),
-        benchmark_id_for_init_(-1) {
+        benchmark_id_for_init_(-1),
+        active_indices_(0),
+        max_dimensions_(0),
+        frames_since_sort_(kFramesBetweenSorts),
+        sort_indices_(false),
+        indices_changed_(false) {
     allocator_callbacks_.set_processor(this);
   }
   virtual ~MotiveProcessor();
@@ -154,10 +226,58 @@ class MotiveProcessor {
     return index_allocator_.CountForIndex(index);
   }
 
+  /// Total number of indices, including any holes that will be removed by the
+  /// next call to Defragment().
+  MotiveIndex NumAllocatedIndices() const {
+    return index_allocator_.num_indices();
+  }
+
+  /// Counts of the work done by this processor, since it was created.
+  MotiveProcessorCounters Counters() const;
+
+  /// Counts of the work done between the two most recent calls to
+  /// UpdateFrameCounters().
+  const MotiveProcessorCounters& FrameCounters() const {
+    return frame_counters_;
+  }
+
+  /// Record the work done since the last call to UpdateFrameCounters().
+  /// Called by the MotiveEngine at the end of every AdvanceFrame(), when
+  /// frame counters are enabled.
+  void UpdateFrameCounters();
+
+  /// Heap memory held by this processor, by category. Includes unused
+  /// capacity in the per-index arrays, so that you can see what Defragment()
+  /// and shrinking would recover.
+  MotiveMemoryUsage MemoryUsage() const;
+
   /// Ensure that the internal state is consistent. Call periodically when
   /// debugging problems where the internal state is corrupt.
   void VerifyInternalState() const;
 
+  /// When enabled, Defragment() also reorders the Motivators by SortKey(),
+  /// whenever Motivators have been added or removed, or have changed their
+  /// sort keys, since the last sort. For example, Motivators that play the
+  /// same spline then have neighboring indices, so they read the same spline
+  /// data one after another. To bound the cost, the sort runs at most once
+  /// every kFramesBetweenSorts calls to Defragment().
+  /// Disabled by default, since the sort moves data. Usually set for every
+  /// processor at once with MotiveEngine::EnableIndexSorting().
+  bool sort_indices() const { return sort_indices_; }
+  void set_sort_indices(bool sort_indices) {
+    sort_indices_ = sort_indices;
+    indices_changed_ = true;
+  }
+
+  /// Minimum number of calls to Defragment() between sorts.
+  static const int kFramesBetweenSorts = 16;
+
+  /// Called by the MotiveEngine to enable or disable look-ahead. Processors
+  /// that evaluate splines should precompute the segment after the current
+  /// one, a little each frame, so that segment transitions are cheaper.
+  /// Other processors can ignore it. See MotiveEngine::EnableLookAhead().
+  virtual void SetLookAhead(bool /*look_ahead*/) {}
+
   // For internal use. Called by the MotiveEngine to profile each processor.
   void RegisterBenchmarks();
   int benchmark_id_for_advance_frame() const {
@@ -201,19 +321,78 @@ class MotiveProcessor {
   /// updated. Can be called at the discretion of your MotiveProcessor,
   /// but normally called at the beginning of your
   /// MotiveProcessor::AdvanceFrame.
-  void Defragment() { index_allocator_.Defragment(); }
+  void Defragment();
+
+  /// The order of the Motivator at `index`, used when sort_indices() is
+  /// enabled. Motivators are sorted by `group`, then by `order`. Motivators
+  /// with equal keys keep their current order.
+  struct SortKey {
+    SortKey() : group(0), order(0.0f) {}
+    SortKey(uintptr_t group, float order) : group(group), order(order) {}
+    bool operator<(const SortKey& rhs) const {
+      return group < rhs.group || (group == rhs.group && order < rhs.order);
+    }
+
+    /// Motivators that share data, such as a source spline, should have the
+    /// same `group`.
+    uintptr_t group;
+
+    /// Order within the group, for example the current time along the spline.
+    float order;
+  };
+
+  /// Override to enable sorting. The default key leaves indices unsorted.
+  virtual SortKey IndexSortKey(MotiveIndex /*index*/) const {
+    return SortKey();
+  }
+
+  /// Call when the IndexSortKey() of `index` may have changed, for example
+  /// when it starts to play a different spline, so that the next sort
+  /// reorders it.
+  void IndexSortKeyChanged() { indices_changed_ = true; }
+
+  /// Derived classes should increment the relevant counters when they do
+  /// work that is counted by MotiveProcessorCounters.
+  MotiveProcessorCounters& MutableCounters() { return counters_; }
+
+  /// Override to add counts that are gathered by helper classes, such as
+  /// BulkSplineEvaluator, to the value returned by Counters().
+  virtual void GatherCounters(MotiveProcessorCounters* /*counters*/) const {}
+
+  /// Override to add the memory held by the derived class to the value
+  /// returned by MemoryUsage(). The base class reports its own arrays.
+  virtual void GatherMemoryUsage(MotiveMemoryUsage* /*usage*/) const {}
 
  private:
   typedef fplutil::IndexAllocator<MotiveIndex> MotiveIndexAllocator;
   typedef MotiveIndexAllocator::IndexRange IndexRange;
 
+  /// A Motivator's block of indices, for SortIndices().
+  struct SortBlock {
+    SortKey key;
+    MotiveIndex index;
+    MotiveDimension dimensions;
+  };
+
   /// Don't notify derived class.
   void RemoveMotivatorWithoutNotifying(MotiveIndex index);
 
+  /// Reorder the Motivators by IndexSortKey(). Called by Defragment().
+  void SortIndices();
+
+  /// Move the Motivator at `old_index` to the inactive `new_index`.
+  void MoveMotivator(MotiveIndex old_index, MotiveIndex new_index,
+                     MotiveDimension dimensions);
+
   /// Handle callbacks from IndexAllocator.
   void MoveIndexRangeBase(const IndexRange& source, MotiveIndex target);
   void SetNumIndicesBase(MotiveIndex num_indices);
 
+  /// Resize the arrays to `num_indices`. If they don't have capacity for
+  /// `num_indices + spare`, grow them to that first, so that later growth
+  /// into the spare indices doesn't reallocate them.
+  void ResizeIndices(MotiveIndex num_indices, MotiveIndex spare);
+
   /// Proxy callbacks from IndexAllocator into MotiveProcessor.
   class AllocatorCallbacks : public MotiveIndexAllocator::CallbackInterface {
    public:
@@ -254,6 +433,37 @@ class MotiveProcessor {
 
   int benchmark_id_for_advance_frame_;
   int benchmark_id_for_init_;
+
+  /// Running totals of the work done by this processor.
+  MotiveProcessorCounters counters_;
+
+  /// Value of Counters() at the last call to UpdateFrameCounters(), and the
+  /// difference from the call before that.
+  MotiveProcessorCounters previous_counters_;
+  MotiveProcessorCounters frame_counters_;
+
+  /// Number of indices currently driven by Motivators.
+  MotiveIndex active_indices_;
+
+  /// Largest number of dimensions of any Motivator initialized so far.
+  /// SortIndices() needs this many spare indices past the end of the arrays.
+  MotiveDimension max_dimensions_;
+
+  /// Calls to Defragment() since the last call to SortIndices().
+  int frames_since_sort_;
+
+  /// If true, Defragment() calls SortIndices(). See set_sort_indices().
+  bool sort_indices_;
+
+  /// Scratch buffers used by SortIndices(). Kept between sorts so that
+  /// sorting doesn't allocate once they've grown to the number of indices.
+  std::vector<SortBlock> sort_blocks_;
+  std::vector<MotiveIndex> sort_sources_;
+  std::vector<MotiveIndex> sort_group_indices_;
+
+  /// True if Motivators have been added or removed, or their sort keys have
+  /// changed, since the last sort.
+  bool indices_changed_;
 };
 
 /// @class MotiveProcessorNf
@@ -108,6 +108,11 @@ class SimpleProcessorTemplate : public MotiveProcessorNf {
     values_.resize(num_indices);
   }
 
+  virtual void GatherMemoryUsage(MotiveMemoryUsage* usage) const {
+    usage->AddVector(kMemoryIndexArrays, data_);
+    usage->AddVector(kMemoryIndexArrays, values_);
+  }
+
   const T& Data(MotiveIndex index) const {
     assert(ValidIndex(index));
     return data_[index];
@@ -15,6 +15,8 @@
 #ifndef MOTIVE_UTIL_BENCHMARK_H_
 #define MOTIVE_UTIL_BENCHMARK_H_
 
+#include <stdint.h>
+
 namespace motive {
 
 #define FPL_TOKEN_PASTE_NESTED(a, b) a##b
@@ -29,39 +31,120 @@ typedef unsigned long long BenchmarkTime;
 /// Get the current system tick count. The unit varies from system to system.
 BenchmarkTime GetBenchmarkTime();
 
+/// Convert a difference between two GetBenchmarkTime() values into seconds.
+/// Only valid after InitBenchmarks() has been called.
+double BenchmarkTimeToSeconds(BenchmarkTime time);
+
 /// Initialize the benchmark tracking system. Multiple things can be benchmarked
 /// simultaneously. Each thing has its own 'id'. We allocate storage for ids
 /// between 0~num_ids-1.
+///
+/// Samples can be recorded from any number of threads. Each thread records
+/// into its own buffers, so recording never waits on a lock.
 void InitBenchmarks(int num_ids);
 
 /// Empty all samples that have been collected with 'Benchmark'.
+/// Should not be called while other threads are recording samples.
 void ClearBenchmarks();
 
 /// Allocate storage on a tag to gather benchmark data for.
 /// Returns the `id` to be passed into the `Benchmark` constructor.
+/// Thread safe.
 int RegisterBenchmark(const char* name);
 
-/// Dump an analysis of the samples to stdout.
+/// Dump an analysis of the samples to stdout. Samples from all threads are
+/// merged. When more than one thread recorded samples for an id, a summary
+/// for each thread is output too.
+/// Should not be called while other threads are recording samples.
 void OutputBenchmarks();
 
+/// Hardware performance counters that can be sampled around every
+/// `Benchmark` scope. See EnableBenchmarkCounters().
+enum BenchmarkCounter {
+  kBenchmarkCycles,
+  kBenchmarkInstructions,
+  kBenchmarkL1DataMisses,
+  kBenchmarkLastLevelCacheMisses,
+  kBenchmarkBranchMisses,
+  kNumBenchmarkCounters
+};
+
+/// Values read from the hardware counters. The kernel may not be able to
+/// count every counter all of the time (e.g. when the PMU has fewer counters
+/// than were requested), so it also reports how long the counters were
+/// enabled and how long they were actually counting.
+struct BenchmarkCounterValues {
+  uint64_t values[kNumBenchmarkCounters];
+  uint64_t time_enabled;
+  uint64_t time_running;
+};
+
+/// Also sample hardware performance counters around every `Benchmark` scope,
+/// so that OutputBenchmarks() can report instructions per cycle, and cache
+/// and branch misses per index. This tells you whether a scope is compute
+/// bound or memory bound.
+///
+/// Uses perf_event_open() on Linux. Each scope costs two extra system calls,
+/// so enable only when you need the counters. Returns false if the counters
+/// are unavailable (e.g. on other platforms, in some virtual machines, or
+/// when restricted by /proc/sys/kernel/perf_event_paranoid). In that case,
+/// benchmarks continue to record timing only.
+bool EnableBenchmarkCounters();
+
+/// Stop sampling hardware counters. Counts already gathered are kept until
+/// ClearBenchmarks().
+void DisableBenchmarkCounters();
+
+/// Start recording a timeline of every `Benchmark` scope, in addition to the
+/// aggregate statistics. The most recent `max_events` scopes are kept in a
+/// ring buffer, so recording can be left on indefinitely. Each event holds
+/// the begin and end time of the scope and the thread it ran on.
+/// Recording is lock-free and safe to do from several threads at once.
+/// Tracing may be restarted while other threads are recording; the ring buffer
+/// is reused, never freed, so late writers cannot touch released memory.
+void StartBenchmarkTrace(int max_events);
+
+/// Stop recording the timeline. Events already recorded are kept until the
+/// next call to StartBenchmarkTrace().
+void StopBenchmarkTrace();
+
+/// Write the recorded timeline to `file_name` as Chrome trace-event JSON.
+/// Open the file in chrome://tracing or the Perfetto UI to find frame spikes.
+/// May be called while other threads are recording. Events that are being
+/// written, or are overwritten while the file is written, are skipped.
+/// Returns false if the file could not be written.
+bool OutputBenchmarkTrace(const char* file_name);
+
 /// @class Benchmark
 /// @brief Record the time for the scope of this variable.
 ///
 /// Creates a benchmark sample. We can sample several things at once. The thing
 /// we're sampling is specified by 'id'.
 /// The sample is the time between creation and destruction of the Benchmark.
+///
+/// `num_indices` is the number of indices processed in the scope. If
+/// specified, hardware counters are reported per index.
 class Benchmark {
  public:
-  explicit Benchmark(int id) : id_(id), start_time_(GetBenchmarkTime()) {}
+  explicit Benchmark(int id, int num_indices = 0);
   ~Benchmark();
  private:
   int id_;
+  int num_indices_;
+  bool counting_;
+  BenchmarkCounterValues start_counters_;
   BenchmarkTime start_time_;
 };
 
 #define FPL_BENCHMARK(name) \
-  static int FPL_UNIQUE(id) = fplbase::RegisterBenchmark(name); \
-  const fplbase::Benchmark FPL_UNIQUE(benchmark)(FPL_UNIQUE(id))
+  static int FPL_UNIQUE(id) = motive::RegisterBenchmark(name); \
+  const motive::Benchmark FPL_UNIQUE(benchmark)(FPL_UNIQUE(id))
+
+/// Like FPL_BENCHMARK, but also records the number of indices processed, so
+/// that hardware counters can be reported per index.
+#define FPL_BENCHMARK_INDICES(name, num_indices) \
+  static int FPL_UNIQUE(id) = motive::RegisterBenchmark(name); \
+  const motive::Benchmark FPL_UNIQUE(benchmark)(FPL_UNIQUE(id), num_indices)
 
 #else // not defined(BENCHMARK_MOTIVE)
 
@@ -70,12 +153,18 @@ inline void InitBenchmarks(int /*num_ids*/) {}
 inline void ClearBenchmarks() {}
 inline int RegisterBenchmark(const char* /*name*/) { return -1; }
 inline void OutputBenchmarks() {}
+inline bool EnableBenchmarkCounters() { return false; }
+inline void DisableBenchmarkCounters() {}
+inline void StartBenchmarkTrace(int /*max_events*/) {}
+inline void StopBenchmarkTrace() {}
+inline bool OutputBenchmarkTrace(const char* /*file_name*/) { return false; }
 class Benchmark {
  public:
-  explicit Benchmark(int /*id*/) {}
+  explicit Benchmark(int /*id*/, int /*num_indices*/ = 0) {}
 };
 
 #define FPL_BENCHMARK(name)
+#define FPL_BENCHMARK_INDICES(name, num_indices)
 
 #endif // not defined(BENCHMARK_MOTIVE)
 
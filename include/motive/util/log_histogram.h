@@ -0,0 +1,106 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MOTIVE_UTIL_LOG_HISTOGRAM_H_
+#define MOTIVE_UTIL_LOG_HISTOGRAM_H_
+
+#include <stdint.h>
+
+namespace motive {
+
+/// @class LogHistogram
+/// @brief Fixed-memory histogram of unsigned integer samples, with buckets
+///        whose width grows with the magnitude of the sample.
+///
+/// Samples below 2^(kMantissaBits + 1) are recorded exactly. Larger samples
+/// are recorded with a relative error of at most 2^-kMantissaBits (~1.6%).
+/// This is the same log-linear bucketing used by HDR histograms: every power
+/// of two is split into 2^kMantissaBits equally sized buckets.
+///
+/// Memory use is constant, regardless of the number of samples, so it's
+/// suitable for long soak runs. Two histograms can be merged, which allows
+/// samples to be collected separately (e.g. per-thread) and combined later.
+class LogHistogram {
+ public:
+  typedef uint64_t Value;
+  typedef uint32_t Count;
+
+  /// Number of bits of precision kept for each sample.
+  static const int kMantissaBits = 6;
+
+  /// Number of buckets for each power of two.
+  static const int kSubBuckets = 1 << kMantissaBits;
+
+  /// Total number of buckets required to hold any 64-bit value.
+  static const int kNumBuckets = (64 - kMantissaBits + 1) * kSubBuckets;
+
+  LogHistogram() { Clear(); }
+
+  /// Add a sample to the histogram.
+  void Append(Value value);
+
+  /// Add all the samples in `rhs` to this histogram.
+  void Merge(const LogHistogram& rhs);
+
+  /// Remove all samples.
+  void Clear();
+
+  /// Total number of samples appended.
+  uint64_t NumSamples() const { return num_samples_; }
+
+  /// Smallest and largest samples appended. Exact, not bucketed.
+  /// Only valid when NumSamples() > 0.
+  Value Min() const { return min_; }
+  Value Max() const { return max_; }
+
+  /// Exact mean of all the samples appended.
+  double Average() const;
+
+  /// Standard deviation of all the samples appended.
+  double StandardDeviation() const;
+
+  /// Return the value below which `percent` of the samples fall.
+  /// For example, Percentile(99.0) returns the p99 value.
+  /// The value returned is within the bucket's error of the true percentile,
+  /// and is always clamped to [Min(), Max()].
+  Value Percentile(double percent) const;
+
+  /// Bucket accessors. Useful for drawing the distribution.
+  /// Buckets are sorted by value, and cover the range
+  /// [BucketMin(i), BucketMax(i)], inclusive.
+  static int BucketIndex(Value value);
+  static Value BucketMin(int bucket);
+  static Value BucketMax(int bucket);
+  Count BucketCount(int bucket) const { return counts_[bucket]; }
+
+ private:
+  /// Number of samples in each bucket.
+  Count counts_[kNumBuckets];
+
+  /// Total number of samples. Equal to the sum of `counts_`.
+  uint64_t num_samples_;
+
+  /// Exact extremes of the samples.
+  Value min_;
+  Value max_;
+
+  /// Running sums, for the mean and standard deviation. Held as doubles so
+  /// that they won't overflow in long runs.
+  double sum_;
+  double sum_of_squares_;
+};
+
+}  // namespace motive
+
+#endif  // MOTIVE_UTIL_LOG_HISTOGRAM_H_
@@ -0,0 +1,111 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MOTIVE_UTIL_MEMORY_USAGE_H_
+#define MOTIVE_UTIL_MEMORY_USAGE_H_
+
+#include <stddef.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace motive {
+
+/// Kinds of memory reported by MotiveMemoryUsage.
+enum MemoryCategory {
+  /// Arrays with one element per index, such as the struct-of-arrays data
+  /// in the processors and the BulkSplineEvaluator.
+  kMemoryIndexArrays,
+
+  /// Blocks allocated separately for each index, such as the per-matrix and
+  /// per-rig data.
+  kMemoryIndexBlocks,
+
+  /// CompactSpline nodes, and the arrays that hold them.
+  kMemorySplines,
+
+  /// Strings used for debugging and lookups, such as bone and animation names.
+  kMemoryNames,
+
+  /// Everything else, such as bone hierarchies and matrix operation lists.
+  kMemoryOther,
+
+  kNumMemoryCategories
+};
+
+/// @class MotiveMemoryUsage
+/// @brief Heap memory owned by a Motive object, by category.
+///
+/// `allocated_bytes` is the memory actually taken from the heap.
+/// `used_bytes` is the part of that memory that holds live data. The
+/// difference is slack: vector capacity that hasn't been used yet, or
+/// splines sitting in a pool waiting to be recycled.
+///
+/// Only memory owned by the object is counted. Memory that the object
+/// references, but doesn't own (e.g. splines in an AnimTable that are played
+/// back by a processor), is reported by its owner.
+struct MotiveMemoryUsage {
+  MotiveMemoryUsage();
+
+  /// Record `used` bytes of live data, out of `allocated` bytes of heap.
+  void Add(MemoryCategory category, size_t used, size_t allocated);
+
+  /// Add every category of `rhs` to this. Useful for summing over objects.
+  void Add(const MotiveMemoryUsage& rhs);
+
+  /// Record the heap memory held by a vector, including unused capacity.
+  /// Does not count memory owned by the elements themselves.
+  template <class T>
+  void AddVector(MemoryCategory category, const std::vector<T>& v) {
+    Add(category, v.size() * sizeof(T), v.capacity() * sizeof(T));
+  }
+
+  /// Record the heap memory held by a string. Short strings are held inside
+  /// the std::string object itself, and take no heap memory.
+  void AddString(MemoryCategory category, const std::string& s);
+
+  /// Record the heap memory held by a hash map, including its bucket array.
+  /// The size of each node is an estimate, since it's implementation defined.
+  /// Does not count memory owned by the keys or values themselves.
+  template <class K, class V>
+  void AddMap(MemoryCategory category, const std::unordered_map<K, V>& m) {
+    typedef typename std::unordered_map<K, V>::value_type Value;
+    const size_t node_size = sizeof(void*) + sizeof(Value) + sizeof(size_t);
+    const size_t nodes = m.size() * node_size;
+    Add(category, nodes, nodes + m.bucket_count() * sizeof(void*));
+  }
+
+  /// Sum over all categories.
+  size_t TotalUsed() const;
+  size_t TotalAllocated() const;
+  size_t TotalSlack() const { return TotalAllocated() - TotalUsed(); }
+
+  /// Allocated memory that holds no live data, for one category.
+  size_t Slack(MemoryCategory category) const {
+    return allocated_bytes[category] - used_bytes[category];
+  }
+
+  /// Short, lower-case name of `category`. Useful for reports.
+  static const char* CategoryName(MemoryCategory category);
+
+  /// Bytes of live data in each category.
+  size_t used_bytes[kNumMemoryCategories];
+
+  /// Bytes taken from the heap in each category. Always >= `used_bytes`.
+  size_t allocated_bytes[kNumMemoryCategories];
+};
+
+}  // namespace motive
+
+#endif  // MOTIVE_UTIL_MEMORY_USAGE_H_
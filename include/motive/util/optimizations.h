@@ -19,19 +19,47 @@ namespace motive {
 
 enum ProcessorOptimization {
   kNoOptimizations,
-  kNeonOptimizations,  /// NEON is a SIMD instruction set for ARM processors
-  kSse3Optimizations,  /// SSE is a SIMD instruction set for x86 processors
-  kSsse3Optimizations  /// SSSE3 is an extension of SSE3
+  kNeonOptimizations,   /// NEON is a SIMD instruction set for ARM processors
+  kSse3Optimizations,   /// SSE is a SIMD instruction set for x86 processors
+  kSsse3Optimizations,  /// SSSE3 is an extension of SSE3
+  kSse2Optimizations,   /// SSE2 kernels for bulk range and curve math
+  kF16cOptimizations    /// kSse2Optimizations plus half-precision storage
 };
 
 /// Look at the capabilities of the CPU and return the most performant set of
 /// processor optimizations. For example, on Android, return kNeonOptimizations
-/// if the CPU supports the NEON instruction set. On x86 (once we have x86
-/// optimizations), return kSse2Optimizations if it's supported, or if it's not,
-/// return kSse2Optimizations if it's supported. If none of the processors are
-/// supported, return kNoOptimizations.
+/// if the CPU supports the NEON instruction set. On other x86 builds, return
+/// kSse2Optimizations if Motive was compiled with SSE2. If none of the
+/// processors are supported, return kNoOptimizations.
+/// Never returns kF16cOptimizations, since half precision is less accurate.
 ProcessorOptimization BestProcessorOptimization();
 
+/// Return true if Motive has been compiled with kernels for `optimization`,
+/// and the CPU can run them. kNoOptimizations is always available.
+bool ProcessorOptimizationAvailable(ProcessorOptimization optimization);
+
+/// Human-readable name of `optimization`. For example, "neon".
+const char* ProcessorOptimizationName(ProcessorOptimization optimization);
+
+/// Optimization used by BulkSplineEvaluators when they are created, and by
+/// bulk math that isn't tied to an evaluator. Initially kSse2Optimizations if
+/// it's available, otherwise kNoOptimizations. BulkSplineEvaluators created
+/// with kF16cOptimizations start in half-precision mode.
+ProcessorOptimization DefaultProcessorOptimization();
+
+/// Change the optimization used by BulkSplineEvaluators created from now on.
+/// Processors create their evaluators when they're created, so call this
+/// before creating a MotiveEngine's Motivators. Lets the same workload be run
+/// once with each kernel variant, so that their results can be compared.
+/// Not thread safe.
+void SetDefaultProcessorOptimization(ProcessorOptimization optimization);
+
+/// Return true if bulk math that isn't tied to a BulkSplineEvaluator, such as
+/// QuadraticCurve::BulkRoots(), should use
+/// its SSE2 kernels. That is, if DefaultProcessorOptimization() is
+/// kSse2Optimizations or kF16cOptimizations.
+bool UseSse2Kernels();
+
 }  // namespace motive
 
 #endif  // MOTIVE_UTIL_OPTIMIZATIONS_H_
\ No newline at end of file
@@ -60,6 +60,8 @@ MOTIVE_SRC_FILES := \
   $(MOTIVE_RELATIVE_DIR)/src/motive/processor/spring_processor.cpp \
   $(MOTIVE_RELATIVE_DIR)/src/motive/processor.cpp \
   $(MOTIVE_RELATIVE_DIR)/src/motive/util/benchmark.cpp \
+  $(MOTIVE_RELATIVE_DIR)/src/motive/util/log_histogram.cpp \
+  $(MOTIVE_RELATIVE_DIR)/src/motive/util/memory_usage.cpp \
   $(MOTIVE_RELATIVE_DIR)/src/motive/util/optimizations.cpp \
   $(MOTIVE_RELATIVE_DIR)/src/motive/version.cpp
 
@@ -83,6 +85,14 @@ ifneq ($(MOTIVE_ENABLE_ASSEMBLY),0)
   endif
 endif
 
+# Let CompactSpline::ParallelBulkYs() start threads. Off by default, like the
+# motive_threads CMake option. Bionic includes pthreads, so no extra libraries
+# are needed.
+MOTIVE_ENABLE_THREADS ?= 0
+ifneq ($(MOTIVE_ENABLE_THREADS),0)
+  MOTIVE_CFLAGS += -DMOTIVE_THREADS
+endif
+
 include $(CLEAR_VARS)
 LOCAL_MODULE := motive
 LOCAL_ARM_MODE := arm
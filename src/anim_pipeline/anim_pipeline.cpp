@@ -30,6 +30,7 @@
 #include "motive/anim.h"
 #include "motive/common.h"
 #include "motive/init.h"
+#include "motive/io/flatbuffers.h"
 #include "motive/math/angle.h"
 
 namespace motive {
@@ -169,10 +170,11 @@ typedef RangeT<BoneIndex> BoneRange;
 class FlatAnim {
  public:
   explicit FlatAnim(const Tolerances& tolerances, bool root_bones_only,
-                    Logger& log)
+                    bool packed, Logger& log)
       : cur_bone_index_(-1),
         tolerances_(tolerances),
         root_bones_only_(root_bones_only),
+        packed_(packed),
         log_(log) {}
 
   unsigned int AllocBone(const char* bone_name, int parent_bone_index) {
@@ -689,7 +691,7 @@ class FlatAnim {
 
           // Output spline MatrixOp.
           CompactSpline* s = CreateCompactSpline(*c);
-          value = CreateSplineFlatBuffer(fbb, *s).Union();
+          value = motive::CompactSplineToFlatBuffers(*s, packed_, fbb).Union();
           value_type = motive::MatrixOpValueFb_CompactSplineFb;
           CompactSpline::Destroy(s);
         }
@@ -998,19 +1000,6 @@ class FlatAnim {
     return motive::ScaleOp(op) ? 1.0f : 0.0f;
   }
 
-  static flatbuffers::Offset<motive::CompactSplineFb> CreateSplineFlatBuffer(
-      flatbuffers::FlatBufferBuilder& fbb, const CompactSpline& s) {
-    auto nodes_fb = fbb.CreateVectorOfStructs(
-        reinterpret_cast<const motive::CompactSplineNodeFb*>(s.nodes()),
-        s.num_nodes());
-
-    auto spline_fb = motive::CreateCompactSplineFb(fbb, s.y_range().start(),
-                                                   s.y_range().end(),
-                                                   s.x_granularity(), nodes_fb);
-
-    return spline_fb;
-  }
-
   static Range SplineYRange(const Channel& ch) {
     // Find extreme values for nodes.
     Range y_range(Range::Empty());
@@ -1031,13 +1020,17 @@ class FlatAnim {
     const Range y_range = SplineYRange(ch);
 
     // Construct the Spline from the node data directly.
+    std::vector<UncompressedNode> spline_nodes(nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      spline_nodes[i].x = static_cast<float>(std::max(0, nodes[i].time));
+      spline_nodes[i].y = nodes[i].val;
+      spline_nodes[i].derivative = nodes[i].derivative;
+    }
     CompactSpline* s =
         CompactSpline::Create(static_cast<CompactSplineIndex>(nodes.size()));
     s->Init(y_range, x_granularity);
-    for (auto n = nodes.begin(); n != nodes.end(); ++n) {
-      const float n_time = static_cast<float>(std::max(0, n->time));
-      s->AddNode(n_time, n->val, n->derivative, kAddWithoutModification);
-    }
+    s->AddNodes(&spline_nodes[0], spline_nodes.size(),
+                kAddWithoutModification);
 
     return s;
   }
@@ -1094,6 +1087,9 @@ class FlatAnim {
   // Each such bone gets its own animation file.
   bool root_bones_only_;
 
+  // Output splines in the packed format. See CompactSpline::CreatePacked().
+  bool packed_;
+
   // Information and warnings.
   Logger& log_;
 };
@@ -1576,6 +1572,7 @@ struct AnimPipelineArgs {
         stagger_end_times(false),
         preserve_start_time(false),
         root_bones_only(false),
+        packed(false),
         axis_system(fplutil::kUnspecifiedAxisSystem),
         distance_unit_scale(-1.0f),
         debug_time(-1) {}
@@ -1588,6 +1585,7 @@ struct AnimPipelineArgs {
   bool stagger_end_times; /// Allow each channel to end at its authored time.
   bool preserve_start_time;  /// Don't shift channels to start at time 0.
   bool root_bones_only;   /// Output bone that has path of animation only.
+  bool packed;            /// Output splines in the packed format.
   AxisSystem axis_system; /// Which axes are up, front, left.
   float distance_unit_scale; /// This number of cm is set to one unit.
   int debug_time;         /// If >0 output animation state at this time.
@@ -1602,7 +1600,8 @@ static void LogUsage(Logger* log) {
       "                     [-tt TRANSLATE_TOLERANCE]\n"
       "                     [-at DERIVATIVE_TOLERANCE] [--repeat|--norepeat]\n"
       "                     [--stagger] [--start] [-a AXES]\n"
-      "                     [-u (unit)|(scale)] [--roots] [--debug_time TIME]\n"
+      "                     [-u (unit)|(scale)] [--roots] [--packed]\n"
+      "                     [--debug_time TIME]\n"
       "                     FBX_FILE\n"
       "\n"
       "Pipeline to convert FBX animations into FlatBuffer animations.\n"
@@ -1682,6 +1681,10 @@ static void LogUsage(Logger* log) {
       "                Each mesh gets its animation file.\n"
       "                Useful for pulling just the path data from an\n"
       "                animation.\n"
+      "  --packed\n"
+      "                store spline nodes with as few bits as possible.\n"
+      "                Files and runtime memory are smaller, but nodes are\n"
+      "                unpacked every time playback reaches a new segment.\n"
       "  --debug_time TIME\n"
       "                output the local transforms for each bone in\n"
       "                the animation at TIME, in ms, and then exit.\n"
@@ -1827,6 +1830,9 @@ static bool ParseAnimPipelineArgs(int argc, char** argv, Logger& log,
     } else if (arg == "--roots" || arg == "--root_bones_only") {
       args->root_bones_only = true;
 
+    } else if (arg == "--packed") {
+      args->packed = true;
+
     } else if (arg == "--debug_time") {
       if (i + 1 < argc - 1) {
         args->debug_time = atoi(argv[i + 1]);
@@ -1876,7 +1882,8 @@ int main(int argc, char** argv) {
   }
 
   // Gather data into a format conducive to our FlatBuffer format.
-  motive::FlatAnim anim(args.tolerances, args.root_bones_only, log);
+  motive::FlatAnim anim(args.tolerances, args.root_bones_only, args.packed,
+                        log);
   pipe.GatherFlatAnim(&anim);
 
   // We want the animation to start from tick 0.
@@ -0,0 +1,97 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+#include "allocation_tracker.h"
+
+namespace motive {
+
+// Every allocation is prefixed with a header that records its size, so that
+// delete knows how many bytes are being returned. The header is padded to the
+// largest fundamental alignment, so the memory returned to the caller is
+// aligned just as well as memory returned by malloc().
+union AllocationHeader {
+  size_t size;
+  long double align_long_double;
+  long long align_long_long;
+  void* align_pointer;
+};
+
+static std::atomic<size_t> gLiveHeapBytes(0);
+static std::atomic<uint64_t> gNumHeapAllocations(0);
+
+static void* TrackedAllocate(size_t size) {
+  AllocationHeader* header =
+      static_cast<AllocationHeader*>(malloc(sizeof(AllocationHeader) + size));
+  if (header == nullptr) return nullptr;
+
+  header->size = size;
+  gLiveHeapBytes.fetch_add(size, std::memory_order_relaxed);
+  gNumHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+  return header + 1;
+}
+
+static void TrackedFree(void* ptr) {
+  if (ptr == nullptr) return;
+
+  AllocationHeader* header = static_cast<AllocationHeader*>(ptr) - 1;
+  gLiveHeapBytes.fetch_sub(header->size, std::memory_order_relaxed);
+  free(header);
+}
+
+size_t LiveHeapBytes() {
+  return gLiveHeapBytes.load(std::memory_order_relaxed);
+}
+
+uint64_t NumHeapAllocations() {
+  return gNumHeapAllocations.load(std::memory_order_relaxed);
+}
+
+}  // namespace motive
+
+// The benchmarker is built without exceptions on some platforms, so report
+// running out of memory by aborting rather than throwing std::bad_alloc.
+void* operator new(size_t size) {
+  void* ptr = motive::TrackedAllocate(size);
+  if (ptr == nullptr) abort();
+  return ptr;
+}
+
+void* operator new[](size_t size) {
+  void* ptr = motive::TrackedAllocate(size);
+  if (ptr == nullptr) abort();
+  return ptr;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return motive::TrackedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return motive::TrackedAllocate(size);
+}
+
+void operator delete(void* ptr) noexcept { motive::TrackedFree(ptr); }
+
+void operator delete[](void* ptr) noexcept { motive::TrackedFree(ptr); }
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+  motive::TrackedFree(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+  motive::TrackedFree(ptr);
+}
@@ -0,0 +1,36 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MOTIVE_BENCHMARKER_ALLOCATION_TRACKER_H_
+#define MOTIVE_BENCHMARKER_ALLOCATION_TRACKER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace motive {
+
+/// Bytes currently allocated with global operator new, and not yet deleted.
+///
+/// The benchmarker replaces the global operator new and delete so that it can
+/// check the numbers reported by MotiveEngine::MemoryUsage() against what was
+/// really taken from the heap. Only the size requested by the caller is
+/// counted, not the allocator's own overhead.
+size_t LiveHeapBytes();
+
+/// Total number of calls to global operator new since the program started.
+uint64_t NumHeapAllocations();
+
+}  // namespace motive
+
+#endif  // MOTIVE_BENCHMARKER_ALLOCATION_TRACKER_H_
@@ -0,0 +1,493 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Generates a corpus of synthetic rig animations, in the same FlatBuffers
+// formats that anim_pipeline outputs.
+//
+// Production animations can't always be shared, and anim_pipeline needs the
+// FBX SDK. This tool writes .motiveanim files and a .motivetab that load,
+// memory, and playback benchmarks can run on instead. The shape of the data is
+// set on the command line: bones, hierarchy depth, channels per bone, nodes
+// per spline, clip length, and the share of channels that are constant.
+//
+// Output depends only on the options, so the same seed always produces the
+// same bytes. Each object's skeleton, and each clip, has its own generator, so
+// adding clips or objects doesn't change the ones that already exist.
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "anim_generated.h"
+#include "anim_list_generated.h"
+#include "anim_table_generated.h"
+#include "benchmark_scenarios.h"
+#include "motive/common.h"
+#include "motive/init.h"
+#include "motive/io/flatbuffers.h"
+#include "motive/math/compact_spline.h"
+
+using motive::BenchmarkRandom;
+using motive::BoneIndex;
+using motive::CompactSpline;
+using motive::CompactSplineIndex;
+using motive::MatrixOpId;
+using motive::MatrixOperationType;
+using motive::OptionValue;
+using motive::Range;
+using motive::UncompressedNode;
+using motive::kInvalidBoneIdx;
+
+static const int kDefaultNumObjects = 1;
+static const int kDefaultNumClips = 20;
+static const int kDefaultNumBones = 64;
+static const int kDefaultMaxDepth = 12;
+static const int kDefaultNumChannels = 6;
+static const int kDefaultNumNodes = 16;
+static const int kDefaultClipLength = 2000;
+static const float kDefaultConstantPercent = 40.0f;
+
+// bone_parents are stored as bytes, and 255 means "no parent".
+static const int kMaxBones = kInvalidBoneIdx;
+
+// Chance that a bone continues the chain of the bone before it, instead of
+// branching from anywhere in the hierarchy. Long chains, like spines and
+// fingers, are common in real skeletons.
+static const float kChainProbability = 0.6f;
+
+// Nodes are spaced evenly in time, then moved by up to this fraction of the
+// spacing, so that they don't all line up.
+static const float kNodeJitter = 0.3f;
+
+// Channels are added to each bone in this order. Rotations are almost always
+// animated, translations less often, and scales rarely.
+static const MatrixOperationType kChannelPreference[] = {
+    motive::kRotateAboutZ, motive::kRotateAboutY, motive::kRotateAboutX,
+    motive::kTranslateX,   motive::kTranslateY,   motive::kTranslateZ,
+    motive::kScaleX,       motive::kScaleY,       motive::kScaleZ};
+
+// Within a bone, operations are applied in this order: translate, then
+// rotate, then scale, similar to what anim_pipeline outputs. The MatrixOpId of a
+// channel is its index here, so ids ascend within each bone, and match
+// between clips.
+static const MatrixOperationType kChannelOrder[] = {
+    motive::kTranslateX,   motive::kTranslateY,   motive::kTranslateZ,
+    motive::kRotateAboutZ, motive::kRotateAboutY, motive::kRotateAboutX,
+    motive::kScaleX,       motive::kScaleY,       motive::kScaleZ};
+
+// Options parsed from the command line.
+struct GeneratorOptions {
+  GeneratorOptions()
+      : num_objects(kDefaultNumObjects),
+        num_clips(kDefaultNumClips),
+        num_bones(kDefaultNumBones),
+        max_depth(kDefaultMaxDepth),
+        num_channels(kDefaultNumChannels),
+        num_nodes(kDefaultNumNodes),
+        clip_length(kDefaultClipLength),
+        constant_percent(kDefaultConstantPercent),
+        seed(1),
+        embed(false),
+        output_dir("."),
+        name("synthetic") {}
+
+  int num_objects;
+  int num_clips;
+  int num_bones;
+  int max_depth;
+  int num_channels;
+  int num_nodes;
+  int clip_length;
+  float constant_percent;
+  uint32_t seed;
+  bool embed;
+  std::string output_dir;
+  std::string name;
+};
+
+// One animated value of a bone. Clips animate it about `base` by up to
+// `amplitude`.
+struct SyntheticChannel {
+  MatrixOperationType op;
+  MatrixOpId id;
+  float base;
+  float amplitude;
+};
+
+// The part of an object that is shared by all of its clips.
+struct SyntheticSkeleton {
+  std::vector<BoneIndex> parents;
+  std::vector<std::vector<SyntheticChannel>> channels;
+};
+
+// Sizes of what was generated, for the summary.
+struct CorpusStats {
+  CorpusStats()
+      : num_files(0), num_bytes(0), num_ops(0), num_constant_ops(0),
+        num_nodes(0) {}
+
+  int num_files;
+  size_t num_bytes;
+  int num_ops;
+  int num_constant_ops;
+  int num_nodes;
+};
+
+static void PrintUsage(const char* program) {
+  printf(
+      "Usage: %s [options]\n"
+      "  --objects=N           Skeletons, each with its own list of clips.\n"
+      "                        Default %d.\n"
+      "  --clips=N             Clips per object. Default %d.\n"
+      "  --bones=N             Bones per skeleton, at most %d. Default %d.\n"
+      "  --depth=N             Maximum depth of the bone hierarchy.\n"
+      "                        Default %d.\n"
+      "  --channels=N          Channels per bone, from 1 to %d. Default %d.\n"
+      "  --nodes=N             Nodes in each spline. Default %d.\n"
+      "  --clip_length=N       Length of each clip, in milliseconds.\n"
+      "                        Default %d.\n"
+      "  --constant_percent=F  Percent of channels that hold a constant\n"
+      "                        value instead of a spline. Default %.0f.\n"
+      "  --seed=N              Seed. Same options ==> same output.\n"
+      "  --embed               Embed the clips in the .motivetab file,\n"
+      "                        instead of writing a .motiveanim for each.\n"
+      "  --output_dir=DIR      Directory to write into. Must exist.\n"
+      "  --name=NAME           Prefix of the output file names.\n",
+      program, kDefaultNumObjects, kDefaultNumClips, kMaxBones - 1,
+      kDefaultNumBones, kDefaultMaxDepth,
+      static_cast<int>(MOTIVE_ARRAY_SIZE(kChannelPreference)),
+      kDefaultNumChannels, kDefaultNumNodes, kDefaultClipLength,
+      kDefaultConstantPercent);
+}
+
+// Returns false if the program should exit without generating anything.
+static bool ParseOptions(int argc, char** argv, GeneratorOptions* options) {
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    const char* value = nullptr;
+    if ((value = OptionValue(arg, "objects")) != nullptr) {
+      options->num_objects = atoi(value);
+    } else if ((value = OptionValue(arg, "clips")) != nullptr) {
+      options->num_clips = atoi(value);
+    } else if ((value = OptionValue(arg, "bones")) != nullptr) {
+      options->num_bones = atoi(value);
+    } else if ((value = OptionValue(arg, "depth")) != nullptr) {
+      options->max_depth = atoi(value);
+    } else if ((value = OptionValue(arg, "channels")) != nullptr) {
+      options->num_channels = atoi(value);
+    } else if ((value = OptionValue(arg, "nodes")) != nullptr) {
+      options->num_nodes = atoi(value);
+    } else if ((value = OptionValue(arg, "clip_length")) != nullptr) {
+      options->clip_length = atoi(value);
+    } else if ((value = OptionValue(arg, "constant_percent")) != nullptr) {
+      options->constant_percent = static_cast<float>(atof(value));
+    } else if ((value = OptionValue(arg, "seed")) != nullptr) {
+      options->seed = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+    } else if ((value = OptionValue(arg, "output_dir")) != nullptr) {
+      options->output_dir = value;
+    } else if ((value = OptionValue(arg, "name")) != nullptr) {
+      options->name = value;
+    } else if (strcmp(arg, "--embed") == 0) {
+      options->embed = true;
+    } else {
+      PrintUsage(argv[0]);
+      return false;
+    }
+  }
+
+  const int max_channels = static_cast<int>(MOTIVE_ARRAY_SIZE(kChannelOrder));
+  if (options->num_objects <= 0 || options->num_clips <= 0 ||
+      options->num_bones <= 0 || options->num_bones >= kMaxBones ||
+      options->max_depth <= 0 || options->num_channels <= 0 ||
+      options->num_channels > max_channels || options->num_nodes < 2 ||
+      options->clip_length <= 0 || options->constant_percent < 0.0f ||
+      options->constant_percent > 100.0f) {
+    fprintf(stderr, "Option out of range. Run with --help for limits.\n");
+    return false;
+  }
+  return true;
+}
+
+// Combine the seed with the object and clip, so that every skeleton and clip
+// has an independent generator.
+static uint32_t MixSeed(uint32_t seed, int object, int clip) {
+  uint32_t h = seed;
+  h = (h ^ static_cast<uint32_t>(object)) * 0x9E3779B1u;
+  h = (h ^ (h >> 15) ^ static_cast<uint32_t>(clip)) * 0x85EBCA77u;
+  return h ^ (h >> 13);
+}
+
+static MatrixOpId ChannelId(MatrixOperationType op) {
+  for (size_t i = 0; i < MOTIVE_ARRAY_SIZE(kChannelOrder); ++i) {
+    if (kChannelOrder[i] == op) return static_cast<MatrixOpId>(i);
+  }
+  assert(false);
+  return motive::kInvalidMatrixOpId;
+}
+
+static bool ChannelLess(const SyntheticChannel& a, const SyntheticChannel& b) {
+  return a.id < b.id;
+}
+
+// Resting value, and range of motion, of a channel of type `op`. Distances
+// are in meters and angles in radians.
+static void InitChannel(MatrixOperationType op, BenchmarkRandom* random,
+                        SyntheticChannel* channel) {
+  channel->op = op;
+  channel->id = ChannelId(op);
+  if (motive::RotateOp(op)) {
+    channel->base = random->Float(-0.5f, 0.5f);
+    channel->amplitude = random->Float(0.05f, 0.8f);
+  } else if (motive::TranslateOp(op)) {
+    // Bones mostly extend along y.
+    channel->base = op == motive::kTranslateY ? random->Float(0.05f, 0.5f)
+                                              : random->Float(-0.1f, 0.1f);
+    channel->amplitude = random->Float(0.0f, 0.05f);
+  } else {
+    channel->base = 1.0f;
+    channel->amplitude = random->Float(0.0f, 0.1f);
+  }
+}
+
+// Bone 0 is the root. Every other bone's parent is an earlier bone, as
+// RigAnim requires, that is shallow enough to have children.
+static void GenerateSkeleton(const GeneratorOptions& options,
+                             BenchmarkRandom* random,
+                             SyntheticSkeleton* skeleton) {
+  const int num_bones = options.num_bones;
+  std::vector<int> depths(num_bones);
+  skeleton->parents.resize(num_bones);
+  skeleton->channels.resize(num_bones);
+  for (int i = 0; i < num_bones; ++i) {
+    std::vector<int> candidates;
+    for (int j = 0; j < i; ++j) {
+      if (depths[j] < options.max_depth) candidates.push_back(j);
+    }
+
+    int parent = -1;
+    if (!candidates.empty()) {
+      const bool extend_chain = candidates.back() == i - 1 &&
+                                random->Float(0.0f, 1.0f) < kChainProbability;
+      parent = extend_chain
+                   ? i - 1
+                   : candidates[random->Int(
+                         static_cast<int>(candidates.size()))];
+    }
+    skeleton->parents[i] =
+        parent < 0 ? kInvalidBoneIdx : static_cast<BoneIndex>(parent);
+    depths[i] = parent < 0 ? 1 : depths[parent] + 1;
+
+    std::vector<SyntheticChannel>& channels = skeleton->channels[i];
+    channels.resize(options.num_channels);
+    for (int c = 0; c < options.num_channels; ++c) {
+      InitChannel(kChannelPreference[c], random, &channels[c]);
+    }
+    std::sort(channels.begin(), channels.end(), ChannelLess);
+  }
+}
+
+// Create a looping spline that wanders around `channel`'s resting value.
+static CompactSpline* CreateChannelSpline(const SyntheticChannel& channel,
+                                          const GeneratorOptions& options,
+                                          BenchmarkRandom* random) {
+  const int num_nodes = options.num_nodes;
+  const float length = static_cast<float>(options.clip_length);
+  const float spacing = length / (num_nodes - 1);
+
+  // The last node matches the first, so that the clip repeats seamlessly.
+  std::vector<float> xs(num_nodes);
+  std::vector<float> ys(num_nodes);
+  for (int i = 0; i < num_nodes; ++i) {
+    const bool end = i == 0 || i == num_nodes - 1;
+    const float jitter =
+        end ? 0.0f : random->Float(-kNodeJitter, kNodeJitter) * spacing;
+    xs[i] = i * spacing + jitter;
+    ys[i] = i == num_nodes - 1
+                ? ys[0]
+                : channel.base +
+                      random->Float(-channel.amplitude, channel.amplitude);
+  }
+
+  // Catmull-Rom derivatives. Wrap around at the ends, since the clip loops.
+  std::vector<float> derivatives(num_nodes);
+  for (int i = 0; i < num_nodes; ++i) {
+    const bool first = i == 0;
+    const bool last = i == num_nodes - 1;
+    const float prev_y = first || last ? ys[num_nodes - 2] : ys[i - 1];
+    const float next_y = first || last ? ys[1] : ys[i + 1];
+    const float width = first || last
+                            ? (length - xs[num_nodes - 2]) + xs[1]
+                            : xs[i + 1] - xs[i - 1];
+    derivatives[i] = (next_y - prev_y) / width;
+  }
+
+  Range y_range(Range::Empty());
+  for (int i = 0; i < num_nodes; ++i) {
+    y_range = y_range.Include(ys[i]);
+  }
+
+  CompactSpline* spline =
+      CompactSpline::Create(static_cast<CompactSplineIndex>(num_nodes));
+  spline->Init(y_range, CompactSpline::RecommendXGranularity(length));
+  std::vector<UncompressedNode> nodes(num_nodes);
+  for (int i = 0; i < num_nodes; ++i) {
+    nodes[i].x = xs[i];
+    nodes[i].y = ys[i];
+    nodes[i].derivative = derivatives[i];
+  }
+  spline->AddNodes(&nodes[0], nodes.size(), motive::kAddWithoutModification);
+  return spline;
+}
+
+static flatbuffers::Offset<motive::RigAnimFb> CreateClipFlatBuffer(
+    flatbuffers::FlatBufferBuilder& fbb, const SyntheticSkeleton& skeleton,
+    const std::string& anim_name, const GeneratorOptions& options,
+    BenchmarkRandom* random, CorpusStats* stats) {
+  const float constant_fraction = options.constant_percent / 100.0f;
+  std::vector<flatbuffers::Offset<motive::MatrixAnimFb>> matrix_anims;
+  std::vector<flatbuffers::Offset<flatbuffers::String>> bone_names;
+  for (size_t bone = 0; bone < skeleton.parents.size(); ++bone) {
+    const std::vector<SyntheticChannel>& channels = skeleton.channels[bone];
+    std::vector<flatbuffers::Offset<motive::MatrixOpFb>> ops;
+    for (size_t c = 0; c < channels.size(); ++c) {
+      const SyntheticChannel& channel = channels[c];
+      flatbuffers::Offset<void> value;
+      motive::MatrixOpValueFb value_type;
+      if (random->Float(0.0f, 1.0f) < constant_fraction) {
+        value = motive::CreateConstantOpFb(fbb, channel.base).Union();
+        value_type = motive::MatrixOpValueFb_ConstantOpFb;
+        stats->num_constant_ops++;
+      } else {
+        CompactSpline* s = CreateChannelSpline(channel, options, random);
+        value = motive::CompactSplineToFlatBuffers(*s, false, fbb).Union();
+        value_type = motive::MatrixOpValueFb_CompactSplineFb;
+        stats->num_nodes += s->num_nodes();
+        CompactSpline::Destroy(s);
+      }
+      ops.push_back(motive::CreateMatrixOpFb(
+          fbb, static_cast<int8_t>(channel.id),
+          static_cast<motive::MatrixOperationTypeFb>(channel.op), value_type,
+          value));
+      stats->num_ops++;
+    }
+    matrix_anims.push_back(
+        motive::CreateMatrixAnimFb(fbb, fbb.CreateVector(ops)));
+
+    char bone_name[16];
+    snprintf(bone_name, sizeof(bone_name), "bone%d", static_cast<int>(bone));
+    bone_names.push_back(fbb.CreateString(bone_name));
+  }
+
+  auto matrix_anims_fb = fbb.CreateVector(matrix_anims);
+  auto bone_parents_fb = fbb.CreateVector(skeleton.parents);
+  auto bone_names_fb = fbb.CreateVector(bone_names);
+  auto anim_name_fb = fbb.CreateString(anim_name);
+  return motive::CreateRigAnimFb(fbb, matrix_anims_fb, bone_parents_fb,
+                                 bone_names_fb, true, anim_name_fb);
+}
+
+static bool WriteFlatBuffer(const std::string& file_name,
+                            const flatbuffers::FlatBufferBuilder& fbb,
+                            CorpusStats* stats) {
+  FILE* f = fopen(file_name.c_str(), "wb");
+  if (f == nullptr) {
+    fprintf(stderr, "Could not open '%s' for writing.\n", file_name.c_str());
+    return false;
+  }
+  const size_t size = fbb.GetSize();
+  const bool ok = fwrite(fbb.GetBufferPointer(), 1, size, f) == size;
+  fclose(f);
+  if (!ok) {
+    fprintf(stderr, "Could not write '%s'.\n", file_name.c_str());
+    return false;
+  }
+  stats->num_files++;
+  stats->num_bytes += size;
+  return true;
+}
+
+static std::string ClipName(const GeneratorOptions& options, int object,
+                            int clip) {
+  char name[64];
+  snprintf(name, sizeof(name), "_object%d_clip%d", object, clip);
+  return options.name + name;
+}
+
+// Write the whole corpus. The table has one list of clips for each object.
+static bool GenerateCorpus(const GeneratorOptions& options,
+                           CorpusStats* stats) {
+  flatbuffers::FlatBufferBuilder table_fbb;
+  std::vector<flatbuffers::Offset<motive::AnimListFb>> lists;
+  for (int object = 0; object < options.num_objects; ++object) {
+    BenchmarkRandom skeleton_random(MixSeed(options.seed, object, 0));
+    SyntheticSkeleton skeleton;
+    GenerateSkeleton(options, &skeleton_random, &skeleton);
+
+    std::vector<flatbuffers::Offset<motive::AnimSource>> anims;
+    for (int clip = 0; clip < options.num_clips; ++clip) {
+      BenchmarkRandom clip_random(MixSeed(options.seed, object, clip + 1));
+      const std::string anim_name = ClipName(options, object, clip);
+
+      if (options.embed) {
+        // Build the clip straight into the table.
+        auto rig_anim_fb = CreateClipFlatBuffer(
+            table_fbb, skeleton, anim_name, options, &clip_random, stats);
+        anims.push_back(motive::CreateAnimSource(
+            table_fbb, motive::AnimSourceUnion_AnimSourceEmbedded,
+            motive::CreateAnimSourceEmbedded(table_fbb, rig_anim_fb).Union()));
+        continue;
+      }
+
+      flatbuffers::FlatBufferBuilder fbb;
+      auto rig_anim_fb = CreateClipFlatBuffer(fbb, skeleton, anim_name,
+                                              options, &clip_random, stats);
+      motive::FinishRigAnimFbBuffer(fbb, rig_anim_fb);
+      const std::string file_name =
+          options.output_dir + "/" + anim_name + ".motiveanim";
+      if (!WriteFlatBuffer(file_name, fbb, stats)) return false;
+
+      anims.push_back(motive::CreateAnimSource(
+          table_fbb, motive::AnimSourceUnion_AnimSourceFileName,
+          motive::CreateAnimSourceFileName(table_fbb,
+                                           table_fbb.CreateString(file_name))
+              .Union()));
+    }
+    lists.push_back(
+        motive::CreateAnimListFb(table_fbb, 0, table_fbb.CreateVector(anims)));
+  }
+
+  auto table_fb =
+      motive::CreateAnimTableFb(table_fbb, table_fbb.CreateVector(lists));
+  motive::FinishAnimTableFbBuffer(table_fbb, table_fb);
+  return WriteFlatBuffer(options.output_dir + "/" + options.name + ".motivetab",
+                         table_fbb, stats);
+}
+
+int main(int argc, char** argv) {
+  GeneratorOptions options;
+  if (!ParseOptions(argc, argv, &options)) return 1;
+
+  CorpusStats stats;
+  if (!GenerateCorpus(options, &stats)) return 1;
+
+  printf(
+      "Wrote %d files, %zu bytes, to '%s'.\n"
+      "%d ops, %d constant, %d spline nodes.\n",
+      stats.num_files, stats.num_bytes, options.output_dir.c_str(),
+      stats.num_ops, stats.num_constant_ops, stats.num_nodes);
+  return 0;
+}
@@ -0,0 +1,718 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+#include "benchmark_scenarios.h"
+#include "motive/anim.h"
+#include "motive/common.h"
+#include "motive/engine.h"
+#include "motive/init.h"
+#include "motive/math/angle.h"
+#include "motive/math/bulk_spline_evaluator.h"
+#include "motive/math/compact_spline.h"
+#include "motive/motivator.h"
+
+namespace motive {
+
+static const SplineInit kRotateInit(kAngleRange);
+static const SplineInit kTranslateInit;
+
+struct SplineNode {
+  float x;
+  float y;
+  float derivative;
+};
+
+static const SplineNode kSinWave[] = {{0.0f, 0.0f, 1.0f},
+                                      {0.5f * kPi, 1.0f, 0.0f},
+                                      {kPi, 0.0f, -1.0f},
+                                      {1.5f * kPi, -1.0f, 0.0f},
+                                      {kTwoPi, 0.0f, 1.0f}};
+
+static const SplineNode kStraightLine[] = {{0.0f, 0.0f, 1.0f},
+                                           {1.0f, 1.0f, 1.0f}};
+
+static const float kLinearOrbitPeriod = 2000.0f;
+static const float kOscillatingSlowlyPeriod = 500.0f;
+static const float kOscillatingSlowlyAmplitude = 0.3f;
+static const float kOscillatingQuicklyPeriod = 200.0f;
+static const float kOscillatingQuicklyAmplitude = 0.1f;
+
+// Target-driven scenarios give each Motivator a new target once every
+// `kRetargetPeriod` frames. The retargets are spread evenly over the frames so
+// that the per-frame cost is steady.
+static const int kRetargetPeriod = 60;
+
+// Time, in MotiveTime units, to reach a new target.
+static const MotiveTime kRetargetTime = 300;
+
+// Percent of Motivators that are destroyed and recreated every frame in the
+// spawn and despawn scenario.
+static const int kChurnPercent = 5;
+
+// Nodes in each spline of the long spline scenarios, and the time between
+// those nodes. Similar to a sampled animation curve.
+static const int kLongSplineNumNodes = 64;
+static const float kLongSplineNodeSpacing = 33.0f;
+
+// Bones in each rig of the rig crowd scenario. Bones are arranged in a
+// binary tree, which is roughly as deep as a humanoid skeleton.
+static const BoneIndex kRigNumBones = 32;
+
+// Take an array of SplineNodes (x, y, derivative) values and scale them
+// into `spline`, which must hold at least 2 * num_nodes - 1 nodes. We use Dual
+// Cubic interpolation to ensure that the splines are well behaved.
+static void InitSpline(const SplineNode* nodes, size_t num_nodes,
+                       float x_scale, float y_scale, CompactSpline* spline) {
+  // Find y-extremes.
+  float min = std::numeric_limits<float>::infinity();
+  float max = -std::numeric_limits<float>::infinity();
+  for (size_t i = 0; i < num_nodes; ++i) {
+    min = std::min(nodes[i].y, min);
+    max = std::max(nodes[i].y, max);
+  }
+
+  // Initialize the spline such that it's bounds are tight to the data.
+  spline->Init(
+      Range(y_scale * min, y_scale * max),
+      CompactSpline::RecommendXGranularity(x_scale * nodes[num_nodes - 1].x));
+
+  // Scale each node and add them all to the curve.
+  std::vector<UncompressedNode> scaled(num_nodes);
+  for (size_t i = 0; i < num_nodes; ++i) {
+    const SplineNode& n = nodes[i];
+    scaled[i].x = n.x * x_scale;
+    scaled[i].y = n.y * y_scale;
+    scaled[i].derivative = n.derivative / x_scale;
+  }
+  spline->AddNodes(&scaled[0], num_nodes);
+}
+
+// AddNode() may insert a dual-cubic mid-node between every pair of nodes.
+static CompactSplineIndex MaxNodes(size_t num_nodes) {
+  return static_cast<CompactSplineIndex>(2 * num_nodes - 1);
+}
+
+// Same as InitSpline(), but allocates the spline.
+// Caller must call CompactSpline::Destroy().
+static CompactSpline* CreateSpline(const SplineNode* nodes, size_t num_nodes,
+                                   float x_scale, float y_scale) {
+  CompactSpline* spline = CompactSpline::Create(MaxNodes(num_nodes));
+  InitSpline(nodes, num_nodes, x_scale, y_scale, spline);
+  return spline;
+}
+
+// Number of Motivators to touch per frame so that every Motivator is touched
+// once every `period` frames.
+static int SliceSize(int num_motivators, int period) {
+  return (num_motivators + period - 1) / period;
+}
+
+// One dimensional Motivators that follow a predefined, repeating spline.
+// Measures the core BulkSplineEvaluator update.
+class SplineScenario : public BenchmarkScenario {
+ public:
+  SplineScenario() : spline_(nullptr) {}
+  virtual ~SplineScenario() { CompactSpline::Destroy(spline_); }
+
+  virtual void Setup(const ScenarioParams& params, MotiveEngine* engine) {
+    SplineInit::Register();
+    spline_ = CreateSpline(kSinWave, MOTIVE_ARRAY_SIZE(kSinWave),
+                           kOscillatingSlowlyPeriod,
+                           kOscillatingSlowlyAmplitude);
+
+    // Scatter the start times so that the Motivators cross segment
+    // boundaries on different frames.
+    BenchmarkRandom random(params.seed);
+    motivators_.resize(params.num_motivators);
+    for (size_t i = 0; i < motivators_.size(); ++i) {
+      Motivator1f& m = motivators_[i];
+      m.Initialize(kTranslateInit, engine);
+      m.SetSpline(*spline_,
+                  SplinePlayback(random.Float(0.0f, spline_->EndX()), true));
+    }
+  }
+
+  virtual int NumIndices() const {
+    return static_cast<int>(motivators_.size());
+  }
+
+ protected:
+  CompactSpline* spline_;
+  std::vector<Motivator1f> motivators_;
+};
+
+// Same as SplineScenario, but with the evaluator's half-precision mode, when
+// it's available. Compare the two to measure the time saved in a full engine.
+// half_precision_benchmark measures the mode's bandwidth and accuracy.
+class HalfPrecisionSplineScenario : public SplineScenario {
+ public:
+  virtual void Setup(const ScenarioParams& params, MotiveEngine* engine) {
+    // The spline processor, and its evaluator, is created along with the
+    // first spline Motivator.
+    const bool half_precision = DefaultHalfPrecision();
+    SetDefaultHalfPrecision(true);
+    SplineScenario::Setup(params, engine);
+    SetDefaultHalfPrecision(half_precision);
+  }
+};
+
+// Same as SplineScenario, but the game also reads every Motivator's velocity
+// each frame, as it would for motion blur or physics handoff. When `kCached`
+// is true, the evaluator's cache_outputs() mode is enabled.
+template <bool kCached>
+class SplineVelocityScenario : public SplineScenario {
+ public:
+  SplineVelocityScenario() : velocity_sum_(0.0f) {}
+
+  virtual void Setup(const ScenarioParams& params, MotiveEngine* engine) {
+    const bool cache_outputs = DefaultCacheOutputs();
+    SetDefaultCacheOutputs(kCached);
+    SplineScenario::Setup(params, engine);
+    SetDefaultCacheOutputs(cache_outputs);
+  }
+
+  virtual void PreFrame(int /*frame*/, MotiveEngine* /*engine*/) {
+    for (size_t i = 0; i < motivators_.size(); ++i) {
+      velocity_sum_ += motivators_[i].Velocity();
+    }
+  }
+
+ private:
+  // Keeps the velocity reads from being optimized away.
+  float velocity_sum_;
+};
+
+// Base class for scenarios whose Motivators chase procedurally-set targets.
+// A rolling slice of Motivators is retargeted every frame so that the
+// Motivators never settle.
+class TargetScenario : public BenchmarkScenario {
+ public:
+  TargetScenario() : random_(1), next_retarget_(0) {}
+
+  virtual void Setup(const ScenarioParams& params, MotiveEngine* engine) {
+    RegisterInit();
+    random_ = BenchmarkRandom(params.seed);
+    motivators_.resize(params.num_motivators);
+    for (size_t i = 0; i < motivators_.size(); ++i) {
+      Motivator1f& m = motivators_[i];
+      m.Initialize(Init(), engine);
+      Retarget(&m);
+    }
+  }
+
+  virtual void PreFrame(int /*frame*/, MotiveEngine* /*engine*/) {
+    const int num_motivators = static_cast<int>(motivators_.size());
+    const int slice = SliceSize(num_motivators, kRetargetPeriod);
+    for (int i = 0; i < slice; ++i) {
+      Retarget(&motivators_[next_retarget_]);
+      next_retarget_ = (next_retarget_ + 1) % num_motivators;
+    }
+  }
+
+  virtual int NumIndices() const {
+    return static_cast<int>(motivators_.size());
+  }
+
+ protected:
+  virtual void RegisterInit() = 0;
+  virtual const MotivatorInit& Init() const = 0;
+  virtual void Retarget(Motivator1f* m) = 0;
+
+  BenchmarkRandom random_;
+
+ private:
+  std::vector<Motivator1f> motivators_;
+  int next_retarget_;
+};
+
+// Motivators that swing past their targets using spring-like physics.
+class OvershootScenario : public TargetScenario {
+ public:
+  OvershootScenario() {
+    init_.set_range(kAngleRange);
+    init_.set_modular(true);
+    init_.set_max_velocity(0.021f);
+    init_.set_max_delta(3.141f);
+    init_.at_target().max_difference = 0.087f;
+    init_.at_target().max_velocity = 0.00059f;
+    init_.set_accel_per_difference(0.00032f);
+    init_.set_wrong_direction_multiplier(4.0f);
+    init_.set_max_delta_time(10);
+  }
+
+ protected:
+  virtual void RegisterInit() { OvershootInit::Register(); }
+  virtual const MotivatorInit& Init() const { return init_; }
+  virtual void Retarget(Motivator1f* m) {
+    m->SetTarget(Target1f(random_.Float(-kPi, kPi), 0.0f, kRetargetTime));
+  }
+
+ private:
+  OvershootInit init_;
+};
+
+// Spring and ease-in-ease-out Motivators take a curve shape instead of a
+// target time.
+static const MotiveCurveShape kBenchmarkCurveShape(1.0f, 300.0f, 0.5f);
+
+// Motivators that oscillate around their targets.
+class SpringScenario : public TargetScenario {
+ protected:
+  virtual void RegisterInit() { SpringInit::Register(); }
+  virtual const MotivatorInit& Init() const { return init_; }
+  virtual void Retarget(Motivator1f* m) {
+    m->SetTargetWithShape(random_.Float(-1.0f, 1.0f), 0.0f,
+                          kBenchmarkCurveShape);
+  }
+
+ private:
+  SpringInit1f init_;
+};
+
+// Motivators that ease-in and ease-out towards their targets.
+class EaseInEaseOutScenario : public TargetScenario {
+ protected:
+  virtual void RegisterInit() { EaseInEaseOutInit::Register(); }
+  virtual const MotivatorInit& Init() const { return init_; }
+  virtual void Retarget(Motivator1f* m) {
+    m->SetTargetWithShape(random_.Float(-1.0f, 1.0f), 0.0f,
+                          kBenchmarkCurveShape);
+  }
+
+ private:
+  EaseInEaseOutInit1f init_;
+};
+
+// Create a large number of matrix motivators that are each driven by multiple
+// one dimensional motivators. This was the original, and only, benchmark.
+class MatrixScenario : public BenchmarkScenario {
+ public:
+  MatrixScenario() {
+    for (int i = 0; i < kNumChildMotivators; ++i) splines_[i] = nullptr;
+  }
+  virtual ~MatrixScenario() {
+    for (int i = 0; i < kNumChildMotivators; ++i) {
+      CompactSpline::Destroy(splines_[i]);
+    }
+  }
+
+  virtual void Setup(const ScenarioParams& params, MotiveEngine* engine) {
+    (void)params;
+    MatrixInit::Register();
+    SplineInit::Register();
+
+    // Create compact splines by modifying some basic functions (straight
+    // line and sign wave). The straight line, in this case, represents an
+    // angle that travels a total of 2pi, so it ends up where it started.
+    splines_[kLinearOrbit] =
+        CreateSpline(kStraightLine, MOTIVE_ARRAY_SIZE(kStraightLine),
+                     kLinearOrbitPeriod, kTwoPi);
+    splines_[kOscillatingSlowly] =
+        CreateSpline(kSinWave, MOTIVE_ARRAY_SIZE(kSinWave),
+                     kOscillatingSlowlyPeriod, kOscillatingSlowlyAmplitude);
+    splines_[kOscillatingQuickly] =
+        CreateSpline(kSinWave, MOTIVE_ARRAY_SIZE(kSinWave),
+                     kOscillatingQuicklyPeriod, kOscillatingQuicklyAmplitude);
+
+    // Create a matrix initializer with a series of basic matrix operations.
+    // The final matrix will be created by applying these operations, in turn.
+    matrix_ops_.AddOp(0, kRotateAboutY, kRotateInit,
+                      *splines_[kLinearOrbit]);
+    matrix_ops_.AddOp(1, kTranslateX, kTranslateInit,
+                      *splines_[kOscillatingSlowly]);
+    matrix_ops_.AddOp(2, kTranslateY, kTranslateInit,
+                      *splines_[kOscillatingQuickly]);
+
+    // Initialize the large array of matrix motivators. Note that the
+    // one dimensional motivators that drive the matrix motivators are created
+    // by the matrix motivators themselves.
+    matrices_.resize(params.num_motivators);
+    for (size_t i = 0; i < matrices_.size(); ++i) {
+      matrices_[i].Initialize(MatrixInit(matrix_ops_), engine);
+    }
+  }
+
+  virtual int NumIndices() const { return static_cast<int>(matrices_.size()); }
+
+ private:
+  enum ChildMotivators {
+    kLinearOrbit,
+    kOscillatingSlowly,
+    kOscillatingQuickly,
+    kNumChildMotivators
+  };
+
+  MatrixOpArray matrix_ops_;
+  CompactSpline* splines_[kNumChildMotivators];
+  std::vector<MatrixMotivator4f> matrices_;
+};
+
+// A crowd of rigged characters, all playing the same looping animation
+// from different start times.
+class RigCrowdScenario : public BenchmarkScenario {
+ public:
+  virtual void Setup(const ScenarioParams& params, MotiveEngine* engine) {
+    RigInit::Register();
+    MatrixInit::Register();
+    SplineInit::Register();
+    CreateAnim();
+
+    BenchmarkRandom random(params.seed);
+    const RigInit init(anim_, anim_.bone_parents(), anim_.NumBones());
+    rigs_.resize(params.num_motivators);
+    for (size_t i = 0; i < rigs_.size(); ++i) {
+      RigMotivator& rig = rigs_[i];
+      rig.Initialize(init, engine);
+      rig.BlendToAnim(anim_,
+                      SplinePlayback(random.Float(0.0f, kLinearOrbitPeriod)));
+    }
+  }
+
+  virtual int NumIndices() const { return static_cast<int>(rigs_.size()); }
+  virtual int MotivatorsPerInstance() const { return kRigNumBones; }
+
+ private:
+  // Each bone sways about its x and y axes and is offset along the y axis
+  // from its parent.
+  void CreateAnim() {
+    anim_.Init("crowd", kRigNumBones, false);
+    for (BoneIndex i = 0; i < kRigNumBones; ++i) {
+      const BoneIndex parent =
+          i == 0 ? kInvalidBoneIdx : static_cast<BoneIndex>((i - 1) / 2);
+      MatrixAnim& m = anim_.InitMatrixAnim(i, parent, "");
+      MatrixAnim::Spline* splines = m.Construct(2);
+
+      splines[0].spline =
+          CreateSpline(kSinWave, MOTIVE_ARRAY_SIZE(kSinWave),
+                       kOscillatingSlowlyPeriod, kOscillatingSlowlyAmplitude);
+      splines[1].spline =
+          CreateSpline(kSinWave, MOTIVE_ARRAY_SIZE(kSinWave),
+                       kOscillatingQuicklyPeriod, kOscillatingQuicklyAmplitude);
+      splines[0].init = SplineInit(kAngleRange);
+      splines[1].init = SplineInit(kAngleRange);
+
+      MatrixOpArray& ops = m.ops();
+      ops.AddOp(0, kTranslateY, 1.0f);
+      ops.AddOp(1, kRotateAboutY, splines[0].init, *splines[0].spline);
+      ops.AddOp(2, kRotateAboutX, splines[1].init, *splines[1].spline);
+    }
+    anim_.set_end_time(static_cast<MotiveTime>(kOscillatingSlowlyPeriod));
+    anim_.set_repeat(true);
+  }
+
+  RigAnim anim_;
+  std::vector<RigMotivator> rigs_;
+};
+
+// Spline Motivators that are continually destroyed and recreated. Measures
+// index allocation, removal, and defragmentation.
+class SpawnDespawnScenario : public BenchmarkScenario {
+ public:
+  SpawnDespawnScenario() : random_(1), spline_(nullptr) {}
+  virtual ~SpawnDespawnScenario() { CompactSpline::Destroy(spline_); }
+
+  virtual void Setup(const ScenarioParams& params, MotiveEngine* engine) {
+    SplineInit::Register();
+    spline_ = CreateSpline(kSinWave, MOTIVE_ARRAY_SIZE(kSinWave),
+                           kOscillatingQuicklyPeriod,
+                           kOscillatingQuicklyAmplitude);
+    random_ = BenchmarkRandom(params.seed);
+    motivators_.resize(params.num_motivators);
+    for (size_t i = 0; i < motivators_.size(); ++i) {
+      Spawn(&motivators_[i], engine);
+    }
+  }
+
+  virtual void PreFrame(int /*frame*/, MotiveEngine* engine) {
+    // Despawn random Motivators, leaving holes in the processor's index
+    // range, then spawn replacements at the end.
+    const int num_motivators = static_cast<int>(motivators_.size());
+    const int churn = SliceSize(num_motivators * kChurnPercent, 100);
+    for (int i = 0; i < churn; ++i) {
+      Motivator1f& m = motivators_[random_.Int(num_motivators)];
+      m.Invalidate();
+      Spawn(&m, engine);
+    }
+  }
+
+  virtual int NumIndices() const {
+    return static_cast<int>(motivators_.size());
+  }
+
+ private:
+  void Spawn(Motivator1f* m, MotiveEngine* engine) {
+    m->Initialize(kTranslateInit, engine);
+    m->SetSpline(*spline_,
+                 SplinePlayback(random_.Float(0.0f, spline_->EndX()), true));
+  }
+
+  BenchmarkRandom random_;
+  CompactSpline* spline_;
+  std::vector<Motivator1f> motivators_;
+};
+
+// Spline Motivators that all receive a new target every frame. Measures
+// the cost of generating and initializing a local spline per Motivator.
+class BulkRetargetScenario : public BenchmarkScenario {
+ public:
+  BulkRetargetScenario() : random_(1) {}
+
+  virtual void Setup(const ScenarioParams& params, MotiveEngine* engine) {
+    SplineInit::Register();
+    random_ = BenchmarkRandom(params.seed);
+    motivators_.resize(params.num_motivators);
+    for (size_t i = 0; i < motivators_.size(); ++i) {
+      // The first target must also specify the current value, since there is
+      // no curve to continue from.
+      Motivator1f& m = motivators_[i];
+      m.Initialize(kTranslateInit, engine);
+      m.SetTarget(CurrentToTarget1f(0.0f, 0.0f, random_.Float(-1.0f, 1.0f),
+                                    0.0f, kRetargetTime));
+    }
+  }
+
+  virtual void PreFrame(int /*frame*/, MotiveEngine* /*engine*/) {
+    for (size_t i = 0; i < motivators_.size(); ++i) {
+      motivators_[i].SetTarget(
+          Target1f(random_.Float(-1.0f, 1.0f), 0.0f, kRetargetTime));
+    }
+  }
+
+  virtual int NumIndices() const {
+    return static_cast<int>(motivators_.size());
+  }
+
+ private:
+  BenchmarkRandom random_;
+  std::vector<Motivator1f> motivators_;
+};
+
+// Four dimensional Motivators, such as quaternions, that all switch to new
+// splines every frame. Half of them blend to the new splines, and half jump.
+// Measures SetSplines(), which sets every dimension of a Motivator at once.
+class SetSplinesScenario : public BenchmarkScenario {
+ public:
+  SetSplinesScenario() : random_(1) {}
+  virtual ~SetSplinesScenario() {
+    for (size_t i = 0; i < spline_sets_.size(); ++i) {
+      CompactSpline::DestroyArray(spline_sets_[i], kDimensions);
+    }
+  }
+
+  virtual void Setup(const ScenarioParams& params, MotiveEngine* engine) {
+    SplineInit::Register();
+    random_ = BenchmarkRandom(params.seed);
+
+    // Every dimension of every set has a different period, so that the
+    // dimensions cross segment boundaries at different times.
+    const size_t num_nodes = MOTIVE_ARRAY_SIZE(kSinWave);
+    for (int i = 0; i < kNumSplineSets; ++i) {
+      CompactSpline* splines =
+          CompactSpline::CreateArray(MaxNodes(num_nodes), kDimensions);
+      CompactSpline* spline = splines;
+      for (int d = 0; d < kDimensions; ++d, spline = spline->Next()) {
+        const float period =
+            kOscillatingSlowlyPeriod * (1.0f + 0.1f * (i * kDimensions + d));
+        InitSpline(kSinWave, num_nodes, period, kOscillatingSlowlyAmplitude,
+                   spline);
+      }
+      spline_sets_.push_back(splines);
+    }
+
+    motivators_.resize(params.num_motivators);
+    for (size_t i = 0; i < motivators_.size(); ++i) {
+      motivators_[i].Initialize(kTranslateInit, engine);
+      SetRandomSplines(&motivators_[i], false);
+    }
+  }
+
+  virtual void PreFrame(int /*frame*/, MotiveEngine* /*engine*/) {
+    for (size_t i = 0; i < motivators_.size(); ++i) {
+      SetRandomSplines(&motivators_[i], random_.Int(2) == 0);
+    }
+  }
+
+  virtual int NumIndices() const {
+    return static_cast<int>(motivators_.size()) * kDimensions;
+  }
+
+  virtual size_t ContentBytes() const {
+    return spline_sets_.size() * kDimensions *
+           CompactSpline::Size(MaxNodes(MOTIVE_ARRAY_SIZE(kSinWave)));
+  }
+
+ private:
+  static const int kDimensions = 4;
+  static const int kNumSplineSets = 8;
+
+  void SetRandomSplines(Motivator4f* m, bool blend) {
+    const CompactSpline* splines = spline_sets_[random_.Int(kNumSplineSets)];
+    SplinePlayback playback(random_.Float(0.0f, splines->EndX()), true);
+    if (blend) {
+      playback.blend_x = static_cast<float>(kRetargetTime);
+    }
+    m->SetSplines(splines, playback);
+  }
+
+  BenchmarkRandom random_;
+  std::vector<CompactSpline*> spline_sets_;
+  std::vector<Motivator4f> motivators_;
+};
+
+// Spline Motivators that each follow their own long, evenly-sampled spline.
+// When `kPacked` is true, the splines are stored in the packed format.
+// Comparing the two measures the memory saved by packing, and the cost of
+// unpacking nodes at segment transitions.
+template <bool kPacked>
+class LongSplineScenario : public BenchmarkScenario {
+ public:
+  virtual ~LongSplineScenario() {
+    for (size_t i = 0; i < splines_.size(); ++i) {
+      CompactSpline::Destroy(splines_[i]);
+    }
+  }
+
+  virtual void Setup(const ScenarioParams& params, MotiveEngine* engine) {
+    SplineInit::Register();
+    BenchmarkRandom random(params.seed);
+    splines_.resize(params.num_motivators);
+    motivators_.resize(params.num_motivators);
+    for (size_t i = 0; i < motivators_.size(); ++i) {
+      CompactSpline* spline = CreateLongSpline(&random);
+      if (kPacked) {
+        CompactSpline* packed = CompactSpline::CreatePacked(*spline);
+        CompactSpline::Destroy(spline);
+        spline = packed;
+      }
+      splines_[i] = spline;
+
+      Motivator1f& m = motivators_[i];
+      m.Initialize(kTranslateInit, engine);
+      m.SetSpline(*spline,
+                  SplinePlayback(random.Float(0.0f, spline->EndX()), true));
+    }
+  }
+
+  virtual int NumIndices() const {
+    return static_cast<int>(motivators_.size());
+  }
+
+  virtual size_t ContentBytes() const {
+    size_t bytes = 0;
+    for (size_t i = 0; i < splines_.size(); ++i) {
+      bytes += splines_[i]->Size();
+    }
+    return bytes;
+  }
+
+ private:
+  // A low-amplitude wave with a random frequency and phase, sampled at
+  // evenly-spaced x values. Caller must call CompactSpline::Destroy().
+  static CompactSpline* CreateLongSpline(BenchmarkRandom* random) {
+    const float amplitude = kOscillatingQuicklyAmplitude;
+    const float frequency = random->Float(0.05f, 0.5f);
+    const float phase = random->Float(0.0f, kTwoPi);
+    const float end_x = kLongSplineNodeSpacing * (kLongSplineNumNodes - 1);
+
+    CompactSpline* spline = CompactSpline::Create(
+        static_cast<CompactSplineIndex>(2 * kLongSplineNumNodes - 1));
+    spline->Init(Range(-amplitude, amplitude),
+                 CompactSpline::RecommendXGranularity(end_x));
+    std::vector<UncompressedNode> nodes(kLongSplineNumNodes);
+    for (int i = 0; i < kLongSplineNumNodes; ++i) {
+      const float angle = phase + frequency * i;
+      nodes[i].x = kLongSplineNodeSpacing * i;
+      nodes[i].y = amplitude * sin(angle);
+      nodes[i].derivative =
+          amplitude * frequency * cos(angle) / kLongSplineNodeSpacing;
+    }
+    spline->AddNodes(&nodes[0], nodes.size());
+    return spline;
+  }
+
+  std::vector<CompactSpline*> splines_;
+  std::vector<Motivator1f> motivators_;
+};
+
+template <class T>
+static BenchmarkScenario* CreateScenario() {
+  return new T();
+}
+
+struct ScenarioEntry {
+  const char* name;
+  BenchmarkScenario* (*create)();
+};
+
+static const ScenarioEntry kScenarios[] = {
+    {"spline", CreateScenario<SplineScenario>},
+    {"spline_half", CreateScenario<HalfPrecisionSplineScenario>},
+    {"spline_velocity", CreateScenario<SplineVelocityScenario<false> >},
+    {"spline_velocity_cached", CreateScenario<SplineVelocityScenario<true> >},
+    {"overshoot", CreateScenario<OvershootScenario>},
+    {"spring", CreateScenario<SpringScenario>},
+    {"ease_in_ease_out", CreateScenario<EaseInEaseOutScenario>},
+    {"matrix", CreateScenario<MatrixScenario>},
+    {"rig_crowd", CreateScenario<RigCrowdScenario>},
+    {"spawn_despawn", CreateScenario<SpawnDespawnScenario>},
+    {"bulk_retarget", CreateScenario<BulkRetargetScenario>},
+    {"set_splines", CreateScenario<SetSplinesScenario>},
+    {"long_spline", CreateScenario<LongSplineScenario<false> >},
+    {"packed_spline", CreateScenario<LongSplineScenario<true> >},
+};
+
+BenchmarkScenario* CreateBenchmarkScenario(const char* name) {
+  for (size_t i = 0; i < MOTIVE_ARRAY_SIZE(kScenarios); ++i) {
+    if (strcmp(kScenarios[i].name, name) == 0) return kScenarios[i].create();
+  }
+  return nullptr;
+}
+
+const char* BenchmarkScenarioName(int i) {
+  assert(0 <= i && i < NumBenchmarkScenarios());
+  return kScenarios[i].name;
+}
+
+int NumBenchmarkScenarios() {
+  return static_cast<int>(MOTIVE_ARRAY_SIZE(kScenarios));
+}
+
+const char* OptionValue(const char* arg, const char* name) {
+  const size_t name_len = strlen(name);
+  if (strncmp(arg, "--", 2) != 0 || strncmp(arg + 2, name, name_len) != 0 ||
+      arg[2 + name_len] != '=') {
+    return nullptr;
+  }
+  return arg + 2 + name_len + 1;
+}
+
+void SplitCommas(const char* s, std::vector<std::string>* out) {
+  const char* start = s;
+  for (const char* c = s;; ++c) {
+    if (*c == ',' || *c == '\0') {
+      if (c > start) out->push_back(std::string(start, c));
+      if (*c == '\0') break;
+      start = c + 1;
+    }
+  }
+}
+
+}  // namespace motive
@@ -0,0 +1,145 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MOTIVE_BENCHMARKER_BENCHMARK_SCENARIOS_H_
+#define MOTIVE_BENCHMARKER_BENCHMARK_SCENARIOS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "motive/common.h"
+
+namespace motive {
+
+class MotiveEngine;
+
+/// Benchmark times are reported in microseconds.
+static const double kMicrosecondsPerSecond = 1000000.0;
+
+/// If `arg` is of the form `--name=value`, return `value`. Otherwise, return
+/// nullptr. Shared by the command-line parsers of the benchmark tools.
+const char* OptionValue(const char* arg, const char* name);
+
+/// Append the non-empty, comma-separated entries of `s` to `out`.
+void SplitCommas(const char* s, std::vector<std::string>* out);
+
+/// @class ScenarioParams
+/// @brief Knobs shared by every benchmark scenario. Set from the command line.
+struct ScenarioParams {
+  ScenarioParams()
+      : num_motivators(10000),
+        num_frames(1000),
+        num_warmup_frames(100),
+        delta_time(1),
+        seed(1) {}
+
+  /// Number of top-level Motivators the scenario creates. For the rig crowd
+  /// scenario, this is the number of rigs.
+  int num_motivators;
+
+  /// Number of frames to measure.
+  int num_frames;
+
+  /// Number of frames to run before we start measuring. Lets caches and
+  /// internal vectors reach their steady state.
+  int num_warmup_frames;
+
+  /// Time passed to MotiveEngine::AdvanceFrame() every frame.
+  MotiveTime delta_time;
+
+  /// Seed for the scenario's pseudo-random choices. Same seed ==> same work.
+  uint32_t seed;
+};
+
+/// @class BenchmarkRandom
+/// @brief Small deterministic generator, so that runs with the same seed
+///        perform the same work on every platform, independent of the C
+///        library's `rand()`.
+class BenchmarkRandom {
+ public:
+  explicit BenchmarkRandom(uint32_t seed) : state_(seed == 0 ? 1 : seed) {}
+
+  /// Xorshift32. Good enough to scatter start times and targets.
+  uint32_t Next() {
+    state_ ^= state_ << 13;
+    state_ ^= state_ >> 17;
+    state_ ^= state_ << 5;
+    return state_;
+  }
+
+  /// Return a value in the range [min, max).
+  float Float(float min, float max) {
+    const float unit = static_cast<float>(Next() >> 8) * (1.0f / 16777216.0f);
+    return min + unit * (max - min);
+  }
+
+  /// Return a value in the range [0, max).
+  int Int(int max) {
+    return static_cast<int>(Next() % static_cast<uint32_t>(max));
+  }
+
+ private:
+  uint32_t state_;
+};
+
+/// @class BenchmarkScenario
+/// @brief One named workload in the benchmark suite.
+///
+/// The runner calls Setup() once, then for every frame calls PreFrame()
+/// followed by MotiveEngine::AdvanceFrame(). Both calls are included in the
+/// frame's measured latency, so scenarios that spawn, despawn, or retarget
+/// Motivators should do that work in PreFrame().
+class BenchmarkScenario {
+ public:
+  virtual ~BenchmarkScenario() {}
+
+  /// Create the Motivators that this scenario animates.
+  virtual void Setup(const ScenarioParams& params, MotiveEngine* engine) = 0;
+
+  /// Per-frame game-side work, such as setting new targets.
+  virtual void PreFrame(int frame, MotiveEngine* engine) {
+    (void)frame;
+    (void)engine;
+  }
+
+  /// Number of Motivator indices that are updated every frame. Used to
+  /// calculate throughput.
+  virtual int NumIndices() const = 0;
+
+  /// Number of Motivators created for each of ScenarioParams::num_motivators.
+  /// Used to compare scenarios at the same scale. For example, each rig in
+  /// the rig crowd scenario is a hierarchy of matrix Motivators.
+  virtual int MotivatorsPerInstance() const { return 1; }
+
+  /// Bytes of animation data, such as splines, that the scenario owns.
+  /// Reported alongside the engine's memory usage, since it is data that
+  /// the game, not Motive, holds.
+  virtual size_t ContentBytes() const { return 0; }
+};
+
+/// Return a newly allocated scenario with name `name`, or nullptr if no
+/// scenario by that name exists. Caller is responsible for deleting.
+BenchmarkScenario* CreateBenchmarkScenario(const char* name);
+
+/// Number of scenarios in the suite.
+int NumBenchmarkScenarios();
+
+/// Name of the `i`th scenario, where 0 <= i < NumBenchmarkScenarios().
+/// Scenarios are run in this order by default.
+const char* BenchmarkScenarioName(int i);
+
+}  // namespace motive
+
+#endif  // MOTIVE_BENCHMARKER_BENCHMARK_SCENARIOS_H_
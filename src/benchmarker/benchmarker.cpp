@@ -13,161 +13,377 @@
 // limitations under the License.
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
 #include <vector>
+#include "allocation_tracker.h"
+#include "benchmark_scenarios.h"
 #include "motive/common.h"
 #include "motive/engine.h"
-#include "motive/math/angle.h"
-#include "motive/math/curve.h"
-#include "motive/math/compact_spline.h"
-#include "motive/init.h"
 #include "motive/util/benchmark.h"
+#include "motive/util/log_histogram.h"
 
-using motive::CompactSpline;
-using motive::CubicCurve;
-using motive::CubicInit;
-using motive::kAngleRange;
-using motive::kPi;
-using motive::kTwoPi;
-using motive::QuadraticCurve;
-using motive::Range;
-using motive::SplinePlayback;
-using mathfu::vec2;
-using mathfu::vec2i;
+using motive::BenchmarkScenario;
+using motive::BenchmarkTime;
+using motive::LogHistogram;
+using motive::MemoryCategory;
 using motive::MotiveEngine;
-using motive::MatrixInit;
-using motive::MatrixOpArray;
-using motive::MatrixMotivator4f;
-using motive::SplineInit;
+using motive::MotiveMemoryUsage;
+using motive::MotiveProcessorCounters;
+using motive::MotiveSpikeReport;
+using motive::OptionValue;
+using motive::ScenarioParams;
+using motive::SplitCommas;
+using motive::kMicrosecondsPerSecond;
 
-static const SplineInit kRotateInit(kAngleRange);
-static const SplineInit kTranslateInit;
 static const int kNumBenchmarkIds = 10;
+static const int kMaxTraceEvents = 1 << 18;
 
-struct SplineNode {
-  float x;
-  float y;
-  float derivative;
+// Measured results for one scenario.
+struct ScenarioResult {
+  ScenarioResult()
+      : num_indices(0),
+        total_seconds(0.0),
+        indices_per_second(0.0),
+        mean_usec(0.0),
+        p50_usec(0.0),
+        p90_usec(0.0),
+        p99_usec(0.0),
+        p99_9_usec(0.0),
+        max_usec(0.0),
+        teardown_reported_bytes(0),
+        teardown_heap_bytes(0),
+        content_bytes(0),
+        num_spikes(0) {}
+
+  std::string name;
+  int num_indices;
+  double total_seconds;
+  double indices_per_second;
+  double mean_usec;
+  double p50_usec;
+  double p90_usec;
+  double p99_usec;
+  double p99_9_usec;
+  double max_usec;
+  MotiveProcessorCounters counters;
+
+  // Memory reported by the engine at the end of the run.
+  MotiveMemoryUsage memory;
+
+  // Cross-check of the reported memory. After the scenario is deleted, the
+  // only memory left is held by the engine. `teardown_reported_bytes` is what
+  // the engine reports at that point, and `teardown_heap_bytes` is what's
+  // actually returned to the heap when the engine is destroyed. The heap
+  // number is slightly larger, since it includes the processor objects
+  // themselves, their index allocators, and the engine's bookkeeping.
+  size_t teardown_reported_bytes;
+  size_t teardown_heap_bytes;
+
+  // Animation data held by the scenario, outside of the engine.
+  size_t content_bytes;
+
+  // Number of processor updates that exceeded --spike_usec.
+  int num_spikes;
 };
 
-static const SplineNode kSinWave[] = {{0.0f, 0.0f, 1.0f},
-                                      {0.5f * kPi, 1.0f, 0.0f},
-                                      {kPi, 0.0f, -1.0f},
-                                      {1.5f * kPi, -1.0f, 0.0f},
-                                      {kTwoPi, 0.0f, 1.0f}};
-
-static const SplineNode kStraightLine[] = {{0.0f, 0.0f, 1.0f},
-                                           {1.0f, 1.0f, 1.0f}};
-
-static const float kLinearOrbitPeriod = 2000.0f;
-static const float kOscillatingSlowlyPeriod = 500.0f;
-static const float kOscillatingSlowlyAmplitude = 0.3f;
-static const float kOscillatingQuicklyPeriod = 200.0f;
-static const float kOscillatingQuicklyAmplitude = 0.1f;
-
-// Take an array of SplineNodes (x, y, derivative) values and scale them
-// to create a CompactSpline. We use Dual Cubic interpolation to ensure that
-// the splines are well behaved.
-static void CreateSpline(const SplineNode* nodes, size_t num_nodes,
-                         float x_scale, float y_scale, CompactSpline* spline) {
-  // Find y-extremes.
-  float min = std::numeric_limits<float>::infinity();
-  float max = -std::numeric_limits<float>::infinity();
-  for (size_t i = 0; i < num_nodes; ++i) {
-    min = std::min(nodes[i].y, min);
-    max = std::max(nodes[i].y, max);
-  }
+// Options parsed from the command line.
+struct BenchmarkerOptions {
+  BenchmarkerOptions()
+      : output_file(nullptr),
+        trace_file(nullptr),
+        processor_stats(false),
+        counters(false),
+        look_ahead(false),
+        spike_usec(0.0) {}
 
-  // Initialize the spline such that it's bounds are tight to the data.
-  spline->Init(
-      Range(y_scale * min, y_scale * max),
-      CompactSpline::RecommendXGranularity(x_scale * nodes[num_nodes - 1].x));
+  ScenarioParams params;
+  std::vector<std::string> scenarios;
+  const char* output_file;
+  const char* trace_file;
+  bool processor_stats;
+  bool counters;
+  bool look_ahead;
+  double spike_usec;
+};
 
-  // Scale each node and add it to the curve.
-  for (size_t i = 0; i < num_nodes; ++i) {
-    const SplineNode& n = nodes[i];
-    spline->AddNode(n.x * x_scale, n.y * y_scale, n.derivative / x_scale);
+static void PrintUsage(const char* program) {
+  printf(
+      "Usage: %s [options]\n"
+      "  --scenarios=a,b,...  Scenarios to run. Default is all of them.\n"
+      "  --count=N            Motivators per scenario.\n"
+      "  --frames=N           Frames to measure.\n"
+      "  --warmup=N           Frames to run before measuring.\n"
+      "  --delta_time=N       Time passed to AdvanceFrame() each frame.\n"
+      "  --seed=N             Seed for the scenarios' random choices.\n"
+      "  --output=FILE        Write JSON results to FILE instead of stdout.\n"
+      "  --trace=FILE         Write a Chrome trace-event timeline to FILE.\n"
+      "  --processor_stats    Print per-processor timing histograms.\n"
+      "  --counters           Add hardware counters to --processor_stats.\n"
+      "  --spike_usec=N       Report processor updates that take over N us.\n"
+      "  --look_ahead         Precompute each spline's next segment. See\n"
+      "                       MotiveEngine::EnableLookAhead().\n"
+      "  --list               List the scenarios and exit.\n"
+      "\nScenarios:\n",
+      program);
+  for (int i = 0; i < motive::NumBenchmarkScenarios(); ++i) {
+    printf("  %s\n", motive::BenchmarkScenarioName(i));
   }
 }
 
-// Create a large number of matrix motivators that are each driven by multiple
-// one dimensional motivators. Then advance them over-and-over, gathering
-// measuring the running time. Print the results in histograms, periodically.
-class MotiveBenchmarker {
- public:
-  MotiveBenchmarker() {
-    MatrixInit::Register();
-    SplineInit::Register();
-
-    // Create compact splines by modifying some basic functions (straight
-    // line and sign wave). The straight line, in this case, represents an
-    // angle that travels a total of 2pi, so it ends up where it started.
-    CreateSpline(kStraightLine, MOTIVE_ARRAY_SIZE(kStraightLine),
-                 kLinearOrbitPeriod, kTwoPi, &splines_[kLinearOrbit]);
-    CreateSpline(kSinWave, MOTIVE_ARRAY_SIZE(kSinWave),
-                 kOscillatingSlowlyPeriod, kOscillatingSlowlyAmplitude,
-                 &splines_[kOscillatingSlowly]);
-    CreateSpline(kSinWave, MOTIVE_ARRAY_SIZE(kSinWave),
-                 kOscillatingQuicklyPeriod, kOscillatingQuicklyAmplitude,
-                 &splines_[kOscillatingQuickly]);
-
-    // Create a matrix initializer with a series of basic matrix operations.
-    // The final matrix will be created by applying these operations, in turn.
-    matrix_ops_.AddOp(0, motive::kRotateAboutY, kRotateInit,
-                      splines_[kLinearOrbit]);
-    matrix_ops_.AddOp(1, motive::kTranslateX, kTranslateInit,
-                      splines_[kOscillatingSlowly]);
-    matrix_ops_.AddOp(2, motive::kTranslateY, kTranslateInit,
-                      splines_[kOscillatingQuickly]);
-
-    // Initialize the large array of matrix motivators. Note that the
-    // one dimensional motivators that drive the matrix motivators are created
-    // by the matrix motivators themselves.
-    for (size_t i = 0; i < kNumMatrices; ++i) {
-      MatrixMotivator4f& m = matrices_[i];
-      m.Initialize(MatrixInit(matrix_ops_), &engine_);
+// Returns false if the program should exit without running benchmarks.
+static bool ParseOptions(int argc, char** argv, BenchmarkerOptions* options) {
+  ScenarioParams& params = options->params;
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    const char* value = nullptr;
+    if ((value = OptionValue(arg, "scenarios")) != nullptr) {
+      SplitCommas(value, &options->scenarios);
+    } else if ((value = OptionValue(arg, "count")) != nullptr) {
+      params.num_motivators = atoi(value);
+    } else if ((value = OptionValue(arg, "frames")) != nullptr) {
+      params.num_frames = atoi(value);
+    } else if ((value = OptionValue(arg, "warmup")) != nullptr) {
+      params.num_warmup_frames = atoi(value);
+    } else if ((value = OptionValue(arg, "delta_time")) != nullptr) {
+      params.delta_time = atoi(value);
+    } else if ((value = OptionValue(arg, "seed")) != nullptr) {
+      params.seed = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+    } else if ((value = OptionValue(arg, "output")) != nullptr) {
+      options->output_file = value;
+    } else if ((value = OptionValue(arg, "trace")) != nullptr) {
+      options->trace_file = value;
+    } else if ((value = OptionValue(arg, "spike_usec")) != nullptr) {
+      options->spike_usec = atof(value);
+    } else if (strcmp(arg, "--processor_stats") == 0) {
+      options->processor_stats = true;
+    } else if (strcmp(arg, "--counters") == 0) {
+      options->counters = true;
+    } else if (strcmp(arg, "--look_ahead") == 0) {
+      options->look_ahead = true;
+    } else if (strcmp(arg, "--list") == 0) {
+      for (int j = 0; j < motive::NumBenchmarkScenarios(); ++j) {
+        printf("%s\n", motive::BenchmarkScenarioName(j));
+      }
+      return false;
+    } else {
+      PrintUsage(argv[0]);
+      return false;
     }
   }
 
-  void Run() {
-    for (int i = 0; i < kNumReports; ++i) {
-      // Advance the engine many times, gathering benchmark information on
-      // each iteration.
-      for (int j = 0; j < kNumIterationsPerReport; ++j) {
-        engine_.AdvanceFrame(1);
-      }
+  if (params.num_motivators <= 0 || params.num_frames <= 0 ||
+      params.num_warmup_frames < 0 || params.delta_time <= 0) {
+    fprintf(stderr, "Counts and times must be positive.\n");
+    return false;
+  }
 
-      // Output benchmark statistics and empty the stats counter.
-      motive::OutputBenchmarks();
-      motive::ClearBenchmarks();
+  // Default to running every scenario.
+  if (options->scenarios.empty()) {
+    for (int i = 0; i < motive::NumBenchmarkScenarios(); ++i) {
+      options->scenarios.push_back(motive::BenchmarkScenarioName(i));
     }
   }
+  return true;
+}
 
- private:
-  // Total number of matrices to animate.
-  static const size_t kNumMatrices = 10000;
+static double TimeToUsec(double time) {
+  return motive::BenchmarkTimeToSeconds(1) * time * kMicrosecondsPerSecond;
+}
 
-  // Number of times to run before quitting.
-  static const int kNumReports = 100;
+// Log spikes to stderr as they happen, so they can be correlated with the
+// trace, and count them for the results.
+static void ReportSpike(const MotiveSpikeReport& report, void* user_data) {
+  fprintf(stderr, "spike: %s\n", report.ToJson().c_str());
+  static_cast<ScenarioResult*>(user_data)->num_spikes++;
+}
 
-  // Number of benchmark samples to collect before analyzing.
-  static const int kNumIterationsPerReport = 1000;
+// Advance the engine, measuring the time for every frame. Frame time includes
+// the scenario's game-side work, such as spawning or retargeting.
+static bool RunScenario(const std::string& name,
+                        const BenchmarkerOptions& options,
+                        ScenarioResult* result) {
+  const ScenarioParams& params = options.params;
+  BenchmarkScenario* scenario = motive::CreateBenchmarkScenario(name.c_str());
+  if (scenario == nullptr) {
+    fprintf(stderr, "Unknown scenario '%s'. Use --list for choices.\n",
+            name.c_str());
+    return false;
+  }
 
-  enum ChildImpellers {
-    kLinearOrbit,
-    kOscillatingSlowly,
-    kOscillatingQuickly,
-    kNumChildImpellers
-  };
+  // Fixed memory, so long soak runs with many frames are fine.
+  LogHistogram frame_times;
+  size_t heap_bytes_before_teardown = 0;
+  {
+    // The scenario holds Motivators that reference processors owned by the
+    // engine, so the scenario must be deleted before the engine.
+    MotiveEngine engine;
+    engine.EnableLookAhead(options.look_ahead);
+    scenario->Setup(params, &engine);
 
-  MotiveEngine engine_;
-  MatrixOpArray matrix_ops_;
-  CompactSpline splines_[kNumChildImpellers];
-  MatrixMotivator4f matrices_[kNumMatrices];
-};
+    for (int i = 0; i < params.num_warmup_frames; ++i) {
+      scenario->PreFrame(i, &engine);
+      engine.AdvanceFrame(params.delta_time);
+    }
+    motive::ClearBenchmarks();
+    if (options.spike_usec > 0.0) {
+      engine.EnableSpikeWatchdog(options.spike_usec / kMicrosecondsPerSecond,
+                                 ReportSpike, result);
+    }
+
+    for (int i = 0; i < params.num_frames; ++i) {
+      const BenchmarkTime start = motive::GetBenchmarkTime();
+      {
+        // Marks frame boundaries in the trace timeline.
+        FPL_BENCHMARK("Frame");
+        scenario->PreFrame(params.num_warmup_frames + i, &engine);
+        engine.AdvanceFrame(params.delta_time);
+      }
+      const BenchmarkTime end = motive::GetBenchmarkTime();
+      frame_times.Append(end - start);
+    }
+
+    result->name = name;
+    result->num_indices = scenario->NumIndices();
+    result->counters = engine.TotalCounters();
+    result->memory = engine.MemoryUsage();
+    result->content_bytes = scenario->ContentBytes();
+    delete scenario;
+
+    result->teardown_reported_bytes = engine.MemoryUsage().TotalAllocated();
+    heap_bytes_before_teardown = motive::LiveHeapBytes();
+  }
+  result->teardown_heap_bytes =
+      heap_bytes_before_teardown - motive::LiveHeapBytes();
+  if (result->teardown_reported_bytes > result->teardown_heap_bytes) {
+    fprintf(stderr,
+            "Warning: scenario '%s' reports %zu bytes of memory, but only %zu"
+            " bytes were freed with the engine.\n",
+            name.c_str(), result->teardown_reported_bytes,
+            result->teardown_heap_bytes);
+  }
+
+  if (options.processor_stats) {
+    motive::OutputBenchmarks();
+  }
+  motive::ClearBenchmarks();
+
+  // Analyze the frame times.
+  const double total_usec =
+      TimeToUsec(frame_times.Average()) * params.num_frames;
+  result->total_seconds = total_usec / kMicrosecondsPerSecond;
+  result->indices_per_second =
+      result->total_seconds > 0.0
+          ? static_cast<double>(result->num_indices) * params.num_frames /
+                result->total_seconds
+          : 0.0;
+  result->mean_usec = TimeToUsec(frame_times.Average());
+  result->p50_usec = TimeToUsec(frame_times.Percentile(50.0));
+  result->p90_usec = TimeToUsec(frame_times.Percentile(90.0));
+  result->p99_usec = TimeToUsec(frame_times.Percentile(99.0));
+  result->p99_9_usec = TimeToUsec(frame_times.Percentile(99.9));
+  result->max_usec = TimeToUsec(frame_times.Max());
+  return true;
+}
+
+static void OutputJson(const BenchmarkerOptions& options,
+                       const std::vector<ScenarioResult>& results, FILE* f) {
+  const ScenarioParams& params = options.params;
+  fprintf(f, "{\n");
+  fprintf(f,
+          "  \"params\": {\"count\": %d, \"frames\": %d, \"warmup_frames\": %d,"
+          " \"delta_time\": %d, \"seed\": %u, \"look_ahead\": %s},\n",
+          params.num_motivators, params.num_frames, params.num_warmup_frames,
+          params.delta_time, static_cast<unsigned int>(params.seed),
+          options.look_ahead ? "true" : "false");
+  fprintf(f, "  \"scenarios\": [\n");
+  for (size_t i = 0; i < results.size(); ++i) {
+    const ScenarioResult& r = results[i];
+    fprintf(f, "    {\n");
+    fprintf(f, "      \"name\": \"%s\",\n", r.name.c_str());
+    fprintf(f, "      \"indices\": %d,\n", r.num_indices);
+    fprintf(f, "      \"total_seconds\": %.6f,\n", r.total_seconds);
+    fprintf(f, "      \"indices_per_second\": %.1f,\n", r.indices_per_second);
+    fprintf(f,
+            "      \"frame_usec\": {\"mean\": %.3f, \"p50\": %.3f, "
+            "\"p90\": %.3f, \"p99\": %.3f, \"p99_9\": %.3f, \"max\": %.3f},\n",
+            r.mean_usec, r.p50_usec, r.p90_usec, r.p99_usec, r.p99_9_usec,
+            r.max_usec);
+    const MotiveProcessorCounters& c = r.counters;
+    fprintf(f,
+            "      \"counters\": {\"motivators_initialized\": %llu, "
+            "\"defragment_moves\": %llu, \"segment_transitions\": %llu, "
+            "\"look_ahead_hits\": %llu, "
+            "\"blends_started\": %llu, \"set_target_calls\": %llu, "
+            "\"reallocations\": %llu},\n",
+            static_cast<unsigned long long>(c.motivators_initialized),
+            static_cast<unsigned long long>(c.defragment_moves),
+            static_cast<unsigned long long>(c.segment_transitions),
+            static_cast<unsigned long long>(c.look_ahead_hits),
+            static_cast<unsigned long long>(c.blends_started),
+            static_cast<unsigned long long>(c.set_target_calls),
+            static_cast<unsigned long long>(c.reallocations));
+    const MotiveMemoryUsage& m = r.memory;
+    fprintf(f, "      \"memory\": {");
+    for (int j = 0; j < motive::kNumMemoryCategories; ++j) {
+      const MemoryCategory category = static_cast<MemoryCategory>(j);
+      fprintf(f, "\"%s\": {\"used\": %zu, \"allocated\": %zu}, ",
+              MotiveMemoryUsage::CategoryName(category), m.used_bytes[j],
+              m.allocated_bytes[j]);
+    }
+    fprintf(f,
+            "\"total_used\": %zu, \"total_allocated\": %zu, "
+            "\"teardown_reported\": %zu, \"teardown_heap\": %zu, "
+            "\"content\": %zu},\n",
+            m.TotalUsed(), m.TotalAllocated(), r.teardown_reported_bytes,
+            r.teardown_heap_bytes, r.content_bytes);
+    fprintf(f, "      \"spikes\": %d\n", r.num_spikes);
+    fprintf(f, "    }%s\n", i + 1 < results.size() ? "," : "");
+  }
+  fprintf(f, "  ]\n");
+  fprintf(f, "}\n");
+}
+
+int main(int argc, char** argv) {
+  BenchmarkerOptions options;
+  if (!ParseOptions(argc, argv, &options)) return 1;
 
-int main() {
   motive::InitBenchmarks(kNumBenchmarkIds);
-  MotiveBenchmarker benchmarker;
-  benchmarker.Run();
+  if (options.trace_file != nullptr) {
+    motive::StartBenchmarkTrace(kMaxTraceEvents);
+  }
+  if (options.counters && !motive::EnableBenchmarkCounters()) {
+    fprintf(stderr,
+            "Hardware counters are unavailable. Reporting timing only.\n");
+  }
+
+  std::vector<ScenarioResult> results;
+  results.reserve(options.scenarios.size());
+  for (size_t i = 0; i < options.scenarios.size(); ++i) {
+    ScenarioResult result;
+    if (!RunScenario(options.scenarios[i], options, &result)) return 1;
+    results.push_back(result);
+  }
+
+  if (options.trace_file != nullptr) {
+    motive::StopBenchmarkTrace();
+    if (!motive::OutputBenchmarkTrace(options.trace_file)) {
+      fprintf(stderr, "Could not write trace to '%s'.\n", options.trace_file);
+      return 1;
+    }
+  }
+
+  FILE* f = stdout;
+  if (options.output_file != nullptr) {
+    f = fopen(options.output_file, "w");
+    if (f == nullptr) {
+      fprintf(stderr, "Could not open '%s' for writing.\n",
+              options.output_file);
+      return 1;
+    }
+  }
+  OutputJson(options, results, f);
+  if (f != stdout) fclose(f);
   return 0;
 }
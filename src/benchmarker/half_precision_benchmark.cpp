@@ -0,0 +1,377 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Compares BulkSplineEvaluator's half-precision mode against the default
+// fp32 layout, for bandwidth and accuracy.
+//
+// Two evaluators play the same splines, from the same start times, at the
+// same rates. One uses each layout. Every frame, both are advanced, and their
+// x and y values are compared. Segment lengths are random, so almost none of
+// their ends are exact in half precision, which is the worst case for
+// accuracy.
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "benchmark_scenarios.h"
+#include "motive/math/bulk_spline_evaluator.h"
+#include "motive/math/compact_spline.h"
+
+using motive::BenchmarkRandom;
+using motive::BulkSplineEvaluator;
+using motive::CompactSpline;
+using motive::CompactSplineIndex;
+using motive::MotiveMemoryUsage;
+using motive::OptionValue;
+using motive::Range;
+using motive::ScenarioParams;
+using motive::SplinePlayback;
+using motive::SplitCommas;
+using motive::UncompressedNode;
+using motive::kMicrosecondsPerSecond;
+
+typedef std::chrono::steady_clock Clock;
+
+static const int kDefaultCounts[] = {1000, 10000, 100000, 1000000};
+static const int kDefaultNumFrames = 100;
+static const int kDefaultNumWarmupFrames = 10;
+static const int kDefaultDeltaTime = 16;
+static const double kBytesPerGigabyte = 1e9;
+
+// Splines are shared by the indices, like clips are shared by a crowd.
+// Nodes are spaced irregularly, like keys in authored animation. Keys have y
+// values in [-1, 1], so y errors are relative to an amplitude of about 1.
+// The spline's y range is wider, for the dual-cubic mid-nodes.
+static const int kNumSplines = 16;
+static const int kNumSplineNodes = 64;
+static const float kMinNodeSpacing = 10.0f;
+static const float kMaxNodeSpacing = 50.0f;
+static const float kMinRate = 0.5f;
+static const float kMaxRate = 2.0f;
+
+// Options parsed from the command line.
+struct HalfOptions {
+  HalfOptions() : json(false), output_file(nullptr) {
+    params.num_frames = kDefaultNumFrames;
+    params.num_warmup_frames = kDefaultNumWarmupFrames;
+    params.delta_time = kDefaultDeltaTime;
+  }
+
+  ScenarioParams params;
+  std::vector<int> counts;
+  bool json;
+  const char* output_file;
+};
+
+// One layout at one count.
+struct HalfResult {
+  HalfResult()
+      : layout(nullptr),
+        count(0),
+        frame_usec(0.0),
+        indices_per_second(0.0),
+        advance_bytes_per_index(0),
+        bytes_per_frame(0),
+        gigabytes_per_second(0.0),
+        max_x_error(0.0f),
+        max_y_error(0.0f),
+        mean_y_error(0.0) {}
+
+  const char* layout;
+  int count;
+  double frame_usec;
+  double indices_per_second;
+
+  // Bytes read per index to advance x: x, rate, and segment end.
+  size_t advance_bytes_per_index;
+
+  // Per-index arrays streamed through every frame, and the rate at which
+  // they were streamed. Same estimate as scaling_benchmark.
+  size_t bytes_per_frame;
+  double gigabytes_per_second;
+
+  // Largest and mean difference from the fp32 layout, over every index of
+  // every measured frame. Zero for the fp32 layout.
+  float max_x_error;
+  float max_y_error;
+  double mean_y_error;
+};
+
+static void PrintUsage(const char* program) {
+  printf(
+      "Usage: %s [options]\n"
+      "  --counts=a,b,...     Spline indices. Default 1000 to 1000000.\n"
+      "  --frames=N           Frames to measure.\n"
+      "  --warmup=N           Frames to run before measuring.\n"
+      "  --delta_time=N       Time passed to AdvanceFrame() each frame.\n"
+      "  --seed=N             Seed for the splines, start times, and rates.\n"
+      "  --json               Output JSON instead of CSV.\n"
+      "  --output=FILE        Write results to FILE instead of stdout.\n",
+      program);
+}
+
+// Returns false if the program should exit without running benchmarks.
+static bool ParseOptions(int argc, char** argv, HalfOptions* options) {
+  ScenarioParams& params = options->params;
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    const char* value = nullptr;
+    if ((value = OptionValue(arg, "counts")) != nullptr) {
+      std::vector<std::string> counts;
+      SplitCommas(value, &counts);
+      for (size_t j = 0; j < counts.size(); ++j) {
+        options->counts.push_back(atoi(counts[j].c_str()));
+      }
+    } else if ((value = OptionValue(arg, "frames")) != nullptr) {
+      params.num_frames = atoi(value);
+    } else if ((value = OptionValue(arg, "warmup")) != nullptr) {
+      params.num_warmup_frames = atoi(value);
+    } else if ((value = OptionValue(arg, "delta_time")) != nullptr) {
+      params.delta_time = atoi(value);
+    } else if ((value = OptionValue(arg, "seed")) != nullptr) {
+      params.seed = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+    } else if ((value = OptionValue(arg, "output")) != nullptr) {
+      options->output_file = value;
+    } else if (strcmp(arg, "--json") == 0) {
+      options->json = true;
+    } else {
+      PrintUsage(argv[0]);
+      return false;
+    }
+  }
+
+  if (options->counts.empty()) {
+    options->counts.assign(
+        kDefaultCounts, kDefaultCounts + MOTIVE_ARRAY_SIZE(kDefaultCounts));
+  }
+
+  bool positive = params.num_frames > 0 && params.num_warmup_frames >= 0 &&
+                  params.delta_time > 0;
+  for (size_t i = 0; i < options->counts.size(); ++i) {
+    positive = positive && options->counts[i] > 0;
+  }
+  if (!positive) {
+    fprintf(stderr, "Counts and times must be positive.\n");
+    return false;
+  }
+  return true;
+}
+
+// Caller must call CompactSpline::Destroy() on every spline.
+static void CreateSplines(BenchmarkRandom* random,
+                          std::vector<CompactSpline*>* splines) {
+  for (int i = 0; i < kNumSplines; ++i) {
+    // AddNodes() may insert a dual-cubic mid-node between every pair of nodes.
+    CompactSpline* spline = CompactSpline::Create(
+        static_cast<CompactSplineIndex>(2 * kNumSplineNodes - 1));
+    spline->Init(Range(-2.0f, 2.0f),
+                 CompactSpline::RecommendXGranularity(kNumSplineNodes *
+                                                      kMaxNodeSpacing));
+    // The last node matches the first, so that the splines loop smoothly.
+    // Otherwise the y values of the two layouts would differ by a jump
+    // whenever only one of them has wrapped around.
+    const float start_y = random->Float(-1.0f, 1.0f);
+    const float start_derivative =
+        random->Float(-1.0f, 1.0f) / kMaxNodeSpacing;
+    std::vector<UncompressedNode> nodes(kNumSplineNodes);
+    float x = 0.0f;
+    for (int j = 0; j < kNumSplineNodes; ++j) {
+      const bool end = j == 0 || j == kNumSplineNodes - 1;
+      nodes[j].x = x;
+      nodes[j].y = end ? start_y : random->Float(-1.0f, 1.0f);
+      nodes[j].derivative =
+          end ? start_derivative
+              : random->Float(-1.0f, 1.0f) / kMaxNodeSpacing;
+      x += random->Float(kMinNodeSpacing, kMaxNodeSpacing);
+    }
+    spline->AddNodes(&nodes[0], nodes.size());
+    splines->push_back(spline);
+  }
+}
+
+static void Advance(BulkSplineEvaluator* evaluator, float delta_x,
+                    double* seconds) {
+  const Clock::time_point start = Clock::now();
+  evaluator->AdvanceFrame(delta_x);
+  *seconds += std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void FillThroughput(int num_frames, double seconds,
+                           const BulkSplineEvaluator& evaluator,
+                           HalfResult* result) {
+  result->frame_usec = seconds * kMicrosecondsPerSecond / num_frames;
+  result->indices_per_second =
+      seconds > 0.0 ? static_cast<double>(result->count) * num_frames / seconds
+                    : 0.0;
+  const MotiveMemoryUsage memory = evaluator.MemoryUsage();
+  result->bytes_per_frame = memory.used_bytes[motive::kMemoryIndexArrays];
+  result->gigabytes_per_second =
+      seconds > 0.0 ? static_cast<double>(result->bytes_per_frame) *
+                          num_frames / seconds / kBytesPerGigabyte
+                    : 0.0;
+}
+
+// Play `count` indices in both layouts, and measure each.
+static void RunCount(int count, const std::vector<CompactSpline*>& splines,
+                     const ScenarioParams& params, HalfResult* full,
+                     HalfResult* half) {
+  BulkSplineEvaluator evaluators[2];
+  evaluators[1].set_half_precision(true);
+  assert(evaluators[1].half_precision());
+
+  BenchmarkRandom random(params.seed + static_cast<uint32_t>(count));
+  for (int j = 0; j < 2; ++j) {
+    evaluators[j].SetNumIndices(count);
+  }
+  for (int i = 0; i < count; ++i) {
+    const CompactSpline* spline = splines[random.Int(kNumSplines)];
+    const SplinePlayback playback(random.Float(0.0f, spline->EndX()), true,
+                                  random.Float(kMinRate, kMaxRate));
+    for (int j = 0; j < 2; ++j) {
+      evaluators[j].SetSplines(i, 1, spline, playback);
+    }
+  }
+
+  const float delta_x = static_cast<float>(params.delta_time);
+  double seconds[2] = {0.0, 0.0};
+  double y_error_sum = 0.0;
+  for (int frame = 0; frame < params.num_warmup_frames + params.num_frames;
+       ++frame) {
+    // Alternate the order, so that neither layout always runs with the
+    // caches warmed by the other.
+    const bool measure = frame >= params.num_warmup_frames;
+    double ignored = 0.0;
+    for (int k = 0; k < 2; ++k) {
+      const int j = (frame + k) % 2;
+      Advance(&evaluators[j], delta_x, measure ? &seconds[j] : &ignored);
+    }
+    if (!measure) continue;
+
+    for (int i = 0; i < count; ++i) {
+      // When only one layout has wrapped around to the start of the spline,
+      // the x values differ by about the spline's length.
+      const CompactSpline* spline = evaluators[0].SourceSpline(i);
+      const float length = spline->EndX() - spline->StartX();
+      const float x_difference =
+          fabsf(evaluators[1].X(i) - evaluators[0].X(i));
+      const float x_error = std::min(x_difference, length - x_difference);
+      const float y_error = fabsf(evaluators[1].Y(i) - evaluators[0].Y(i));
+      half->max_x_error = std::max(half->max_x_error, x_error);
+      half->max_y_error = std::max(half->max_y_error, y_error);
+      y_error_sum += y_error;
+    }
+  }
+
+  full->layout = "fp32";
+  half->layout = "half";
+  full->count = half->count = count;
+  full->advance_bytes_per_index = 3 * sizeof(float);
+  half->advance_bytes_per_index = 2 * sizeof(float) + sizeof(uint16_t);
+  FillThroughput(params.num_frames, seconds[0], evaluators[0], full);
+  FillThroughput(params.num_frames, seconds[1], evaluators[1], half);
+  half->mean_y_error =
+      y_error_sum / (static_cast<double>(count) * params.num_frames);
+}
+
+static void OutputCsv(const std::vector<HalfResult>& results, FILE* f) {
+  fprintf(f,
+          "layout,count,frame_usec,indices_per_second,"
+          "advance_bytes_per_index,bytes_per_frame,gigabytes_per_second,"
+          "max_x_error,max_y_error,mean_y_error\n");
+  for (size_t i = 0; i < results.size(); ++i) {
+    const HalfResult& r = results[i];
+    fprintf(f, "%s,%d,%.3f,%.1f,%zu,%zu,%.3f,%g,%g,%g\n", r.layout, r.count,
+            r.frame_usec, r.indices_per_second, r.advance_bytes_per_index,
+            r.bytes_per_frame, r.gigabytes_per_second, r.max_x_error,
+            r.max_y_error, r.mean_y_error);
+  }
+}
+
+static void OutputJson(const ScenarioParams& params,
+                       const std::vector<HalfResult>& results, FILE* f) {
+  fprintf(f, "{\n");
+  fprintf(f,
+          "  \"params\": {\"frames\": %d, \"warmup_frames\": %d,"
+          " \"delta_time\": %d, \"seed\": %u},\n",
+          params.num_frames, params.num_warmup_frames, params.delta_time,
+          static_cast<unsigned int>(params.seed));
+  fprintf(f, "  \"results\": [\n");
+  for (size_t i = 0; i < results.size(); ++i) {
+    const HalfResult& r = results[i];
+    fprintf(f,
+            "    {\"layout\": \"%s\", \"count\": %d, \"frame_usec\": %.3f, "
+            "\"indices_per_second\": %.1f, \"advance_bytes_per_index\": %zu, "
+            "\"bytes_per_frame\": %zu, \"gigabytes_per_second\": %.3f, "
+            "\"max_x_error\": %g, \"max_y_error\": %g, "
+            "\"mean_y_error\": %g}%s\n",
+            r.layout, r.count, r.frame_usec, r.indices_per_second,
+            r.advance_bytes_per_index, r.bytes_per_frame,
+            r.gigabytes_per_second, r.max_x_error, r.max_y_error,
+            r.mean_y_error, i + 1 < results.size() ? "," : "");
+  }
+  fprintf(f, "  ]\n");
+  fprintf(f, "}\n");
+}
+
+int main(int argc, char** argv) {
+  HalfOptions options;
+  if (!ParseOptions(argc, argv, &options)) return 1;
+
+  if (!motive::HalfPrecisionAvailable()) {
+    fprintf(stderr,
+            "Half-precision mode is unavailable. Build with the motive_f16c "
+            "CMake option.\n");
+    return 1;
+  }
+
+  BenchmarkRandom random(options.params.seed);
+  std::vector<CompactSpline*> splines;
+  CreateSplines(&random, &splines);
+
+  std::vector<HalfResult> results;
+  for (size_t c = 0; c < options.counts.size(); ++c) {
+    HalfResult full;
+    HalfResult half;
+    RunCount(options.counts[c], splines, options.params, &full, &half);
+    results.push_back(full);
+    results.push_back(half);
+  }
+
+  for (size_t i = 0; i < splines.size(); ++i) {
+    CompactSpline::Destroy(splines[i]);
+  }
+
+  FILE* f = stdout;
+  if (options.output_file != nullptr) {
+    f = fopen(options.output_file, "w");
+    if (f == nullptr) {
+      fprintf(stderr, "Could not open '%s' for writing.\n",
+              options.output_file);
+      return 1;
+    }
+  }
+  if (options.json) {
+    OutputJson(options.params, results, f);
+  } else {
+    OutputCsv(results, f);
+  }
+  if (f != stdout) fclose(f);
+  return 0;
+}
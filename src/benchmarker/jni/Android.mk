@@ -40,6 +40,8 @@ LOCAL_C_INCLUDES := \
 # MOTIVE_TEST_ASSEMBLY := 1
 
 LOCAL_SRC_FILES := \
+  $(MOTIVE_RELATIVE_DIR)/src/benchmarker/allocation_tracker.cpp \
+  $(MOTIVE_RELATIVE_DIR)/src/benchmarker/benchmark_scenarios.cpp \
   $(MOTIVE_RELATIVE_DIR)/src/benchmarker/benchmarker.cpp
 
 LOCAL_WHOLE_STATIC_LIBRARIES:=android_native_app_glue libfplutil_main \
@@ -0,0 +1,582 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Plays real rig animations on a crowd of RigMotivators, without a window or
+// GPU.
+//
+// Loads a directory of .motiveanim files, or an AnimTable (.motivetab) or
+// AnimList (.motivelist), and spawns rigs that play random clips from random
+// start times. Every frame, rigs whose clip is ending, plus a random share of
+// the others, blend to a new clip. Times the blend starts, the call to
+// MotiveEngine::AdvanceFrame(), and the copy of every rig's global transforms
+// into a skinning buffer, separately.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#if !defined(_WIN32)
+#include <dirent.h>
+#endif
+#include "anim_generated.h"
+#include "anim_list_generated.h"
+#include "anim_table_generated.h"
+#include "benchmark_scenarios.h"
+#include "motive/anim.h"
+#include "motive/anim_table.h"
+#include "motive/engine.h"
+#include "motive/init.h"
+#include "motive/motivator.h"
+#include "motive/util/benchmark.h"
+#include "motive/util/log_histogram.h"
+
+using mathfu::AffineTransform;
+using motive::AnimTable;
+using motive::BenchmarkRandom;
+using motive::BenchmarkTime;
+using motive::LogHistogram;
+using motive::MotiveEngine;
+using motive::MotiveProcessorCounters;
+using motive::MotiveTime;
+using motive::OptionValue;
+using motive::RigAnim;
+using motive::RigInit;
+using motive::RigMotivator;
+using motive::SplinePlayback;
+using motive::kMicrosecondsPerSecond;
+
+static const int kDefaultNumRigs = 1000;
+static const int kDefaultNumFrames = 1000;
+static const int kDefaultNumWarmupFrames = 100;
+
+// Animations are authored in milliseconds, so this is roughly 60Hz.
+static const MotiveTime kDefaultDeltaTime = 16;
+static const MotiveTime kDefaultMaxBlendTime = 250;
+static const float kDefaultBlendPercent = 1.0f;
+static const char kAnimExtension[] = ".motiveanim";
+
+// Options parsed from the command line.
+struct PlaybackOptions {
+  PlaybackOptions()
+      : num_rigs(kDefaultNumRigs),
+        num_frames(kDefaultNumFrames),
+        num_warmup_frames(kDefaultNumWarmupFrames),
+        delta_time(kDefaultDeltaTime),
+        max_blend_time(kDefaultMaxBlendTime),
+        blend_percent(kDefaultBlendPercent),
+        seed(1),
+        output_file(nullptr),
+        look_ahead(false) {}
+
+  std::vector<std::string> inputs;
+  int num_rigs;
+  int num_frames;
+  int num_warmup_frames;
+  MotiveTime delta_time;
+  MotiveTime max_blend_time;
+  float blend_percent;
+  uint32_t seed;
+  const char* output_file;
+  bool look_ahead;
+};
+
+// Distribution of the time spent in one phase of the frame.
+struct PhaseResult {
+  PhaseResult()
+      : mean_usec(0.0),
+        p50_usec(0.0),
+        p90_usec(0.0),
+        p99_usec(0.0),
+        max_usec(0.0) {}
+
+  double mean_usec;
+  double p50_usec;
+  double p90_usec;
+  double p99_usec;
+  double max_usec;
+};
+
+enum PlaybackPhase {
+  kPhaseBlendStarts,
+  kPhaseAdvanceFrame,
+  kPhaseTransformOutput,
+  kPhaseFrame,
+  kNumPlaybackPhases
+};
+
+static const char* const kPhaseNames[] = {"blend_starts", "advance_frame",
+                                          "transform_output", "frame"};
+
+struct PlaybackResult {
+  PlaybackResult()
+      : num_objects(0),
+        num_clips(0),
+        num_rigs(0),
+        num_bones(0),
+        num_blends(0),
+        blend_usec(0.0),
+        bones_per_second(0.0),
+        segment_transitions(0),
+        look_ahead_hits(0),
+        table_bytes(0),
+        engine_bytes(0) {}
+
+  int num_objects;
+  int num_clips;
+  int num_rigs;
+
+  // Total bones in all the rigs. One matrix is output for each.
+  int num_bones;
+
+  // Blends started during the measured frames, and the mean time to start
+  // one.
+  int num_blends;
+  double blend_usec;
+  double bones_per_second;
+  PhaseResult phases[kNumPlaybackPhases];
+
+  // Segment transitions in the measured frames, and how many of them used a
+  // segment precomputed by --look_ahead.
+  uint64_t segment_transitions;
+  uint64_t look_ahead_hits;
+
+  // Memory held by the loaded animations, and by the engine for the rigs.
+  size_t table_bytes;
+  size_t engine_bytes;
+};
+
+static void PrintUsage(const char* program) {
+  printf(
+      "Usage: %s [options] input...\n"
+      "  input                A directory holding .motiveanim files, any\n"
+      "                       number of .motiveanim files, or a single\n"
+      "                       .motivetab or .motivelist file.\n"
+      "  --rigs=N             Rigs to animate. Default %d.\n"
+      "  --frames=N           Frames to measure.\n"
+      "  --warmup=N           Frames to run before measuring.\n"
+      "  --delta_time=N       Time passed to AdvanceFrame() each frame.\n"
+      "  --max_blend_time=N   Blends take a random time up to N.\n"
+      "  --blend_percent=F    Percent of rigs that blend to a new clip every\n"
+      "                       frame, in addition to those whose clip ends.\n"
+      "  --seed=N             Seed for the random clips, times, and blends.\n"
+      "  --look_ahead         Precompute each spline's next segment. See\n"
+      "                       MotiveEngine::EnableLookAhead().\n"
+      "  --output=FILE        Write JSON results to FILE instead of stdout.\n",
+      program, kDefaultNumRigs);
+}
+
+// Returns false if the program should exit without running the benchmark.
+static bool ParseOptions(int argc, char** argv, PlaybackOptions* options) {
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    const char* value = nullptr;
+    if ((value = OptionValue(arg, "rigs")) != nullptr) {
+      options->num_rigs = atoi(value);
+    } else if ((value = OptionValue(arg, "frames")) != nullptr) {
+      options->num_frames = atoi(value);
+    } else if ((value = OptionValue(arg, "warmup")) != nullptr) {
+      options->num_warmup_frames = atoi(value);
+    } else if ((value = OptionValue(arg, "delta_time")) != nullptr) {
+      options->delta_time = atoi(value);
+    } else if ((value = OptionValue(arg, "max_blend_time")) != nullptr) {
+      options->max_blend_time = atoi(value);
+    } else if ((value = OptionValue(arg, "blend_percent")) != nullptr) {
+      options->blend_percent = static_cast<float>(atof(value));
+    } else if ((value = OptionValue(arg, "seed")) != nullptr) {
+      options->seed = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+    } else if ((value = OptionValue(arg, "output")) != nullptr) {
+      options->output_file = value;
+    } else if (strcmp(arg, "--look_ahead") == 0) {
+      options->look_ahead = true;
+    } else if (strncmp(arg, "--", 2) != 0) {
+      options->inputs.push_back(arg);
+    } else {
+      PrintUsage(argv[0]);
+      return false;
+    }
+  }
+
+  if (options->inputs.empty()) {
+    PrintUsage(argv[0]);
+    return false;
+  }
+  if (options->num_rigs <= 0 || options->num_frames <= 0 ||
+      options->num_warmup_frames < 0 || options->delta_time <= 0 ||
+      options->max_blend_time < 0 || options->blend_percent < 0.0f) {
+    fprintf(stderr, "Counts, times, and percents must be positive.\n");
+    return false;
+  }
+  return true;
+}
+
+static bool LoadFile(const char* file_name, std::string* dest) {
+  FILE* f = fopen(file_name, "rb");
+  if (f == nullptr) return false;
+
+  fseek(f, 0, SEEK_END);
+  const long len = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  bool ok = len >= 0;
+  if (ok) {
+    dest->resize(static_cast<size_t>(len));
+    ok = len == 0 || fread(&(*dest)[0], 1, dest->size(), f) == dest->size();
+  }
+  fclose(f);
+  return ok;
+}
+
+// AnimTable::LoadFn that reads straight from the file system.
+static const char* AnimLoadFn(const char* file_name, std::string* scratch_buf) {
+  if (!LoadFile(file_name, scratch_buf)) {
+    fprintf(stderr, "Could not load animation file '%s'.\n", file_name);
+    return nullptr;
+  }
+  return scratch_buf->c_str();
+}
+
+static bool EndsWith(const std::string& s, const char* suffix) {
+  const size_t suffix_len = strlen(suffix);
+  return s.size() >= suffix_len &&
+         s.compare(s.size() - suffix_len, suffix_len, suffix) == 0;
+}
+
+static bool IsDirectory(const std::string& name) {
+#if defined(_WIN32)
+  (void)name;
+  return false;
+#else
+  DIR* dir = opendir(name.c_str());
+  if (dir == nullptr) return false;
+  closedir(dir);
+  return true;
+#endif
+}
+
+// Append the names of all .motiveanim files in `dir_name` to `file_names`.
+// Returns false if `dir_name` is not a directory.
+static bool ListAnimFiles(const std::string& dir_name,
+                          std::vector<std::string>* file_names) {
+#if defined(_WIN32)
+  (void)dir_name;
+  (void)file_names;
+  return false;
+#else
+  DIR* dir = opendir(dir_name.c_str());
+  if (dir == nullptr) return false;
+
+  // Sort so that the same seed picks the same clips on every file system.
+  std::vector<std::string> found;
+  for (dirent* entry = readdir(dir); entry != nullptr; entry = readdir(dir)) {
+    const std::string name(entry->d_name);
+    if (EndsWith(name, kAnimExtension)) found.push_back(dir_name + "/" + name);
+  }
+  closedir(dir);
+  std::sort(found.begin(), found.end());
+  file_names->insert(file_names->end(), found.begin(), found.end());
+  return true;
+#endif
+}
+
+// Load `inputs` into `table`. A single AnimTable or AnimList file is loaded
+// as is. Otherwise, every .motiveanim file (or directory of them) becomes an
+// animation for one object.
+static bool LoadAnimTable(const std::vector<std::string>& inputs,
+                          AnimTable* table) {
+  if (inputs.size() == 1 && !EndsWith(inputs[0], kAnimExtension) &&
+      !IsDirectory(inputs[0])) {
+    std::string buf;
+    if (LoadFile(inputs[0].c_str(), &buf)) {
+      if (motive::AnimTableFbBufferHasIdentifier(buf.c_str())) {
+        return table->InitFromFlatBuffers(*motive::GetAnimTableFb(buf.c_str()),
+                                          AnimLoadFn);
+      }
+      if (motive::AnimListFbBufferHasIdentifier(buf.c_str())) {
+        return table->InitFromFlatBuffers(*motive::GetAnimListFb(buf.c_str()),
+                                          AnimLoadFn);
+      }
+    }
+    fprintf(stderr, "'%s' is not a directory or animation file.\n",
+            inputs[0].c_str());
+    return false;
+  }
+
+  AnimTable::ListFileNames file_names;
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    if (EndsWith(inputs[i], kAnimExtension)) {
+      file_names.push_back(inputs[i]);
+    } else if (!ListAnimFiles(inputs[i], &file_names)) {
+      fprintf(stderr, "'%s' is not a directory or animation file.\n",
+              inputs[i].c_str());
+      return false;
+    }
+  }
+  if (file_names.empty()) {
+    fprintf(stderr, "No %s files found.\n", kAnimExtension);
+    return false;
+  }
+  return table->InitFromAnimFileNames(file_names, AnimLoadFn);
+}
+
+// A rig in the crowd, and the clips it can play. Only clips of the same
+// object share a skeleton, so a rig never blends to another object's clips.
+struct CrowdRig {
+  RigMotivator motivator;
+  const std::vector<const RigAnim*>* clips;
+};
+
+class RigPlayback {
+ public:
+  RigPlayback(const AnimTable& table, const PlaybackOptions& options)
+      : table_(table), options_(options), random_(options.seed) {}
+
+  // Returns false if `table` holds no clips to play.
+  bool Setup(MotiveEngine* engine, PlaybackResult* result) {
+    clips_.resize(table_.NumObjects());
+    std::vector<int> objects;
+    for (int object = 0; object < table_.NumObjects(); ++object) {
+      for (int i = 0; i < table_.NumAnims(object); ++i) {
+        const RigAnim* clip = table_.Query(object, i);
+        if (clip != nullptr) clips_[object].push_back(clip);
+      }
+      if (!clips_[object].empty()) objects.push_back(object);
+      result->num_clips += static_cast<int>(clips_[object].size());
+    }
+    result->num_objects = static_cast<int>(objects.size());
+    if (objects.empty()) return false;
+
+    // Spread the rigs evenly over the objects, like a crowd of several
+    // character types.
+    int num_bones = 0;
+    rigs_.resize(options_.num_rigs);
+    for (size_t i = 0; i < rigs_.size(); ++i) {
+      const int object = objects[i % objects.size()];
+      const RigAnim& defining_anim = table_.DefiningAnim(object);
+      CrowdRig& rig = rigs_[i];
+      rig.clips = &clips_[object];
+      rig.motivator.Initialize(
+          RigInit(defining_anim, defining_anim.bone_parents(),
+                  defining_anim.NumBones()),
+          engine);
+      StartClip(&rig, 0);
+      num_bones += defining_anim.NumBones();
+    }
+    transforms_.resize(num_bones);
+    result->num_rigs = static_cast<int>(rigs_.size());
+    result->num_bones = num_bones;
+    return true;
+  }
+
+  // Start new clips. Returns the number of blends started.
+  int BlendStarts() {
+    const float blend_fraction = options_.blend_percent / 100.0f;
+    int num_blends = 0;
+    for (size_t i = 0; i < rigs_.size(); ++i) {
+      CrowdRig& rig = rigs_[i];
+      const bool clip_ending =
+          rig.motivator.TimeRemaining() < options_.delta_time;
+      if (!clip_ending && random_.Float(0.0f, 1.0f) >= blend_fraction) continue;
+
+      StartClip(&rig, options_.max_blend_time);
+      num_blends++;
+    }
+    return num_blends;
+  }
+
+  // Copy every rig's bone matrices into one buffer, as a renderer would
+  // before skinning.
+  void TransformOutput() {
+    AffineTransform* out = transforms_.data();
+    for (size_t i = 0; i < rigs_.size(); ++i) {
+      const RigMotivator& rig = rigs_[i].motivator;
+      const int num_bones = rig.DefiningAnim()->NumBones();
+      const AffineTransform* global_transforms = rig.GlobalTransforms();
+      out = std::copy(global_transforms, global_transforms + num_bones, out);
+    }
+  }
+
+ private:
+  // Time for one play through `clip`. Unlike RigAnim::end_time(), finite
+  // for repeating clips too.
+  static MotiveTime ClipLength(const RigAnim& clip) {
+    MotiveTime length = 0;
+    for (motive::BoneIndex i = 0; i < clip.NumBones(); ++i) {
+      length = std::max(length, clip.Anim(i).ops().EndTime());
+    }
+    return length;
+  }
+
+  // Blend `rig` to a random clip, from a random start time, over a random
+  // time up to `max_blend_time`.
+  void StartClip(CrowdRig* rig, MotiveTime max_blend_time) {
+    const std::vector<const RigAnim*>& clips = *rig->clips;
+    const RigAnim& clip =
+        *clips[random_.Int(static_cast<int>(clips.size()))];
+    const float start_time =
+        random_.Float(0.0f, static_cast<float>(ClipLength(clip)));
+    const float blend_time =
+        random_.Float(0.0f, static_cast<float>(max_blend_time));
+    rig->motivator.BlendToAnim(
+        clip, SplinePlayback(start_time, clip.repeat(), 1.0f, blend_time));
+  }
+
+  const AnimTable& table_;
+  const PlaybackOptions& options_;
+  BenchmarkRandom random_;
+
+  // The non-empty clips of each object in the table.
+  std::vector<std::vector<const RigAnim*> > clips_;
+  std::vector<CrowdRig> rigs_;
+
+  // Destination of TransformOutput(). One matrix for every bone of every rig.
+  std::vector<AffineTransform> transforms_;
+};
+
+static double TimeToUsec(double time) {
+  return motive::BenchmarkTimeToSeconds(1) * time * kMicrosecondsPerSecond;
+}
+
+static void AnalyzePhase(const LogHistogram& times, PhaseResult* phase) {
+  phase->mean_usec = TimeToUsec(times.Average());
+  phase->p50_usec = TimeToUsec(static_cast<double>(times.Percentile(50.0)));
+  phase->p90_usec = TimeToUsec(static_cast<double>(times.Percentile(90.0)));
+  phase->p99_usec = TimeToUsec(static_cast<double>(times.Percentile(99.0)));
+  phase->max_usec = TimeToUsec(static_cast<double>(times.Max()));
+}
+
+static bool RunPlayback(const AnimTable& table, const PlaybackOptions& options,
+                        PlaybackResult* result) {
+  // The rigs reference processors owned by the engine, so they must be
+  // destroyed before the engine.
+  MotiveEngine engine;
+  engine.EnableLookAhead(options.look_ahead);
+  RigPlayback playback(table, options);
+  if (!playback.Setup(&engine, result)) {
+    fprintf(stderr, "No animations to play.\n");
+    return false;
+  }
+
+  for (int i = 0; i < options.num_warmup_frames; ++i) {
+    playback.BlendStarts();
+    engine.AdvanceFrame(options.delta_time);
+    playback.TransformOutput();
+  }
+
+  LogHistogram times[kNumPlaybackPhases];
+  BenchmarkTime total_blend_time = 0;
+  const MotiveProcessorCounters counters_before = engine.TotalCounters();
+  for (int i = 0; i < options.num_frames; ++i) {
+    const BenchmarkTime start = motive::GetBenchmarkTime();
+    result->num_blends += playback.BlendStarts();
+    const BenchmarkTime blended = motive::GetBenchmarkTime();
+    engine.AdvanceFrame(options.delta_time);
+    const BenchmarkTime advanced = motive::GetBenchmarkTime();
+    playback.TransformOutput();
+    const BenchmarkTime end = motive::GetBenchmarkTime();
+
+    times[kPhaseBlendStarts].Append(blended - start);
+    times[kPhaseAdvanceFrame].Append(advanced - blended);
+    times[kPhaseTransformOutput].Append(end - advanced);
+    times[kPhaseFrame].Append(end - start);
+    total_blend_time += blended - start;
+  }
+
+  for (int i = 0; i < kNumPlaybackPhases; ++i) {
+    AnalyzePhase(times[i], &result->phases[i]);
+  }
+  const MotiveProcessorCounters counters =
+      engine.TotalCounters().Delta(counters_before);
+  result->segment_transitions = counters.segment_transitions;
+  result->look_ahead_hits = counters.look_ahead_hits;
+  result->blend_usec =
+      result->num_blends > 0
+          ? TimeToUsec(static_cast<double>(total_blend_time)) /
+                result->num_blends
+          : 0.0;
+  const double total_seconds = result->phases[kPhaseFrame].mean_usec *
+                               options.num_frames / kMicrosecondsPerSecond;
+  result->bones_per_second =
+      total_seconds > 0.0 ? static_cast<double>(result->num_bones) *
+                                options.num_frames / total_seconds
+                          : 0.0;
+  result->table_bytes = table.MemoryUsage().TotalAllocated();
+  result->engine_bytes = engine.MemoryUsage().TotalAllocated();
+  return true;
+}
+
+static void OutputJson(const PlaybackOptions& options,
+                       const PlaybackResult& result, FILE* f) {
+  fprintf(f, "{\n");
+  fprintf(f,
+          "  \"params\": {\"rigs\": %d, \"frames\": %d, \"warmup_frames\": %d,"
+          " \"delta_time\": %d, \"max_blend_time\": %d,"
+          " \"blend_percent\": %.3f, \"seed\": %u, \"look_ahead\": %s},\n",
+          options.num_rigs, options.num_frames, options.num_warmup_frames,
+          options.delta_time, options.max_blend_time, options.blend_percent,
+          static_cast<unsigned int>(options.seed),
+          options.look_ahead ? "true" : "false");
+  fprintf(f,
+          "  \"content\": {\"objects\": %d, \"clips\": %d, \"bones\": %d,"
+          " \"table_bytes\": %zu, \"engine_bytes\": %zu},\n",
+          result.num_objects, result.num_clips, result.num_bones,
+          result.table_bytes, result.engine_bytes);
+  fprintf(f,
+          "  \"blends\": %d,\n  \"blend_usec\": %.3f,\n"
+          "  \"bones_per_second\": %.1f,\n",
+          result.num_blends, result.blend_usec, result.bones_per_second);
+  fprintf(f,
+          "  \"segment_transitions\": %llu,\n  \"look_ahead_hits\": %llu,\n",
+          static_cast<unsigned long long>(result.segment_transitions),
+          static_cast<unsigned long long>(result.look_ahead_hits));
+  fprintf(f, "  \"phases\": {\n");
+  for (int i = 0; i < kNumPlaybackPhases; ++i) {
+    const PhaseResult& p = result.phases[i];
+    fprintf(f,
+            "    \"%s\": {\"mean_usec\": %.3f, \"p50_usec\": %.3f, "
+            "\"p90_usec\": %.3f, \"p99_usec\": %.3f, \"max_usec\": %.3f}%s\n",
+            kPhaseNames[i], p.mean_usec, p.p50_usec, p.p90_usec, p.p99_usec,
+            p.max_usec, i + 1 < kNumPlaybackPhases ? "," : "");
+  }
+  fprintf(f, "  }\n");
+  fprintf(f, "}\n");
+}
+
+int main(int argc, char** argv) {
+  PlaybackOptions options;
+  if (!ParseOptions(argc, argv, &options)) return 1;
+
+  motive::SplineInit::Register();
+  motive::MatrixInit::Register();
+  motive::RigInit::Register();
+
+  AnimTable table;
+  if (!LoadAnimTable(options.inputs, &table)) return 1;
+
+  PlaybackResult result;
+  if (!RunPlayback(table, options, &result)) return 1;
+
+  FILE* f = stdout;
+  if (options.output_file != nullptr) {
+    f = fopen(options.output_file, "w");
+    if (f == nullptr) {
+      fprintf(stderr, "Could not open '%s' for writing.\n",
+              options.output_file);
+      return 1;
+    }
+  }
+  OutputJson(options, result, f);
+  if (f != stdout) fclose(f);
+  return 0;
+}
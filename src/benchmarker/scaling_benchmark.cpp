@@ -0,0 +1,406 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Sweeps motivator counts against worker thread counts, to find where
+// animation stops scaling.
+//
+// Each worker thread owns a MotiveEngine, and updates a share of the
+// Motivators. Engines share no mutable state, so this is how a game can
+// spread animation over several cores. The results show when the workload
+// becomes limited by memory bandwidth instead of compute.
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "benchmark_scenarios.h"
+#include "motive/engine.h"
+
+using motive::BenchmarkScenario;
+using motive::MotiveEngine;
+using motive::MotiveMemoryUsage;
+using motive::OptionValue;
+using motive::ScenarioParams;
+using motive::SplitCommas;
+using motive::kMicrosecondsPerSecond;
+
+typedef std::chrono::steady_clock Clock;
+
+static const char* const kDefaultWorkloads[] = {"spline", "matrix",
+                                                "rig_crowd"};
+static const int kDefaultCounts[] = {1000, 10000, 100000, 1000000};
+static const int kDefaultNumFrames = 100;
+static const int kDefaultNumWarmupFrames = 10;
+static const double kBytesPerGigabyte = 1e9;
+
+// Options parsed from the command line.
+struct ScalingOptions {
+  ScalingOptions() : json(false), output_file(nullptr) {
+    params.num_frames = kDefaultNumFrames;
+    params.num_warmup_frames = kDefaultNumWarmupFrames;
+  }
+
+  ScenarioParams params;
+  std::vector<std::string> workloads;
+  std::vector<int> counts;
+  std::vector<int> threads;
+  bool json;
+  const char* output_file;
+};
+
+// One configuration of the sweep.
+struct ScalingResult {
+  ScalingResult()
+      : count(0),
+        threads(0),
+        indices(0),
+        frame_usec(0.0),
+        indices_per_second(0.0),
+        speedup(0.0),
+        efficiency(0.0),
+        bytes_per_frame(0),
+        gigabytes_per_second(0.0) {}
+
+  std::string workload;
+  int count;
+  int threads;
+  int indices;
+  double frame_usec;
+  double indices_per_second;
+
+  // Throughput relative to the fewest threads measured for the same workload
+  // and count, and that speedup divided by the extra threads used.
+  double speedup;
+  double efficiency;
+
+  // Per-index data streamed through every frame, and the rate at which it
+  // was streamed. A lower bound on the memory traffic, since data is read at
+  // least once per frame, and some is written too.
+  size_t bytes_per_frame;
+  double gigabytes_per_second;
+};
+
+// One engine, and the scenario that drives it, updated by one worker thread.
+struct ScalingWorker {
+  ScalingWorker() : scenario(nullptr) {}
+
+  // The scenario holds Motivators that reference processors owned by the
+  // engine, so the scenario must be deleted before the engine.
+  ~ScalingWorker() { delete scenario; }
+
+  MotiveEngine engine;
+  BenchmarkScenario* scenario;
+  ScenarioParams params;
+};
+
+static void PrintUsage(const char* program) {
+  printf(
+      "Usage: %s [options]\n"
+      "  --workloads=a,b,...  Scenarios to sweep. Default spline,matrix,"
+      "rig_crowd.\n"
+      "  --counts=a,b,...     Total Motivators. Default 1000 to 1000000.\n"
+      "  --threads=a,b,...    Worker threads. Default powers of two up to the\n"
+      "                       number of hardware threads.\n"
+      "  --frames=N           Frames to measure.\n"
+      "  --warmup=N           Frames to run before measuring.\n"
+      "  --delta_time=N       Time passed to AdvanceFrame() each frame.\n"
+      "  --seed=N             Seed for the scenarios' random choices.\n"
+      "  --json               Output JSON instead of CSV.\n"
+      "  --output=FILE        Write results to FILE instead of stdout.\n",
+      program);
+}
+
+static void SplitInts(const char* s, std::vector<int>* out) {
+  std::vector<std::string> strings;
+  SplitCommas(s, &strings);
+  for (size_t i = 0; i < strings.size(); ++i) {
+    out->push_back(atoi(strings[i].c_str()));
+  }
+}
+
+// Returns false if the program should exit without running benchmarks.
+static bool ParseOptions(int argc, char** argv, ScalingOptions* options) {
+  ScenarioParams& params = options->params;
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    const char* value = nullptr;
+    if ((value = OptionValue(arg, "workloads")) != nullptr) {
+      SplitCommas(value, &options->workloads);
+    } else if ((value = OptionValue(arg, "counts")) != nullptr) {
+      SplitInts(value, &options->counts);
+    } else if ((value = OptionValue(arg, "threads")) != nullptr) {
+      SplitInts(value, &options->threads);
+    } else if ((value = OptionValue(arg, "frames")) != nullptr) {
+      params.num_frames = atoi(value);
+    } else if ((value = OptionValue(arg, "warmup")) != nullptr) {
+      params.num_warmup_frames = atoi(value);
+    } else if ((value = OptionValue(arg, "delta_time")) != nullptr) {
+      params.delta_time = atoi(value);
+    } else if ((value = OptionValue(arg, "seed")) != nullptr) {
+      params.seed = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+    } else if ((value = OptionValue(arg, "output")) != nullptr) {
+      options->output_file = value;
+    } else if (strcmp(arg, "--json") == 0) {
+      options->json = true;
+    } else {
+      PrintUsage(argv[0]);
+      return false;
+    }
+  }
+
+  if (options->workloads.empty()) {
+    for (size_t i = 0; i < MOTIVE_ARRAY_SIZE(kDefaultWorkloads); ++i) {
+      options->workloads.push_back(kDefaultWorkloads[i]);
+    }
+  }
+  if (options->counts.empty()) {
+    options->counts.assign(
+        kDefaultCounts, kDefaultCounts + MOTIVE_ARRAY_SIZE(kDefaultCounts));
+  }
+  if (options->threads.empty()) {
+    const int max_threads =
+        std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    for (int n = 1; n < max_threads; n *= 2) {
+      options->threads.push_back(n);
+    }
+    options->threads.push_back(max_threads);
+  }
+
+  for (size_t i = 0; i < options->workloads.size(); ++i) {
+    BenchmarkScenario* scenario =
+        motive::CreateBenchmarkScenario(options->workloads[i].c_str());
+    if (scenario == nullptr) {
+      fprintf(stderr, "Unknown workload '%s'.\n",
+              options->workloads[i].c_str());
+      return false;
+    }
+    delete scenario;
+  }
+
+  bool positive = params.num_frames > 0 && params.num_warmup_frames >= 0 &&
+                  params.delta_time > 0;
+  for (size_t i = 0; i < options->counts.size(); ++i) {
+    positive = positive && options->counts[i] > 0;
+  }
+  for (size_t i = 0; i < options->threads.size(); ++i) {
+    positive = positive && options->threads[i] > 0;
+  }
+  if (!positive) {
+    fprintf(stderr, "Counts, threads, and times must be positive.\n");
+    return false;
+  }
+  return true;
+}
+
+// Update `worker` for all the warmup frames, then wait for `go` and update it
+// for all the measured frames.
+static void RunWorker(ScalingWorker* worker, std::atomic<int>* num_ready,
+                      const std::atomic<bool>* go) {
+  const ScenarioParams& params = worker->params;
+  for (int i = 0; i < params.num_warmup_frames; ++i) {
+    worker->scenario->PreFrame(i, &worker->engine);
+    worker->engine.AdvanceFrame(params.delta_time);
+  }
+
+  num_ready->fetch_add(1);
+  while (!go->load()) {
+    std::this_thread::yield();
+  }
+
+  for (int i = 0; i < params.num_frames; ++i) {
+    worker->scenario->PreFrame(params.num_warmup_frames + i, &worker->engine);
+    worker->engine.AdvanceFrame(params.delta_time);
+  }
+}
+
+// Split `count` Motivators over `num_threads` engines, and measure the time
+// to update them all in parallel. Returns false if the configuration can't be
+// run.
+static bool RunConfiguration(const std::string& workload, int count,
+                             int num_threads, const ScalingOptions& options,
+                             ScalingResult* result) {
+  std::vector<ScalingWorker*> workers(num_threads);
+  bool valid = true;
+
+  // Set up serially. Registering processors with the engine isn't thread
+  // safe, and it keeps setup out of the measurement.
+  for (int i = 0; i < num_threads && valid; ++i) {
+    ScalingWorker* worker = new ScalingWorker();
+    workers[i] = worker;
+    worker->scenario = motive::CreateBenchmarkScenario(workload.c_str());
+    assert(worker->scenario != nullptr);
+
+    // Spread the instances evenly, so that no thread has much more work.
+    const int instances = count / worker->scenario->MotivatorsPerInstance();
+    if (instances < num_threads) {
+      fprintf(stderr, "Skipping %s with %d Motivators on %d threads.\n",
+              workload.c_str(), count, num_threads);
+      valid = false;
+      break;
+    }
+    worker->params = options.params;
+    worker->params.num_motivators =
+        instances / num_threads + (i < instances % num_threads ? 1 : 0);
+    worker->params.seed = options.params.seed + static_cast<uint32_t>(i);
+    worker->scenario->Setup(worker->params, &worker->engine);
+  }
+
+  if (valid) {
+    std::atomic<int> num_ready(0);
+    std::atomic<bool> go(false);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+      threads.push_back(std::thread(RunWorker, workers[i], &num_ready, &go));
+    }
+
+    // Start the clock once every thread has warmed up.
+    while (num_ready.load() < num_threads) {
+      std::this_thread::yield();
+    }
+    const Clock::time_point start = Clock::now();
+    go.store(true);
+    for (size_t i = 0; i < threads.size(); ++i) {
+      threads[i].join();
+    }
+    const double seconds =
+        std::chrono::duration<double>(Clock::now() - start).count();
+
+    result->workload = workload;
+    result->count = count;
+    result->threads = num_threads;
+    for (int i = 0; i < num_threads; ++i) {
+      result->indices += workers[i]->scenario->NumIndices();
+      const MotiveMemoryUsage memory = workers[i]->engine.MemoryUsage();
+      result->bytes_per_frame += memory.used_bytes[motive::kMemoryIndexArrays] +
+                                 memory.used_bytes[motive::kMemoryIndexBlocks];
+    }
+
+    const int num_frames = options.params.num_frames;
+    result->frame_usec = seconds * kMicrosecondsPerSecond / num_frames;
+    result->indices_per_second =
+        seconds > 0.0 ? static_cast<double>(result->indices) * num_frames /
+                            seconds
+                      : 0.0;
+    result->gigabytes_per_second =
+        seconds > 0.0 ? static_cast<double>(result->bytes_per_frame) *
+                            num_frames / seconds / kBytesPerGigabyte
+                      : 0.0;
+  }
+
+  for (size_t i = 0; i < workers.size(); ++i) {
+    delete workers[i];
+  }
+  return valid;
+}
+
+// Fill in `speedup` and `efficiency`, relative to the result with the fewest
+// threads for the same workload and count.
+static void CalculateSpeedups(std::vector<ScalingResult>* results) {
+  for (size_t i = 0; i < results->size(); ++i) {
+    ScalingResult& r = (*results)[i];
+    const ScalingResult* base = &r;
+    for (size_t j = 0; j < results->size(); ++j) {
+      const ScalingResult& b = (*results)[j];
+      if (b.workload == r.workload && b.count == r.count &&
+          b.threads < base->threads) {
+        base = &b;
+      }
+    }
+    if (base->indices_per_second <= 0.0) continue;
+    r.speedup = r.indices_per_second / base->indices_per_second;
+    r.efficiency = r.speedup * base->threads / r.threads;
+  }
+}
+
+static void OutputCsv(const std::vector<ScalingResult>& results, FILE* f) {
+  fprintf(f,
+          "workload,count,threads,indices,frame_usec,indices_per_second,"
+          "speedup,efficiency,bytes_per_frame,gigabytes_per_second\n");
+  for (size_t i = 0; i < results.size(); ++i) {
+    const ScalingResult& r = results[i];
+    fprintf(f, "%s,%d,%d,%d,%.3f,%.1f,%.3f,%.3f,%zu,%.3f\n",
+            r.workload.c_str(), r.count, r.threads, r.indices, r.frame_usec,
+            r.indices_per_second, r.speedup, r.efficiency, r.bytes_per_frame,
+            r.gigabytes_per_second);
+  }
+}
+
+static void OutputJson(const ScenarioParams& params,
+                       const std::vector<ScalingResult>& results, FILE* f) {
+  fprintf(f, "{\n");
+  fprintf(f,
+          "  \"params\": {\"frames\": %d, \"warmup_frames\": %d,"
+          " \"delta_time\": %d, \"seed\": %u, \"hardware_threads\": %u},\n",
+          params.num_frames, params.num_warmup_frames, params.delta_time,
+          static_cast<unsigned int>(params.seed),
+          std::thread::hardware_concurrency());
+  fprintf(f, "  \"results\": [\n");
+  for (size_t i = 0; i < results.size(); ++i) {
+    const ScalingResult& r = results[i];
+    fprintf(f,
+            "    {\"workload\": \"%s\", \"count\": %d, \"threads\": %d, "
+            "\"indices\": %d, \"frame_usec\": %.3f, "
+            "\"indices_per_second\": %.1f, \"speedup\": %.3f, "
+            "\"efficiency\": %.3f, \"bytes_per_frame\": %zu, "
+            "\"gigabytes_per_second\": %.3f}%s\n",
+            r.workload.c_str(), r.count, r.threads, r.indices, r.frame_usec,
+            r.indices_per_second, r.speedup, r.efficiency, r.bytes_per_frame,
+            r.gigabytes_per_second, i + 1 < results.size() ? "," : "");
+  }
+  fprintf(f, "  ]\n");
+  fprintf(f, "}\n");
+}
+
+int main(int argc, char** argv) {
+  ScalingOptions options;
+  if (!ParseOptions(argc, argv, &options)) return 1;
+
+  std::vector<ScalingResult> results;
+  for (size_t w = 0; w < options.workloads.size(); ++w) {
+    for (size_t c = 0; c < options.counts.size(); ++c) {
+      for (size_t t = 0; t < options.threads.size(); ++t) {
+        ScalingResult result;
+        if (!RunConfiguration(options.workloads[w], options.counts[c],
+                              options.threads[t], options, &result)) {
+          continue;
+        }
+        results.push_back(result);
+      }
+    }
+  }
+  CalculateSpeedups(&results);
+
+  FILE* f = stdout;
+  if (options.output_file != nullptr) {
+    f = fopen(options.output_file, "w");
+    if (f == nullptr) {
+      fprintf(stderr, "Could not open '%s' for writing.\n",
+              options.output_file);
+      return 1;
+    }
+  }
+  if (options.json) {
+    OutputJson(options.params, results, f);
+  } else {
+    OutputCsv(results, f);
+  }
+  if (f != stdout) fclose(f);
+  return 0;
+}
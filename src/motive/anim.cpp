@@ -42,6 +42,39 @@ MatrixAnim& RigAnim::InitMatrixAnim(BoneIndex idx, BoneIndex parent,
   return anims_[idx];
 }
 
+MotiveMemoryUsage MatrixAnim::MemoryUsage() const {
+  MotiveMemoryUsage usage;
+  usage.AddVector(kMemoryOther, ops_.ops());
+  usage.AddVector(kMemorySplines, splines_);
+  for (auto it = splines_.begin(); it != splines_.end(); ++it) {
+    if (it->spline == nullptr) continue;
+
+    // Splines are created with exactly as many nodes as they hold, but
+    // count any unused nodes as slack anyway. Packed splines have no slack.
+    const CompactSpline& spline = *it->spline;
+    const size_t used = spline.packed()
+                            ? spline.Size()
+                            : CompactSpline::Size(spline.num_nodes());
+    usage.Add(kMemorySplines, used, spline.Size());
+  }
+  return usage;
+}
+
+MotiveMemoryUsage RigAnim::MemoryUsage() const {
+  MotiveMemoryUsage usage;
+  usage.AddVector(kMemoryOther, anims_);
+  for (auto it = anims_.begin(); it != anims_.end(); ++it) {
+    usage.Add(it->MemoryUsage());
+  }
+  usage.AddVector(kMemoryOther, bone_parents_);
+  usage.AddVector(kMemoryNames, bone_names_);
+  for (auto it = bone_names_.begin(); it != bone_names_.end(); ++it) {
+    usage.AddString(kMemoryNames, *it);
+  }
+  usage.AddString(kMemoryNames, anim_name_);
+  return usage;
+}
+
 int RigAnim::NumOps() const {
   size_t num_ops = 0;
   for (BoneIndex i = 0; i < NumBones(); ++i) {
@@ -352,6 +352,32 @@ static void CreateDefiningAnim(const RigAnim** anims, size_t num_anims,
   }
 }
 
+MotiveMemoryUsage AnimTable::MemoryUsage() const {
+  MotiveMemoryUsage usage;
+  usage.AddVector(kMemoryOther, indices_);
+  for (auto it = indices_.begin(); it != indices_.end(); ++it) {
+    usage.AddVector(kMemoryOther, *it);
+  }
+
+  usage.AddVector(kMemoryOther, defining_anims_);
+  for (auto it = defining_anims_.begin(); it != defining_anims_.end(); ++it) {
+    usage.Add(it->MemoryUsage());
+  }
+
+  usage.AddMap(kMemoryNames, name_map_);
+  for (auto it = name_map_.begin(); it != name_map_.end(); ++it) {
+    usage.AddString(kMemoryNames, it->first);
+  }
+
+  // Each animation is allocated individually with `new RigAnim()`.
+  usage.AddVector(kMemoryOther, anims_);
+  for (auto it = anims_.begin(); it != anims_.end(); ++it) {
+    usage.Add(kMemoryOther, sizeof(RigAnim), sizeof(RigAnim));
+    usage.Add((*it)->MemoryUsage());
+  }
+  return usage;
+}
+
 size_t AnimTable::MaxAnimIndex() const {
   size_t max_anim_idx = 0;
   for (size_t i = 0; i < indices_.size(); ++i) {
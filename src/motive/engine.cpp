@@ -12,6 +12,9 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <chrono>
+#include <sstream>
+
 #include "motive/engine.h"
 #include "motive/processor.h"
 #include "motive/version.h"
@@ -19,6 +22,36 @@
 
 namespace motive {
 
+// Monotonic, so that spikes aren't caused by the wall clock being adjusted.
+typedef std::chrono::steady_clock SpikeClock;
+
+// Output `counters` as the members of a JSON object.
+static void CountersToJson(const MotiveProcessorCounters& counters,
+                           std::ostream& os) {
+  os << "{\"active_indices\": " << counters.active_indices
+     << ", \"holes\": " << counters.holes
+     << ", \"motivators_initialized\": " << counters.motivators_initialized
+     << ", \"defragment_moves\": " << counters.defragment_moves
+     << ", \"segment_transitions\": " << counters.segment_transitions
+     << ", \"look_ahead_hits\": " << counters.look_ahead_hits
+     << ", \"blends_started\": " << counters.blends_started
+     << ", \"set_target_calls\": " << counters.set_target_calls
+     << ", \"reallocations\": " << counters.reallocations << "}";
+}
+
+std::string MotiveSpikeReport::ToJson() const {
+  std::ostringstream oss;
+  oss << "{\"processor\": \"" << (type == nullptr ? "unknown" : *type)
+      << "\", \"frame\": " << frame << ", \"seconds\": " << seconds
+      << ", \"threshold_seconds\": " << threshold_seconds
+      << ", \"num_indices\": " << num_indices << ", \"advance_frame\": ";
+  CountersToJson(advance_frame, oss);
+  oss << ", \"frame_work\": ";
+  CountersToJson(frame_work, oss);
+  oss << "}";
+  return oss.str();
+}
+
 // static
 MotiveEngine::FunctionMap MotiveEngine::function_map_;
 
@@ -30,7 +63,15 @@ void MotiveEngine::RegisterProcessorFactory(
 
 // Prevent the version string from being stripped from the binary by keeping
 // a reference to it here.
-MotiveEngine::MotiveEngine() : version_(&Version()) {}
+MotiveEngine::MotiveEngine()
+    : version_(&Version()),
+      frame_counters_enabled_(false),
+      look_ahead_enabled_(false),
+      index_sorting_enabled_(false),
+      frame_(0),
+      spike_threshold_seconds_(0.0),
+      spike_callback_(nullptr),
+      spike_user_data_(nullptr) {}
 
 void MotiveEngine::Reset() {
   for (ProcessorMap::iterator it = mapped_processors_.begin();
@@ -63,6 +104,8 @@ MotiveProcessor* MotiveEngine::Processor(MotivatorType type) {
   ProcessorDetails details;
   details.processor = fns.create();
   details.processor->RegisterBenchmarks();
+  if (look_ahead_enabled_) details.processor->SetLookAhead(true);
+  if (index_sorting_enabled_) details.processor->set_sort_indices(true);
   mapped_processors_.insert(ProcessorPair(type, details.processor));
   sorted_processors_.insert(details);
 
@@ -76,11 +119,129 @@ void MotiveEngine::AdvanceFrame(MotiveTime delta_time) {
   // which might in turn depend on the output of a *different* item in
   // processor A. In this case, we have to do two passes. For now, just
   // assume that one pass is sufficient.
+  const bool watchdog = spike_callback_ != nullptr;
+  spikes_.clear();
+  for (ProcessorSet::iterator it = sorted_processors_.begin();
+       it != sorted_processors_.end(); ++it) {
+    MotiveProcessor* processor = it->processor;
+    const MotiveProcessorCounters before =
+        watchdog ? processor->Counters() : MotiveProcessorCounters();
+    const SpikeClock::time_point start =
+        watchdog ? SpikeClock::now() : SpikeClock::time_point();
+    {
+      const motive::Benchmark b(processor->benchmark_id_for_advance_frame(),
+                                processor->NumAllocatedIndices());
+      processor->AdvanceFrame(delta_time);
+    }
+    if (!watchdog) continue;
+
+    // Only snapshot the counters again when the frame was slow.
+    const double seconds =
+        std::chrono::duration<double>(SpikeClock::now() - start).count();
+    if (seconds <= spike_threshold_seconds_) continue;
+
+    MotiveSpikeReport report;
+    report.type = processor->Type();
+    report.frame = frame_;
+    report.seconds = seconds;
+    report.threshold_seconds = spike_threshold_seconds_;
+    report.num_indices = processor->NumAllocatedIndices();
+    report.advance_frame = processor->Counters().Delta(before);
+    spikes_.push_back(report);
+  }
+
+  // Record the work done in this frame, after all processors have updated.
+  // Processors can set targets on each other's Motivators.
+  if (frame_counters_enabled_ || watchdog) {
+    for (ProcessorSet::iterator it = sorted_processors_.begin();
+         it != sorted_processors_.end(); ++it) {
+      it->processor->UpdateFrameCounters();
+    }
+  }
+
+  // Report spikes once the whole frame's work is known.
+  for (size_t i = 0; i < spikes_.size(); ++i) {
+    MotiveSpikeReport& report = spikes_[i];
+    report.frame_work = mapped_processors_[report.type]->FrameCounters();
+    spike_callback_(report, spike_user_data_);
+  }
+  frame_++;
+}
+
+void MotiveEngine::Counters(std::vector<MotiveCounterReport>* reports) const {
+  reports->resize(sorted_processors_.size());
+  size_t i = 0;
+  for (ProcessorSet::const_iterator it = sorted_processors_.begin();
+       it != sorted_processors_.end(); ++it, ++i) {
+    MotiveCounterReport& report = (*reports)[i];
+    report.type = it->processor->Type();
+    report.totals = it->processor->Counters();
+    report.frame = it->processor->FrameCounters();
+  }
+}
+
+MotiveProcessorCounters MotiveEngine::TotalCounters() const {
+  MotiveProcessorCounters total;
+  for (ProcessorSet::const_iterator it = sorted_processors_.begin();
+       it != sorted_processors_.end(); ++it) {
+    total.Add(it->processor->Counters());
+  }
+  return total;
+}
+
+MotiveMemoryUsage MotiveEngine::MemoryUsage() const {
+  MotiveMemoryUsage usage;
+  for (ProcessorSet::const_iterator it = sorted_processors_.begin();
+       it != sorted_processors_.end(); ++it) {
+    usage.Add(it->processor->MemoryUsage());
+  }
+  return usage;
+}
+
+void MotiveEngine::EnableFrameCounters(bool enable) {
+  // Start counting from now, so the first frame doesn't report all the work
+  // done before counters were enabled.
+  if (enable && !frame_counters_enabled_) {
+    for (ProcessorSet::iterator it = sorted_processors_.begin();
+         it != sorted_processors_.end(); ++it) {
+      it->processor->UpdateFrameCounters();
+    }
+  }
+  frame_counters_enabled_ = enable;
+}
+
+void MotiveEngine::EnableLookAhead(bool enable) {
+  for (ProcessorSet::iterator it = sorted_processors_.begin();
+       it != sorted_processors_.end(); ++it) {
+    it->processor->SetLookAhead(enable);
+  }
+  look_ahead_enabled_ = enable;
+}
+
+void MotiveEngine::EnableIndexSorting(bool enable) {
   for (ProcessorSet::iterator it = sorted_processors_.begin();
        it != sorted_processors_.end(); ++it) {
-    const motive::Benchmark b(it->processor->benchmark_id_for_advance_frame());
-    it->processor->AdvanceFrame(delta_time);
+    it->processor->set_sort_indices(enable);
+  }
+  index_sorting_enabled_ = enable;
+}
+
+void MotiveEngine::EnableSpikeWatchdog(double threshold_seconds,
+                                       SpikeCallback* callback,
+                                       void* user_data) {
+  assert(callback != nullptr);
+
+  // As with EnableFrameCounters(), start counting from now, so that the first
+  // report doesn't include all the work done before the watchdog was enabled.
+  if (!frame_counters_enabled_ && spike_callback_ == nullptr) {
+    for (ProcessorSet::iterator it = sorted_processors_.begin();
+         it != sorted_processors_.end(); ++it) {
+      it->processor->UpdateFrameCounters();
+    }
   }
+  spike_threshold_seconds_ = threshold_seconds;
+  spike_callback_ = callback;
+  spike_user_data_ = user_data;
 }
 
 }  // namespace motive
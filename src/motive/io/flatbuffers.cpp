@@ -17,6 +17,7 @@
 #include "motive/anim.h"
 #include "motive/init.h"
 #include "motive/io/flatbuffers.h"
+#include "motive/math/compact_spline.h"
 
 namespace motive {
 
@@ -92,24 +93,33 @@ void MatrixAnimFromFlatBuffers(const MatrixAnimFb& params, MatrixAnim* anim) {
             reinterpret_cast<const CompactSplineFb*>(op->value());
         MatrixAnim::Spline& s = splines[spline_idx++];
 
-        // Ensure the spline will fit into our memory buffer.
-        const CompactSplineIndex num_spline_nodes =
-            static_cast<CompactSplineIndex>(spline_fb->nodes()->size());
-
-        // Create the CompactSpline in the memory buffer.
-        s.spline = CompactSpline::Create(num_spline_nodes);
-
-        // Copy the spline data into s.spline.
-        // TODO: modify CompactSpline so we can just point at spline data
-        //       instead of copying it.
         const Range y_range(spline_fb->y_range_start(),
                             spline_fb->y_range_end());
-        s.spline->Init(y_range, spline_fb->x_granularity());
-        for (auto n = spline_fb->nodes()->begin();
-             n != spline_fb->nodes()->end(); ++n) {
-          s.spline->AddNodeVerbatim(n->x(), n->y(), n->angle());
+        const auto packed_nodes = spline_fb->packed_nodes();
+        if (flatbuffers::VectorLength(packed_nodes) > 0) {
+          // Copy the packed nodes as they are. They're unpacked on demand.
+          s.spline = CompactSpline::CreateFromPackedData(
+              y_range, spline_fb->x_granularity(),
+              spline_fb->num_packed_nodes(), packed_nodes->data(),
+              packed_nodes->size());
+        } else {
+          // Ensure the spline will fit into our memory buffer.
+          const CompactSplineIndex num_spline_nodes =
+              static_cast<CompactSplineIndex>(spline_fb->nodes()->size());
+
+          // Create the CompactSpline in the memory buffer.
+          s.spline = CompactSpline::Create(num_spline_nodes);
+
+          // Copy the spline data into s.spline.
+          // TODO: modify CompactSpline so we can just point at spline data
+          //       instead of copying it.
+          s.spline->Init(y_range, spline_fb->x_granularity());
+          for (auto n = spline_fb->nodes()->begin();
+               n != spline_fb->nodes()->end(); ++n) {
+            s.spline->AddNodeVerbatim(n->x(), n->y(), n->angle());
+          }
+          assert(s.spline->num_nodes() == s.spline->max_nodes());
         }
-        assert(s.spline->num_nodes() == s.spline->max_nodes());
 
         // Hold `init` and `playback` data in structures that won't disappear,
         // since these are referenced by pointer.
@@ -159,4 +169,28 @@ void RigAnimFromFlatBuffers(const RigAnimFb& params, RigAnim* anim) {
   anim->set_repeat(params.repeat() != 0);
 }
 
+flatbuffers::Offset<CompactSplineFb> CompactSplineToFlatBuffers(
+    const CompactSpline& spline, bool packed,
+    flatbuffers::FlatBufferBuilder& fbb) {
+  const Range& y_range = spline.y_range();
+
+  // Only pack when it saves memory. Packed splines have a header, so very
+  // short splines can be larger when packed.
+  if (packed && CompactSpline::PackedSize(spline) < spline.Size()) {
+    CompactSpline* p = CompactSpline::CreatePacked(spline);
+    auto packed_fb = fbb.CreateVector(p->packed_data(), p->packed_data_size());
+    auto spline_fb = CreateCompactSplineFb(
+        fbb, y_range.start(), y_range.end(), spline.x_granularity(), 0,
+        packed_fb, spline.num_nodes());
+    CompactSpline::Destroy(p);
+    return spline_fb;
+  }
+
+  auto nodes_fb = fbb.CreateVectorOfStructs(
+      reinterpret_cast<const CompactSplineNodeFb*>(spline.nodes()),
+      spline.num_nodes());
+  return CreateCompactSplineFb(fbb, y_range.start(), y_range.end(),
+                               spline.x_granularity(), nodes_fb);
+}
+
 }  // namespace motive
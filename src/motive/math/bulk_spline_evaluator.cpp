@@ -26,23 +26,79 @@ namespace motive {
 
 // These functions are implemented in assembly language.
 extern "C" void UpdateCubicXsAndGetMask_Neon(const float& delta_x,
-                                             const float* x_ends, int num_xs,
-                                             float* xs, uint8_t* masks);
+                                             const float* x_ends,
+                                             const float* playback_rates,
+                                             int num_xs, float* xs,
+                                             uint8_t* masks);
 
-// y_range pointer is of type BulkSplineEvaluator::YRange (not used here because
-// it's private, and extern "C" functions cannot be friends).
 extern "C" void EvaluateCubics_Neon(const CubicCurve* curves, const float* xs,
-                                    const void* y_ranges, int num_curves,
+                                    const Range* y_ranges, int num_curves,
                                     float* ys);
 
+#if defined(MOTIVE_F16C) && !defined(__F16C__)
+#error MOTIVE_F16C requires compiling with F16C instructions, e.g. -mf16c.
+#endif
+
+bool HalfPrecisionAvailable() {
+  return ProcessorOptimizationAvailable(kF16cOptimizations);
+}
+
+static bool g_default_half_precision = false;
+
+bool DefaultHalfPrecision() { return g_default_half_precision; }
+
+void SetDefaultHalfPrecision(bool half_precision) {
+  g_default_half_precision = half_precision;
+}
+
+static bool g_default_cache_outputs = false;
+
+bool DefaultCacheOutputs() { return g_default_cache_outputs; }
+
+void SetDefaultCacheOutputs(bool cache_outputs) {
+  g_default_cache_outputs = cache_outputs;
+}
+
 void BulkSplineEvaluator::SetNumIndices(const Index num_indices) {
   sources_.resize(num_indices);
   y_ranges_.resize(num_indices);
   cubic_xs_.resize(num_indices, 0.0f);
-  cubic_x_ends_.resize(num_indices, 0.0f);
   cubics_.resize(num_indices);
   ys_.resize(num_indices, 0.0f);
+  rates_.resize(num_indices, 1.0f);
   scratch_.resize(num_indices, 0);
+  if (look_ahead_) {
+    next_segments_.resize(num_indices);
+  }
+  if (half_precision_) {
+    half_x_ends_.resize(num_indices, 0);
+  } else {
+    cubic_x_ends_.resize(num_indices, 0.0f);
+  }
+  if (cache_outputs_) {
+    derivatives_.resize(num_indices, 0.0f);
+    end_ys_.resize(num_indices, 0.0f);
+    end_derivatives_.resize(num_indices, 0.0f);
+  }
+}
+
+MotiveMemoryUsage BulkSplineEvaluator::MemoryUsage() const {
+  MotiveMemoryUsage usage;
+  usage.AddVector(kMemoryIndexArrays, sources_);
+  usage.AddVector(kMemoryIndexArrays, rates_);
+  usage.AddVector(kMemoryIndexArrays, y_ranges_);
+  usage.AddVector(kMemoryIndexArrays, cubic_xs_);
+  usage.AddVector(kMemoryIndexArrays, cubic_x_ends_);
+  usage.AddVector(kMemoryIndexArrays, cubics_);
+  usage.AddVector(kMemoryIndexArrays, ys_);
+  usage.AddVector(kMemoryIndexArrays, scratch_);
+  usage.AddVector(kMemoryIndexArrays, blend_lookups_);
+  usage.AddVector(kMemoryIndexArrays, half_x_ends_);
+  usage.AddVector(kMemoryIndexArrays, derivatives_);
+  usage.AddVector(kMemoryIndexArrays, end_ys_);
+  usage.AddVector(kMemoryIndexArrays, end_derivatives_);
+  usage.AddVector(kMemoryIndexArrays, next_segments_);
+  return usage;
 }
 
 void BulkSplineEvaluator::MoveIndices(
@@ -53,42 +109,63 @@ void BulkSplineEvaluator::MoveIndices(
     sources_[new_i] = sources_[old_i];
     y_ranges_[new_i] = y_ranges_[old_i];
     cubic_xs_[new_i] = cubic_xs_[old_i];
-    cubic_x_ends_[new_i] = cubic_x_ends_[old_i];
     cubics_[new_i] = cubics_[old_i];
     ys_[new_i] = ys_[old_i];
+    rates_[new_i] = rates_[old_i];
+    if (look_ahead_) {
+      next_segments_[new_i] = next_segments_[old_i];
+    }
+    if (half_precision_) {
+      half_x_ends_[new_i] = half_x_ends_[old_i];
+    } else {
+      cubic_x_ends_[new_i] = cubic_x_ends_[old_i];
+    }
+    if (cache_outputs_) {
+      derivatives_[new_i] = derivatives_[old_i];
+      end_ys_[new_i] = end_ys_[old_i];
+      end_derivatives_[new_i] = end_derivatives_[old_i];
+    }
   }
 }
 
 void BulkSplineEvaluator::SetYRanges(const Index index, const Index count,
                                      const Range& modular_range) {
   for (int i = index; i < index + count; ++i) {
-    YRange& r = y_ranges_[i];
-    r.modular_range = modular_range;
+    y_ranges_[i] = modular_range;
   }
 }
 
-CubicInit BulkSplineEvaluator::CalculateBlendInit(
-    const Index index, const CompactSpline& spline,
-    const SplinePlayback& playback) const {
-
-  // Calculate spline segment where the blend will end.
+void BulkSplineEvaluator::LookUpBlend(const CompactSpline& spline,
+                                      const SplinePlayback& playback,
+                                      BlendLookup* lookup) const {
+  // Find the segment of the target spline where the blend starts.
+  lookup->start_index = spline.IndexForXAllowingRepeat(
+      playback.start_x, kInvalidSplineIndex, playback.repeat,
+      &lookup->start_x);
+
+  // Find the segment where the blend ends. Unless the blend wraps around, it
+  // ends at or shortly after the segment where it starts, so search forward
+  // from there.
   const float blend_width = playback.blend_x * playback.playback_rate;
-  float blend_end_x = 0.0f;
-  const CompactSplineIndex blend_end_index = spline.IndexForXAllowingRepeat(
-      playback.start_x + blend_width, kInvalidSplineIndex, playback.repeat,
-      &blend_end_x);
+  lookup->end_index = spline.IndexForXAllowingRepeat(
+      playback.start_x + blend_width, lookup->start_index, playback.repeat,
+      &lookup->end_x);
+}
 
+CubicInit BulkSplineEvaluator::CalculateBlendInit(
+    const Index index, const CompactSpline& spline,
+    const SplinePlayback& playback, const BlendLookup& lookup) const {
   // Gather the spline values. Only create the cubic if we have to.
   float end_y = 0.0f;
   float end_derivative = 0.0f;
-  if (OutsideSpline(blend_end_index)) {
+  if (OutsideSpline(lookup.end_index)) {
     // Get the start or end y-values of the spline.
-    end_y = spline.NodeY(blend_end_index);
+    end_y = spline.NodeY(lookup.end_index);
 
   } else {
     // Create the cubic for the end segment.
-    const float curve_x = blend_end_x - spline.NodeX(blend_end_index);
-    const CubicInit curve_init = spline.CreateCubicInit(blend_end_index);
+    const float curve_x = lookup.end_x - spline.NodeX(lookup.end_index);
+    const CubicInit curve_init = spline.CreateCubicInit(lookup.end_index);
     const CubicCurve curve(curve_init);
     end_y = curve.Evaluate(curve_x);
     end_derivative = curve.Derivative(curve_x);
@@ -99,48 +176,55 @@ CubicInit BulkSplineEvaluator::CalculateBlendInit(
   const float start_derivative = Derivative(index);
 
   // Account for modular arithmentic. Always start in the normalized range.
-  const YRange& r = y_ranges_[index];
-  if (r.modular_range.Valid() != 0) {
+  const Range& r = y_ranges_[index];
+  if (r.Valid() != 0) {
     // We take the shortest modular path to the new curve.
     // So if we're blending from angle 170 to angle -170 (=+190),
     // we will blend from 170-->190 instead of 170-->-170.
-    start_y = r.modular_range.NormalizeCloseValue(start_y);
-    const float end_y_normalized = r.modular_range.NormalizeCloseValue(end_y);
-    const float diff_y = r.modular_range.Normalize(end_y_normalized - start_y);
+    float ys[2] = {start_y, end_y};
+    r.NormalizeCloseValues(ys, 2, ys);
+    start_y = ys[0];
+    const float diff_y = r.Normalize(ys[1] - start_y);
     end_y = start_y + diff_y;
   }
 
   // Return the cubic parameters.
+  const float blend_width = playback.blend_x * playback.playback_rate;
   return CubicInit(start_y, start_derivative, end_y, end_derivative,
                    blend_width);
 }
 
 void BulkSplineEvaluator::BlendToSpline(const Index index,
                                         const CompactSpline& spline,
-                                        const SplinePlayback& playback) {
+                                        const SplinePlayback& playback,
+                                        const BlendLookup& lookup) {
   // Calculate the spline that transitions from the current curve state
   // to the target spline's state.
   // Transition spline runs from x=0-->playback.blend_time.
-  const CubicInit blend_init = CalculateBlendInit(index, spline, playback);
+  const CubicInit blend_init =
+      CalculateBlendInit(index, spline, playback, lookup);
+  num_blends_++;
 
   // Shift the transition spline so that it overlaps perfectly onto the target
   // spline. Initialize all the x-parameters as if we were initializing the
   // target spline. This will let us transition out of the transition spline
   // straight into the target spline without special casing.
-  float blend_start_x = 0.0f;
-  const CompactSplineIndex blend_start_index = spline.IndexForXAllowingRepeat(
-      playback.start_x, kInvalidSplineIndex, playback.repeat, &blend_start_x);
-  const float cubic_start_x = blend_start_x - spline.NodeX(blend_start_index);
+  const float cubic_start_x =
+      lookup.start_x - spline.NodeX(lookup.start_index);
 
   Source& s = sources_[index];
-  s.rate = playback.playback_rate;
   s.y_offset = playback.y_offset;
   s.y_scale = playback.y_scale;
   s.spline = &spline;
-  s.x_index = blend_start_index;
+  s.x_index = lookup.start_index;
   s.repeat = playback.repeat;
+  SetRate(index, playback.playback_rate);
+  CacheEndValues(index);
+  if (look_ahead_) {
+    next_segments_[index].x_index = kInvalidSplineIndex;
+  }
   cubic_xs_[index] = cubic_start_x;
-  cubic_x_ends_[index] = cubic_start_x + playback.blend_x;
+  SetCubicXEnd(index, cubic_start_x + playback.blend_x);
   cubics_[index].Init(blend_init);
   cubics_[index].ShiftRight(cubic_start_x);
 }
@@ -149,42 +233,63 @@ void BulkSplineEvaluator::JumpToSpline(const Index index,
                                        const CompactSpline& spline,
                                        const SplinePlayback& playback) {
   Source& s = sources_[index];
-  s.rate = playback.playback_rate;
   s.y_offset = playback.y_offset;
   s.y_scale = playback.y_scale;
   s.spline = &spline;
   s.x_index = kInvalidSplineIndex;
   s.repeat = playback.repeat;
-  InitCubic(index, playback.start_x);
+  SetRate(index, playback.playback_rate);
+  CacheEndValues(index);
+  InitSegment(index, playback.start_x);
 }
 
 void BulkSplineEvaluator::SetSplines(
     const Index index, const Index count, const CompactSpline* splines,
     const SplinePlayback& playback) {
+  // `splines` should specify `count` splines, but gracefully handle the
+  // case when it doesn't.
+  Index num_set = 0;
+  for (const CompactSpline* spline = splines;
+       num_set < count && spline != nullptr; spline = spline->Next()) {
+    num_set++;
+  }
+  ClearSplines(index + num_set, count - num_set);
+  if (num_set == 0) return;
+
+  // Look up the segments of every index first, while the splines' x data is
+  // in cache.
+  //
+  // If we're already playing a spline, and the blend time is specified,
+  // create a curve that blends from the current state to a point later in
+  // the new spline. Blends need the index's current state, so they only look
+  // up their segments in this pass. Jumps don't, so they're set now.
+  if (static_cast<Index>(blend_lookups_.size()) < num_set) {
+    blend_lookups_.resize(num_set);
+  }
   const CompactSpline* spline = splines;
-  for (Index i = index; i < index + count; ++i, spline = spline->Next()) {
-    // `splines` should specify `count` splines, but gracefully handle the
-    // case when it doesn't.
-    if (spline == nullptr) {
-      ClearSplines(i, count - i + index);
-      break;
+  for (Index j = 0; j < num_set; ++j, spline = spline->Next()) {
+    BlendLookup& lookup = blend_lookups_[j];
+    lookup.blend =
+        sources_[index + j].spline != nullptr && playback.blend_x > 0.0f;
+    if (lookup.blend) {
+      LookUpBlend(*spline, playback, &lookup);
+    } else {
+      JumpToSpline(index + j, *spline, playback);
     }
+  }
 
-    // If we're already playing a spline, and the blend time is specified,
-    // create a curve that blends from the current state to a point later in
-    // the new spline.
-    const Source& s = sources_[i];
-    const bool should_blend = s.spline != nullptr && playback.blend_x > 0.0f;
-    if (should_blend) {
-      BlendToSpline(i, *spline, playback);
+  // Then create the cubics, which reads the splines' y data.
+  spline = splines;
+  for (Index j = 0; j < num_set; ++j, spline = spline->Next()) {
+    if (blend_lookups_[j].blend) {
+      BlendToSpline(index + j, *spline, playback, blend_lookups_[j]);
     } else {
-      JumpToSpline(i, *spline, playback);
+      InitSegmentCubic(index + j);
     }
-
-    // Update the results.
-    // TODO OPT: Evaluate these in bulk.
-    EvaluateIndex(i);
   }
+
+  // Evaluate them all in one pass.
+  EvaluateIndices(index, num_set);
 }
 
 void BulkSplineEvaluator::Splines(const Index index, const Index count,
@@ -197,24 +302,34 @@ void BulkSplineEvaluator::Splines(const Index index, const Index count,
 void BulkSplineEvaluator::ClearSplines(const Index index, const Index count) {
   for (Index i = index; i < index + count; ++i) {
     sources_[i].spline = nullptr;
+    if (look_ahead_) {
+      next_segments_[i].x_index = kInvalidSplineIndex;
+    }
     cubics_[i] = CubicCurve(0.0f, 0.0f, 0.0f, cubic_xs_[i]);
     cubic_xs_[i] = 0.0f;
-    cubic_x_ends_[i] = std::numeric_limits<float>::infinity();
+    SetCubicXEnd(i, std::numeric_limits<float>::infinity());
   }
 }
 
 void BulkSplineEvaluator::SetXs(const Index index, const Index count,
                                 const float x) {
+  // Look up every segment first, while the splines' x data is in cache.
+  for (Index i = index; i < index + count; ++i) {
+    InitSegment(i, x);
+  }
+
+  // Then create the cubics, which reads the splines' y data.
   for (Index i = index; i < index + count; ++i) {
-    InitCubic(i, x);
-    EvaluateIndex(i);
+    InitSegmentCubic(i);
   }
+
+  EvaluateIndices(index, count);
 }
 
 void BulkSplineEvaluator::SetPlaybackRates(const Index index, const Index count,
                                            float playback_rate) {
   for (Index i = index; i < index + count; ++i) {
-    sources_[i].rate = playback_rate;
+    SetRate(i, playback_rate);
   }
 }
 
@@ -222,10 +337,11 @@ void BulkSplineEvaluator::UpdateCubicXsAndGetMask_C(const float delta_x,
                                                     uint8_t* masks) {
   const int num_xs = NumIndices();
   const float* x_ends = &cubic_x_ends_.front();
+  const float* rates = &rates_.front();
   float* xs = &cubic_xs_.front();
 
   for (int i = 0; i < num_xs; ++i) {
-    xs[i] += delta_x * sources_[i].rate;
+    xs[i] += delta_x * rates[i];
     masks[i] = xs[i] > x_ends[i] ? 0xFF : 0x00;
   }
 }
@@ -273,7 +389,7 @@ size_t BulkSplineEvaluator::UpdateCubicXs_OneStep(const float delta_x,
 
   for (Index i = 0; i < num_indices; ++i) {
     // Increment each cubic x value by delta_x.
-    cubic_xs_[i] += delta_x * sources_[i].rate;
+    cubic_xs_[i] += delta_x * rates_[i];
 
     // When x has gone past the end of the cubic, it should be reinitialized.
     if (cubic_xs_[i] > cubic_x_ends_[i]) {
@@ -283,7 +399,54 @@ size_t BulkSplineEvaluator::UpdateCubicXs_OneStep(const float delta_x,
   return num_to_init;
 }
 
+// Same as UpdateCubicXs_OneStep(), but reads the half-precision segment ends,
+// to use less memory bandwidth.
+size_t BulkSplineEvaluator::UpdateCubicXs_Half(const float delta_x,
+                                               Index* indices_to_init) {
+  const Index num_indices = NumIndices();
+  const float* rates = rates_.data();
+  const uint16_t* x_ends = half_x_ends_.data();
+  float* xs = cubic_xs_.data();
+  size_t num_to_init = 0;
+
+  for (Index i = 0; i < num_indices; ++i) {
+    xs[i] += delta_x * rates[i];
+    if (xs[i] > HalfToFloat(x_ends[i])) {
+      indices_to_init[num_to_init++] = i;
+    }
+  }
+  return num_to_init;
+}
+
+void BulkSplineEvaluator::set_half_precision(bool half_precision) {
+  half_precision = half_precision && HalfPrecisionAvailable();
+  if (half_precision == half_precision_) return;
+
+  // Convert the segment ends to the new format, then release the memory of
+  // the old format.
+  const Index num_indices = NumIndices();
+  if (half_precision) {
+    half_x_ends_.resize(num_indices);
+    for (Index i = 0; i < num_indices; ++i) {
+      half_x_ends_[i] = HalfFromFloatRoundDown(cubic_x_ends_[i]);
+    }
+    std::vector<float>().swap(cubic_x_ends_);
+  } else {
+    cubic_x_ends_.resize(num_indices);
+    for (Index i = 0; i < num_indices; ++i) {
+      cubic_x_ends_[i] = HalfToFloat(half_x_ends_[i]);
+    }
+    std::vector<uint16_t>().swap(half_x_ends_);
+  }
+  half_precision_ = half_precision;
+}
+
 void BulkSplineEvaluator::InitCubic(const Index index, const float start_x) {
+  InitSegment(index, start_x);
+  InitSegmentCubic(index);
+}
+
+void BulkSplineEvaluator::InitSegment(const Index index, const float start_x) {
   // Do nothing if the requested index has no spline.
   Source& s = sources_[index];
   if (s.spline == nullptr) return;
@@ -302,21 +465,126 @@ void BulkSplineEvaluator::InitCubic(const Index index, const float start_x) {
   //   index might match, but the cubic curve will not mach. We should refactor
   //   to detect that case, so we can skip over the CreateCubicInit() call.
   s.x_index = x_index;
+  SetCubicXEnd(index, x_range.Length());
+}
+
+void BulkSplineEvaluator::InitSegmentCubic(const Index index) {
+  const Source& s = sources_[index];
+  if (s.spline == nullptr) return;
 
-  // Initialize the cubic to interpolate the new spline segment.
-  cubic_x_ends_[index] = x_range.Length();
+  // Initialize the cubic to interpolate the spline segment.
   CubicCurve& c = cubics_[index];
-  const CubicInit init = s.spline->CreateCubicInit(x_index);
+  const CubicInit init = s.spline->CreateCubicInit(s.x_index);
   c.Init(init);
 
   c.ScaleUp(s.y_scale);
   c.ShiftUp(s.y_offset);
+
+  // The precomputed segment, if any, followed the old segment.
+  if (look_ahead_) {
+    next_segments_[index].x_index = kInvalidSplineIndex;
+  }
+}
+
+void BulkSplineEvaluator::set_look_ahead(bool look_ahead) {
+  look_ahead_ = look_ahead;
+  look_ahead_cursor_ = 0;
+  if (look_ahead) {
+    next_segments_.assign(NumIndices(), NextSegment());
+  } else {
+    // Release the memory.
+    std::vector<NextSegment>().swap(next_segments_);
+  }
+}
+
+bool BulkSplineEvaluator::PrecomputeNextSegment(const Index index) {
+  const Source& s = sources_[index];
+  NextSegment& n = next_segments_[index];
+  if (s.spline == nullptr || OutsideSpline(s.x_index)) return false;
+
+  // Only segments within the spline can be precomputed. The segment after
+  // the last one depends on whether we repeat, so isn't worth predicting.
+  const CompactSplineIndex x_index =
+      static_cast<CompactSplineIndex>(s.x_index + 1);
+  if (n.x_index == x_index || x_index >= s.spline->LastNodeIndex()) {
+    return false;
+  }
+
+  // Same calculations as InitCubic(), so that the results are identical.
+  const Range x_range = s.spline->RangeX(x_index);
+  const float x_granularity = s.spline->x_granularity();
+  n.start_x = x_range.start();
+  n.width_x = x_range.Length();
+  n.start_grain =
+      detail::CompactSplineNode::QuantizeX(x_range.start(), x_granularity);
+  n.end_grain =
+      detail::CompactSplineNode::QuantizeX(x_range.end(), x_granularity);
+  n.cubic.Init(s.spline->CreateCubicInit(x_index));
+  n.cubic.ScaleUp(s.y_scale);
+  n.cubic.ShiftUp(s.y_offset);
+  n.x_index = x_index;
+  return true;
+}
+
+BulkSplineEvaluator::Index BulkSplineEvaluator::PrecomputeNextSegments(
+    Index max_count) {
+  assert(look_ahead_);
+  const Index num_indices = NumIndices();
+  Index num_precomputed = 0;
+  for (Index i = 0; i < num_indices && num_precomputed < max_count; ++i) {
+    if (look_ahead_cursor_ >= num_indices) {
+      look_ahead_cursor_ = 0;
+    }
+    if (PrecomputeNextSegment(look_ahead_cursor_)) {
+      num_precomputed++;
+    }
+    look_ahead_cursor_++;
+  }
+  return num_precomputed;
+}
+
+bool BulkSplineEvaluator::SwapInNextSegment(const Index index) {
+  Source& s = sources_[index];
+  NextSegment& n = next_segments_[index];
+  if (s.spline == nullptr || n.x_index != s.x_index + 1) return false;
+
+  // Only use the precomputed segment if it's the one InitCubic() would pick.
+  const float x = X(index);
+  const int grain =
+      detail::CompactSplineNode::QuantizeX(x, s.spline->x_granularity());
+  if (grain < n.start_grain || grain >= n.end_grain) return false;
+
+  s.x_index = n.x_index;
+  cubic_xs_[index] = x - n.start_x;
+  SetCubicXEnd(index, n.width_x);
+  cubics_[index] = n.cubic;
+  n.x_index = kInvalidSplineIndex;
+  return true;
 }
 
 void BulkSplineEvaluator::EvaluateIndex(const Index index) {
   // Evaluate the cubic spline.
   CubicCurve& c = cubics_[index];
   ys_[index] = c.Evaluate(cubic_xs_[index]);
+  if (cache_outputs_) {
+    derivatives_[index] = c.Derivative(cubic_xs_[index]);
+  }
+}
+
+void BulkSplineEvaluator::EvaluateIndices(const Index index,
+                                          const Index count) {
+  const CubicCurve* cubics = cubics_.data() + index;
+  const float* xs = cubic_xs_.data() + index;
+  float* ys = ys_.data() + index;
+  for (Index i = 0; i < count; ++i) {
+    ys[i] = cubics[i].Evaluate(xs[i]);
+  }
+  if (cache_outputs_) {
+    float* derivatives = derivatives_.data() + index;
+    for (Index i = 0; i < count; ++i) {
+      derivatives[i] = cubics[i].Derivative(xs[i]);
+    }
+  }
 }
 
 void BulkSplineEvaluator::EvaluateCubics_C() {
@@ -325,21 +593,74 @@ void BulkSplineEvaluator::EvaluateCubics_C() {
   }
 }
 
+// Same as EvaluateCubics_C(), but also calculate derivatives while the cubic
+// coefficients are loaded.
+void BulkSplineEvaluator::EvaluateCubicsAndDerivatives_C() {
+  const Index num_indices = NumIndices();
+  const CubicCurve* cubics = cubics_.data();
+  const float* xs = cubic_xs_.data();
+  float* ys = ys_.data();
+  float* derivatives = derivatives_.data();
+  for (Index i = 0; i < num_indices; ++i) {
+    ys[i] = cubics[i].Evaluate(xs[i]);
+    derivatives[i] = cubics[i].Derivative(xs[i]);
+  }
+}
+
+void BulkSplineEvaluator::set_cache_outputs(bool cache_outputs) {
+  cache_outputs_ = cache_outputs;
+  if (!cache_outputs) {
+    // Release the memory.
+    std::vector<float>().swap(derivatives_);
+    std::vector<float>().swap(end_ys_);
+    std::vector<float>().swap(end_derivatives_);
+    return;
+  }
+
+  const Index num_indices = NumIndices();
+  derivatives_.assign(num_indices, 0.0f);
+  end_ys_.assign(num_indices, 0.0f);
+  end_derivatives_.assign(num_indices, 0.0f);
+  for (Index i = 0; i < num_indices; ++i) {
+    if (sources_[i].spline == nullptr) continue;
+    derivatives_[i] = cubics_[i].Derivative(cubic_xs_[i]);
+    CacheEndValues(i);
+  }
+}
+
 void BulkSplineEvaluator::AdvanceFrame(const float delta_x) {
   // Add 'delta_x' to 'cubic_xs'.
   // Gather a list of indices that are now beyond the end of the cubic.
   Index* indices_to_init = scratch_.size() == 0 ? nullptr : &scratch_.front();
-  const size_t num_to_init = UpdateCubicXs(delta_x, indices_to_init);
+  size_t num_to_init = 0;
+  {
+    FPL_BENCHMARK_INDICES("BulkSplineEvaluator::UpdateCubicXs",
+                          NumIndices());
+    num_to_init = UpdateCubicXs(delta_x, indices_to_init);
+  }
+  num_segment_transitions_ += num_to_init;
 
   // Reinitialize indices that have traversed beyond the end of their cubic.
-  for (size_t i = 0; i < num_to_init; ++i) {
-    const Index index = indices_to_init[i];
-    InitCubic(index, X(index));
+  {
+    FPL_BENCHMARK_INDICES("BulkSplineEvaluator::InitCubics",
+                          static_cast<int>(num_to_init));
+    for (size_t i = 0; i < num_to_init; ++i) {
+      const Index index = indices_to_init[i];
+      if (look_ahead_ && SwapInNextSegment(index)) {
+        num_look_ahead_hits_++;
+        continue;
+      }
+      InitCubic(index, X(index));
+    }
   }
 
   // Update 'ys_' array. Also might affect the constant coefficients of
   // 'cubics_', if we're adjusting for modular arithmetic.
-  EvaluateCubics();
+  {
+    FPL_BENCHMARK_INDICES("BulkSplineEvaluator::EvaluateCubics",
+                          NumIndices());
+    EvaluateCubics();
+  }
 }
 
 bool BulkSplineEvaluator::Valid(const Index index) const {
@@ -365,8 +686,8 @@ inline void BulkSplineEvaluator::UpdateCubicXsAndGetMask(const float delta_x,
 
   UpdateCubicXsAndGetMask_C(delta_x, masks);
   MOTIVE_ASSEMBLY_FUNCTION_NAME(UpdateCubicXsAndGetMask_)(
-      delta_x, &cubic_x_ends_.front(), num_xs, &xs_assembly.front(),
-      &masks_assembly.front());
+      delta_x, &cubic_x_ends_.front(), &rates_.front(), num_xs,
+      &xs_assembly.front(), &masks_assembly.front());
 
   for (int i = 0; i < num_xs; ++i) {
     assert(cubic_xs_[i] == xs_assembly[i]);
@@ -378,7 +699,8 @@ inline void BulkSplineEvaluator::UpdateCubicXsAndGetMask(const float delta_x,
 #if defined(MOTIVE_NEON)
   if (optimization_ == kNeonOptimizations) {
     UpdateCubicXsAndGetMask_Neon(delta_x, &cubic_x_ends_.front(),
-                                  NumIndices(), &cubic_xs_.front(), masks);
+                                  &rates_.front(), NumIndices(),
+                                  &cubic_xs_.front(), masks);
   } else
 #endif
   {
@@ -390,6 +712,10 @@ inline void BulkSplineEvaluator::UpdateCubicXsAndGetMask(const float delta_x,
 
 inline size_t BulkSplineEvaluator::UpdateCubicXs(const float delta_x,
                                                  Index* indices_to_init) {
+  if (half_precision_) {
+    return UpdateCubicXs_Half(delta_x, indices_to_init);
+  }
+
 #if defined(MOTIVE_ASSEMBLY_TEST)
   std::vector<float> xs_original(cubic_xs_);
   std::vector<Index> indices_one(NumIndices());
@@ -424,6 +750,11 @@ inline size_t BulkSplineEvaluator::UpdateCubicXs(const float delta_x,
 }
 
 inline void BulkSplineEvaluator::EvaluateCubics() {
+  if (cache_outputs_) {
+    EvaluateCubicsAndDerivatives_C();
+    return;
+  }
+
 #if defined(MOTIVE_ASSEMBLY_TEST)
   std::vector<float> ys_assembly(NumIndices());
   std::vector<CubicCurve> cubics_assembly(cubics_);
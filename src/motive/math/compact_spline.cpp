@@ -12,12 +12,20 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <stddef.h>
+#include <algorithm>
+#include <limits>
+#include <memory>
 #include <string>
 #include <sstream>
 #include <vector>
 #include "motive/math/bulk_spline_evaluator.h"
 #include "motive/math/dual_cubic.h"
 
+#if defined(MOTIVE_THREADS)
+#include <thread>
+#endif  // defined(MOTIVE_THREADS)
+
 namespace motive {
 
 using mathfu::Lerp;
@@ -33,11 +41,23 @@ const CompactSplineYRung CompactSplineNode::kMaxY =
     std::numeric_limits<CompactSplineXGrain>::max();
 const CompactSplineAngle CompactSplineNode::kMinAngle =
     std::numeric_limits<CompactSplineAngle>::min();
+const int CompactSplineNode::kQuarterTurn;
 const float CompactSplineNode::kYScale = 1.0f / static_cast<float>(kMaxY);
 const float CompactSplineNode::kAngleScale =
     static_cast<float>(-M_PI / static_cast<double>(kMinAngle));
 static const float kYRangeBufferPercent = 1.05f;
 
+// Number of segments after the guess that IndexForX() checks before searching.
+// During playback, x usually moves forward by less than a segment per update,
+// so the segment we want is almost always the guess or the one after it.
+static const int kForwardScanSegments = 3;
+
+// ParallelBulkYs() splits its work into blocks of at most this many splines
+// and points. Block boundaries don't depend on the number of threads, so
+// neither do the results.
+static const size_t kBulkYsSplinesPerBlock = 256;
+static const size_t kBulkYsPointsPerBlock = 512;
+
 // YsBulkOutput records the evaluated y and derivative values into 2D arrays.
 // Arrays are of length num_points * num_splines.
 class YsBulkOutput : public CompactSpline::BulkOutput {
@@ -124,6 +144,99 @@ void CompactSpline::AddNode(const float x, const float y,
                             const CompactSplineAddMethod method) {
   const CompactSplineNode new_node(x, y, derivative, x_granularity_, y_range_);
 
+  // Add a dual-cubic mid-node, if required, to keep cubic curves well behaved.
+  // If we're adding a point at the same x, there will be a discontinuity in
+  // the curve at x, so there's no cubic to keep well behaved.
+  const bool check_middle_node = method == kEnsureCubicWellBehaved &&
+                                 num_nodes_ != 0 && Back().x() != new_node.x();
+  if (check_middle_node) {
+    const CompactSplineNode last_node = Back();
+    const CubicInit init = CreateCubicInit(last_node, new_node);
+    const CubicCurve curve(init);
+
+    // A curve is well behaved if it has uniform curvature.
+    if (!curve.UniformCurvature(Range(0.0f, WidthX(last_node, new_node)))) {
+      // Find a suitable intermediate node using the math from the Dual Cubics
+      // document.
+      UncompressedNode mid_node;
+      CalculateDualCubicMidNode(init, &mid_node.x, &mid_node.y,
+                                &mid_node.derivative);
+      AddNodeWithMidNode(new_node, &mid_node);
+      return;
+    }
+  }
+  AddNodeWithMidNode(new_node, nullptr);
+}
+
+void CompactSpline::AddNodes(const UncompressedNode* nodes, size_t num_nodes,
+                             const CompactSplineAddMethod method) {
+  if (method == kAddWithoutModification) {
+    for (size_t i = 0; i < num_nodes; ++i) {
+      AddNode(nodes[i].x, nodes[i].y, nodes[i].derivative, method);
+    }
+    return;
+  }
+
+  // Compress all the nodes, and gather the segments that join nodes of
+  // different x. Each of those segments is a cubic that may need a mid-node.
+  // Note that the last node is always the node before, even when a node is
+  // skipped or a discontinuity is collapsed, so the segments are independent
+  // of the mid-nodes inserted.
+  std::vector<CompactSplineNode> new_nodes;
+  std::vector<CubicInit> inits;
+  std::vector<size_t> init_nodes;
+  new_nodes.reserve(num_nodes);
+  for (size_t i = 0; i < num_nodes; ++i) {
+    const UncompressedNode& n = nodes[i];
+    new_nodes.push_back(CompactSplineNode(n.x, n.y, n.derivative,
+                                          x_granularity_, y_range_));
+    const bool has_last_node = i > 0 || num_nodes_ != 0;
+    if (!has_last_node) continue;
+    const CompactSplineNode last_node = i > 0 ? new_nodes[i - 1] : Back();
+    if (last_node.x() == new_nodes[i].x()) continue;
+    inits.push_back(CreateCubicInit(last_node, new_nodes[i]));
+    init_nodes.push_back(i);
+  }
+
+  // Find the cubics that aren't well behaved, and calculate their mid-nodes
+  // all at once.
+  std::unique_ptr<bool[]> well_behaved(new bool[inits.size()]);
+  const size_t num_mid_nodes =
+      ClassifyWellBehavedCubics(inits.data(), inits.size(), well_behaved.get());
+  std::vector<CubicInit> mid_inits;
+  mid_inits.reserve(num_mid_nodes);
+  for (size_t i = 0; i < inits.size(); ++i) {
+    if (!well_behaved[i]) mid_inits.push_back(inits[i]);
+  }
+  std::vector<float> mid_xs(num_mid_nodes);
+  std::vector<float> mid_ys(num_mid_nodes);
+  std::vector<float> mid_derivatives(num_mid_nodes);
+  CalculateDualCubicMidNodes(mid_inits.data(), num_mid_nodes, mid_xs.data(),
+                             mid_ys.data(), mid_derivatives.data());
+
+  // Append the nodes, with their mid-nodes.
+  size_t init_index = 0;
+  size_t mid_index = 0;
+  for (size_t i = 0; i < num_nodes; ++i) {
+    const bool has_init =
+        init_index < init_nodes.size() && init_nodes[init_index] == i;
+    const bool has_mid_node = has_init && !well_behaved[init_index];
+    init_index += has_init ? 1 : 0;
+    if (!has_mid_node) {
+      AddNodeWithMidNode(new_nodes[i], nullptr);
+      continue;
+    }
+    UncompressedNode mid_node;
+    mid_node.x = mid_xs[mid_index];
+    mid_node.y = mid_ys[mid_index];
+    mid_node.derivative = mid_derivatives[mid_index];
+    mid_index++;
+    AddNodeWithMidNode(new_nodes[i], &mid_node);
+  }
+}
+
+void CompactSpline::AddNodeWithMidNode(const CompactSplineNode& new_node,
+                                       const UncompressedNode* mid_node) {
   // Precondition: Nodes must come *after* or *at* the last node.
   assert(num_nodes_ == 0 || new_node.x() >= Back().x());
 
@@ -139,36 +252,21 @@ void CompactSpline::AddNode(const float x, const float y,
     // a discontinuity, but for any more, the middle points will just take up
     // space, so remove it.
     const bool already_ends_in_discontinuity =
-        num_nodes_ >= 2 && Back().x() == nodes_[num_nodes_ - 2].x();
+        num_nodes_ >= 2 && Back().x() == NodeXGrain(num_nodes_ - 2);
     if (already_ends_in_discontinuity) num_nodes_--;
   }
 
-  // Add a dual-cubic mid-node, if required, to keep cubic curves well behaved.
-  const bool add_middle_node =
-      !discontinuity && method == kEnsureCubicWellBehaved && num_nodes_ != 0;
-  if (add_middle_node) {
-    const CompactSplineNode& last_node = Back();
-    const CubicInit init = CreateCubicInit(last_node, new_node);
-    const CubicCurve curve(init);
-
-    // A curve is well behaved if it has uniform curvature.
-    if (!curve.UniformCurvature(Range(0.0f, WidthX(last_node, new_node)))) {
-      // Find a suitable intermediate node using the math from the Dual Cubics
-      // document.
-      float mid_x;
-      float mid_y;
-      float mid_derivative;
-      CalculateDualCubicMidNode(init, &mid_x, &mid_y, &mid_derivative);
-
-      // Add the intermediate node, as long as it
-      const CompactSplineNode mid_node(last_node.X(x_granularity_) + mid_x,
-                                       mid_y, mid_derivative, x_granularity_,
-                                       y_range_);
-      const bool is_unique_x =
-          mid_node.x() != last_node.x() && mid_node.x() != new_node.x();
-      if (is_unique_x) {
-        AddNodeVerbatim(mid_node);
-      }
+  // Add the intermediate node, as long as it has a unique x.
+  if (mid_node != nullptr) {
+    assert(!discontinuity);
+    const CompactSplineNode last_node = Back();
+    const CompactSplineNode mid(last_node.X(x_granularity_) + mid_node->x,
+                                mid_node->y, mid_node->derivative,
+                                x_granularity_, y_range_);
+    const bool is_unique_x =
+        mid.x() != last_node.x() && mid.x() != new_node.x();
+    if (is_unique_x) {
+      AddNodeVerbatim(mid);
     }
   }
 
@@ -178,10 +276,7 @@ void CompactSpline::AddNode(const float x, const float y,
 
 void CompactSpline::AddUncompressedNodes(const UncompressedNode* nodes,
                                          size_t num_nodes) {
-  for (size_t i = 0; i < num_nodes; ++i) {
-    AddNode(nodes[i].x, nodes[i].y, nodes[i].derivative,
-            kAddWithoutModification);
-  }
+  AddNodes(nodes, num_nodes, kAddWithoutModification);
 }
 
 float CompactSpline::NodeX(const CompactSplineIndex index) const {
@@ -191,15 +286,13 @@ float CompactSpline::NodeX(const CompactSplineIndex index) const {
   // x=0..first node's x.
   if (index == kAfterSplineIndex) return EndX();
   if (index == kBeforeSplineIndex) return 0.0f;
-  assert(index < num_nodes_);
-  return nodes_[index].X(x_granularity_);
+  return Node(index).X(x_granularity_);
 }
 
 float CompactSpline::NodeY(const CompactSplineIndex index) const {
   if (index == kAfterSplineIndex) return EndY();
   if (index == kBeforeSplineIndex) return StartY();
-  assert(index < num_nodes_);
-  return nodes_[index].Y(y_range_);
+  return Node(index).Y(y_range_);
 }
 
 float CompactSpline::CalculatedSlowly(const float x,
@@ -258,6 +351,117 @@ void CompactSpline::BulkYs(const CompactSpline* const splines,
   BulkEvaluate(splines, num_splines, start_x, delta_x, num_points, &output);
 }
 
+// static
+size_t CompactSpline::NumBulkYsBlocks(const size_t num_splines,
+                                      const size_t num_points) {
+  const size_t num_spline_blocks =
+      (num_splines + kBulkYsSplinesPerBlock - 1) / kBulkYsSplinesPerBlock;
+  const size_t num_point_blocks =
+      (num_points + kBulkYsPointsPerBlock - 1) / kBulkYsPointsPerBlock;
+  return num_spline_blocks * num_point_blocks;
+}
+
+// static
+void CompactSpline::BulkYsBlocks(const CompactSpline* const splines,
+                                 const size_t num_splines,
+                                 const float start_x, const float delta_x,
+                                 const size_t num_points,
+                                 const BulkYsOutput& out,
+                                 const size_t first_block,
+                                 const size_t block_step) {
+  assert(block_step > 0);
+  const size_t num_spline_blocks =
+      (num_splines + kBulkYsSplinesPerBlock - 1) / kBulkYsSplinesPerBlock;
+  const size_t num_blocks = NumBulkYsBlocks(num_splines, num_points);
+  if (first_block >= num_blocks) return;
+
+  // Reuse one evaluator for all our blocks.
+  BulkSplineEvaluator evaluator;
+  evaluator.set_half_precision(false);
+  evaluator.set_cache_outputs(out.derivatives != nullptr);
+  float derivatives[kBulkYsSplinesPerBlock];
+
+  for (size_t block = first_block; block < num_blocks; block += block_step) {
+    const size_t spline_begin =
+        (block % num_spline_blocks) * kBulkYsSplinesPerBlock;
+    const size_t point_begin =
+        (block / num_spline_blocks) * kBulkYsPointsPerBlock;
+    const int block_splines = static_cast<int>(
+        std::min(kBulkYsSplinesPerBlock, num_splines - spline_begin));
+    const size_t block_points =
+        std::min(kBulkYsPointsPerBlock, num_points - point_begin);
+
+    // Note that we set `repeat` = false, so that we can accurately get the
+    // last value in the spline.
+    const SplinePlayback playback(start_x +
+                                  static_cast<float>(point_begin) * delta_x);
+    evaluator.SetNumIndices(block_splines);
+    evaluator.SetSplines(0, block_splines,
+                         splines->NextAtIdx(static_cast<int>(spline_begin)),
+                         playback);
+
+    for (size_t p = 0; p < block_points; ++p) {
+      if (p > 0) {
+        evaluator.AdvanceFrame(delta_x);
+      }
+      const size_t offset =
+          (point_begin + p) * out.point_stride + spline_begin * out.spline_stride;
+      if (out.ys != nullptr) {
+        const float* ys = evaluator.Ys(0);
+        float* ys_out = out.ys + offset;
+        for (int s = 0; s < block_splines; ++s) {
+          ys_out[s * out.spline_stride] = ys[s];
+        }
+      }
+      if (out.derivatives != nullptr) {
+        evaluator.Derivatives(0, block_splines, derivatives);
+        float* derivatives_out = out.derivatives + offset;
+        for (int s = 0; s < block_splines; ++s) {
+          derivatives_out[s * out.spline_stride] = derivatives[s];
+        }
+      }
+    }
+  }
+}
+
+// static
+void CompactSpline::ParallelBulkYs(const CompactSpline* const splines,
+                                   const size_t num_splines,
+                                   const float start_x, const float delta_x,
+                                   const size_t num_points,
+                                   const BulkYsOutput& out,
+                                   unsigned int num_threads) {
+  if (num_splines == 0 || num_points == 0) return;
+
+#if defined(MOTIVE_THREADS)
+  // Don't start more threads than there are blocks.
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  num_threads = static_cast<unsigned int>(std::min(
+      static_cast<size_t>(num_threads), NumBulkYsBlocks(num_splines,
+                                                        num_points)));
+
+  // The calling thread does its share of the work too.
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads - 1);
+  for (unsigned int i = 1; i < num_threads; ++i) {
+    threads.push_back(std::thread(BulkYsBlocks, splines, num_splines, start_x,
+                                  delta_x, num_points, out,
+                                  static_cast<size_t>(i),
+                                  static_cast<size_t>(num_threads)));
+  }
+  BulkYsBlocks(splines, num_splines, start_x, delta_x, num_points, out, 0,
+               num_threads);
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i].join();
+  }
+#else
+  (void)num_threads;
+  BulkYsBlocks(splines, num_splines, start_x, delta_x, num_points, out, 0, 1);
+#endif  // defined(MOTIVE_THREADS)
+}
+
 Range CompactSpline::RangeX(const CompactSplineIndex index) const {
   if (index == kBeforeSplineIndex)
     // Return 0.0f for the start of the range instead of -inf.
@@ -268,8 +472,8 @@ Range CompactSpline::RangeX(const CompactSplineIndex index) const {
   if (index == kAfterSplineIndex)
     return Range(EndX(), std::numeric_limits<float>::infinity());
 
-  return Range(nodes_[index].X(x_granularity_),
-               nodes_[index + 1].X(x_granularity_));
+  return Range(NodeXGrain(index) * x_granularity_,
+               NodeXGrain(index + 1) * x_granularity_);
 }
 
 CompactSplineIndex CompactSpline::IndexForX(
@@ -278,25 +482,35 @@ CompactSplineIndex CompactSpline::IndexForX(
 
   // Check bounds first.
   // Return negative if before index 0.
-  if (quantized_x < Front().x()) return kBeforeSplineIndex;
+  if (quantized_x < NodeXGrain(0)) return kBeforeSplineIndex;
 
   // When we are exactly on the last node, we want to return the index of the
   // last segment (i.e. the second last node). This is so that the derivative
   // at the end matches the derivative of the last node, and not 0 (since
   // derivatives beyond the spline are forced to 0).
   // This only makes sense if there is more than one node in the spline.
-  if (quantized_x == Back().x() && num_nodes_ >= 2) return num_nodes_ - 2;
+  const int end_x = NodeXGrain(LastNodeIndex());
+  if (quantized_x == end_x && num_nodes_ >= 2) return num_nodes_ - 2;
 
   // Return index of the last index if beyond the last index.
-  if (quantized_x >= Back().x()) return kAfterSplineIndex;
+  if (quantized_x >= end_x) return kAfterSplineIndex;
 
-  // Check the guess value first.
+  // Check the guess value first, then the segments just after it.
   const CompactSplineXGrain compact_x =
       static_cast<CompactSplineXGrain>(quantized_x);
-  if (IndexContainsX(compact_x, guess_index)) return guess_index;
+  if (guess_index < LastNodeIndex()) {
+    const int scan_end = std::min(guess_index + kForwardScanSegments + 1,
+                                  static_cast<int>(LastNodeIndex()));
+    for (int i = guess_index; i < scan_end; ++i) {
+      const CompactSplineIndex index = static_cast<CompactSplineIndex>(i);
+      if (IndexContainsX(compact_x, index)) return index;
+    }
+  }
 
   // Search for it, if the initial guess fails.
-  const CompactSplineIndex index = BinarySearchIndexForX(compact_x);
+  const CompactSplineIndex index = HasXLookup()
+                                       ? LookupIndexForX(compact_x)
+                                       : BinarySearchIndexForX(compact_x);
   assert(IndexContainsX(compact_x, index));
   return index;
 }
@@ -335,52 +549,348 @@ CompactSplineIndex CompactSpline::ClampIndex(const CompactSplineIndex index,
 
 bool CompactSpline::IndexContainsX(const CompactSplineXGrain compact_x,
                                    const CompactSplineIndex index) const {
-  return index < LastNodeIndex() && nodes_[index].x() <= compact_x &&
-         compact_x <= nodes_[index + 1].x();
-}
-
-static inline bool CompareSplineNodeX(const CompactSplineXGrain compact_x,
-                                      const CompactSplineNode& n) {
-  return compact_x < n.x();
+  return index < LastNodeIndex() && NodeXGrain(index) <= compact_x &&
+         compact_x <= NodeXGrain(index + 1);
 }
 
 CompactSplineIndex CompactSpline::BinarySearchIndexForX(
     const CompactSplineXGrain compact_x) const {
-  // Binary search nodes by x.
-  // TODO OPT: avoid the pointer arithmetic (which is expensive on ARM since it
-  // requires an integer division) by searching with indices instead of
-  // iterators.
-  //     int low = 0;
-  //     int hi = max_hi;
-  //     while (low + 1 < hi) {
-  //       const int mid = (low + hi) / 2;
-  //
-  //       if (compact_x < nodes_[mid].x()) {
-  //         hi = mid;
-  //       } else {
-  //         low = mid;
-  //       }
-  //     }
-  const auto upper_it = std::upper_bound(nodes_, &nodes_[num_nodes_], compact_x,
-                                         CompareSplineNodeX);
-  const int low = static_cast<int>(upper_it - nodes_) - 1;
-  assert(0 <= low && low < LastNodeIndex());
+  // Binary search nodes by x. Use indices instead of iterators to avoid the
+  // pointer arithmetic, which is expensive on ARM since it requires an integer
+  // division. The node at `low` is always <= compact_x, and the node at `hi` is
+  // always > compact_x.
+  int low = 0;
+  int hi = LastNodeIndex();
+  assert(NodeXGrain(low) <= compact_x && compact_x < NodeXGrain(hi));
+  while (low + 1 < hi) {
+    const int mid = (low + hi) / 2;
+    if (compact_x < NodeXGrain(mid)) {
+      hi = mid;
+    } else {
+      low = mid;
+    }
+  }
 
   // We return the lower index: x is in the segment bt 'index' and 'index' + 1.
   return static_cast<CompactSplineIndex>(low);
 }
 
+CompactSplineIndex CompactSpline::LookupIndexForX(
+    const CompactSplineXGrain compact_x) const {
+  assert(HasXLookup() && NodeXGrain(0) <= compact_x &&
+         compact_x < NodeXGrain(LastNodeIndex()));
+
+  // The cell gives the segment at the start of its interval. Step forward
+  // over any nodes between the start of the interval and `compact_x`.
+  const int cell = (compact_x - NodeXGrain(0)) >> x_lookup_shift_;
+  int index = XLookupCells()[cell];
+  const int last_segment = LastSegmentIndex();
+  while (index < last_segment && NodeXGrain(index + 1) <= compact_x) {
+    ++index;
+  }
+  return static_cast<CompactSplineIndex>(index);
+}
+
+void CompactSpline::InitXLookup() {
+  assert(max_x_lookup_cells_ > 0 && num_nodes_ >= 2 && !packed_);
+
+  // Use the narrowest power-of-two cell width that covers the spline with at
+  // most `max_x_lookup_cells_` cells, so that finding the cell is just a
+  // shift.
+  const int start_x = NodeXGrain(0);
+  const int end_x = NodeXGrain(LastNodeIndex());
+  const int width = end_x - start_x;
+  uint8_t shift = 0;
+  while ((width >> shift) >= max_x_lookup_cells_) ++shift;
+
+  // Fill each cell with the segment at the start of its interval. The last
+  // cell may start on the last node, which belongs to the last segment.
+  const int num_used_cells = (width >> shift) + 1;
+  for (int i = 0; i < num_used_cells; ++i) {
+    const int x = std::min(start_x + (i << shift), end_x - 1);
+    XLookupCells()[i] =
+        BinarySearchIndexForX(static_cast<CompactSplineXGrain>(x));
+  }
+  x_lookup_shift_ = shift;
+}
+
+// Packed data starts with this header. It's followed by the table of
+// distinct angles, if `num_angles` is non-zero, and then the nodes, each
+// packed into x_bits + y_bits + angle_bits bits. Multi-byte values are
+// little-endian, as in the rest of our serialized data.
+struct PackedSplineHeader {
+  // Total bytes of packed data, including this header.
+  uint32_t data_size;
+
+  // Node i's x is x_start + (i * x_step) / 65536, plus x_offset_min, plus
+  // the x bits of the node.
+  int32_t x_step;
+  int32_t x_offset_min;
+  uint16_t x_start;
+
+  // Node y's are y_min plus the y bits of the node.
+  uint16_t y_min;
+
+  // If `num_angles` is zero, node angles are angle_min plus the angle bits of
+  // the node. Otherwise, the angle bits are an index into the angle table.
+  int16_t angle_min;
+  uint16_t num_angles;
+
+  uint8_t x_bits;
+  uint8_t y_bits;
+  uint8_t angle_bits;
+  uint8_t padding;
+};
+
+// Fixed-point shift for PackedSplineHeader::x_step.
+static const int kXStepShift = 16;
+
+// Nodes are read 64-bits at a time, so pad the end of the packed nodes.
+static const size_t kPackedNodesPadding = sizeof(uint64_t);
+
+// Return the number of bits required to store values from 0 to `max_value`.
+static uint8_t BitsRequired(uint32_t max_value) {
+  uint8_t bits = 0;
+  while (bits < 32 && (max_value >> bits) != 0) ++bits;
+  return bits;
+}
+
+static int PredictedX(const PackedSplineHeader& h, int index) {
+  return h.x_start +
+         static_cast<int>((static_cast<int64_t>(index) * h.x_step) >>
+                          kXStepShift);
+}
+
+static const PackedSplineHeader& PackedHeader(const uint8_t* data) {
+  return *reinterpret_cast<const PackedSplineHeader*>(data);
+}
+
+static const CompactSplineAngle* PackedAngles(const uint8_t* data) {
+  return reinterpret_cast<const CompactSplineAngle*>(
+      data + sizeof(PackedSplineHeader));
+}
+
+static const uint8_t* PackedNodeBits(const uint8_t* data) {
+  return data + sizeof(PackedSplineHeader) +
+         PackedHeader(data).num_angles * sizeof(CompactSplineAngle);
+}
+
+// Return the `num_bits` bits that start `bit_offset` bits into `bits`.
+// Always reads 64 bits, so `bits` must be padded.
+static inline uint64_t ReadBits(const uint8_t* bits, size_t bit_offset,
+                                int num_bits) {
+  uint64_t word;
+  memcpy(&word, bits + (bit_offset >> 3), sizeof(word));
+  const uint64_t mask = (static_cast<uint64_t>(1) << num_bits) - 1;
+  return (word >> (bit_offset & 7)) & mask;
+}
+
+static inline void WriteBits(uint8_t* bits, size_t bit_offset, uint64_t value) {
+  uint64_t word;
+  memcpy(&word, bits + (bit_offset >> 3), sizeof(word));
+  word |= value << (bit_offset & 7);
+  memcpy(bits + (bit_offset >> 3), &word, sizeof(word));
+}
+
+// Choose the bit widths used to pack `source`, and gather its distinct
+// angles, if storing them in a table is smaller.
+static void PlanPacking(const CompactSpline& source, PackedSplineHeader* h,
+                        std::vector<CompactSplineAngle>* angles) {
+  const int num_nodes = source.num_nodes();
+  assert(num_nodes >= 1);
+  memset(h, 0, sizeof(*h));
+
+  // Predict x's as evenly spaced from the first to the last node.
+  const int start_x = source.Node(0).x();
+  const int end_x = source.Node(source.LastNodeIndex()).x();
+  h->x_start = static_cast<uint16_t>(start_x);
+  h->x_step = num_nodes < 2
+                  ? 0
+                  : static_cast<int32_t>(
+                        ((static_cast<int64_t>(end_x - start_x)
+                          << kXStepShift) +
+                         (num_nodes - 1) / 2) /
+                        (num_nodes - 1));
+
+  int x_offset_min = std::numeric_limits<int>::max();
+  int x_offset_max = std::numeric_limits<int>::min();
+  int y_min = std::numeric_limits<int>::max();
+  int y_max = std::numeric_limits<int>::min();
+  int angle_min = std::numeric_limits<int>::max();
+  int angle_max = std::numeric_limits<int>::min();
+  angles->clear();
+  for (int i = 0; i < num_nodes; ++i) {
+    const CompactSplineNode n = source.Node(static_cast<CompactSplineIndex>(i));
+    const int x_offset = n.x() - PredictedX(*h, i);
+    x_offset_min = std::min(x_offset_min, x_offset);
+    x_offset_max = std::max(x_offset_max, x_offset);
+    y_min = std::min(y_min, static_cast<int>(n.y()));
+    y_max = std::max(y_max, static_cast<int>(n.y()));
+    angle_min = std::min(angle_min, static_cast<int>(n.angle()));
+    angle_max = std::max(angle_max, static_cast<int>(n.angle()));
+    angles->push_back(n.angle());
+  }
+  std::sort(angles->begin(), angles->end());
+  angles->erase(std::unique(angles->begin(), angles->end()), angles->end());
+
+  h->x_offset_min = x_offset_min;
+  h->x_bits = BitsRequired(static_cast<uint32_t>(x_offset_max - x_offset_min));
+  h->y_min = static_cast<uint16_t>(y_min);
+  h->y_bits = BitsRequired(static_cast<uint32_t>(y_max - y_min));
+  h->angle_min = static_cast<int16_t>(angle_min);
+
+  // Use a table of angles only if it's smaller, including the table itself.
+  const uint8_t offset_bits =
+      BitsRequired(static_cast<uint32_t>(angle_max - angle_min));
+  const uint8_t index_bits =
+      BitsRequired(static_cast<uint32_t>(angles->size() - 1));
+  const size_t offset_cost = static_cast<size_t>(num_nodes) * offset_bits;
+  const size_t table_cost = static_cast<size_t>(num_nodes) * index_bits +
+                            angles->size() * 8 * sizeof(CompactSplineAngle);
+  if (table_cost < offset_cost) {
+    h->num_angles = static_cast<uint16_t>(angles->size());
+    h->angle_bits = index_bits;
+  } else {
+    angles->clear();
+    h->angle_bits = offset_bits;
+  }
+
+  const size_t node_bits = h->x_bits + h->y_bits + h->angle_bits;
+  const size_t nodes_size =
+      (num_nodes * node_bits + 7) / 8 + kPackedNodesPadding;
+  h->data_size = static_cast<uint32_t>(
+      sizeof(PackedSplineHeader) +
+      angles->size() * sizeof(CompactSplineAngle) + nodes_size);
+}
+
+size_t CompactSpline::PackedSize(const size_t data_size) {
+  const size_t kAlignMask = sizeof(float) - 1;
+  return (kBaseSize + data_size + kAlignMask) & ~kAlignMask;
+}
+
+size_t CompactSpline::PackedSize(const CompactSpline& source) {
+  PackedSplineHeader h;
+  std::vector<CompactSplineAngle> angles;
+  PlanPacking(source, &h, &angles);
+  return PackedSize(h.data_size);
+}
+
+size_t CompactSpline::packed_data_size() const {
+  return PackedHeader(packed_data()).data_size;
+}
+
+CompactSpline* CompactSpline::CreatePackedInPlace(const CompactSpline& source,
+                                                  void* buffer) {
+  // The packed header is read in place, so must be aligned.
+  static_assert(offsetof(CompactSpline, nodes_) %
+                        alignof(PackedSplineHeader) ==
+                    0,
+                "Packed header is misaligned");
+
+  PackedSplineHeader h;
+  std::vector<CompactSplineAngle> angles;
+  PlanPacking(source, &h, &angles);
+
+  CompactSpline* spline = new (buffer) CompactSpline();
+  spline->y_range_ = source.y_range_;
+  spline->x_granularity_ = source.x_granularity_;
+  spline->num_nodes_ = source.num_nodes_;
+  spline->max_nodes_ = source.num_nodes_;
+  spline->packed_ = 1;
+
+  uint8_t* data = reinterpret_cast<uint8_t*>(spline->nodes_);
+  memset(data, 0, h.data_size);
+  memcpy(data, &h, sizeof(h));
+  if (!angles.empty()) {
+    memcpy(data + sizeof(h), &angles[0],
+           angles.size() * sizeof(CompactSplineAngle));
+  }
+
+  // Pack angle, then y, then x into each node's bits, so that x is in the
+  // lowest bits and can be read on its own.
+  uint8_t* bits = data + sizeof(h) + angles.size() * sizeof(CompactSplineAngle);
+  const int node_bits = h.x_bits + h.y_bits + h.angle_bits;
+  for (int i = 0; i < source.num_nodes_; ++i) {
+    const CompactSplineNode n = source.Node(static_cast<CompactSplineIndex>(i));
+    const uint64_t angle =
+        h.num_angles == 0
+            ? static_cast<uint64_t>(n.angle() - h.angle_min)
+            : static_cast<uint64_t>(
+                  std::lower_bound(angles.begin(), angles.end(), n.angle()) -
+                  angles.begin());
+    const uint64_t y = static_cast<uint64_t>(n.y() - h.y_min);
+    const uint64_t x =
+        static_cast<uint64_t>(n.x() - PredictedX(h, i) - h.x_offset_min);
+    const uint64_t value = (((angle << h.y_bits) | y) << h.x_bits) | x;
+    WriteBits(bits, static_cast<size_t>(i) * node_bits, value);
+  }
+
+  assert(spline->Size() <= PackedSize(source));
+  return spline;
+}
+
+CompactSpline* CompactSpline::CreateFromPackedData(
+    const Range& y_range, float x_granularity, CompactSplineIndex num_nodes,
+    const uint8_t* data, size_t data_size) {
+  assert(data_size >= sizeof(PackedSplineHeader) &&
+         PackedHeader(data).data_size == data_size);
+  uint8_t* buffer = new uint8_t[PackedSize(data_size)];
+  CompactSpline* spline = new (buffer) CompactSpline();
+  spline->y_range_ = y_range;
+  spline->x_granularity_ = x_granularity;
+  spline->num_nodes_ = num_nodes;
+  spline->max_nodes_ = num_nodes;
+  spline->packed_ = 1;
+  memcpy(spline->nodes_, data, data_size);
+  return spline;
+}
+
+CompactSplineNode CompactSpline::PackedNode(
+    const CompactSplineIndex index) const {
+  const uint8_t* data = packed_data();
+  const PackedSplineHeader& h = PackedHeader(data);
+  const int node_bits = h.x_bits + h.y_bits + h.angle_bits;
+  const uint64_t value = ReadBits(PackedNodeBits(data),
+                                  static_cast<size_t>(index) * node_bits,
+                                  node_bits);
+
+  const uint64_t x_mask = (static_cast<uint64_t>(1) << h.x_bits) - 1;
+  const uint64_t y_mask = (static_cast<uint64_t>(1) << h.y_bits) - 1;
+  const int x = PredictedX(h, index) + h.x_offset_min +
+                static_cast<int>(value & x_mask);
+  const int y = h.y_min + static_cast<int>((value >> h.x_bits) & y_mask);
+  const int angle_bits = static_cast<int>(value >> (h.x_bits + h.y_bits));
+  const CompactSplineAngle angle =
+      h.num_angles == 0
+          ? static_cast<CompactSplineAngle>(h.angle_min + angle_bits)
+          : PackedAngles(data)[angle_bits];
+  return CompactSplineNode(static_cast<CompactSplineXGrain>(x),
+                           static_cast<CompactSplineYRung>(y), angle);
+}
+
+CompactSplineXGrain CompactSpline::PackedX(
+    const CompactSplineIndex index) const {
+  const uint8_t* data = packed_data();
+  const PackedSplineHeader& h = PackedHeader(data);
+  const int node_bits = h.x_bits + h.y_bits + h.angle_bits;
+  const uint64_t x_offset = ReadBits(
+      PackedNodeBits(data), static_cast<size_t>(index) * node_bits, h.x_bits);
+  return static_cast<CompactSplineXGrain>(PredictedX(h, index) +
+                                          h.x_offset_min +
+                                          static_cast<int>(x_offset));
+}
+
 CubicInit CompactSpline::CreateCubicInit(const CompactSplineIndex index) const {
   // Handle case where we are outside of the interpolatable range.
   if (OutsideSpline(index)) {
-    const CompactSplineNode& n = index == kBeforeSplineIndex ? Front() : Back();
+    const CompactSplineNode n = index == kBeforeSplineIndex ? Front() : Back();
     const float constant_y = n.Y(y_range_);
     return CubicInit(constant_y, 0.0f, constant_y, 0.0f, 1.0f);
   }
 
   // Interpolate between the nodes at 'index' and 'index' + 1.
   assert(index + 1 < num_nodes_);
-  return CreateCubicInit(nodes_[index], nodes_[index + 1]);
+  return CreateCubicInit(Node(index), Node(index + 1));
 }
 
 CubicInit CompactSpline::CreateCubicInit(const CompactSplineNode& s,
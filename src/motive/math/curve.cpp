@@ -18,6 +18,10 @@
 #include "motive/math/bulk_spline_evaluator.h"
 #include "motive/math/float.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif  // defined(__SSE2__)
+
 #ifdef _DEBUG
 #define MOTIVE_CURVE_SANITY_CHECKS
 #endif // _DEBUG
@@ -235,7 +239,15 @@ size_t QuadraticCurve::RangesMatchingSign(const Range& x_limits, float sign,
   // valid and invalid regions.
   float roots[2];
   const size_t num_roots = RootsInRange(x_limits, roots);
+  return RangesMatchingSignWithRoots(x_limits, sign, roots, num_roots,
+                                     matching);
+}
 
+size_t QuadraticCurve::RangesMatchingSignWithRoots(const Range& x_limits,
+                                                   float sign,
+                                                   const float roots[2],
+                                                   size_t num_roots,
+                                                   Range matching[2]) const {
   // We want ranges where the spline's sign equals valid_sign's.
   const bool valid_at_start = sign * Evaluate(x_limits.start()) >= 0.0f;
   const bool valid_at_end = sign * Evaluate(x_limits.end()) >= 0.0f;
@@ -268,6 +280,258 @@ size_t QuadraticCurve::RangesMatchingSign(const Range& x_limits, float sign,
   return 1;
 }
 
+#if defined(__SSE2__)
+// Four-lane versions of the exponent helpers in float.h.
+static inline __m128i ExponentAsInt4(const __m128 f) {
+  const __m128i bits = _mm_srli_epi32(_mm_castps_si128(f), kExponentShift);
+  return _mm_sub_epi32(
+      _mm_and_si128(bits, _mm_set1_epi32(static_cast<int>(kExponentMask))),
+      _mm_set1_epi32(kExponentOffset));
+}
+
+static inline __m128 ExponentFromInt4(const __m128i i) {
+  const __m128i biased = _mm_add_epi32(i, _mm_set1_epi32(kExponentOffset));
+  return _mm_castsi128_ps(_mm_slli_epi32(
+      _mm_and_si128(biased, _mm_set1_epi32(static_cast<int>(kExponentMask))),
+      kExponentShift));
+}
+
+static inline __m128 MaxPowerOf2Scale4(const __m128 f, const int max_exponent) {
+  const __m128i exponent =
+      _mm_sub_epi32(_mm_set1_epi32(max_exponent), ExponentAsInt4(f));
+  const __m128i max_float_exponent = _mm_set1_epi32(kMaxFloatExponent);
+  const __m128i too_big = _mm_cmpgt_epi32(exponent, max_float_exponent);
+  return ExponentFromInt4(
+      _mm_or_si128(_mm_and_si128(too_big, max_float_exponent),
+                   _mm_andnot_si128(too_big, exponent)));
+}
+
+static inline __m128 Select4(const __m128 mask, const __m128 a,
+                             const __m128 b) {
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static inline __m128 Abs4(const __m128 x) {
+  return _mm_andnot_ps(_mm_set1_ps(-0.0f), x);
+}
+
+// Same as unary minus. Note that 0 - x would turn -0 into +0 instead.
+static inline __m128 Negate4(const __m128 x) {
+  return _mm_xor_ps(_mm_set1_ps(-0.0f), x);
+}
+
+// Solve up to four quadratics at once. Every step of Roots() and
+// RootsWithoutNormalizing() is computed in all lanes, with the same
+// operations in the same order, and the branches are replaced by masks. So the
+// roots match the scalar versions, including the sign of zero roots, unless
+// the compiler contracts the scalar arithmetic into fused multiply-adds.
+static void QuadraticRoots4(const QuadraticCurve* curves, size_t count,
+                            QuadraticCurve::RootsArray* roots) {
+  assert(0 < count && count <= 4);
+  static const int kMaxExponentForRootCoeff = kMaxInvertableExponent - 1;
+
+  // Repeat the last curve in unused lanes. Their results are discarded.
+  const QuadraticCurve& q0 = curves[0];
+  const QuadraticCurve& q1 = curves[count > 1 ? 1 : 0];
+  const QuadraticCurve& q2 = curves[count > 2 ? 2 : count - 1];
+  const QuadraticCurve& q3 = curves[count - 1];
+  const __m128 c2 = _mm_setr_ps(q0.Coeff(2), q1.Coeff(2), q2.Coeff(2),
+                                q3.Coeff(2));
+  const __m128 c1 = _mm_setr_ps(q0.Coeff(1), q1.Coeff(1), q2.Coeff(1),
+                                q3.Coeff(1));
+  const __m128 c0 = _mm_setr_ps(q0.Coeff(0), q1.Coeff(0), q2.Coeff(0),
+                                q3.Coeff(0));
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 invertable_min = _mm_set1_ps(kInvertablePowerOf2Range.start());
+  const __m128 invertable_max = _mm_set1_ps(kInvertablePowerOf2Range.end());
+
+  // Scale in the x-axis so that c2 is in the range of the larger of c1 or c0.
+  // See Roots() for details.
+  const __m128 abs2 = Abs4(c2);
+  const __m128 abs1 = Abs4(c1);
+  const __m128 abs0 = Abs4(c0);
+  const __m128 scale_with_linear = _mm_cmpge_ps(abs1, abs0);
+  const __m128 quotient = _mm_div_ps(abs2, _mm_max_ps(abs1, abs0));
+  const __m128 quotient_invertable =
+      _mm_and_ps(_mm_cmple_ps(invertable_min, quotient),
+                 _mm_cmple_ps(quotient, invertable_max));
+  const __m128i negative_exponent =
+      _mm_sub_epi32(_mm_setzero_si128(), ExponentAsInt4(quotient));
+  const __m128i half_negative_exponent = _mm_srai_epi32(
+      _mm_add_epi32(negative_exponent, _mm_srli_epi32(negative_exponent, 31)),
+      1);
+  const __m128 x_scale_reciprocal_unclamped = Select4(
+      quotient_invertable,
+      Select4(scale_with_linear, ExponentFromInt4(negative_exponent),
+              ExponentFromInt4(half_negative_exponent)),
+      one);
+  const __m128 x_scale_reciprocal =
+      _mm_min_ps(MaxPowerOf2Scale4(abs1, kMaxInvertableExponent),
+                 x_scale_reciprocal_unclamped);
+  const __m128 x_scaled2 =
+      _mm_mul_ps(_mm_mul_ps(c2, x_scale_reciprocal), x_scale_reciprocal);
+  const __m128 x_scaled1 = _mm_mul_ps(c1, x_scale_reciprocal);
+
+  // Scale in the y-axis so that c2 is near 1.
+  const __m128 x_scaled_abs2 = Abs4(x_scaled2);
+  const __m128 clamped2 = _mm_max_ps(
+      invertable_min, _mm_min_ps(invertable_max, x_scaled_abs2));
+  const __m128 y_scale_unclamped = ExponentFromInt4(
+      _mm_sub_epi32(_mm_setzero_si128(), ExponentAsInt4(clamped2)));
+  const __m128 y_scale_max = _mm_min_ps(
+      MaxPowerOf2Scale4(abs0, kMaxExponentForRootCoeff),
+      MaxPowerOf2Scale4(Abs4(x_scaled1), kMaxExponentForRootCoeff));
+  const __m128 y_scale = _mm_min_ps(y_scale_max, y_scale_unclamped);
+  const __m128 a = _mm_mul_ps(y_scale, x_scaled2);
+  const __m128 b = _mm_mul_ps(y_scale, x_scaled1);
+  const __m128 c = _mm_mul_ps(y_scale, c0);
+
+#ifdef MOTIVE_CURVE_SANITY_CHECKS
+  // Same sanity checks as Roots(), lane by lane.
+  float quotients[4];
+  float linear_quotients[4];
+  float constant_quotients[4];
+  float x_scaled_abs2s[4];
+  float y_scales[4];
+  float y_scales_unclamped[4];
+  float as[4];
+  float bs[4];
+  float cs[4];
+  int with_linear[4];
+  _mm_storeu_ps(quotients, quotient);
+  _mm_storeu_ps(linear_quotients, _mm_div_ps(x_scaled_abs2, Abs4(x_scaled1)));
+  _mm_storeu_ps(constant_quotients, _mm_div_ps(x_scaled_abs2, abs0));
+  _mm_storeu_ps(x_scaled_abs2s, x_scaled_abs2);
+  _mm_storeu_ps(y_scales, y_scale);
+  _mm_storeu_ps(y_scales_unclamped, y_scale_unclamped);
+  _mm_storeu_ps(as, Abs4(a));
+  _mm_storeu_ps(bs, Abs4(b));
+  _mm_storeu_ps(cs, Abs4(c));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(with_linear),
+                   _mm_castps_si128(scale_with_linear));
+  for (size_t i = 0; i < count; ++i) {
+    assert(!kInvertablePowerOf2Range.Contains(quotients[i]) ||
+           Range(0.5f, 2.0f).Contains(with_linear[i] != 0
+                                          ? linear_quotients[i]
+                                          : constant_quotients[i]));
+    assert((Range(0.5f, 2.0f).Contains(as[i]) ||
+            !kInvertablePowerOf2Range.Contains(x_scaled_abs2s[i]) ||
+            y_scales[i] != y_scales_unclamped[i]) &&
+           bs[i] <= std::numeric_limits<float>::max() &&
+           cs[i] <= std::numeric_limits<float>::max());
+  }
+#endif  // MOTIVE_CURVE_SANITY_CHECKS
+
+  // Quadratic formula, as in RootsWithoutNormalizing().
+  const __m128 epsilon = _mm_mul_ps(
+      _mm_max_ps(_mm_max_ps(Abs4(a), Abs4(b)), Abs4(c)),
+      _mm_set1_ps(kEpsilonScale));
+  const __m128 is_linear = _mm_cmplt_ps(Abs4(a), epsilon);
+  const __m128 is_constant = _mm_cmplt_ps(Abs4(b), epsilon);
+  const __m128 neg_b = Negate4(b);
+  const __m128 linear_root = _mm_div_ps(Negate4(c), b);
+  const __m128 discriminant_unclamped = _mm_sub_ps(
+      _mm_mul_ps(b, b), _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(4.0f), a), c));
+  const __m128 discriminant =
+      _mm_andnot_ps(_mm_cmple_ps(Abs4(discriminant_unclamped), epsilon),
+                    discriminant_unclamped);
+  const __m128 no_real_roots = _mm_cmplt_ps(discriminant, _mm_setzero_ps());
+  const __m128 one_real_root = _mm_cmpeq_ps(discriminant, _mm_setzero_ps());
+  const __m128 divisor =
+      _mm_mul_ps(_mm_div_ps(one, a), _mm_set1_ps(0.5f));
+  const __m128 sqrt_discriminant = _mm_sqrt_ps(
+      _mm_andnot_ps(no_real_roots, discriminant));
+  const __m128 root_minus =
+      _mm_mul_ps(_mm_sub_ps(neg_b, sqrt_discriminant), divisor);
+  const __m128 root_plus =
+      _mm_mul_ps(_mm_add_ps(neg_b, sqrt_discriminant), divisor);
+  const __m128 quadratic_root0 =
+      Select4(one_real_root, _mm_mul_ps(neg_b, divisor),
+              _mm_min_ps(root_plus, root_minus));
+  const __m128 quadratic_root1 = _mm_max_ps(root_plus, root_minus);
+
+  // Number of roots. Comparison masks are -1 when true.
+  //   linear:    1, or 0 if constant
+  //   quadratic: 2, or 1 if one real root, or 0 if no real roots
+  const __m128i linear_len =
+      _mm_add_epi32(_mm_set1_epi32(1), _mm_castps_si128(is_constant));
+  const __m128i quadratic_len = _mm_add_epi32(
+      _mm_add_epi32(_mm_set1_epi32(2), _mm_castps_si128(one_real_root)),
+      _mm_slli_epi32(_mm_castps_si128(no_real_roots), 1));
+  const __m128i is_linear_int = _mm_castps_si128(is_linear);
+  const __m128i len =
+      _mm_or_si128(_mm_and_si128(is_linear_int, linear_len),
+                   _mm_andnot_si128(is_linear_int, quadratic_len));
+
+  // Undo the x-scaling.
+  const __m128 root0 = _mm_mul_ps(
+      Select4(is_linear, linear_root, quadratic_root0), x_scale_reciprocal);
+  const __m128 root1 = _mm_mul_ps(quadratic_root1, x_scale_reciprocal);
+
+  int lens[4];
+  float roots0[4];
+  float roots1[4];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(lens), len);
+  _mm_storeu_ps(roots0, root0);
+  _mm_storeu_ps(roots1, root1);
+  const int distinct = _mm_movemask_ps(_mm_cmpneq_ps(root_minus, root_plus));
+  (void)distinct;
+  for (size_t i = 0; i < count; ++i) {
+    assert(lens[i] != 2 || (distinct & (1 << i)) != 0);
+    roots[i].len = static_cast<size_t>(lens[i]);
+    roots[i].arr[0] = roots0[i];
+    roots[i].arr[1] = roots1[i];
+  }
+}
+#endif  // defined(__SSE2__)
+
+void QuadraticCurve::BulkRoots(const QuadraticCurve* curves, size_t count,
+                               RootsArray* roots) {
+#if defined(__SSE2__)
+  if (UseSse2Kernels()) {
+    for (size_t i = 0; i < count; i += 4) {
+      QuadraticRoots4(&curves[i], std::min<size_t>(count - i, 4), &roots[i]);
+    }
+    return;
+  }
+#endif  // defined(__SSE2__)
+  for (size_t i = 0; i < count; ++i) {
+    curves[i].Roots(&roots[i]);
+  }
+}
+
+void QuadraticCurve::BulkRootsInRange(const QuadraticCurve* curves,
+                                      size_t count, const Range& x_limits,
+                                      RootsArray* roots) {
+  BulkRoots(curves, count, roots);
+
+  // Same as RootsInRange().
+  const float epsilon_x = x_limits.Length() * kEpsilonScale;
+  for (size_t i = 0; i < count; ++i) {
+    roots[i].len = Range::ValuesInRange(x_limits, epsilon_x, roots[i].len,
+                                        roots[i].arr);
+  }
+}
+
+void QuadraticCurve::BulkRangesMatchingSign(const QuadraticCurve* curves,
+                                            const float* signs, size_t count,
+                                            const Range& x_limits,
+                                            RangeArray* matching) {
+  // Solve the roots in batches, so that the roots can live on the stack.
+  static const size_t kBatchSize = 32;
+  RootsArray roots[kBatchSize];
+  for (size_t start = 0; start < count; start += kBatchSize) {
+    const size_t batch_count = std::min(count - start, kBatchSize);
+    BulkRootsInRange(&curves[start], batch_count, x_limits, roots);
+    for (size_t i = 0; i < batch_count; ++i) {
+      const size_t index = start + i;
+      matching[index].len = curves[index].RangesMatchingSignWithRoots(
+          x_limits, signs[index], roots[i].arr, roots[i].len,
+          matching[index].arr);
+    }
+  }
+}
+
 bool QuadraticCurve::operator==(const QuadraticCurve& rhs) const {
   for (int i = 0; i < kNumCoeff; ++i) {
     if (c_[i] != rhs.c_[i]) return false;
@@ -348,6 +612,53 @@ bool CubicCurve::UniformCurvature(const Range& x_limits) const {
   return start_second_derivative * end_second_derivative >= 0.0f;
 }
 
+void CubicCurve::BulkUniformCurvature(const CubicCurve* curves,
+                                      const Range* x_limits, size_t count,
+                                      bool* uniform) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  // Same math as UniformCurvature(), four curves at a time.
+  const __m128 six = _mm_set1_ps(6.0f);
+  const __m128 two = _mm_set1_ps(2.0f);
+  const size_t sse2_count = UseSse2Kernels() ? count : 0;
+  for (; i + 4 <= sse2_count; i += 4) {
+    const CubicCurve* c = &curves[i];
+    const Range* r = &x_limits[i];
+    const __m128 c3 = _mm_setr_ps(c[0].c_[3], c[1].c_[3], c[2].c_[3],
+                                  c[3].c_[3]);
+    const __m128 c2 = _mm_setr_ps(c[0].c_[2], c[1].c_[2], c[2].c_[2],
+                                  c[3].c_[2]);
+    const __m128 c1 = _mm_setr_ps(c[0].c_[1], c[1].c_[1], c[2].c_[1],
+                                  c[3].c_[1]);
+    const __m128 c0 = _mm_setr_ps(c[0].c_[0], c[1].c_[0], c[2].c_[0],
+                                  c[3].c_[0]);
+    const __m128 start = _mm_setr_ps(r[0].start(), r[1].start(),
+                                     r[2].start(), r[3].start());
+    const __m128 end =
+        _mm_setr_ps(r[0].end(), r[1].end(), r[2].end(), r[3].end());
+    const __m128 epsilon = _mm_mul_ps(
+        _mm_max_ps(_mm_max_ps(_mm_max_ps(Abs4(c3), Abs4(c2)), Abs4(c1)),
+                   Abs4(c0)),
+        _mm_set1_ps(kEpsilonScale));
+    const __m128 six_c3 = _mm_mul_ps(six, c3);
+    const __m128 two_c2 = _mm_mul_ps(two, c2);
+    const __m128 start_second =
+        _mm_add_ps(_mm_mul_ps(six_c3, start), two_c2);
+    const __m128 end_second = _mm_add_ps(_mm_mul_ps(six_c3, end), two_c2);
+    const __m128 product = _mm_mul_ps(
+        _mm_andnot_ps(_mm_cmple_ps(Abs4(start_second), epsilon), start_second),
+        _mm_andnot_ps(_mm_cmple_ps(Abs4(end_second), epsilon), end_second));
+    const int mask = _mm_movemask_ps(_mm_cmpge_ps(product, _mm_setzero_ps()));
+    for (int j = 0; j < 4; ++j) {
+      uniform[i + j] = (mask & (1 << j)) != 0;
+    }
+  }
+#endif  // defined(__SSE2__)
+  for (; i < count; ++i) {
+    uniform[i] = curves[i].UniformCurvature(x_limits[i]);
+  }
+}
+
 bool CubicCurve::operator==(const CubicCurve& rhs) const {
   for (int i = 0; i < kNumCoeff; ++i) {
     if (c_[i] != rhs.c_[i]) return false;
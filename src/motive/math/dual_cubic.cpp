@@ -26,6 +26,8 @@ static const float kMinYDiff = 0.1f; // Prevent division by zero.
 // One node of a spline that specifies both first and second derivatives.
 // Only used internally.
 struct SplineControlNode {
+  SplineControlNode()
+      : x(0.0f), y(0.0f), derivative(0.0f), second_derivative(0.0f) {}
   SplineControlNode(const float x, const float y, const float derivative,
                     const float second_derivative = 0.0f)
       : x(x),
@@ -73,34 +75,14 @@ static QuadraticCurve CalculateValidMidRangeSplineForEnd(
   return QuadraticCurve(c2, c1, c0);
 }
 
-static Range CalculateValidMidRange(const SplineControlNode& start,
-                                    const SplineControlNode& end,
-                                    bool* is_valid = nullptr) {
-  // The sign of these quadratics determine where the mid-node is valid.
-  // One quadratic for the start cubic, and one for the end cubic.
-  const QuadraticCurve start_spline =
-      CalculateValidMidRangeSplineForStart(start, end);
-  const QuadraticCurve end_spline =
-      CalculateValidMidRangeSplineForEnd(start, end);
-
-  // The mid node is valid when the quadratic sign matches the second
-  // derivative's sign.
-  Range::RangeArray<2> start_ranges;
-  Range::RangeArray<2> end_ranges;
-  start_spline.RangesMatchingSign(kZeroToOne, start.second_derivative,
-                                  &start_ranges);
-  end_spline.RangesMatchingSign(kZeroToOne, end.second_derivative, &end_ranges);
-
+static Range CalculateValidMidRange(
+    const QuadraticCurve::RangeArray& start_ranges,
+    const QuadraticCurve::RangeArray& end_ranges) {
   // Find the valid overlapping ranges, or the gaps inbetween the ranges.
   Range::RangeArray<4> intersections;
   Range::RangeArray<4> gaps;
   Range::IntersectRanges(start_ranges, end_ranges, &intersections, &gaps);
 
-  // The mid-node is valid only if there is an overlapping range.
-  if (is_valid != nullptr) {
-    *is_valid = intersections.len > 0;
-  }
-
   // Take the largest overlapping range. If none, find the smallest gap
   // between the ranges.
   return intersections.len > 0
@@ -109,13 +91,7 @@ static Range CalculateValidMidRange(const SplineControlNode& start,
                             : kZeroToOne;
 }
 
-static float CalculateMidPercent(const SplineControlNode& start,
-                                 const SplineControlNode& end) {
-  // The mid value we called 'k' in the dual cubic documentation.
-  // It's between 0~1 and determines where the start and end cubics are joined
-  // along the x-axis.
-  const Range valid_range = CalculateValidMidRange(start, end);
-
+static float CalculateMidPercent(const Range& valid_range) {
   // Return the part of the range closest to the half-way mark. This seems to
   // generate the smoothest looking curves.
   const float mid_unclamped = valid_range.Clamp(0.5f);
@@ -232,41 +208,59 @@ static float ApproximateMidPercent(const SplineControlNode& start,
   return mid_percent;
 }
 
-void CalculateDualCubicMidNode(const CubicInit& init, float* x, float* y,
-                               float* derivative) {
+// Characterize the start and end nodes of the cubic in `init`, including
+// second derivatives, on the x domain 0~1.
+static void CalculateControlNodes(const CubicInit& init,
+                                  SplineControlNode* start,
+                                  SplineControlNode* end) {
   // The initial y and derivative values of our node are given by the
   // 'init' control nodes. We scale to x from 0~1, because all of our math
   // assumes x on this domain.
-  SplineControlNode start(0.0f, init.start_y,
-                          init.start_derivative * init.width_x);
-  SplineControlNode end(1.0f, init.end_y, init.end_derivative * init.width_x);
+  *start = SplineControlNode(0.0f, init.start_y,
+                             init.start_derivative * init.width_x);
+  *end = SplineControlNode(1.0f, init.end_y,
+                           init.end_derivative * init.width_x);
 
   // Use a heuristic to guess a reasonably close place to split the cubic into
   // two cubics.
   float start_percent, end_percent;
   const float approx_mid_percent =
-      ApproximateMidPercent(start, end, &start_percent, &end_percent);
+      ApproximateMidPercent(*start, *end, &start_percent, &end_percent);
 
   // Given the start and end conditions and the place to split the cubic,
   // find the extreme second derivatives for start and end curves. See the
   // Dual Cubic document for a derivation of the math here.
   const float start_extreme_second =
-      ExtremeSecondDerivativeForStart(start, end, approx_mid_percent);
+      ExtremeSecondDerivativeForStart(*start, *end, approx_mid_percent);
   const float end_extreme_second =
-      ExtremeSecondDerivativeForEnd(start, end, approx_mid_percent);
+      ExtremeSecondDerivativeForEnd(*start, *end, approx_mid_percent);
 
   // Don't just use the extreme values since this will create a curve that's
   // flat in the middle. Skew the second derivative to favor the steeper side.
-  start.second_derivative = Lerp(0.0f, start_extreme_second, start_percent);
-  end.second_derivative = Lerp(0.0f, end_extreme_second, end_percent);
+  start->second_derivative = Lerp(0.0f, start_extreme_second, start_percent);
+  end->second_derivative = Lerp(0.0f, end_extreme_second, end_percent);
+}
 
-  // Now that we have the full characterization of the start end end nodes
-  // (including second derivatives), calculate the actual ideal mid percent
-  // (i.e. the place to split the curve).
-  const float mid_percent = CalculateMidPercent(start, end);
+void CalculateDualCubicMidNode(const CubicInit& init, float* x, float* y,
+                               float* derivative) {
+  // Same math as CalculateDualCubicMidNodes(), but without the batch arrays,
+  // which cost more to set up than one mid node costs to calculate.
+  SplineControlNode start;
+  SplineControlNode end;
+  CalculateControlNodes(init, &start, &end);
 
-  // With a full characterization of start and end nodes, and a place to
-  // split the curve, we can uniquely calculate the mid node.
+  // The sign of these quadratics determine where the mid-node is valid.
+  // One quadratic for the start cubic, and one for the end cubic.
+  QuadraticCurve::RangeArray start_ranges;
+  QuadraticCurve::RangeArray end_ranges;
+  CalculateValidMidRangeSplineForStart(start, end)
+      .RangesMatchingSign(kZeroToOne, start.second_derivative, &start_ranges);
+  CalculateValidMidRangeSplineForEnd(start, end)
+      .RangesMatchingSign(kZeroToOne, end.second_derivative, &end_ranges);
+
+  // Calculate the ideal place to split the curve, and the mid node there.
+  const float mid_percent =
+      CalculateMidPercent(CalculateValidMidRange(start_ranges, end_ranges));
   const SplineControlNode mid = CalculateMidNode(start, end, mid_percent);
 
   // Re-scale the output values to the proper x-width.
@@ -275,4 +269,81 @@ void CalculateDualCubicMidNode(const CubicInit& init, float* x, float* y,
   *derivative = mid.derivative / init.width_x;
 }
 
+void CalculateDualCubicMidNodes(const CubicInit* inits, size_t count,
+                                float* xs, float* ys, float* derivatives) {
+  // Work in batches, so that the intermediate values live on the stack.
+  static const size_t kBatchSize = 32;
+  SplineControlNode starts[kBatchSize];
+  SplineControlNode ends[kBatchSize];
+  QuadraticCurve splines[2 * kBatchSize];
+  float signs[2 * kBatchSize];
+  QuadraticCurve::RangeArray ranges[2 * kBatchSize];
+
+  for (size_t batch = 0; batch < count; batch += kBatchSize) {
+    const size_t batch_count = std::min(count - batch, kBatchSize);
+    const CubicInit* batch_inits = &inits[batch];
+
+    // The sign of these quadratics determine where the mid-node is valid.
+    // One quadratic for the start cubic, and one for the end cubic. The mid
+    // node is valid when the quadratic sign matches the second derivative's
+    // sign.
+    for (size_t i = 0; i < batch_count; ++i) {
+      CalculateControlNodes(batch_inits[i], &starts[i], &ends[i]);
+      splines[2 * i] = CalculateValidMidRangeSplineForStart(starts[i], ends[i]);
+      splines[2 * i + 1] =
+          CalculateValidMidRangeSplineForEnd(starts[i], ends[i]);
+      signs[2 * i] = starts[i].second_derivative;
+      signs[2 * i + 1] = ends[i].second_derivative;
+    }
+
+    // Solve the quadratics for every cubic in the batch together.
+    QuadraticCurve::BulkRangesMatchingSign(splines, signs, 2 * batch_count,
+                                           kZeroToOne, ranges);
+
+    for (size_t i = 0; i < batch_count; ++i) {
+      // Now that we have the full characterization of the start end end nodes
+      // (including second derivatives), calculate the actual ideal mid
+      // percent (i.e. the place to split the curve).
+      const float mid_percent = CalculateMidPercent(
+          CalculateValidMidRange(ranges[2 * i], ranges[2 * i + 1]));
+
+      // With a full characterization of start and end nodes, and a place to
+      // split the curve, we can uniquely calculate the mid node.
+      const SplineControlNode mid =
+          CalculateMidNode(starts[i], ends[i], mid_percent);
+
+      // Re-scale the output values to the proper x-width.
+      const float width_x = batch_inits[i].width_x;
+      xs[batch + i] = mid.x * width_x;
+      ys[batch + i] = mid.y;
+      derivatives[batch + i] = mid.derivative / width_x;
+    }
+  }
+}
+
+size_t ClassifyWellBehavedCubics(const CubicInit* inits, size_t count,
+                                 bool* well_behaved) {
+  static const size_t kBatchSize = 64;
+  CubicCurve curves[kBatchSize];
+  Range x_limits[kBatchSize];
+
+  size_t num_not_well_behaved = 0;
+  for (size_t batch = 0; batch < count; batch += kBatchSize) {
+    const size_t batch_count = std::min(count - batch, kBatchSize);
+    for (size_t i = 0; i < batch_count; ++i) {
+      const CubicInit& init = inits[batch + i];
+      curves[i].Init(init);
+      x_limits[i] = Range(0.0f, init.width_x);
+    }
+
+    // A curve is well behaved if it has uniform curvature.
+    CubicCurve::BulkUniformCurvature(curves, x_limits, batch_count,
+                                     &well_behaved[batch]);
+    for (size_t i = 0; i < batch_count; ++i) {
+      num_not_well_behaved += well_behaved[batch + i] ? 0 : 1;
+    }
+  }
+  return num_not_well_behaved;
+}
+
 }  // namespace motive
@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include "motive/processor.h"
 #include "motive/motivator.h"
 #include "motive/util/benchmark.h"
@@ -68,7 +69,11 @@ void MotiveProcessor::InitializeMotivator(const MotivatorInit& init,
 
   // Assign an 'index' to reference the new Motivator. All interactions between
   // the Motivator and MotiveProcessor use this 'index' to identify the data.
+  max_dimensions_ = std::max(max_dimensions_, dimensions);
   const MotiveIndex index = index_allocator_.Alloc(dimensions);
+  active_indices_ += dimensions;
+  indices_changed_ = true;
+  counters_.motivators_initialized++;
 
   // Keep a pointer to the Motivator around. We may Defragment() the indices and
   // move the data around. We also need remove the Motivator when we're
@@ -97,6 +102,8 @@ void MotiveProcessor::RemoveMotivatorWithoutNotifying(MotiveIndex index) {
   for (MotiveDimension i = 0; i < dimensions; ++i) {
     motivators_[index + i] = nullptr;
   }
+  active_indices_ -= dimensions;
+  indices_changed_ = true;
 
   // Recycle 'index'. It will be used in the next allocation, or back-filled in
   // the next call to Defragment().
@@ -152,7 +159,130 @@ bool MotiveProcessor::ValidMotivatorIndex(MotiveIndex index) const {
   return ValidIndex(index) && IsMotivatorIndex(index);
 }
 
+void MotiveProcessor::Defragment() {
+  FPL_BENCHMARK("MotiveProcessor::Defragment");
+  index_allocator_.Defragment();
+
+  // Sorts are rate limited, since the key of every Motivator can change
+  // every frame, but the benefit of sorting only builds up over many frames.
+  frames_since_sort_++;
+  if (sort_indices_ && indices_changed_ &&
+      frames_since_sort_ >= kFramesBetweenSorts) {
+    SortIndices();
+    frames_since_sort_ = 0;
+    indices_changed_ = false;
+  }
+}
+
+namespace {
+
+template <class Block>
+bool LessDimensions(const Block& a, const Block& b) {
+  return a.dimensions < b.dimensions;
+}
+
+template <class Block>
+bool LessKey(const Block& a, const Block& b) {
+  return a.key < b.key;
+}
+
+}  // namespace
+
+void MotiveProcessor::SortIndices() {
+  FPL_BENCHMARK("MotiveProcessor::SortIndices");
+
+  // Gather the Motivators. Defragment() has already removed the holes.
+  const MotiveIndex num_indices = index_allocator_.num_indices();
+  std::vector<SortBlock>& blocks = sort_blocks_;
+  blocks.clear();
+  for (MotiveIndex i = 0; i < num_indices; i += Dimensions(i)) {
+    assert(motivators_[i] != nullptr);
+    const SortBlock b = {IndexSortKey(i), i, Dimensions(i)};
+    blocks.push_back(b);
+  }
+
+  // A Motivator can only move to an index that's occupied by a Motivator of
+  // the same dimension, so that the index allocator's record of block sizes
+  // remains valid. So sort each dimension separately. `sources[i]` is the
+  // index of the block that should move to index `i`.
+  std::stable_sort(blocks.begin(), blocks.end(), LessDimensions<SortBlock>);
+  std::vector<MotiveIndex>& sources = sort_sources_;
+  sources.resize(num_indices);
+  bool sorted = true;
+  for (size_t start = 0; start < blocks.size();) {
+    size_t end = start + 1;
+    while (end < blocks.size() &&
+           blocks[end].dimensions == blocks[start].dimensions) {
+      end++;
+    }
+
+    // Blocks of this dimension are in index order, so record their indices
+    // before sorting them by key.
+    std::vector<MotiveIndex>& indices = sort_group_indices_;
+    indices.resize(end - start);
+    for (size_t i = start; i < end; ++i) {
+      indices[i - start] = blocks[i].index;
+    }
+    std::stable_sort(blocks.begin() + start, blocks.begin() + end,
+                     LessKey<SortBlock>);
+    for (size_t i = start; i < end; ++i) {
+      const MotiveIndex index = indices[i - start];
+      sources[index] = blocks[i].index;
+      sorted = sorted && sources[index] == index;
+    }
+    start = end;
+  }
+  if (sorted) return;
+
+  // Apply the permutation one cycle at a time. The first block of each cycle
+  // is moved past the end of the data, to free up its index for the rest of
+  // the cycle. SetNumIndicesBase() has reserved capacity for it, so the
+  // arrays are not reallocated.
+  const MotiveIndex temp_index = num_indices;
+  ResizeIndices(num_indices + max_dimensions_, 0);
+  for (size_t b = 0; b < blocks.size(); ++b) {
+    const MotiveIndex start = blocks[b].index;
+    if (sources[start] == start) continue;
+
+    const MotiveDimension dimensions = blocks[b].dimensions;
+    MoveMotivator(start, temp_index, dimensions);
+    MotiveIndex hole = start;
+    for (;;) {
+      const MotiveIndex source = sources[hole];
+      sources[hole] = hole;
+      if (source == start) break;
+      MoveMotivator(source, hole, dimensions);
+      hole = source;
+    }
+    MoveMotivator(temp_index, hole, dimensions);
+  }
+  ResizeIndices(num_indices, 0);
+
+  VerifyInternalState();
+}
+
+void MotiveProcessor::MoveMotivator(MotiveIndex old_index,
+                                    MotiveIndex new_index,
+                                    MotiveDimension dimensions) {
+  motivators_[old_index]->Init(this, new_index);
+  counters_.defragment_moves += dimensions;
+  MoveIndices(old_index, new_index, dimensions);
+  for (MotiveDimension i = 0; i < dimensions; ++i) {
+    assert(motivators_[new_index + i] == nullptr);
+    motivators_[new_index + i] = motivators_[old_index + i];
+    motivators_[old_index + i] = nullptr;
+  }
+}
+
 void MotiveProcessor::SetNumIndicesBase(MotiveIndex num_indices) {
+  // SortIndices() temporarily uses the indices past the end. When sorting is
+  // enabled and the arrays have to grow anyway, grow them to hold those
+  // indices too, so that sorting never reallocates the arrays itself.
+  ResizeIndices(num_indices, sort_indices_ ? max_dimensions_ : 0);
+}
+
+void MotiveProcessor::ResizeIndices(MotiveIndex num_indices,
+                                    MotiveIndex spare) {
   // When the size decreases, we don't bother reallocating the size of the
   // 'motivators_' vector. We want to avoid reallocating as much as possible,
   // so we let it grow to its high-water mark.
@@ -160,8 +290,19 @@ void MotiveProcessor::SetNumIndicesBase(MotiveIndex num_indices) {
   // TODO: Ideally, we should reserve approximately the right amount of storage
   // for motivators_. That would require adding a user-defined initialization
   // parameter.
+  const size_t capacity = motivators_.capacity();
+  if (static_cast<size_t>(num_indices + spare) > capacity && spare > 0) {
+    motivators_.resize(num_indices + spare);
+    SetNumIndices(num_indices + spare);
+  }
   motivators_.resize(num_indices);
 
+  // Derived classes resize their arrays in lock step with 'motivators_', so
+  // a reallocation here means every per-index array has been reallocated.
+  if (motivators_.capacity() != capacity) {
+    counters_.reallocations++;
+  }
+
   // Call derived class.
   SetNumIndices(num_indices);
 }
@@ -174,6 +315,8 @@ void MotiveProcessor::MoveIndexRangeBase(const IndexRange& source,
     motivators_[i]->Init(this, i + index_diff);
   }
 
+  counters_.defragment_moves += source.Length();
+
   // Tell derivated class about the move.
   MoveIndices(source.start(), target, source.Length());
 
@@ -188,6 +331,52 @@ void MotiveProcessor::MoveIndexRangeBase(const IndexRange& source,
   }
 }
 
+MotiveProcessorCounters MotiveProcessor::Counters() const {
+  MotiveProcessorCounters counters = counters_;
+  counters.active_indices = active_indices_;
+  counters.holes = index_allocator_.num_indices() - active_indices_;
+  GatherCounters(&counters);
+  return counters;
+}
+
+MotiveMemoryUsage MotiveProcessor::MemoryUsage() const {
+  MotiveMemoryUsage usage;
+  usage.AddVector(kMemoryIndexArrays, motivators_);
+  GatherMemoryUsage(&usage);
+  return usage;
+}
+
+void MotiveProcessor::UpdateFrameCounters() {
+  const MotiveProcessorCounters counters = Counters();
+  frame_counters_ = counters.Delta(previous_counters_);
+  previous_counters_ = counters;
+}
+
+MotiveProcessorCounters MotiveProcessorCounters::Delta(
+    const MotiveProcessorCounters& earlier) const {
+  MotiveProcessorCounters delta = *this;
+  delta.motivators_initialized -= earlier.motivators_initialized;
+  delta.defragment_moves -= earlier.defragment_moves;
+  delta.segment_transitions -= earlier.segment_transitions;
+  delta.look_ahead_hits -= earlier.look_ahead_hits;
+  delta.blends_started -= earlier.blends_started;
+  delta.set_target_calls -= earlier.set_target_calls;
+  delta.reallocations -= earlier.reallocations;
+  return delta;
+}
+
+void MotiveProcessorCounters::Add(const MotiveProcessorCounters& rhs) {
+  active_indices += rhs.active_indices;
+  holes += rhs.holes;
+  motivators_initialized += rhs.motivators_initialized;
+  defragment_moves += rhs.defragment_moves;
+  segment_transitions += rhs.segment_transitions;
+  look_ahead_hits += rhs.look_ahead_hits;
+  blends_started += rhs.blends_started;
+  set_target_calls += rhs.set_target_calls;
+  reallocations += rhs.reallocations;
+}
+
 void MotiveProcessor::RegisterBenchmarks() {
   const std::string class_name(*Type());
   benchmark_id_for_advance_frame_ =
@@ -144,6 +144,7 @@ class EaseInEaseOutMotiveProcessor
                                   const float* target_values,
                                   const float* target_velocities,
                                   const MotiveCurveShape& shape) {
+    MutableCounters().set_target_calls += dimensions;
     for (MotiveDimension i = 0; i < dimensions; ++i) {
       int processor_index = index + i;
       EaseInEaseOutData& d = Data(processor_index);
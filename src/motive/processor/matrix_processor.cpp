@@ -366,6 +366,9 @@ class MatrixData {
   const mat4& result_matrix() const { return result_matrix_; }
   int num_ops() const { return num_ops_; }
 
+  // Number of bytes allocated by Create().
+  size_t Size() const { return SizeOfClass(num_ops_); }
+
   static MatrixData* Create(const MatrixInit& init, MotiveEngine* engine) {
     // Allocate a buffer that is big enough to hold MatrixData.
     const MatrixInit::OpVector& ops = init.ops();
@@ -463,6 +466,7 @@ class MatrixMotiveProcessor : public MatrixProcessor4f {
 
   virtual void SetChildTarget1f(MotiveIndex index, MotiveChildIndex child_index,
                                 const MotiveTarget1f& t) {
+    MutableCounters().set_target_calls++;
     Data(index).Op(child_index).SetTarget1f(t);
     // TODO: Update end time.
   }
@@ -477,6 +481,7 @@ class MatrixMotiveProcessor : public MatrixProcessor4f {
 
   virtual void BlendToOps(MotiveIndex index, const MatrixOpArray& ops,
                           const motive::SplinePlayback& playback) {
+    // Blends are counted by the processors of the individual curves.
     Data(index).BlendToOps(ops.ops(), playback);
   }
 
@@ -531,6 +536,15 @@ class MatrixMotiveProcessor : public MatrixProcessor4f {
     data_.resize(num_indices, nullptr);
   }
 
+  virtual void GatherMemoryUsage(MotiveMemoryUsage* usage) const {
+    usage->AddVector(kMemoryIndexArrays, data_);
+    for (auto it = data_.begin(); it != data_.end(); ++it) {
+      if (*it == nullptr) continue;
+      const size_t size = (*it)->Size();
+      usage->Add(kMemoryIndexBlocks, size, size);
+    }
+  }
+
   const MatrixData& Data(MotiveIndex index) const {
     assert(ValidIndex(index));
     return *data_[index];
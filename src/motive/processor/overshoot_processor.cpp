@@ -91,8 +91,9 @@ class OvershootMotiveProcessor : public MotiveProcessorNf {
                            float* out) const {
     for (MotiveDimension i = 0; i < dimensions; ++i) {
       const OvershootData& d = Data(index + i);
-      out[i] = Normalize(d, d.target_value - values_[i]);
+      out[i] = d.target_value - values_[index + i];
     }
+    Range::NormalizeCloseValues(&modular_ranges_[index], out, dimensions, out);
   }
 
   // TODO: Implement this after converting Overshoot to use splines.
@@ -104,6 +105,7 @@ class OvershootMotiveProcessor : public MotiveProcessorNf {
 
   virtual void SetTargets(MotiveIndex index, MotiveDimension dimensions,
                           const MotiveTarget1f* ts) {
+    MutableCounters().set_target_calls += dimensions;
     const MotiveTarget1f* t = ts;
     for (MotiveIndex i = index; i < index + dimensions; ++i, ++t) {
       OvershootData& d = Data(i);
@@ -129,9 +131,14 @@ class OvershootMotiveProcessor : public MotiveProcessorNf {
   virtual void InitializeIndices(const MotivatorInit& init, MotiveIndex index,
                                  MotiveDimension dimensions,
                                  MotiveEngine* /*engine*/) {
+    const OvershootInit& overshoot_init =
+        static_cast<const OvershootInit&>(init);
+    const Range modular_range =
+        overshoot_init.modular() ? overshoot_init.range() : Range();
     for (MotiveIndex i = index; i < index + dimensions; ++i) {
-      Data(i).Initialize(static_cast<const OvershootInit&>(init));
+      Data(i).Initialize(overshoot_init);
       values_[i] = 0.0f;
+      modular_ranges_[i] = modular_range;
     }
   }
 
@@ -146,12 +153,20 @@ class OvershootMotiveProcessor : public MotiveProcessorNf {
     for (MotiveDimension i = 0; i < dimensions; ++i, ++new_i, ++old_i) {
       data_[new_i] = data_[old_i];
       values_[new_i] = values_[old_i];
+      modular_ranges_[new_i] = modular_ranges_[old_i];
     }
   }
 
   virtual void SetNumIndices(MotiveIndex num_indices) {
     data_.resize(num_indices);
     values_.resize(num_indices);
+    modular_ranges_.resize(num_indices);
+  }
+
+  virtual void GatherMemoryUsage(MotiveMemoryUsage* usage) const {
+    usage->AddVector(kMemoryIndexArrays, data_);
+    usage->AddVector(kMemoryIndexArrays, values_);
+    usage->AddVector(kMemoryIndexArrays, modular_ranges_);
   }
 
   const OvershootData& Data(MotiveIndex index) const {
@@ -207,6 +222,10 @@ class OvershootMotiveProcessor : public MotiveProcessorNf {
 
   std::vector<OvershootData> data_;
   std::vector<float> values_;
+
+  // d.init.range() if d.init.modular(), otherwise an invalid range, for each
+  // OvershootData d in data_. Lets Differences() normalize in bulk.
+  std::vector<Range> modular_ranges_;
 };
 
 MOTIVE_INSTANCE(OvershootInit, OvershootMotiveProcessor);
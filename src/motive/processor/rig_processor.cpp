@@ -21,6 +21,7 @@
 #include "motive/init.h"
 #include "motive/math/angle.h"
 #include "motive/math/bulk_spline_evaluator.h"
+#include "motive/util/benchmark.h"
 
 using motive::Angle;
 using motive::kPi;
@@ -112,6 +113,14 @@ class RigData {
 
   const RigAnim* defining_anim() const { return defining_anim_; }
 
+  // Number of bytes allocated for this class and its per-bone arrays.
+  // The matrix motivators' data is held by the matrix processor.
+  size_t Size() const {
+    const size_t num_bones = static_cast<size_t>(NumBones());
+    return sizeof(RigData) +
+           num_bones * (sizeof(MatrixMotivator4f) + sizeof(AffineTransform));
+  }
+
   void ChildValuesForDebugging(std::vector<float>* values) const {
     values->resize(defining_anim_->NumOps());
 
@@ -249,10 +258,13 @@ class MotiveRigProcessor : public RigProcessor {
     Defragment();
 
     // Process the series of matrix operations for each index.
-    const MotiveIndex num_indices = NumIndices();
-    for (MotiveIndex index = 0; index < num_indices; ++index) {
-      RigData& d = Data(index);
-      d.UpdateGlobalTransforms();
+    {
+      FPL_BENCHMARK("MotiveRigProcessor::UpdateGlobalTransforms");
+      const MotiveIndex num_indices = NumIndices();
+      for (MotiveIndex index = 0; index < num_indices; ++index) {
+        RigData& d = Data(index);
+        d.UpdateGlobalTransforms();
+      }
     }
 
     // Update our global time. It shouldn't matter if this wraps
@@ -262,6 +274,7 @@ class MotiveRigProcessor : public RigProcessor {
 
   virtual void BlendToAnim(MotiveIndex index, const RigAnim& anim,
                            const motive::SplinePlayback& playback) {
+    // Blends are counted by the processors of the individual curves.
     Data(index).BlendToAnim(anim, playback, time_);
   }
 
@@ -343,6 +356,15 @@ class MotiveRigProcessor : public RigProcessor {
     data_.resize(num_indices, nullptr);
   }
 
+  virtual void GatherMemoryUsage(MotiveMemoryUsage* usage) const {
+    usage->AddVector(kMemoryIndexArrays, data_);
+    for (auto it = data_.begin(); it != data_.end(); ++it) {
+      if (*it == nullptr) continue;
+      const size_t size = (*it)->Size();
+      usage->Add(kMemoryIndexBlocks, size, size);
+    }
+  }
+
   const RigData& Data(MotiveIndex index) const {
     assert(ValidIndex(index));
     return *data_[index];
@@ -26,6 +26,10 @@ using motive::Range;
 // that go above or below the supplied nodes.
 static const float kYRangeBufferPercent = 1.2f;
 
+// When look-ahead is enabled, every index is visited once in this many frames
+// to precompute its next segment.
+static const int kLookAheadFrames = 16;
+
 struct SplineData {
   SplineData() : local_spline(nullptr) {}
 
@@ -44,6 +48,17 @@ class SplineMotiveProcessor : public MotiveProcessorNf {
   virtual void AdvanceFrame(MotiveTime delta_time) {
     Defragment();
     interpolator_.AdvanceFrame(static_cast<float>(delta_time));
+
+    // Spread the precomputation over several frames, so that the cost of
+    // a frame stays flat even when many segments were just entered.
+    if (interpolator_.look_ahead()) {
+      interpolator_.PrecomputeNextSegments(
+          interpolator_.NumIndices() / kLookAheadFrames + 1);
+    }
+  }
+
+  virtual void SetLookAhead(bool look_ahead) {
+    interpolator_.set_look_ahead(look_ahead);
   }
 
   virtual MotivatorType Type() const { return SplineInit::kType; }
@@ -107,6 +122,7 @@ class SplineMotiveProcessor : public MotiveProcessorNf {
     // Snaps the current value and velocity to the way point's start value
     // and velocity.
     interpolator_.SetSplines(index, dimensions, splines, playback);
+    IndexSortKeyChanged();
   }
 
   virtual void SetSplinesAndTargets(MotiveIndex index,
@@ -124,6 +140,7 @@ class SplineMotiveProcessor : public MotiveProcessorNf {
         interpolator_.SetSplines(index + i, 1, splines[i], playback);
       }
     }
+    IndexSortKeyChanged();
   }
 
   virtual void Splines(MotiveIndex index, MotiveDimension dimensions,
@@ -136,6 +153,7 @@ class SplineMotiveProcessor : public MotiveProcessorNf {
   virtual void SetSplineTime(MotiveIndex index, MotiveDimension dimensions,
                              MotiveTime time) {
     interpolator_.SetXs(index, dimensions, static_cast<float>(time));
+    IndexSortKeyChanged();
   }
 
   // TODO: Push this loop into BulkSplineInterpolator.
@@ -148,6 +166,7 @@ class SplineMotiveProcessor : public MotiveProcessorNf {
  protected:
   // TODO: Change to CreateSplineToTarget()
   void SetTarget(MotiveIndex index, const MotiveTarget1f& t) {
+    MutableCounters().set_target_calls++;
     SplineData& d = Data(index);
 
     // If the first node specifies time=0, that means we want to override the
@@ -188,6 +207,7 @@ class SplineMotiveProcessor : public MotiveProcessorNf {
     // Point the interpolator at the spline we just created. Always start our
     // spline at time 0.
     interpolator_.SetSplines(index, 1, d.local_spline, SplinePlayback());
+    IndexSortKeyChanged();
   }
 
   virtual void InitializeIndices(const MotivatorInit& init, MotiveIndex index,
@@ -224,6 +244,35 @@ class SplineMotiveProcessor : public MotiveProcessorNf {
     interpolator_.SetNumIndices(num_indices);
   }
 
+  // Group Motivators by the spline they play, so that segment transitions
+  // read nearby spline data, and then by how far along that spline they are.
+  virtual SortKey IndexSortKey(MotiveIndex index) const {
+    const CompactSpline* spline = interpolator_.SourceSpline(index);
+    if (spline == nullptr) return SortKey();
+    return SortKey(reinterpret_cast<uintptr_t>(spline), interpolator_.X(index));
+  }
+
+  virtual void GatherCounters(MotiveProcessorCounters* counters) const {
+    counters->segment_transitions += interpolator_.NumSegmentTransitions();
+    counters->look_ahead_hits += interpolator_.NumLookAheadHits();
+    counters->blends_started += interpolator_.NumBlends();
+  }
+
+  virtual void GatherMemoryUsage(MotiveMemoryUsage* usage) const {
+    usage->AddVector(kMemoryIndexArrays, data_);
+    usage->Add(interpolator_.MemoryUsage());
+
+    // Local splines are allocated with `new CompactSpline()`, so each one
+    // holds the default number of nodes. Splines in the pool are all slack.
+    usage->AddVector(kMemorySplines, spline_pool_);
+    const size_t spline_size = sizeof(CompactSpline);
+    for (auto it = data_.begin(); it != data_.end(); ++it) {
+      if (it->local_spline == nullptr) continue;
+      usage->Add(kMemorySplines, spline_size, spline_size);
+    }
+    usage->Add(kMemorySplines, 0, spline_pool_.size() * spline_size);
+  }
+
   const SplineData& Data(MotiveIndex index) const {
     assert(ValidIndex(index));
     return data_[index];
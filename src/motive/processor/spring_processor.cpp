@@ -93,6 +93,7 @@ class SpringMotiveProcessor : public SimpleProcessorTemplate<SpringData> {
                                   const float* target_values,
                                   const float* /*target_velocities*/,
                                   const MotiveCurveShape& shape) {
+    MutableCounters().set_target_calls += dimensions;
     for (MotiveDimension i = 0; i < dimensions; ++i) {
       int processor_index = index + i;
       SpringData& d = Data(processor_index);
@@ -15,12 +15,26 @@
 #if defined(BENCHMARK_MOTIVE)
 
 #include <assert.h>
+#include <algorithm>
+#include <atomic>
 #include <limits>
 #include <math.h>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <string.h>
 #include <vector>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif  // defined(__linux__)
+#include "motive/common.h"
 #include "motive/util/benchmark.h"
+#include "motive/util/log_histogram.h"
 #include "benchmark_common.h" // From mathfu
 
 
@@ -28,89 +42,43 @@ namespace motive {
 
 static const double kMicrosecondsPerSecond = 1000000.0;
 
-// Holds an array of sampled data. Provide statistical analysis functions.
-template<class T>
+// Percentiles reported by OutputBenchmarks().
+static const double kReportedPercentiles[] = {50.0, 90.0, 99.0, 99.9};
+
+// Accumulates sampled data into a fixed-memory histogram. Provide statistical
+// analysis functions.
 class SampleAnalyzer {
  public:
   // Buckets are used in the histogram functions.
-  typedef uint16_t BucketType;
-  typedef typename std::vector<BucketType> BucketArray;
+  typedef uint64_t BucketType;
+  typedef std::vector<BucketType> BucketArray;
   static const int kDefaultHistogramWidth = 80;
   static const int kDefaultHistogramHeight = 10;
 
   // Functions to set the time data.
   explicit SampleAnalyzer(const char* name) : name_(name) {}
-  void Append(T sample) { samples_.push_back(sample); }
-  void Clear() { samples_.clear(); }
+  void Merge(const LogHistogram& samples) { samples_.Merge(samples); }
   void SetName(const char* name) { name_ = name; }
 
   // Const-functions to analyze the samples.
-  size_t NumSamples() const { return samples_.size(); }
-  BenchmarkTime Average() const;
-  BenchmarkTime StandardDeviation(BenchmarkTime average) const;
-  void MinMax(BenchmarkTime* min_time, BenchmarkTime* max_time) const;
+  uint64_t NumSamples() const { return samples_.NumSamples(); }
   void Histogram(BenchmarkTime min, BenchmarkTime max,
                  BucketArray* buckets_pointer) const;
   std::string Statistics(double to_usec, int width = kDefaultHistogramWidth,
                          int height = kDefaultHistogramHeight) const;
+  std::string Summary(double to_usec) const;
 
  private:
-  // The sampled data. This vector is never shrunk. It will incur some
-  // overhead when it gets reallocated, but once it reaches its highwater
-  // mark, there will be no reallocation.
-  std::vector<T> samples_;
+  // The sampled data. Memory use is constant, no matter how many samples are
+  // appended, so we can run for arbitrarily long without reallocating.
+  LogHistogram samples_;
 
   // The name is used in functions that output text, like Statistics().
   std::string name_;
 };
 
-template<class T>
-BenchmarkTime SampleAnalyzer<T>::Average() const {
-  // Gather the sum of all the samples.
-  // TODO: properly handle overflow in sum.
-  BenchmarkTime sum = 0;
-  for (auto it = samples_.begin(); it != samples_.end(); ++it) {
-    sum += *it;
-  }
-
-  // Divide by the count, with proper rounding.
-  const BenchmarkTime count = samples_.size();
-  return (sum + count / 2) / count;
-}
-
-template<class T>
-BenchmarkTime SampleAnalyzer<T>::StandardDeviation(BenchmarkTime average) const {
-  // Gather the sum of squares.
-  // TODO: handle possible overflow in sum.
-  BenchmarkTime deviation_sum = 0;
-  for (auto it = samples_.begin(); it != samples_.end(); ++it) {
-    const BenchmarkTime diff = *it - average;
-    deviation_sum += diff * diff;
-  }
-
-  // Use doubles to calculate the square root of deviation_sum.
-  const BenchmarkTime count = samples_.size();
-  const BenchmarkTime deviation_squared = (deviation_sum + count / 2) / count;
-  const double deviation = sqrt(static_cast<double>(deviation_squared));
-  const double deviation_rounded = floor(deviation + 0.5);
-  return static_cast<BenchmarkTime>(deviation_rounded);
-}
-
-template<class T>
-void SampleAnalyzer<T>::MinMax(BenchmarkTime* min_time, BenchmarkTime* max_time) const {
-  BenchmarkTime min = std::numeric_limits<BenchmarkTime>::max();
-  BenchmarkTime max = std::numeric_limits<BenchmarkTime>::min();
-  for (auto it = samples_.begin(); it != samples_.end(); ++it) {
-    min = std::min(min, *it);
-    max = std::max(max, *it);
-  }
-  *min_time = min;
-  *max_time = max;
-}
-
-template<class T>
-void SampleAnalyzer<T>::Histogram(BenchmarkTime min, BenchmarkTime max,
-                                  BucketArray* buckets_pointer) const {
+void SampleAnalyzer::Histogram(BenchmarkTime min, BenchmarkTime max,
+                               BucketArray* buckets_pointer) const {
   // Use all the buckets we can.
   BucketArray& buckets = *buckets_pointer;
   buckets.resize(buckets.capacity());
@@ -122,36 +90,51 @@ void SampleAnalyzer<T>::Histogram(BenchmarkTime min, BenchmarkTime max,
   const BenchmarkTime num_buckets = buckets.size();
   const BenchmarkTime width = max - min;
   if (width == 0) {
-    buckets[0] = static_cast<BucketType>(samples_.size());
+    buckets[0] = NumSamples();
     return;
   }
 
-  // Place each sample in the appropriate bucket.
+  // Redistribute the logarithmic buckets into linear buckets. Each log bucket
+  // is placed according to its middle value.
   // TODO: handle possible overflow in multiplication.
-  for (auto it = samples_.begin(); it != samples_.end(); ++it) {
-    const BenchmarkTime t = *it;
-    const BenchmarkTime bucket = (num_buckets - 1) * (t - min) / (max - min);
+  const int first = LogHistogram::BucketIndex(min);
+  const int last = LogHistogram::BucketIndex(max);
+  for (int i = first; i <= last; ++i) {
+    const LogHistogram::Count count = samples_.BucketCount(i);
+    if (count == 0) continue;
+    const BenchmarkTime bucket_min = LogHistogram::BucketMin(i);
+    const BenchmarkTime middle = std::max(
+        min, std::min(max, bucket_min + (LogHistogram::BucketMax(i) -
+                                         bucket_min) / 2));
+    const BenchmarkTime bucket = (num_buckets - 1) * (middle - min) / width;
     assert(bucket < num_buckets);
-    buckets[static_cast<size_t>(bucket)]++;
+    buckets[static_cast<size_t>(bucket)] += count;
   }
 }
 
-template<class T>
-std::string SampleAnalyzer<T>::Statistics(double to_usec, int width,
-                                          int height) const {
+std::string SampleAnalyzer::Statistics(double to_usec, int width,
+                                       int height) const {
   std::stringstream s;
 
   // Output general statistics.
-  BenchmarkTime min = 0;
-  BenchmarkTime max = 0;
-  MinMax(&min, &max);
-  const BenchmarkTime avg = Average();
-  const BenchmarkTime stdev = StandardDeviation(avg);
+  const BenchmarkTime min = samples_.Min();
+  const BenchmarkTime max = samples_.Max();
   s << name_ << ": "
-    << "average " << avg * to_usec << "usec"
+    << "average " << samples_.Average() * to_usec << "usec"
     << ", min " << min * to_usec << "usec"
     << ", max " << max * to_usec << "usec"
-    << ", standard deviation " << stdev * to_usec << "usec" << std::endl;
+    << ", standard deviation " << samples_.StandardDeviation() * to_usec
+    << "usec" << std::endl;
+
+  // Output the tail latencies, which matter more than the average for
+  // per-frame work.
+  s << "  ";
+  for (size_t i = 0; i < MOTIVE_ARRAY_SIZE(kReportedPercentiles); ++i) {
+    const double percent = kReportedPercentiles[i];
+    s << (i == 0 ? "" : ", ") << "p" << percent << " "
+      << samples_.Percentile(percent) * to_usec << "usec";
+  }
+  s << " (" << NumSamples() << " samples)" << std::endl;
 
   // Gather a histogram with 'width' buckets.
   BucketArray buckets(width);
@@ -166,8 +149,8 @@ std::string SampleAnalyzer<T>::Statistics(double to_usec, int width,
 
   // Output an ASCII histogram.
   for (int i = 0; i < height; ++i) {
-    const uint32_t bucket_cutoff = static_cast<uint32_t>(height - i - 1) *
-                                       biggest_bucket / height;
+    const BucketType bucket_cutoff =
+        static_cast<BucketType>(height - i - 1) * biggest_bucket / height;
     for (int j = 0; j < width; ++j) {
       s << (buckets[j] > bucket_cutoff ? '#' : ' ');
     }
@@ -176,45 +159,548 @@ std::string SampleAnalyzer<T>::Statistics(double to_usec, int width,
   return s.str();
 }
 
+std::string SampleAnalyzer::Summary(double to_usec) const {
+  std::stringstream s;
+  s << name_ << ": " << NumSamples() << " samples"
+    << ", average " << samples_.Average() * to_usec << "usec"
+    << ", p50 " << samples_.Percentile(50.0) * to_usec << "usec"
+    << ", p99 " << samples_.Percentile(99.0) * to_usec << "usec"
+    << ", max " << samples_.Max() * to_usec << "usec";
+  return s.str();
+}
+
+// Return a small, stable number for the calling thread. These are much easier
+// to read in reports and the trace viewer than the platform's thread handles.
+static uint32_t CurrentThreadId() {
+  static std::atomic<uint32_t> next_thread_id(0);
+  static thread_local uint32_t thread_id = next_thread_id++;
+  return thread_id;
+}
+
+// Sums of hardware counter deltas over many scopes.
+struct CounterTotals {
+  CounterTotals()
+      : time_enabled(0), time_running(0), num_scopes(0), num_indices(0) {
+    memset(values, 0, sizeof(values));
+  }
+  void Merge(const CounterTotals& rhs) {
+    for (int i = 0; i < kNumBenchmarkCounters; ++i) {
+      values[i] += rhs.values[i];
+    }
+    time_enabled += rhs.time_enabled;
+    time_running += rhs.time_running;
+    num_scopes += rhs.num_scopes;
+    num_indices += rhs.num_indices;
+  }
+  uint64_t values[kNumBenchmarkCounters];
+  uint64_t time_enabled;
+  uint64_t time_running;
+  uint64_t num_scopes;
+  uint64_t num_indices;
+};
+
+// Samples recorded by a single thread, one histogram per id. Only the owning
+// thread appends to it, so recording a sample needs no locking.
+struct ThreadSamples {
+  explicit ThreadSamples(uint32_t thread_id) : thread(thread_id) {}
+  uint32_t thread;
+  std::vector<LogHistogram> times;
+  std::vector<CounterTotals> counters;
+};
+
+// Guards registration and the list of threads. Never held while recording.
+static std::mutex gMutex;
+
+// The name of each id, in order of registration.
+static std::vector<std::string> gNames;
+static std::atomic<int> gNumIds(0);
+
+// Every thread that has recorded a sample. Never deleted, so that samples
+// from threads that have since exited are still reported.
+static std::vector<ThreadSamples*> gThreadSamples;
+
+// Return the calling thread's sample buffers, creating them if required.
+static ThreadSamples& CurrentThreadSamples() {
+  static thread_local ThreadSamples* samples = nullptr;
+  if (samples == nullptr) {
+    samples = new ThreadSamples(CurrentThreadId());
+    std::lock_guard<std::mutex> lock(gMutex);
+    gThreadSamples.push_back(samples);
+  }
+  return *samples;
+}
+
+// True while hardware counters should be sampled around every scope.
+static std::atomic<bool> gCountersEnabled(false);
+
+// True for each counter that could be opened by EnableBenchmarkCounters().
+static bool gCounterAvailable[kNumBenchmarkCounters];
+
+#if defined(__linux__)
+
+// perf_event_open() configuration for each BenchmarkCounter.
+struct CounterConfig {
+  uint32_t type;
+  uint64_t config;
+};
+static const CounterConfig kCounterConfigs[] = {
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+  { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                        (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+};
+static_assert(MOTIVE_ARRAY_SIZE(kCounterConfigs) == kNumBenchmarkCounters,
+              "kCounterConfigs must have an entry for every BenchmarkCounter");
+
+// The hardware counters of one thread. Opened as a single perf event group,
+// so that all the counters are read with one system call, and are scheduled
+// onto the PMU together. If the PMU has fewer counters than the group needs,
+// the group is multiplexed or never scheduled at all, so we also read the
+// time the group was enabled and running, and scale or discard accordingly.
+class CounterGroup {
+ public:
+  CounterGroup() : leader_fd_(-1), num_open_(0), tried_(false) {
+    for (int i = 0; i < kNumBenchmarkCounters; ++i) {
+      fds_[i] = -1;
+      slots_[i] = -1;
+    }
+  }
+
+  ~CounterGroup() {
+    for (int i = 0; i < kNumBenchmarkCounters; ++i) {
+      if (fds_[i] >= 0) close(fds_[i]);
+    }
+  }
+
+  // Open the counters for the calling thread. Counters that the system does
+  // not support are skipped. Returns false if no counters could be opened.
+  bool Open() {
+    if (tried_) return num_open_ > 0;
+    tried_ = true;
+
+    for (int i = 0; i < kNumBenchmarkCounters; ++i) {
+      perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = kCounterConfigs[i].type;
+      attr.config = kCounterConfigs[i].config;
+      attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                         PERF_FORMAT_TOTAL_TIME_RUNNING;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+
+      // Count the calling thread on any CPU. The first counter opened leads
+      // the group.
+      const int fd = static_cast<int>(
+          syscall(__NR_perf_event_open, &attr, 0, -1, leader_fd_, 0));
+      if (fd < 0) continue;
+
+      fds_[i] = fd;
+      slots_[i] = num_open_++;
+      if (leader_fd_ < 0) leader_fd_ = fd;
+    }
+    return num_open_ > 0;
+  }
+
+  bool IsOpen(int counter) const { return slots_[counter] >= 0; }
+
+  // Read the current value of every counter. Returns false on failure.
+  bool Read(BenchmarkCounterValues* values) const {
+    // Layout of the data read for PERF_FORMAT_GROUP with both total times.
+    struct {
+      uint64_t num_values;
+      uint64_t time_enabled;
+      uint64_t time_running;
+      uint64_t values[kNumBenchmarkCounters];
+    } group;
+    if (leader_fd_ < 0 || read(leader_fd_, &group, sizeof(group)) <= 0) {
+      return false;
+    }
+    for (int i = 0; i < kNumBenchmarkCounters; ++i) {
+      values->values[i] = slots_[i] >= 0 ? group.values[slots_[i]] : 0;
+    }
+    values->time_enabled = group.time_enabled;
+    values->time_running = group.time_running;
+    return true;
+  }
+
+ private:
+  int fds_[kNumBenchmarkCounters];
+  int slots_[kNumBenchmarkCounters];
+  int leader_fd_;
+  int num_open_;
+  bool tried_;
+};
+
+static CounterGroup& CurrentThreadCounters() {
+  static thread_local CounterGroup counters;
+  return counters;
+}
+
+static bool OpenCounters(bool* available) {
+  CounterGroup& counters = CurrentThreadCounters();
+  if (!counters.Open()) return false;
+  for (int i = 0; i < kNumBenchmarkCounters; ++i) {
+    available[i] = counters.IsOpen(i);
+  }
+  return true;
+}
+
+static bool ReadCounters(BenchmarkCounterValues* values) {
+  CounterGroup& counters = CurrentThreadCounters();
+  return counters.Open() && counters.Read(values);
+}
+
+#else  // not defined(__linux__)
+
+// Hardware counters are not yet supported on this platform.
+static bool OpenCounters(bool* /*available*/) { return false; }
+static bool ReadCounters(BenchmarkCounterValues* /*values*/) {
+  return false;
+}
+
+#endif  // not defined(__linux__)
+
+// Describe the hardware counters, normalized by the number of indices
+// processed. If no indices were specified, normalize by the number of scopes.
+static std::string CounterStatistics(const CounterTotals& totals) {
+  static const char* kCounterNames[] = {
+    "cycles", "instructions", "L1D misses", "LLC misses", "branch misses"
+  };
+  static_assert(MOTIVE_ARRAY_SIZE(kCounterNames) == kNumBenchmarkCounters,
+                "kCounterNames must have an entry for every BenchmarkCounter");
+
+  std::stringstream s;
+  s << "  counters over " << totals.num_scopes << " scopes: ";
+
+  // The group was never scheduled onto the PMU, so the counts are all zero
+  // and mean nothing.
+  if (totals.time_running == 0) {
+    s << "unavailable (counters were never scheduled)";
+    return s.str();
+  }
+
+  // The group was multiplexed with other events, so extrapolate the counts
+  // to the full time the scopes ran, like `perf stat` does.
+  const bool scaled = totals.time_running < totals.time_enabled;
+  if (scaled) {
+    s << "scaled, counted " << 100.0 * static_cast<double>(totals.time_running) /
+                                   static_cast<double>(totals.time_enabled)
+      << "% of the time, ";
+  }
+  const double scale = scaled ? static_cast<double>(totals.time_enabled) /
+                                    static_cast<double>(totals.time_running)
+                              : 1.0;
+
+  const bool per_index = totals.num_indices > 0;
+  const double divisor = static_cast<double>(
+      per_index ? totals.num_indices : totals.num_scopes) / scale;
+  if (gCounterAvailable[kBenchmarkCycles] &&
+      gCounterAvailable[kBenchmarkInstructions] &&
+      totals.values[kBenchmarkCycles] > 0) {
+    s << "IPC "
+      << static_cast<double>(totals.values[kBenchmarkInstructions]) /
+             static_cast<double>(totals.values[kBenchmarkCycles])
+      << ", ";
+  }
+  s << "per " << (per_index ? "index" : "scope") << ":";
+  for (int i = 0; i < kNumBenchmarkCounters; ++i) {
+    if (!gCounterAvailable[i]) continue;
+    s << " " << kCounterNames[i] << " "
+      << static_cast<double>(totals.values[i]) / divisor;
+  }
+  return s.str();
+}
+
+// One scope recorded on the timeline. Fields are atomic so that a reader can
+// copy a slot while a writer is overwriting it; `sequence` tells the reader
+// whether the copy is whole. See RecordTraceEvent() and ReadTraceEvent().
+struct TraceSlot {
+  TraceSlot() : sequence(0), begin(0), end(0), id(0), thread(0) {}
+
+  // 2 * (event number + 1) once the event is completely written. Odd while
+  // a writer is in the middle of writing it.
+  std::atomic<uint64_t> sequence;
+  std::atomic<BenchmarkTime> begin;
+  std::atomic<BenchmarkTime> end;
+  std::atomic<int> id;
+  std::atomic<uint32_t> thread;
+};
+
+struct TraceEvent {
+  BenchmarkTime begin;
+  BenchmarkTime end;
+  int id;
+  uint32_t thread;
+};
+
+// Ring buffer of the most recently recorded scopes. Writers claim an event
+// number with an atomic increment of `head`, so several threads can record at
+// once without locking. The total number of events ever recorded is `head`.
+struct TraceBuffer {
+  explicit TraceBuffer(size_t capacity) : slots(capacity), head(0) {}
+  std::vector<TraceSlot> slots;
+  std::atomic<uint64_t> head;
+};
 
-// One SampleAnalyzer per id being benchmarked.
-typedef SampleAnalyzer<BenchmarkTime> TimeAnalyzer;
-static std::vector<TimeAnalyzer> gTimes;
+// The buffer currently being recorded into, or nullptr if not tracing.
+// Buffers are never freed while the program runs, because a writer may still
+// hold a pointer to one after tracing restarts. Instead they are kept in
+// `gTraceBuffers`, and reused when StartBenchmarkTrace() is called again with
+// the same capacity, so restarting does not grow memory.
+static std::atomic<TraceBuffer*> gTraceBuffer(nullptr);
+static std::vector<std::unique_ptr<TraceBuffer>> gTraceBuffers;
+
+// The last buffer recorded into, and its head when recording started. Stay
+// valid after StopBenchmarkTrace() so that the events can be output.
+static TraceBuffer* gTraceOutputBuffer = nullptr;
+static uint64_t gTraceStartEvent = 0;
+
+static void RecordTraceEvent(TraceBuffer* buffer, int id, BenchmarkTime begin,
+                             BenchmarkTime end) {
+  const uint64_t event = buffer->head.fetch_add(1, std::memory_order_relaxed);
+  TraceSlot& slot = buffer->slots[static_cast<size_t>(
+      event % buffer->slots.size())];
+
+  // Mark the slot as being written, then write it, then publish it.
+  slot.sequence.store(2 * event + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.begin.store(begin, std::memory_order_relaxed);
+  slot.end.store(end, std::memory_order_relaxed);
+  slot.id.store(id, std::memory_order_relaxed);
+  slot.thread.store(CurrentThreadId(), std::memory_order_relaxed);
+  slot.sequence.store(2 * event + 2, std::memory_order_release);
+}
+
+// Copy event number `event` into `e`. Returns false if the slot is being
+// written, or has already been overwritten by a newer event.
+static bool ReadTraceEvent(const TraceBuffer& buffer, uint64_t event,
+                           TraceEvent* e) {
+  const TraceSlot& slot =
+      buffer.slots[static_cast<size_t>(event % buffer.slots.size())];
+  const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+  if (sequence != 2 * event + 2) return false;
+  e->begin = slot.begin.load(std::memory_order_relaxed);
+  e->end = slot.end.load(std::memory_order_relaxed);
+  e->id = slot.id.load(std::memory_order_relaxed);
+  e->thread = slot.thread.load(std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return slot.sequence.load(std::memory_order_relaxed) == sequence;
+}
 
 BenchmarkTime GetBenchmarkTime() { return Timer::GetTicks(); }
 
+double BenchmarkTimeToSeconds(BenchmarkTime time) {
+  return static_cast<double>(time) * Timer::tick_period();
+}
+
 void InitBenchmarks(int num_ids) {
   Timer::InitializeTickPeriod();
-  gTimes.reserve(num_ids);
+  std::lock_guard<std::mutex> lock(gMutex);
+  gNames.reserve(num_ids);
 }
 
 void ClearBenchmarks() {
-  for (auto it = gTimes.begin(); it != gTimes.end(); ++it) {
-    it->Clear();
+  std::lock_guard<std::mutex> lock(gMutex);
+  for (size_t t = 0; t < gThreadSamples.size(); ++t) {
+    std::vector<LogHistogram>& times = gThreadSamples[t]->times;
+    for (size_t i = 0; i < times.size(); ++i) {
+      times[i].Clear();
+    }
+    std::vector<CounterTotals>& counters = gThreadSamples[t]->counters;
+    std::fill(counters.begin(), counters.end(), CounterTotals());
   }
 }
 
 int RegisterBenchmark(const char* name) {
-  const int id = static_cast<int>(gTimes.size());
-  gTimes.push_back(TimeAnalyzer(name));
+  std::lock_guard<std::mutex> lock(gMutex);
+  const int id = static_cast<int>(gNames.size());
+  gNames.push_back(name);
+
+  // Publish the new id only after its name has been stored.
+  gNumIds.store(id + 1, std::memory_order_release);
   return id;
 }
 
 void OutputBenchmarks() {
   const double to_usec = Timer::tick_period() * kMicrosecondsPerSecond;
+  std::lock_guard<std::mutex> lock(gMutex);
   printf("\n");
-  for (size_t i = 0; i < gTimes.size(); ++i) {
-    if (gTimes[i].NumSamples() > 0) {
-      printf("%s\n", gTimes[i].Statistics(to_usec).c_str());
+  for (size_t i = 0; i < gNames.size(); ++i) {
+    // Merge the samples from every thread.
+    SampleAnalyzer total(gNames[i].c_str());
+    CounterTotals counter_totals;
+    int num_threads = 0;
+    for (size_t t = 0; t < gThreadSamples.size(); ++t) {
+      const std::vector<LogHistogram>& times = gThreadSamples[t]->times;
+      if (i < times.size() && times[i].NumSamples() > 0) {
+        total.Merge(times[i]);
+        num_threads++;
+      }
+      const std::vector<CounterTotals>& counters = gThreadSamples[t]->counters;
+      if (i < counters.size()) {
+        counter_totals.Merge(counters[i]);
+      }
+    }
+    if (total.NumSamples() == 0) continue;
+    printf("%s", total.Statistics(to_usec).c_str());
+    if (counter_totals.num_scopes > 0) {
+      printf("%s\n", CounterStatistics(counter_totals).c_str());
+    }
+
+    // Break the samples down by thread, when more than one thread recorded.
+    if (num_threads > 1) {
+      for (size_t t = 0; t < gThreadSamples.size(); ++t) {
+        const ThreadSamples& thread_samples = *gThreadSamples[t];
+        if (i >= thread_samples.times.size() ||
+            thread_samples.times[i].NumSamples() == 0) continue;
+
+        std::stringstream thread_name;
+        thread_name << "  thread " << thread_samples.thread;
+        SampleAnalyzer thread_total(thread_name.str().c_str());
+        thread_total.Merge(thread_samples.times[i]);
+        printf("%s\n", thread_total.Summary(to_usec).c_str());
+      }
+    }
+    printf("\n");
+  }
+}
+
+bool EnableBenchmarkCounters() {
+  if (!OpenCounters(gCounterAvailable)) return false;
+  gCountersEnabled = true;
+  return true;
+}
+
+void DisableBenchmarkCounters() { gCountersEnabled = false; }
+
+void StartBenchmarkTrace(int max_events) {
+  assert(max_events > 0);
+  std::lock_guard<std::mutex> lock(gMutex);
+  gTraceBuffer.store(nullptr, std::memory_order_release);
+
+  // Reuse a buffer of the same capacity, if we have one. This is safe even
+  // if a writer from the previous trace is still recording into it: buffers
+  // are never freed, slots are only ever accessed atomically, and event
+  // numbers keep increasing across restarts.
+  const size_t capacity = static_cast<size_t>(max_events);
+  TraceBuffer* buffer = nullptr;
+  for (size_t i = 0; i < gTraceBuffers.size(); ++i) {
+    if (gTraceBuffers[i]->slots.size() == capacity) {
+      buffer = gTraceBuffers[i].get();
+      break;
+    }
+  }
+  if (buffer == nullptr) {
+    gTraceBuffers.push_back(
+        std::unique_ptr<TraceBuffer>(new TraceBuffer(capacity)));
+    buffer = gTraceBuffers.back().get();
+  }
+
+  // Only output events recorded after this point.
+  gTraceOutputBuffer = buffer;
+  gTraceStartEvent = buffer->head.load(std::memory_order_relaxed);
+  gTraceBuffer.store(buffer, std::memory_order_release);
+}
+
+void StopBenchmarkTrace() {
+  gTraceBuffer.store(nullptr, std::memory_order_release);
+}
+
+bool OutputBenchmarkTrace(const char* file_name) {
+  std::lock_guard<std::mutex> lock(gMutex);
+  FILE* f = fopen(file_name, "w");
+  if (f == nullptr) return false;
+
+  // Only the most recent events are still in the ring buffer. Events that
+  // were being written, or were overwritten while we read, are skipped.
+  std::vector<TraceEvent> events;
+  const TraceBuffer* buffer = gTraceOutputBuffer;
+  if (buffer != nullptr) {
+    const uint64_t head = buffer->head.load(std::memory_order_acquire);
+    const uint64_t capacity = static_cast<uint64_t>(buffer->slots.size());
+    const uint64_t first =
+        std::max(gTraceStartEvent, head > capacity ? head - capacity : 0);
+    events.reserve(static_cast<size_t>(head - first));
+    for (uint64_t i = first; i < head; ++i) {
+      TraceEvent e;
+      if (ReadTraceEvent(*buffer, i, &e)) events.push_back(e);
     }
   }
+
+  // Output times relative to the earliest event, so that they're readable.
+  BenchmarkTime origin = std::numeric_limits<BenchmarkTime>::max();
+  for (size_t i = 0; i < events.size(); ++i) {
+    origin = std::min(origin, events[i].begin);
+  }
+
+  // Use "complete" events, which hold both begin and end times. Unlike
+  // separate begin and end events, they can't become unmatched when the ring
+  // buffer wraps around.
+  const double to_usec = Timer::tick_period() * kMicrosecondsPerSecond;
+  fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+  for (size_t i = 0; i < events.size(); ++i) {
+    const TraceEvent& e = events[i];
+    assert(0 <= e.id && e.id < static_cast<int>(gNames.size()));
+    fprintf(f,
+            "  {\"name\": \"%s\", \"cat\": \"motive\", \"ph\": \"X\", "
+            "\"pid\": 0, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}%s\n",
+            gNames[e.id].c_str(), static_cast<unsigned int>(e.thread),
+            (e.begin - origin) * to_usec, (e.end - e.begin) * to_usec,
+            i + 1 < events.size() ? "," : "");
+  }
+  fprintf(f, "]}\n");
+
+  const bool write_error = ferror(f) != 0;
+  return fclose(f) == 0 && !write_error;
 }
 
+Benchmark::Benchmark(int id, int num_indices)
+    : id_(id),
+      num_indices_(num_indices),
+      counting_(gCountersEnabled.load(std::memory_order_relaxed) &&
+                ReadCounters(&start_counters_)),
+      start_time_(GetBenchmarkTime()) {}
+
 Benchmark::~Benchmark() {
   BenchmarkTime end_time = GetBenchmarkTime();
+  BenchmarkCounterValues end_counters;
+  const bool counted = counting_ && ReadCounters(&end_counters);
+
+  assert(0 <= id_ && id_ < gNumIds.load(std::memory_order_acquire));
 
-  assert(0 <= id_ && id_ < static_cast<int>(gTimes.size()));
-  gTimes[id_].Append(end_time - start_time_);
+  // Only this thread touches its own buffers, so no locking is required.
+  // Grow them when ids have been registered since our last sample.
+  std::vector<LogHistogram>& times = CurrentThreadSamples().times;
+  if (id_ >= static_cast<int>(times.size())) {
+    times.resize(gNumIds.load(std::memory_order_acquire));
+  }
+  times[id_].Append(end_time - start_time_);
+
+  if (counted) {
+    std::vector<CounterTotals>& counters = CurrentThreadSamples().counters;
+    if (id_ >= static_cast<int>(counters.size())) {
+      counters.resize(gNumIds.load(std::memory_order_acquire));
+    }
+    CounterTotals& totals = counters[id_];
+    for (int i = 0; i < kNumBenchmarkCounters; ++i) {
+      totals.values[i] += end_counters.values[i] - start_counters_.values[i];
+    }
+    totals.time_enabled +=
+        end_counters.time_enabled - start_counters_.time_enabled;
+    totals.time_running +=
+        end_counters.time_running - start_counters_.time_running;
+    totals.num_scopes++;
+    totals.num_indices += num_indices_;
+  }
+
+  TraceBuffer* trace = gTraceBuffer.load(std::memory_order_acquire);
+  if (trace != nullptr) {
+    RecordTraceEvent(trace, id_, start_time_, end_time);
+  }
 }
 
 }  // namespace motive
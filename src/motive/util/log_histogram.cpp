@@ -0,0 +1,139 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <limits>
+#include "motive/util/log_histogram.h"
+
+namespace motive {
+
+// Samples below this value are recorded exactly, one bucket per value.
+static const LogHistogram::Value kExactLimit =
+    static_cast<LogHistogram::Value>(2 * LogHistogram::kSubBuckets);
+
+// Return the index of the most significant set bit in `value`.
+// `value` must be non-zero.
+static inline int MostSignificantBit(LogHistogram::Value value) {
+  assert(value != 0);
+#if defined(__GNUC__)
+  return 63 - __builtin_clzll(value);
+#else
+  int bit = 0;
+  while (value >>= 1) bit++;
+  return bit;
+#endif
+}
+
+// static
+int LogHistogram::BucketIndex(Value value) {
+  if (value < kExactLimit) return static_cast<int>(value);
+
+  // Keep the top kMantissaBits + 1 bits of `value`. The top bit is always set,
+  // so the mantissa is in the range [kSubBuckets, 2 * kSubBuckets).
+  const int shift = MostSignificantBit(value) - kMantissaBits;
+  const int mantissa = static_cast<int>(value >> shift);
+  return shift * kSubBuckets + mantissa;
+}
+
+// static
+LogHistogram::Value LogHistogram::BucketMin(int bucket) {
+  assert(0 <= bucket && bucket < kNumBuckets);
+  if (bucket < static_cast<int>(kExactLimit)) {
+    return static_cast<Value>(bucket);
+  }
+
+  const int shift = bucket / kSubBuckets - 1;
+  const Value mantissa =
+      static_cast<Value>(bucket % kSubBuckets + kSubBuckets);
+  return mantissa << shift;
+}
+
+// static
+LogHistogram::Value LogHistogram::BucketMax(int bucket) {
+  return bucket + 1 < kNumBuckets ? BucketMin(bucket + 1) - 1
+                                  : std::numeric_limits<Value>::max();
+}
+
+void LogHistogram::Append(Value value) {
+  counts_[BucketIndex(value)]++;
+  num_samples_++;
+  min_ = std::min(min_, value);
+  max_ = std::max(max_, value);
+  const double v = static_cast<double>(value);
+  sum_ += v;
+  sum_of_squares_ += v * v;
+}
+
+void LogHistogram::Merge(const LogHistogram& rhs) {
+  for (int i = 0; i < kNumBuckets; ++i) {
+    counts_[i] += rhs.counts_[i];
+  }
+  num_samples_ += rhs.num_samples_;
+  min_ = std::min(min_, rhs.min_);
+  max_ = std::max(max_, rhs.max_);
+  sum_ += rhs.sum_;
+  sum_of_squares_ += rhs.sum_of_squares_;
+}
+
+void LogHistogram::Clear() {
+  memset(counts_, 0, sizeof(counts_));
+  num_samples_ = 0;
+  min_ = std::numeric_limits<Value>::max();
+  max_ = std::numeric_limits<Value>::min();
+  sum_ = 0.0;
+  sum_of_squares_ = 0.0;
+}
+
+double LogHistogram::Average() const {
+  return num_samples_ == 0 ? 0.0 : sum_ / static_cast<double>(num_samples_);
+}
+
+double LogHistogram::StandardDeviation() const {
+  if (num_samples_ == 0) return 0.0;
+  const double average = Average();
+  const double variance =
+      sum_of_squares_ / static_cast<double>(num_samples_) - average * average;
+  return variance > 0.0 ? sqrt(variance) : 0.0;
+}
+
+LogHistogram::Value LogHistogram::Percentile(double percent) const {
+  if (num_samples_ == 0) return 0;
+
+  // The rank of the sample we're looking for, in the range [1, num_samples_].
+  const double clamped_percent = std::max(0.0, std::min(percent, 100.0));
+  // Multiply before dividing, so that, e.g., p99.9 of 1000 samples is exactly
+  // rank 999, and not 999.0000001 (which rounds up to 1000).
+  const double exact_rank =
+      ceil(clamped_percent * static_cast<double>(num_samples_) / 100.0);
+  const uint64_t rank =
+      std::max<uint64_t>(1, static_cast<uint64_t>(exact_rank));
+
+  // Walk the buckets until we've passed `rank` samples.
+  uint64_t seen = 0;
+  for (int i = 0; i < kNumBuckets; ++i) {
+    seen += counts_[i];
+    if (seen >= rank) {
+      // Report the middle of the bucket, which halves the worst-case error.
+      const Value bucket_min = BucketMin(i);
+      const Value middle = bucket_min + (BucketMax(i) - bucket_min) / 2;
+      return std::max(min_, std::min(middle, max_));
+    }
+  }
+  return max_;
+}
+
+}  // namespace motive
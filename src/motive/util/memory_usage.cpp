@@ -0,0 +1,82 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <assert.h>
+#include <string.h>
+#include "motive/util/memory_usage.h"
+
+namespace motive {
+
+static const char* const kCategoryNames[] = {
+    "index_arrays", "index_blocks", "splines", "names", "other",
+};
+static_assert(sizeof(kCategoryNames) / sizeof(kCategoryNames[0]) ==
+                  kNumMemoryCategories,
+              "Update kCategoryNames to match MemoryCategory.");
+
+MotiveMemoryUsage::MotiveMemoryUsage() {
+  memset(used_bytes, 0, sizeof(used_bytes));
+  memset(allocated_bytes, 0, sizeof(allocated_bytes));
+}
+
+void MotiveMemoryUsage::Add(MemoryCategory category, size_t used,
+                            size_t allocated) {
+  assert(0 <= category && category < kNumMemoryCategories);
+  assert(used <= allocated);
+  used_bytes[category] += used;
+  allocated_bytes[category] += allocated;
+}
+
+void MotiveMemoryUsage::Add(const MotiveMemoryUsage& rhs) {
+  for (int i = 0; i < kNumMemoryCategories; ++i) {
+    used_bytes[i] += rhs.used_bytes[i];
+    allocated_bytes[i] += rhs.allocated_bytes[i];
+  }
+}
+
+void MotiveMemoryUsage::AddString(MemoryCategory category,
+                                  const std::string& s) {
+  // With the small string optimization, short strings point into the
+  // std::string object itself.
+  const char* data = s.data();
+  const char* object = reinterpret_cast<const char*>(&s);
+  if (object <= data && data < object + sizeof(s)) return;
+
+  // Include the terminating null.
+  Add(category, s.size() + 1, s.capacity() + 1);
+}
+
+size_t MotiveMemoryUsage::TotalUsed() const {
+  size_t total = 0;
+  for (int i = 0; i < kNumMemoryCategories; ++i) {
+    total += used_bytes[i];
+  }
+  return total;
+}
+
+size_t MotiveMemoryUsage::TotalAllocated() const {
+  size_t total = 0;
+  for (int i = 0; i < kNumMemoryCategories; ++i) {
+    total += allocated_bytes[i];
+  }
+  return total;
+}
+
+// static
+const char* MotiveMemoryUsage::CategoryName(MemoryCategory category) {
+  assert(0 <= category && category < kNumMemoryCategories);
+  return kCategoryNames[category];
+}
+
+}  // namespace motive
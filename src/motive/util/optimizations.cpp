@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <assert.h>
 #include "motive/util/optimizations.h"
 
 #if defined(__ANDROID__)
@@ -36,9 +37,77 @@ ProcessorOptimization BestProcessorOptimization() {
     default:
       break;
   }
+#elif defined(__SSE2__)
+  return kSse2Optimizations;
 #endif  // defined(__ANDROID__)
 
   return kNoOptimizations;
 }
 
+#if defined(__SSE2__)
+static ProcessorOptimization gDefaultOptimization = kSse2Optimizations;
+#else
+static ProcessorOptimization gDefaultOptimization = kNoOptimizations;
+#endif  // defined(__SSE2__)
+
+bool ProcessorOptimizationAvailable(ProcessorOptimization optimization) {
+  switch (optimization) {
+    case kNoOptimizations:
+      return true;
+
+#if defined(MOTIVE_NEON)
+    case kNeonOptimizations:
+      return BestProcessorOptimization() == kNeonOptimizations;
+#endif  // defined(MOTIVE_NEON)
+
+#if defined(__SSE2__)
+    // SSE2 is part of x86-64, so the CPU always supports it.
+    case kSse2Optimizations:
+      return true;
+#endif  // defined(__SSE2__)
+
+#if defined(MOTIVE_F16C)
+    // MOTIVE_F16C builds require F16C, like -mf16c builds.
+    case kF16cOptimizations:
+      return true;
+#endif  // defined(MOTIVE_F16C)
+
+    // There are no SSE3 or SSSE3 kernels yet.
+    default:
+      return false;
+  }
+}
+
+const char* ProcessorOptimizationName(ProcessorOptimization optimization) {
+  switch (optimization) {
+    case kNoOptimizations:
+      return "scalar";
+    case kNeonOptimizations:
+      return "neon";
+    case kSse3Optimizations:
+      return "sse3";
+    case kSsse3Optimizations:
+      return "ssse3";
+    case kSse2Optimizations:
+      return "sse2";
+    case kF16cOptimizations:
+      return "f16c";
+  }
+  return "unknown";
+}
+
+ProcessorOptimization DefaultProcessorOptimization() {
+  return gDefaultOptimization;
+}
+
+void SetDefaultProcessorOptimization(ProcessorOptimization optimization) {
+  assert(ProcessorOptimizationAvailable(optimization));
+  gDefaultOptimization = optimization;
+}
+
+bool UseSse2Kernels() {
+  return gDefaultOptimization == kSse2Optimizations ||
+         gDefaultOptimization == kF16cOptimizations;
+}
+
 }  // namespace motive
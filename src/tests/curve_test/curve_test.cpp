@@ -254,6 +254,101 @@ TEST_F(CurveTests, QuadraticRangesMatchingSign_SmallValues) {
   EXPECT_EQ(matching.len, 1u);
 }
 
+// Edge-case quadratics from the QuadraticRoot_* tests above, plus a few with
+// ordinary coefficients.
+static const QuadraticCurve kBulkQuadratics[] = {
+    QuadraticCurve(kMaxFloat, 0.0f, 0.0f),
+    QuadraticCurve(kMaxFloat, kMaxFloat, -kMaxFloat),
+    QuadraticCurve(kMaxFloat, kMaxFloat, -1.0f),
+    QuadraticCurve(kMaxFloat, kMaxFloat, kMaxFloat),
+    QuadraticCurve(kMinFloat, kMinFloat, kMinFloat),
+    QuadraticCurve(-kMinFloat, kMinFloat, kMinFloat),
+    QuadraticCurve(-kMinFloat, 0.0f, 0.0f),
+    QuadraticCurve(-kMinFloat, kMaxFloat, 1.0f),
+    QuadraticCurve(kMaxFloat, -kMinFloat, 0.0f),
+    QuadraticCurve(0.0f, 0.0f, 1.0f),
+    QuadraticCurve(0.0f, 1.0f, 0.0f),
+    QuadraticCurve(1.0f, 0.0f, 0.0f),
+    QuadraticCurve(60.0f, -32.0f, 6.0f),
+    QuadraticCurve(60.0f, -32.0f, 4.26666689f),
+    QuadraticCurve(60.0f, -32.0f, 4.0f),
+    QuadraticCurve(-0.00006f, -0.000028f, 0.0001f),
+    QuadraticCurve(-0.00006f, -0.000028f, -0.00000326666691f),
+    QuadraticCurve(-0.00006f, -0.000028f, -0.000006f),
+    QuadraticCurve(0.000000006f, -0.0000000032f, 0.0000000004f),
+    QuadraticCurve(-0.00000003f, 0.0f, 0.0008f),
+    QuadraticCurve(0.000000001f, 1.0f, -0.00000001f),
+    QuadraticCurve(1.006107e-11f, -3.01832101e-11f, 1.006107e-11f),
+    QuadraticCurve(-2.0f, 3.0f, 0.5f),
+    QuadraticCurve(0.25f, -1.0f, 0.75f),
+    QuadraticCurve(-4.0f, 4.0f, -1.0f),
+};
+static const size_t kNumBulkQuadratics =
+    sizeof(kBulkQuadratics) / sizeof(kBulkQuadratics[0]);
+
+// Bulk root finding must match the scalar version exactly, for every batch
+// size and alignment.
+TEST_F(CurveTests, QuadraticBulkRoots) {
+  for (size_t start = 0; start < kNumBulkQuadratics; ++start) {
+    const size_t count = kNumBulkQuadratics - start;
+    std::vector<QuadraticCurve::RootsArray> bulk(count);
+    QuadraticCurve::BulkRoots(&kBulkQuadratics[start], count, &bulk[0]);
+    for (size_t i = 0; i < count; ++i) {
+      QuadraticCurve::RootsArray roots;
+      kBulkQuadratics[start + i].Roots(&roots);
+      ASSERT_EQ(roots.len, bulk[i].len);
+      for (size_t j = 0; j < roots.len; ++j) {
+        EXPECT_EQ(roots.arr[j], bulk[i].arr[j]);
+      }
+    }
+  }
+}
+
+// Roots of zero must keep the scalar version's sign, too. EXPECT_EQ treats
+// 0 and -0 as equal, so compare the sign bits separately.
+TEST_F(CurveTests, QuadraticBulkRootsSignedZero) {
+  const QuadraticCurve curves[] = {
+      QuadraticCurve(1.0f, 0.0f, 0.0f),   QuadraticCurve(1.0f, -0.0f, 0.0f),
+      QuadraticCurve(1.0f, 0.0f, -0.0f),  QuadraticCurve(-1.0f, -0.0f, -0.0f),
+      QuadraticCurve(0.0f, 1.0f, 0.0f),   QuadraticCurve(0.0f, 1.0f, -0.0f),
+      QuadraticCurve(-0.0f, -1.0f, 0.0f), QuadraticCurve(-0.0f, -1.0f, -0.0f),
+      QuadraticCurve(1.0f, 1.0f, 0.0f),   QuadraticCurve(1.0f, -1.0f, -0.0f),
+  };
+  const size_t count = sizeof(curves) / sizeof(curves[0]);
+  QuadraticCurve::RootsArray bulk[count];
+  QuadraticCurve::BulkRoots(curves, count, bulk);
+  for (size_t i = 0; i < count; ++i) {
+    QuadraticCurve::RootsArray roots;
+    curves[i].Roots(&roots);
+    ASSERT_EQ(roots.len, bulk[i].len);
+    for (size_t j = 0; j < roots.len; ++j) {
+      EXPECT_EQ(roots.arr[j], bulk[i].arr[j]);
+      EXPECT_EQ(std::signbit(roots.arr[j]), std::signbit(bulk[i].arr[j]))
+          << curves[i].Text() << " root " << j;
+    }
+  }
+}
+
+TEST_F(CurveTests, QuadraticBulkRangesMatchingSign) {
+  const Range limits(0.0f, 1.0f);
+  std::vector<float> signs(kNumBulkQuadratics);
+  for (size_t i = 0; i < kNumBulkQuadratics; ++i) {
+    signs[i] = i % 2 == 0 ? 1.0f : -1.0f;
+  }
+  std::vector<QuadraticCurve::RangeArray> bulk(kNumBulkQuadratics);
+  QuadraticCurve::BulkRangesMatchingSign(kBulkQuadratics, &signs[0],
+                                         kNumBulkQuadratics, limits, &bulk[0]);
+  for (size_t i = 0; i < kNumBulkQuadratics; ++i) {
+    QuadraticCurve::RangeArray matching;
+    kBulkQuadratics[i].RangesMatchingSign(limits, signs[i], &matching);
+    ASSERT_EQ(matching.len, bulk[i].len);
+    for (size_t j = 0; j < matching.len; ++j) {
+      EXPECT_EQ(matching.arr[j].start(), bulk[i].arr[j].start());
+      EXPECT_EQ(matching.arr[j].end(), bulk[i].arr[j].end());
+    }
+  }
+}
+
 TEST_F(CurveTests, CubicWithWidth) {
   const CubicInit init(1.0f, -8.0f, 0.3f, -4.0f, 1.0f);
   const CubicCurve c(init);
@@ -291,6 +386,33 @@ static void TestShiftRight(const CubicInit& init, float shift) {
   TestShift(init, shift, ShiftRight, 1.0f);
 }
 
+TEST_F(CurveTests, CubicBulkUniformCurvature) {
+  static const CubicInit kInits[] = {
+      CubicInit(1.0f, -8.0f, 0.3f, -4.0f, 1.0f),
+      CubicInit(0.0f, 1.0f, 1.0f, 1.0f, 1.0f),
+      CubicInit(0.0f, 0.0f, 1.0f, 0.0f, 1.0f),
+      CubicInit(0.0f, 10.0f, 1.0f, -10.0f, 2.0f),
+      CubicInit(2.0f, 0.0f, 2.0f, 0.0f, 1.0f),
+      CubicInit(-1.0f, 3.0f, 1.0f, 0.1f, 0.5f),
+      CubicInit(0.0f, -5.0f, 0.0f, 5.0f, 4.0f),
+  };
+  static const size_t kNumInits = sizeof(kInits) / sizeof(kInits[0]);
+
+  std::vector<CubicCurve> curves;
+  std::vector<Range> limits;
+  for (size_t i = 0; i < kNumInits; ++i) {
+    curves.push_back(CubicCurve(kInits[i]));
+    limits.push_back(Range(0.0f, kInits[i].width_x));
+  }
+
+  bool uniform[kNumInits];
+  CubicCurve::BulkUniformCurvature(&curves[0], &limits[0], kNumInits,
+                                   uniform);
+  for (size_t i = 0; i < kNumInits; ++i) {
+    EXPECT_EQ(curves[i].UniformCurvature(limits[i]), uniform[i]);
+  }
+}
+
 TEST_F(CurveTests, CubicShiftLeft) {
   const CubicInit init(1.0f, -8.0f, 0.3f, -4.0f, 1.0f);
   TestShiftLeft(init, 0.0f);
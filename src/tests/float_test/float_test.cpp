@@ -158,6 +158,68 @@ TEST_F(FloatingPointTests, ClampNearZero) {
   EXPECT_EQ(0.00001f, motive::ClampNearZero(0.00001f, 0.000001f));
 }
 
+TEST_F(FloatingPointTests, HalfToFloatSpecial) {
+  EXPECT_EQ(0.0f, motive::HalfToFloat(0x0000));
+  EXPECT_EQ(1.0f, motive::HalfToFloat(0x3C00));
+  EXPECT_EQ(-2.0f, motive::HalfToFloat(0xC000));
+  EXPECT_EQ(65504.0f, motive::HalfToFloat(motive::kHalfMax));
+  EXPECT_EQ(std::ldexp(1.0f, -24), motive::HalfToFloat(0x0001));
+  EXPECT_EQ(std::ldexp(1.0f, -14), motive::HalfToFloat(0x0400));
+  EXPECT_EQ(kInfinity, motive::HalfToFloat(motive::kHalfInfinity));
+  EXPECT_EQ(-kInfinity, motive::HalfToFloat(0xFC00));
+  EXPECT_TRUE(std::isnan(motive::HalfToFloat(motive::kHalfQuietNaN)));
+}
+
+// Every half should survive the trip to float and back.
+TEST_F(FloatingPointTests, HalfRoundTrip) {
+  for (uint32_t i = 0; i <= 0xFFFF; ++i) {
+    const uint16_t h = static_cast<uint16_t>(i);
+    const float f = motive::HalfToFloat(h);
+    if (std::isnan(f)) continue;
+    EXPECT_EQ(h, motive::HalfFromFloat(f));
+    EXPECT_EQ(h, motive::HalfFromFloatRoundDown(f));
+  }
+}
+
+// Check rounding of values between every pair of adjacent halves.
+TEST_F(FloatingPointTests, HalfRounding) {
+  for (uint16_t h = 0; h < motive::kHalfMax; ++h) {
+    const uint16_t next = static_cast<uint16_t>(h + 1);
+    const uint16_t even = (h & 1) == 0 ? h : next;
+    const uint16_t negative = motive::kHalfSignBit;
+    const float a = motive::HalfToFloat(h);
+    const float b = motive::HalfToFloat(next);
+    const float quarter = a + 0.25f * (b - a);
+    const float half = a + 0.5f * (b - a);
+    const float three_quarters = a + 0.75f * (b - a);
+
+    EXPECT_EQ(h, motive::HalfFromFloat(quarter));
+    EXPECT_EQ(even, motive::HalfFromFloat(half));
+    EXPECT_EQ(next, motive::HalfFromFloat(three_quarters));
+    EXPECT_EQ(h, motive::HalfFromFloatRoundDown(quarter));
+    EXPECT_EQ(h, motive::HalfFromFloatRoundDown(half));
+    EXPECT_EQ(h, motive::HalfFromFloatRoundDown(three_quarters));
+
+    EXPECT_EQ(negative | h, motive::HalfFromFloat(-quarter));
+    EXPECT_EQ(negative | even, motive::HalfFromFloat(-half));
+    EXPECT_EQ(negative | next, motive::HalfFromFloatRoundDown(-quarter));
+    EXPECT_EQ(negative | next, motive::HalfFromFloatRoundDown(-half));
+  }
+}
+
+TEST_F(FloatingPointTests, HalfFromFloatLimits) {
+  EXPECT_EQ(motive::kHalfMax, motive::HalfFromFloat(65519.0f));
+  EXPECT_EQ(motive::kHalfInfinity, motive::HalfFromFloat(65520.0f));
+  EXPECT_EQ(motive::kHalfInfinity, motive::HalfFromFloat(kMaxFloat));
+  EXPECT_EQ(motive::kHalfMax, motive::HalfFromFloatRoundDown(kMaxFloat));
+  EXPECT_EQ(0xFC00, motive::HalfFromFloatRoundDown(-70000.0f));
+  EXPECT_EQ(0x0000, motive::HalfFromFloat(kMinFloat));
+  EXPECT_EQ(0x0000, motive::HalfFromFloatRoundDown(kMinFloat));
+  EXPECT_EQ(0x8001, motive::HalfFromFloatRoundDown(-kMinFloat));
+  EXPECT_EQ(motive::kHalfInfinity, motive::HalfFromFloatRoundDown(kInfinity));
+  EXPECT_EQ(0xFC00, motive::HalfFromFloat(-kInfinity));
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
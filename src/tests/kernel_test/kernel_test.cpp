@@ -0,0 +1,617 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Runs the same randomized workloads with every kernel variant that's
+// available on this machine, and checks that the results agree.
+//
+// Variants are compared against the scalar kernels within a tolerance in
+// ULPs, since SIMD kernels may round differently. kF16cOptimizations stores
+// segment ends in half precision, so blends can end a little early, and it
+// gets a looser tolerance. The scalar kernels are compared against
+// CompactSpline's direct evaluation, and against themselves, so the workloads
+// are meaningful even where scalar is the only variant.
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "gtest/gtest.h"
+#include "motive/anim.h"
+#include "motive/engine.h"
+#include "motive/init.h"
+#include "motive/math/angle.h"
+#include "motive/math/bulk_spline_evaluator.h"
+#include "motive/math/compact_spline.h"
+#include "motive/math/curve.h"
+#include "motive/math/float.h"
+#include "motive/motivator.h"
+#include "motive/util/optimizations.h"
+
+using mathfu::AffineTransform;
+using mathfu::mat4;
+using motive::Angle;
+using motive::BoneIndex;
+using motive::BulkSplineEvaluator;
+using motive::CompactSpline;
+using motive::CompactSplineIndex;
+using motive::MatrixAnim;
+using motive::MatrixInit;
+using motive::MatrixMotivator4f;
+using motive::MatrixOpArray;
+using motive::Motivator1f;
+using motive::MotiveEngine;
+using motive::MotiveTime;
+using motive::OvershootInit;
+using motive::ProcessorOptimization;
+using motive::Range;
+using motive::RigAnim;
+using motive::RigInit;
+using motive::RigMotivator;
+using motive::SplineInit;
+using motive::SplinePlayback;
+using motive::CubicCurve;
+using motive::CubicInit;
+using motive::QuadraticCurve;
+using motive::UncompressedNode;
+using motive::kAngleRange;
+using motive::kF16cOptimizations;
+using motive::kInvalidBoneIdx;
+using motive::kNoOptimizations;
+
+// Variants may round differently, so allow results to differ by a few units in
+// the last place. Values very close to zero have tiny ULPs, so also accept
+// absolute differences below `kVariantEpsilon`.
+static const int32_t kMaxUlps = 16;
+static const float kVariantEpsilon = 1e-6f;
+
+// Half-precision segment ends can end a blend up to 2^-10 of its length
+// early. In these workloads, that moves values by about 1e-5 of their
+// magnitude, so this tolerance is relative to values larger than 1.
+static const float kHalfPrecisionEpsilon = 1e-4f;
+
+// BulkSplineEvaluator evaluates each segment relative to its start, while
+// CompactSpline::YCalculatedSlowly() evaluates it directly. Tolerance is a
+// fraction of the spline's y-range.
+static const float kReferenceTolerance = 1e-4f;
+
+static const int kNumSplines = 16;
+static const int kNumIndices = 200;
+static const int kNumFrames = 300;
+static const int kNumEngineMotivators = 40;
+static const int kNumRigBones = 8;
+
+// A new blend is started on some index every `kBlendPeriod` frames.
+static const int kBlendPeriod = 3;
+
+// Frame times vary between these, so that x advances by more than a segment
+// on some frames, and by a fraction of one on others.
+static const MotiveTime kMinDeltaTime = 1;
+static const MotiveTime kMaxDeltaTime = 40;
+
+// Deterministic generator, so that every variant sees the same workload.
+class KernelRandom {
+ public:
+  explicit KernelRandom(uint32_t seed) : state_(seed == 0 ? 1 : seed) {}
+
+  uint32_t Next() {
+    state_ ^= state_ << 13;
+    state_ ^= state_ >> 17;
+    state_ ^= state_ << 5;
+    return state_;
+  }
+
+  // Return a value in the range [min, max).
+  float Float(float min, float max) {
+    const float unit = static_cast<float>(Next() >> 8) * (1.0f / 16777216.0f);
+    return min + unit * (max - min);
+  }
+
+  // Return a playback rate in the range [0.5, 2).
+  float Rate() { return Float(0.5f, 2.0f); }
+
+  // Return a value in the range [0, max).
+  int Int(int max) {
+    return static_cast<int>(Next() % static_cast<uint32_t>(max));
+  }
+
+ private:
+  uint32_t state_;
+};
+
+// Map floats onto integers such that adjacent floats map to adjacent
+// integers, and return the distance between `a` and `b` in that space.
+static int64_t UlpDistance(float a, float b) {
+  int32_t ia;
+  int32_t ib;
+  memcpy(&ia, &a, sizeof(ia));
+  memcpy(&ib, &b, sizeof(ib));
+  const int64_t oa = ia < 0 ? static_cast<int64_t>(INT32_MIN) - ia : ia;
+  const int64_t ob = ib < 0 ? static_cast<int64_t>(INT32_MIN) - ib : ib;
+  return oa > ob ? oa - ob : ob - oa;
+}
+
+static bool VariantsAgree(float a, float b,
+                          ProcessorOptimization optimization) {
+  const float epsilon =
+      optimization == kF16cOptimizations
+          ? kHalfPrecisionEpsilon * std::max(1.0f, fabsf(a))
+          : kVariantEpsilon;
+  return fabsf(a - b) <= epsilon || UlpDistance(a, b) <= kMaxUlps;
+}
+
+// Every value of `variant` must agree with `scalar`.
+static void ExpectTracesAgree(const std::vector<float>& scalar,
+                              const std::vector<float>& variant,
+                              ProcessorOptimization optimization) {
+  ASSERT_EQ(scalar.size(), variant.size());
+  for (size_t i = 0; i < scalar.size(); ++i) {
+    EXPECT_TRUE(VariantsAgree(scalar[i], variant[i], optimization))
+        << motive::ProcessorOptimizationName(optimization) << " value " << i
+        << ": scalar " << scalar[i] << " vs " << variant[i];
+  }
+}
+
+// Every value must be bit-for-bit identical.
+static void ExpectTracesIdentical(const std::vector<float>& a,
+                                  const std::vector<float>& b) {
+  ASSERT_EQ(a.size(), b.size());
+  EXPECT_EQ(0, memcmp(a.data(), b.data(), a.size() * sizeof(a[0])));
+}
+
+// Engine workloads are created with the default optimization, so set it for
+// the lifetime of a workload.
+class ScopedDefaultOptimization {
+ public:
+  explicit ScopedDefaultOptimization(ProcessorOptimization optimization)
+      : previous_(motive::DefaultProcessorOptimization()) {
+    motive::SetDefaultProcessorOptimization(optimization);
+  }
+  ~ScopedDefaultOptimization() {
+    motive::SetDefaultProcessorOptimization(previous_);
+  }
+
+ private:
+  ProcessorOptimization previous_;
+};
+
+class KernelTests : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    motive::MatrixInit::Register();
+    motive::OvershootInit::Register();
+    motive::RigInit::Register();
+    motive::SplineInit::Register();
+
+    for (int i = 0; i <= kF16cOptimizations; ++i) {
+      const ProcessorOptimization optimization =
+          static_cast<ProcessorOptimization>(i);
+      if (motive::ProcessorOptimizationAvailable(optimization)) {
+        optimizations_.push_back(optimization);
+      }
+    }
+
+    // Splines with many short segments, so that indices often cross several
+    // segments in one frame, and with long segments. Odd splines are angles
+    // that wrap around at +-pi.
+    KernelRandom random(7);
+    for (int i = 0; i < kNumSplines; ++i) {
+      const bool angle = i % 2 == 1;
+      const int num_nodes = i % 4 < 2 ? 30 : 4;
+      const float length = i % 4 < 2 ? 200.0f : 2000.0f;
+      splines_.push_back(CreateSpline(num_nodes, length, angle, &random));
+    }
+  }
+
+  virtual void TearDown() {
+    for (size_t i = 0; i < splines_.size(); ++i) {
+      CompactSpline::Destroy(splines_[i]);
+    }
+  }
+
+  // Create a spline that starts and ends with the same value and derivative,
+  // so that it loops smoothly. Angle splines cross from near pi to near -pi,
+  // to exercise modular arithmetic.
+  static CompactSpline* CreateSpline(int num_nodes, float length, bool angle,
+                                     KernelRandom* random) {
+    // Leave room for mid-nodes, which may overshoot the nodes' values.
+    const Range y_range = angle ? Range(-10.0f, 10.0f) : Range(-4.0f, 4.0f);
+    const float spacing = length / (num_nodes - 1);
+
+    // AddNode() may insert a dual-cubic mid-node between every pair of nodes.
+    CompactSpline* spline = CompactSpline::Create(
+        static_cast<CompactSplineIndex>(2 * num_nodes - 1));
+    spline->Init(y_range, CompactSpline::RecommendXGranularity(length));
+    const float start_y = angle ? 3.0f : random->Float(-0.5f, 0.5f);
+    for (int i = 0; i < num_nodes; ++i) {
+      const bool end = i == 0 || i == num_nodes - 1;
+      const float x = i * spacing +
+                      (end ? 0.0f : random->Float(-0.4f, 0.4f) * spacing);
+      const float y =
+          end ? start_y
+              : angle ? random->Float(2.0f, 4.5f) * (i % 2 == 0 ? 1.0f : -1.0f)
+                      : random->Float(-0.9f, 0.9f);
+      const float derivative = end ? 0.0f : random->Float(-0.01f, 0.01f);
+      spline->AddNode(x, y, derivative);
+    }
+    return spline;
+  }
+
+  // Play random splines on a BulkSplineEvaluator with `optimization`, and
+  // append every index's x, y, and derivative, every frame, to `trace`.
+  // If `check_reference`, also check y against CompactSpline's evaluation.
+  void RunEvaluator(ProcessorOptimization optimization, bool check_reference,
+                    std::vector<float>* trace) {
+    KernelRandom random(11);
+    ScopedDefaultOptimization scoped(optimization);
+    BulkSplineEvaluator evaluator;
+    EXPECT_EQ(optimization, evaluator.optimization());
+    evaluator.SetNumIndices(kNumIndices);
+
+    // Blending indices don't follow their spline until the blend completes.
+    std::vector<float> blend_remaining(kNumIndices, 0.0f);
+    for (int i = 0; i < kNumIndices; ++i) {
+      const CompactSpline& spline = *splines_[i % kNumSplines];
+      if (i % 2 == 1) evaluator.SetYRanges(i, 1, kAngleRange);
+      evaluator.SetSplines(
+          i, 1, &spline,
+          SplinePlayback(random.Float(spline.StartX(), spline.EndX()),
+                         i % 5 != 0, random.Rate()));
+    }
+
+    for (int frame = 0; frame < kNumFrames; ++frame) {
+      // Blend to a new spline of the same kind, so that angles stay angles.
+      if (frame % kBlendPeriod == 0) {
+        const int i = random.Int(kNumIndices);
+        const CompactSpline& spline =
+            *splines_[(random.Int(kNumSplines / 2) * 2 + i % 2)];
+        const float rate = random.Rate();
+        const float blend_x = random.Float(10.0f, 200.0f);
+        evaluator.SetSplines(
+            i, 1, &spline,
+            SplinePlayback(random.Float(spline.StartX(), spline.EndX()), true,
+                           rate, blend_x));
+        blend_remaining[i] = blend_x;
+      }
+
+      const float delta_x = static_cast<float>(
+          kMinDeltaTime + random.Int(kMaxDeltaTime - kMinDeltaTime + 1));
+      evaluator.AdvanceFrame(delta_x);
+
+      for (int i = 0; i < kNumIndices; ++i) {
+        trace->push_back(evaluator.X(i));
+        trace->push_back(evaluator.Y(i));
+        trace->push_back(evaluator.Derivative(i));
+
+        blend_remaining[i] -= delta_x * evaluator.PlaybackRate(i);
+        if (!check_reference || blend_remaining[i] > 0.0f) continue;
+
+        const CompactSpline& spline = *evaluator.SourceSpline(i);
+        const float reference = spline.YCalculatedSlowly(evaluator.X(i));
+        const float tolerance = kReferenceTolerance * spline.y_range().Length();
+        const float difference =
+            evaluator.ModularArithmetic(i)
+                ? Angle::WrapAngle(evaluator.Y(i) - reference)
+                : evaluator.Y(i) - reference;
+        EXPECT_LE(fabsf(difference), tolerance)
+            << motive::ProcessorOptimizationName(optimization) << " frame "
+            << frame << " index " << i << " x " << evaluator.X(i);
+      }
+    }
+
+    // The workload must cover segment transitions and blends.
+    EXPECT_GT(evaluator.NumSegmentTransitions(),
+              static_cast<uint64_t>(kNumFrames));
+    EXPECT_GT(evaluator.NumBlends(), 0u);
+  }
+
+ public:
+  // The workloads below are public so that tests can take their address.
+
+  // Spline Motivators that are blended to new splines as they play.
+  void RunSplineWorkload(std::vector<float>* trace) {
+    KernelRandom random(13);
+    MotiveEngine engine;
+    std::vector<Motivator1f> motivators(kNumEngineMotivators);
+    for (size_t i = 0; i < motivators.size(); ++i) {
+      const bool angle = i % 2 == 1;
+      motivators[i].Initialize(
+          angle ? SplineInit(kAngleRange) : SplineInit(), &engine);
+      motivators[i].SetSpline(*splines_[i % kNumSplines],
+                              SplinePlayback(0.0f, true));
+    }
+    for (int frame = 0; frame < kNumFrames; ++frame) {
+      if (frame % kBlendPeriod == 0) {
+        const int i = random.Int(kNumEngineMotivators);
+        const CompactSpline& spline =
+            *splines_[(random.Int(kNumSplines / 2) * 2 + i % 2)];
+        motivators[i].SetSpline(
+            spline, SplinePlayback(0.0f, true, 1.0f, random.Float(10, 100)));
+      }
+      engine.AdvanceFrame(
+          kMinDeltaTime + random.Int(kMaxDeltaTime - kMinDeltaTime + 1));
+      for (size_t i = 0; i < motivators.size(); ++i) {
+        trace->push_back(motivators[i].Value());
+        trace->push_back(motivators[i].Velocity());
+      }
+    }
+  }
+
+  // Overshoot Motivators chasing random targets, some of them angles.
+  void RunOvershootWorkload(std::vector<float>* trace) {
+    KernelRandom random(17);
+    OvershootInit angle_init;
+    angle_init.set_modular(true);
+    angle_init.set_range(kAngleRange);
+    angle_init.set_max_velocity(0.021f);
+    angle_init.set_max_delta(3.141f);
+    angle_init.at_target().max_difference = 0.087f;
+    angle_init.at_target().max_velocity = 0.00059f;
+    angle_init.set_accel_per_difference(0.00032f);
+    angle_init.set_wrong_direction_multiplier(4.0f);
+    angle_init.set_max_delta_time(10);
+
+    MotiveEngine engine;
+    std::vector<Motivator1f> motivators(kNumEngineMotivators);
+    for (size_t i = 0; i < motivators.size(); ++i) {
+      motivators[i].Initialize(angle_init, &engine);
+    }
+    for (int frame = 0; frame < kNumFrames; ++frame) {
+      const int i = random.Int(kNumEngineMotivators);
+      motivators[i].SetTarget(
+          motive::Current1f(random.Float(-motive::kPi, motive::kPi)));
+      engine.AdvanceFrame(
+          kMinDeltaTime + random.Int(kMaxDeltaTime - kMinDeltaTime + 1));
+      for (size_t j = 0; j < motivators.size(); ++j) {
+        trace->push_back(motivators[j].Value());
+        trace->push_back(motivators[j].Velocity());
+      }
+    }
+  }
+
+  // Matrix Motivators built from spline-driven rotations and translations.
+  void RunMatrixWorkload(std::vector<float>* trace) {
+    KernelRandom random(19);
+    MotiveEngine engine;
+    std::vector<MatrixMotivator4f> motivators(kNumEngineMotivators);
+
+    // MatrixOpArray references its inits, so they must outlive the ops.
+    const SplineInit scalar_init;
+    const SplineInit angle_init(kAngleRange);
+    for (size_t i = 0; i < motivators.size(); ++i) {
+      MatrixOpArray ops(4);
+      ops.AddOp(0, motive::kTranslateX, scalar_init,
+                *splines_[(2 * i) % kNumSplines]);
+      ops.AddOp(1, motive::kTranslateY, 1.0f);
+      ops.AddOp(2, motive::kRotateAboutY, angle_init,
+                *splines_[(2 * i + 1) % kNumSplines]);
+      ops.AddOp(3, motive::kRotateAboutX, angle_init,
+                *splines_[(2 * i + 3) % kNumSplines]);
+      motivators[i].Initialize(MatrixInit(ops), &engine);
+    }
+    for (int frame = 0; frame < kNumFrames; ++frame) {
+      engine.AdvanceFrame(
+          kMinDeltaTime + random.Int(kMaxDeltaTime - kMinDeltaTime + 1));
+      for (size_t i = 0; i < motivators.size(); ++i) {
+        const mat4& m = motivators[i].Value();
+        trace->insert(trace->end(), &m[0], &m[0] + 16);
+      }
+    }
+  }
+
+  // Fill `anim` with a chain of bones, each rotated by two splines.
+  static void CreateRigAnim(KernelRandom* random, RigAnim* anim) {
+    anim->Init("kernel", kNumRigBones, false);
+    for (BoneIndex i = 0; i < kNumRigBones; ++i) {
+      const BoneIndex parent =
+          i == 0 ? kInvalidBoneIdx : static_cast<BoneIndex>(i - 1);
+      MatrixAnim& m = anim->InitMatrixAnim(i, parent, "");
+      MatrixAnim::Spline* splines = m.Construct(2);
+      for (int j = 0; j < 2; ++j) {
+        splines[j].spline = CreateSpline(8, 2000.0f, true, random);
+        splines[j].init = SplineInit(kAngleRange);
+      }
+      MatrixOpArray& ops = m.ops();
+      ops.AddOp(0, motive::kTranslateY, 1.0f);
+      ops.AddOp(1, motive::kRotateAboutY, splines[0].init, *splines[0].spline);
+      ops.AddOp(2, motive::kRotateAboutX, splines[1].init, *splines[1].spline);
+    }
+    anim->set_end_time(2000);
+    anim->set_repeat(true);
+  }
+
+  // Rigs that blend between two animations.
+  void RunRigWorkload(std::vector<float>* trace) {
+    KernelRandom random(23);
+    RigAnim anims[2];
+    CreateRigAnim(&random, &anims[0]);
+    CreateRigAnim(&random, &anims[1]);
+
+    MotiveEngine engine;
+    std::vector<RigMotivator> rigs(kNumEngineMotivators / 4);
+    const RigInit init(anims[0], anims[0].bone_parents(), kNumRigBones);
+    for (size_t i = 0; i < rigs.size(); ++i) {
+      rigs[i].Initialize(init, &engine);
+      rigs[i].BlendToAnim(anims[i % 2], SplinePlayback(random.Float(0, 2000)));
+    }
+    for (int frame = 0; frame < kNumFrames; ++frame) {
+      if (frame % kBlendPeriod == 0) {
+        const int i = random.Int(static_cast<int>(rigs.size()));
+        rigs[i].BlendToAnim(
+            anims[random.Int(2)],
+            SplinePlayback(random.Float(0, 2000), true, 1.0f,
+                           random.Float(10, 200)));
+      }
+      engine.AdvanceFrame(
+          kMinDeltaTime + random.Int(kMaxDeltaTime - kMinDeltaTime + 1));
+      for (size_t i = 0; i < rigs.size(); ++i) {
+        const AffineTransform* transforms = rigs[i].GlobalTransforms();
+        for (int bone = 0; bone < kNumRigBones; ++bone) {
+          const AffineTransform& t = transforms[bone];
+          trace->insert(trace->end(), &t[0], &t[0] + 12);
+        }
+      }
+    }
+  }
+
+  // Bulk math that's selected by the default optimization instead of by an
+  // evaluator: quadratic roots, cubic curvature checks, and spline
+  // construction, which uses both for its mid-nodes. Range normalization is
+  // chosen at compile time, so range_test covers its SIMD path.
+  void RunBulkMathWorkload(std::vector<float>* trace) {
+    KernelRandom random(29);
+    const size_t kCount = 1001;
+
+    // Quadratics with no, one, and two roots, and linear ones.
+    std::vector<QuadraticCurve> quadratics;
+    for (size_t i = 0; i < kCount; ++i) {
+      const float c2 = i % 4 == 0 ? 0.0f : random.Float(-10.0f, 10.0f);
+      quadratics.push_back(QuadraticCurve(c2, random.Float(-10.0f, 10.0f),
+                                          random.Float(-10.0f, 10.0f)));
+    }
+    std::vector<QuadraticCurve::RootsArray> roots(kCount);
+    QuadraticCurve::BulkRoots(&quadratics[0], kCount, &roots[0]);
+    for (size_t i = 0; i < kCount; ++i) {
+      trace->push_back(static_cast<float>(roots[i].len));
+      trace->insert(trace->end(), roots[i].arr, roots[i].arr + roots[i].len);
+    }
+
+    std::vector<CubicCurve> cubics;
+    std::vector<Range> x_limits;
+    for (size_t i = 0; i < kCount; ++i) {
+      const float width = random.Float(0.1f, 10.0f);
+      cubics.push_back(CubicCurve(CubicInit(
+          random.Float(-1.0f, 1.0f), random.Float(-1.0f, 1.0f),
+          random.Float(-1.0f, 1.0f), random.Float(-1.0f, 1.0f), width)));
+      x_limits.push_back(Range(0.0f, width));
+    }
+    std::unique_ptr<bool[]> uniform(new bool[kCount]);
+    CubicCurve::BulkUniformCurvature(&cubics[0], &x_limits[0], kCount,
+                                     uniform.get());
+    for (size_t i = 0; i < kCount; ++i) {
+      trace->push_back(uniform[i] ? 1.0f : 0.0f);
+    }
+
+    // Steep nodes, so that most segments need a mid-node.
+    const size_t kNumNodes = 200;
+    std::vector<UncompressedNode> nodes(kNumNodes);
+    for (size_t i = 0; i < kNumNodes; ++i) {
+      nodes[i].x = 10.0f * i + random.Float(0.0f, 5.0f);
+      nodes[i].y = random.Float(-1.0f, 1.0f);
+      nodes[i].derivative = random.Float(-1.0f, 1.0f);
+    }
+    CompactSpline* spline = CompactSpline::Create(
+        static_cast<CompactSplineIndex>(2 * kNumNodes - 1));
+    spline->Init(Range(-4.0f, 4.0f),
+                 CompactSpline::RecommendXGranularity(nodes.back().x));
+    spline->AddNodes(&nodes[0], kNumNodes);
+    trace->push_back(static_cast<float>(spline->num_nodes()));
+    for (CompactSplineIndex i = 0; i < spline->num_nodes(); ++i) {
+      trace->push_back(spline->NodeX(i));
+      trace->push_back(spline->NodeY(i));
+      trace->push_back(spline->NodeDerivative(i));
+    }
+    CompactSpline::Destroy(spline);
+  }
+
+  typedef void (KernelTests::*Workload)(std::vector<float>* trace);
+
+ protected:
+
+  // Run `workload` with every available variant, and compare to scalar.
+  void CheckEngineWorkload(Workload workload) {
+    std::vector<float> scalar;
+    {
+      ScopedDefaultOptimization scoped(kNoOptimizations);
+      (this->*workload)(&scalar);
+    }
+    ASSERT_FALSE(scalar.empty());
+
+    for (size_t i = 0; i < optimizations_.size(); ++i) {
+      std::vector<float> variant;
+      ScopedDefaultOptimization scoped(optimizations_[i]);
+      (this->*workload)(&variant);
+      if (optimizations_[i] == kNoOptimizations) {
+        ExpectTracesIdentical(scalar, variant);
+      } else {
+        ExpectTracesAgree(scalar, variant, optimizations_[i]);
+      }
+    }
+  }
+
+  std::vector<ProcessorOptimization> optimizations_;
+  std::vector<CompactSpline*> splines_;
+};
+
+// Scalar must always be available, as the baseline for every other variant.
+// The default must be available too, and must not lose precision.
+TEST_F(KernelTests, ScalarAvailable) {
+  ASSERT_FALSE(optimizations_.empty());
+  EXPECT_EQ(kNoOptimizations, optimizations_[0]);
+  EXPECT_TRUE(motive::ProcessorOptimizationAvailable(
+      motive::DefaultProcessorOptimization()));
+  EXPECT_NE(kF16cOptimizations, motive::DefaultProcessorOptimization());
+  EXPECT_EQ(motive::HalfPrecisionAvailable(),
+            motive::ProcessorOptimizationAvailable(kF16cOptimizations));
+}
+
+// Every variant should follow its splines across segment transitions, loops,
+// and modular ranges, and land back on the spline after blending.
+TEST_F(KernelTests, EvaluatorMatchesReference) {
+  for (size_t i = 0; i < optimizations_.size(); ++i) {
+    std::vector<float> trace;
+    RunEvaluator(optimizations_[i], true, &trace);
+  }
+}
+
+// Variants should agree with scalar at every frame, including mid-blend.
+TEST_F(KernelTests, EvaluatorVariantsAgree) {
+  std::vector<float> scalar;
+  RunEvaluator(kNoOptimizations, false, &scalar);
+  for (size_t i = 0; i < optimizations_.size(); ++i) {
+    std::vector<float> variant;
+    RunEvaluator(optimizations_[i], false, &variant);
+    if (optimizations_[i] == kNoOptimizations) {
+      ExpectTracesIdentical(scalar, variant);
+    } else {
+      ExpectTracesAgree(scalar, variant, optimizations_[i]);
+    }
+  }
+}
+
+TEST_F(KernelTests, SplineWorkloadVariantsAgree) {
+  CheckEngineWorkload(&KernelTests::RunSplineWorkload);
+}
+
+TEST_F(KernelTests, OvershootWorkloadVariantsAgree) {
+  CheckEngineWorkload(&KernelTests::RunOvershootWorkload);
+}
+
+TEST_F(KernelTests, MatrixWorkloadVariantsAgree) {
+  CheckEngineWorkload(&KernelTests::RunMatrixWorkload);
+}
+
+TEST_F(KernelTests, RigWorkloadVariantsAgree) {
+  CheckEngineWorkload(&KernelTests::RunRigWorkload);
+}
+
+TEST_F(KernelTests, BulkMathVariantsAgree) {
+  CheckEngineWorkload(&KernelTests::RunBulkMathWorkload);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
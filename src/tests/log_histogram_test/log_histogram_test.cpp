@@ -0,0 +1,142 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <limits>
+#include "gtest/gtest.h"
+#include "motive/util/log_histogram.h"
+
+using motive::LogHistogram;
+
+// Largest relative error of any value recorded in the histogram.
+static const double kRelativeError = 1.0 / LogHistogram::kSubBuckets;
+
+// Values below this are recorded exactly.
+static const LogHistogram::Value kExactLimit = 2 * LogHistogram::kSubBuckets;
+
+class LogHistogramTests : public ::testing::Test {
+protected:
+  virtual void SetUp() {}
+  virtual void TearDown() {}
+};
+
+// Buckets must be contiguous, non-overlapping, and cover all 64-bit values.
+TEST_F(LogHistogramTests, BucketsCoverAllValues) {
+  EXPECT_EQ(0u, LogHistogram::BucketMin(0));
+  for (int i = 1; i < LogHistogram::kNumBuckets; ++i) {
+    EXPECT_EQ(LogHistogram::BucketMax(i - 1) + 1, LogHistogram::BucketMin(i));
+  }
+  EXPECT_EQ(std::numeric_limits<LogHistogram::Value>::max(),
+            LogHistogram::BucketMax(LogHistogram::kNumBuckets - 1));
+}
+
+// Every value should map to the bucket that contains it.
+TEST_F(LogHistogramTests, BucketIndexInverse) {
+  for (int i = 0; i < LogHistogram::kNumBuckets; ++i) {
+    EXPECT_EQ(i, LogHistogram::BucketIndex(LogHistogram::BucketMin(i)));
+    EXPECT_EQ(i, LogHistogram::BucketIndex(LogHistogram::BucketMax(i)));
+  }
+}
+
+// Small values get one bucket each, so their percentiles should be exact.
+TEST_F(LogHistogramTests, SmallValuesExact) {
+  for (LogHistogram::Value v = 0; v < kExactLimit; ++v) {
+    EXPECT_EQ(LogHistogram::BucketMin(LogHistogram::BucketIndex(v)),
+              LogHistogram::BucketMax(LogHistogram::BucketIndex(v)));
+
+    LogHistogram h;
+    h.Append(v);
+    EXPECT_EQ(v, h.Percentile(50.0));
+  }
+}
+
+// Large values should be reported within the advertised relative error.
+TEST_F(LogHistogramTests, LargeValuesRelativeError) {
+  for (LogHistogram::Value v = kExactLimit; v < (1ULL << 62); v = v * 3 + 1) {
+    const int bucket = LogHistogram::BucketIndex(v);
+    const double width = static_cast<double>(LogHistogram::BucketMax(bucket) -
+                                             LogHistogram::BucketMin(bucket));
+    EXPECT_LE(width / static_cast<double>(v), kRelativeError);
+  }
+}
+
+// Percentiles of 1..1000 should be close to the percentile itself.
+TEST_F(LogHistogramTests, Percentiles) {
+  LogHistogram h;
+  for (LogHistogram::Value v = 1; v <= 1000; ++v) {
+    h.Append(v);
+  }
+  EXPECT_EQ(1000u, h.NumSamples());
+  EXPECT_EQ(1u, h.Min());
+  EXPECT_EQ(1000u, h.Max());
+  EXPECT_DOUBLE_EQ(500.5, h.Average());
+
+  const double percents[] = {50.0, 90.0, 99.0, 99.9};
+  for (size_t i = 0; i < sizeof(percents) / sizeof(percents[0]); ++i) {
+    const double expected = percents[i] * 10.0;
+    const double actual = static_cast<double>(h.Percentile(percents[i]));
+    EXPECT_NEAR(expected, actual, expected * kRelativeError);
+  }
+
+  // Extreme percentiles are clamped to the exact min and max.
+  EXPECT_EQ(1u, h.Percentile(0.0));
+  EXPECT_EQ(1000u, h.Percentile(100.0));
+}
+
+// A single outlier should show up in p99.9 but not in p99.
+TEST_F(LogHistogramTests, TailOutlier) {
+  LogHistogram h;
+  for (int i = 0; i < 999; ++i) {
+    h.Append(100);
+  }
+  h.Append(1000000);
+  EXPECT_EQ(100u, h.Percentile(99.0));
+  EXPECT_EQ(100u, h.Percentile(99.9));
+  EXPECT_EQ(1000000u, h.Percentile(100.0));
+}
+
+// Merging two histograms should be the same as appending to one.
+TEST_F(LogHistogramTests, Merge) {
+  LogHistogram all;
+  LogHistogram evens;
+  LogHistogram odds;
+  for (LogHistogram::Value v = 0; v < 10000; v += 7) {
+    all.Append(v);
+    ((v & 1) ? odds : evens).Append(v);
+  }
+  evens.Merge(odds);
+
+  EXPECT_EQ(all.NumSamples(), evens.NumSamples());
+  EXPECT_EQ(all.Min(), evens.Min());
+  EXPECT_EQ(all.Max(), evens.Max());
+  EXPECT_DOUBLE_EQ(all.Average(), evens.Average());
+  for (int i = 0; i < LogHistogram::kNumBuckets; ++i) {
+    EXPECT_EQ(all.BucketCount(i), evens.BucketCount(i));
+  }
+}
+
+// After Clear(), the histogram should be empty.
+TEST_F(LogHistogramTests, Clear) {
+  LogHistogram h;
+  h.Append(12345);
+  h.Clear();
+  EXPECT_EQ(0u, h.NumSamples());
+  EXPECT_EQ(0u, h.Percentile(50.0));
+  EXPECT_EQ(0.0, h.Average());
+  EXPECT_EQ(0u, h.BucketCount(LogHistogram::BucketIndex(12345)));
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -58,9 +58,13 @@ using motive::Motivator2f;
 using motive::Motivator3f;
 using motive::Motivator4f;
 using motive::MotivatorInit;
+using motive::MotiveCounterReport;
 using motive::MotiveCurveShape;
 using motive::MotiveDimension;
 using motive::MotiveEngine;
+using motive::MotiveMemoryUsage;
+using motive::MotiveProcessorCounters;
+using motive::MotiveSpikeReport;
 using motive::MotiveTarget1f;
 using motive::MotiveTarget2f;
 using motive::MotiveTarget3f;
@@ -1088,6 +1092,254 @@ void Splines(MotiveTests& t) {
 }
 TEST_ALL_VECTOR_MOTIVATORS_F(Splines)
 
+// Processor counters should follow Motivator lifetimes and retargets, and
+// frame counters should report only the work done since the last frame.
+TEST_F(MotiveTests, ProcessorCounters) {
+  engine().EnableFrameCounters(true);
+  Motivator1f a(smooth_scalar_init(), &engine());
+  Motivator1f b(smooth_scalar_init(), &engine());
+  a.SetTarget(motive::CurrentToTarget1f(0.0f, 0.0f, 1.0f, 0.0f, 100));
+  b.SetTarget(motive::CurrentToTarget1f(0.0f, 0.0f, 1.0f, 0.0f, 100));
+
+  // Open a hole at the start of the processor's data.
+  a.Invalidate();
+  const MotiveProcessorCounters before = engine().TotalCounters();
+  EXPECT_EQ(2u, before.motivators_initialized);
+  EXPECT_EQ(1, before.active_indices);
+  EXPECT_EQ(1, before.holes);
+  EXPECT_EQ(2u, before.set_target_calls);
+  EXPECT_EQ(0u, before.defragment_moves);
+
+  // Defragment() fills the hole by moving `b` down.
+  engine().AdvanceFrame(1);
+  std::vector<MotiveCounterReport> reports;
+  engine().Counters(&reports);
+  ASSERT_EQ(1u, reports.size());
+  EXPECT_EQ(SplineInit::kType, reports[0].type);
+  EXPECT_EQ(1, reports[0].totals.active_indices);
+  EXPECT_EQ(0, reports[0].totals.holes);
+  EXPECT_EQ(1u, reports[0].totals.defragment_moves);
+  EXPECT_EQ(1u, reports[0].frame.defragment_moves);
+  EXPECT_EQ(2u, reports[0].frame.set_target_calls);
+
+  // Running past the end of the curve moves onto the next segment.
+  engine().AdvanceFrame(200);
+  engine().Counters(&reports);
+  EXPECT_GT(reports[0].totals.segment_transitions, 0u);
+  EXPECT_EQ(0u, reports[0].frame.defragment_moves);
+  EXPECT_EQ(0u, reports[0].frame.set_target_calls);
+  EXPECT_EQ(2u, reports[0].totals.set_target_calls);
+}
+
+// A matrix blend is counted once per blended channel, by the processor that
+// evaluates the channel, and not again by the matrix processor.
+TEST_F(MotiveTests, BlendsCountedOnce) {
+  const CompactSpline* splines = simple_splines(1);
+  MatrixOpArray ops(2);
+  ops.AddOp(0, motive::kTranslateX, spline_scalar_init, 1.0f);
+  ops.AddOp(1, motive::kTranslateY, spline_scalar_init, 1.0f);
+  MatrixMotivator4f matrix_motivator(MatrixInit(ops), &engine_);
+  engine_.AdvanceFrame(kTimePerFrame);
+
+  MatrixOpArray blend_ops(2);
+  blend_ops.AddOp(0, motive::kTranslateX, spline_scalar_init, splines[0]);
+  blend_ops.AddOp(1, motive::kTranslateY, spline_scalar_init, splines[0]);
+  const uint64_t before = engine_.TotalCounters().blends_started;
+  matrix_motivator.BlendToOps(blend_ops,
+                              SplinePlayback(0.0f, false, 1.0f, 10.0f));
+  EXPECT_EQ(before + 2, engine_.TotalCounters().blends_started);
+}
+
+// Sorting indices by spline should move Motivators without changing what
+// they play. Motivators of different dimensions are sorted separately.
+TEST_F(MotiveTests, SortIndices) {
+  static const int kNumScalars = 8;
+  static const int kNumVectors = 3;
+  static const MotiveTime kDeltaTime = 1;
+  engine().EnableIndexSorting(true);
+  const CompactSpline* splines = simple_splines(2);
+
+  // Interleave the splines, and the dimensions, so that the sort has to move
+  // most Motivators.
+  Motivator1f scalars[kNumScalars];
+  Motivator2f vectors[kNumVectors];
+  for (int i = 0; i < kNumScalars; ++i) {
+    scalars[i].Initialize(smooth_scalar_init(), &engine());
+    scalars[i].SetSpline(splines[i % 2],
+                         SplinePlayback(static_cast<float>(10 * i)));
+    if (i < kNumVectors) {
+      vectors[i].Initialize(smooth_scalar_init(), &engine());
+      vectors[i].SetSplines(&splines[2 * (i % 2)],
+                            SplinePlayback(static_cast<float>(20 * i)));
+    }
+  }
+
+  // Defragment(), and therefore the sort, is called at the start of
+  // AdvanceFrame. The arrays were grown with room for the sort's temporary
+  // block, so the sort doesn't reallocate them.
+  const uint64_t reallocations = engine().TotalCounters().reallocations;
+  engine().AdvanceFrame(kDeltaTime);
+  EXPECT_GT(engine().TotalCounters().defragment_moves, 0u);
+  EXPECT_EQ(reallocations, engine().TotalCounters().reallocations);
+  for (int i = 0; i < kNumScalars; ++i) {
+    const MotiveTime time = 10 * i + kDeltaTime;
+    EXPECT_TRUE(scalars[i].Valid());
+    EXPECT_EQ(time, scalars[i].SplineTime());
+    EXPECT_NEAR(splines[i % 2].YCalculatedSlowly(static_cast<float>(time)),
+                scalars[i].Value(), kAngleEpsilon);
+  }
+  for (int i = 0; i < kNumVectors; ++i) {
+    const MotiveTime time = 20 * i + kDeltaTime;
+    EXPECT_TRUE(vectors[i].Valid());
+    EXPECT_EQ(time, vectors[i].SplineTime());
+    const float y = splines[2 * (i % 2)].YCalculatedSlowly(
+        static_cast<float>(time));
+    EXPECT_TRUE(VectorNear(vectors[i].Value(), vec2(y), vec2(kAngleEpsilon)));
+  }
+
+  // Without new or removed Motivators, there is nothing more to sort.
+  const uint64_t moves = engine().TotalCounters().defragment_moves;
+  engine().AdvanceFrame(kDeltaTime);
+  EXPECT_EQ(moves, engine().TotalCounters().defragment_moves);
+
+  // Changing a spline changes the order, but the sort waits until enough
+  // frames have passed since the last one.
+  scalars[0].SetSpline(splines[1], SplinePlayback(0.0f));
+  const int kFramesBetweenSorts = motive::MotiveProcessor::kFramesBetweenSorts;
+  for (int i = 2; i < kFramesBetweenSorts; ++i) {
+    engine().AdvanceFrame(kDeltaTime);
+  }
+  EXPECT_EQ(moves, engine().TotalCounters().defragment_moves);
+  engine().AdvanceFrame(kDeltaTime);
+  EXPECT_GT(engine().TotalCounters().defragment_moves, moves);
+  EXPECT_TRUE(scalars[0].Valid());
+  EXPECT_EQ(kDeltaTime * (kFramesBetweenSorts - 1), scalars[0].SplineTime());
+}
+
+// The sort's temporary block should fit in the spare indices even when the
+// arrays have no room beyond them.
+TEST_F(MotiveTests, SortIndicesWithoutExtraCapacity) {
+  static const MotiveTime kDeltaTime = 1;
+  engine().EnableIndexSorting(true);
+  const CompactSpline* splines = simple_splines(2);
+
+  // Growing from one to two indices, plus one spare, leaves the arrays with
+  // capacity for exactly three indices.
+  Motivator1f first;
+  Motivator1f second;
+  first.Initialize(smooth_scalar_init(), &engine());
+  second.Initialize(smooth_scalar_init(), &engine());
+  first.SetSpline(splines[1], SplinePlayback(0.0f));
+  second.SetSpline(splines[0], SplinePlayback(0.0f));
+
+  const uint64_t reallocations = engine().TotalCounters().reallocations;
+  engine().AdvanceFrame(kDeltaTime);
+  EXPECT_GT(engine().TotalCounters().defragment_moves, 0u);
+  EXPECT_EQ(reallocations, engine().TotalCounters().reallocations);
+  EXPECT_NEAR(splines[1].YCalculatedSlowly(static_cast<float>(kDeltaTime)),
+              first.Value(), kAngleEpsilon);
+  EXPECT_NEAR(splines[0].YCalculatedSlowly(static_cast<float>(kDeltaTime)),
+              second.Value(), kAngleEpsilon);
+}
+
+// Look-ahead should not change any values, only how segment transitions are
+// calculated.
+TEST_F(MotiveTests, LookAhead) {
+  static const int kNumMotivators = 4;
+  static const MotiveTime kDeltaTime = 30;
+  static const float kStartTime = 300.0f;
+  MotiveEngine look_ahead_engine;
+  look_ahead_engine.EnableLookAhead(true);
+  EXPECT_TRUE(look_ahead_engine.look_ahead_enabled());
+
+  Motivator1f plain[kNumMotivators];
+  Motivator1f ahead[kNumMotivators];
+  for (int i = 0; i < kNumMotivators; ++i) {
+    const SplinePlayback playback(kStartTime + 10.0f * i);
+    plain[i].Initialize(smooth_scalar_init(), &engine());
+    plain[i].SetSpline(simple_spline(), playback);
+    ahead[i].Initialize(smooth_scalar_init(), &look_ahead_engine);
+    ahead[i].SetSpline(simple_spline(), playback);
+  }
+
+  // Cross the boundary between the spline's two segments.
+  for (int frame = 0; frame < 10; ++frame) {
+    engine().AdvanceFrame(kDeltaTime);
+    look_ahead_engine.AdvanceFrame(kDeltaTime);
+    for (int i = 0; i < kNumMotivators; ++i) {
+      EXPECT_EQ(plain[i].Value(), ahead[i].Value());
+      EXPECT_EQ(plain[i].Velocity(), ahead[i].Velocity());
+    }
+  }
+  const MotiveProcessorCounters counters = look_ahead_engine.TotalCounters();
+  EXPECT_EQ(engine().TotalCounters().segment_transitions,
+            counters.segment_transitions);
+  EXPECT_EQ(static_cast<uint64_t>(kNumMotivators), counters.look_ahead_hits);
+  EXPECT_EQ(0u, engine().TotalCounters().look_ahead_hits);
+}
+
+// Memory usage should track the splines allocated and recycled by the
+// processor, and never report more used than allocated.
+TEST_F(MotiveTests, ProcessorMemoryUsage) {
+  const MotiveMemoryUsage empty = engine().MemoryUsage();
+  EXPECT_EQ(0u, empty.TotalAllocated());
+
+  Motivator1f a(smooth_scalar_init(), &engine());
+  Motivator1f b(smooth_scalar_init(), &engine());
+  a.SetTarget(motive::CurrentToTarget1f(0.0f, 0.0f, 1.0f, 0.0f, 100));
+  b.SetTarget(motive::CurrentToTarget1f(0.0f, 0.0f, 1.0f, 0.0f, 100));
+
+  const MotiveMemoryUsage active = engine().MemoryUsage();
+  EXPECT_GT(active.used_bytes[motive::kMemoryIndexArrays], 0u);
+  EXPECT_EQ(2 * sizeof(CompactSpline),
+            active.used_bytes[motive::kMemorySplines]);
+  for (int i = 0; i < motive::kNumMemoryCategories; ++i) {
+    EXPECT_LE(active.used_bytes[i], active.allocated_bytes[i]);
+  }
+
+  // Invalidating returns the spline to the pool, where it's slack.
+  a.Invalidate();
+  const MotiveMemoryUsage recycled = engine().MemoryUsage();
+  EXPECT_LT(recycled.used_bytes[motive::kMemorySplines],
+            active.used_bytes[motive::kMemorySplines]);
+  EXPECT_GE(recycled.Slack(motive::kMemorySplines), sizeof(CompactSpline));
+  EXPECT_LE(active.TotalAllocated(), recycled.TotalAllocated());
+}
+
+static void RecordSpike(const MotiveSpikeReport& report, void* user_data) {
+  static_cast<std::vector<MotiveSpikeReport>*>(user_data)->push_back(report);
+}
+
+// With a negative threshold, every processor is reported every frame. Work
+// done between frames should be reported with the next frame's spike.
+TEST_F(MotiveTests, SpikeWatchdog) {
+  std::vector<MotiveSpikeReport> spikes;
+  engine().EnableSpikeWatchdog(-1.0, RecordSpike, &spikes);
+  Motivator1f a(smooth_scalar_init(), &engine());
+  a.SetTarget(motive::CurrentToTarget1f(0.0f, 0.0f, 1.0f, 0.0f, 100));
+
+  engine().AdvanceFrame(1);
+  ASSERT_EQ(1u, spikes.size());
+  EXPECT_EQ(SplineInit::kType, spikes[0].type);
+  EXPECT_EQ(0u, spikes[0].frame);
+  EXPECT_EQ(1, spikes[0].num_indices);
+  EXPECT_EQ(0u, spikes[0].advance_frame.motivators_initialized);
+  EXPECT_EQ(1u, spikes[0].frame_work.motivators_initialized);
+  EXPECT_EQ(1u, spikes[0].frame_work.set_target_calls);
+  EXPECT_NE(std::string::npos, spikes[0].ToJson().find("\"frame_work\""));
+
+  // Running past the end of the curve is work done inside AdvanceFrame().
+  engine().AdvanceFrame(200);
+  ASSERT_EQ(2u, spikes.size());
+  EXPECT_EQ(1u, spikes[1].frame);
+  EXPECT_GT(spikes[1].advance_frame.segment_transitions, 0u);
+  EXPECT_EQ(0u, spikes[1].frame_work.motivators_initialized);
+
+  engine().DisableSpikeWatchdog();
+  engine().AdvanceFrame(1);
+  EXPECT_EQ(2u, spikes.size());
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -285,6 +285,21 @@ static float NormalizeClose(const Range& r, float x) {
   return r.NormalizeCloseValue(x);
 }
 
+// Normalize enough copies of `x` to use both the SIMD and the scalar paths,
+// and check that they agree.
+static float NormalizeBulk(const Range& r, float x) {
+  static const size_t kNumValues = 7;
+  float xs[kNumValues];
+  for (size_t i = 0; i < kNumValues; ++i) {
+    xs[i] = x;
+  }
+  r.NormalizeCloseValues(xs, kNumValues, xs);
+  for (size_t i = 1; i < kNumValues; ++i) {
+    EXPECT_EQ(xs[0], xs[i]);
+  }
+  return xs[0];
+}
+
 void TestNormalize_Inside(NormalizeFn* fn) {
   const Range a(-kPi, kPi);
   const Range zero_one(0.0f, 1.0f);
@@ -362,6 +377,46 @@ TEST_F(RangeTests, NormalizeClose_Distant) {
   TestNormalize_Distant(NormalizeClose);
 }
 
+TEST_F(RangeTests, NormalizeBulk_Inside) {
+  TestNormalize_Inside(NormalizeBulk);
+}
+TEST_F(RangeTests, NormalizeBulk_Border) {
+  TestNormalize_Border(NormalizeBulk);
+}
+TEST_F(RangeTests, NormalizeBulk_JustOutside) {
+  TestNormalize_JustOutside(NormalizeBulk);
+}
+TEST_F(RangeTests, NormalizeBulk_FartherOutside) {
+  TestNormalize_FartherOutside(NormalizeBulk);
+}
+TEST_F(RangeTests, NormalizeBulk_Distant) {
+  TestNormalize_Distant(NormalizeBulk);
+}
+
+// Each value is normalized into its own range. Invalid ranges leave the
+// value untouched.
+TEST_F(RangeTests, NormalizeBulk_PerValueRanges) {
+  const Range angle(-kPi, kPi);
+  const Range zero_one(0.0f, 1.0f);
+  const Range ranges[] = {angle, Range(), zero_one, angle, Range(),
+                          zero_one, angle, Range(), zero_one};
+  const float xs[] = {-1.5f * kPi, 7.0f, 1.5f, 0.5f, -100.0f,
+                      -0.25f,      kPi,  kPi, 2.0f};
+  static const size_t kNumValues = sizeof(xs) / sizeof(xs[0]);
+  float out[kNumValues];
+  Range::NormalizeCloseValues(ranges, xs, kNumValues, out);
+
+  for (size_t i = 0; i < kNumValues; ++i) {
+    const float expected = ranges[i].Valid()
+                               ? ranges[i].NormalizeCloseValue(xs[i])
+                               : xs[i];
+    EXPECT_NEAR(expected, out[i], kAngleEpsilon);
+    if (ranges[i].Valid()) {
+      EXPECT_TRUE(ranges[i].ContainsExcludingStart(out[i]));
+    }
+  }
+}
+
 TEST_F(RangeTests, Covers) {
   const float a[] = {1.0f, -3.0f, 2.0f, 5.0f, 0.0f, 6.0f};
   const Range covers = Range::Covers(a, MOTIVE_ARRAY_SIZE(a));
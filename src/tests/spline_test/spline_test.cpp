@@ -296,6 +296,101 @@ TEST_F(SplineTests, IndexForXMidSecondLast) {
   EXPECT_EQ(2, short_spline_.IndexForX(4.1f, kRidiculousSplineIndex));
 }
 
+// Ensure the fast tan and atan used to decode and encode node derivatives
+// are accurate to well within the angle quantization.
+TEST_F(SplineTests, NodeDerivativeAccuracy) {
+  using motive::detail::CompactSplineNode;
+  static const int kQuarterTurn = CompactSplineNode::kQuarterTurn;
+  static const double kAngleScale = M_PI / (2.0 * kQuarterTurn);
+  for (int angle = -kQuarterTurn + 1; angle < kQuarterTurn; ++angle) {
+    const CompactSplineNode node(0, 0, static_cast<int16_t>(angle));
+    const double expected = tan(angle * kAngleScale);
+    EXPECT_NEAR(expected, node.Derivative(), fabs(expected) * 1e-6 + 1e-7);
+  }
+
+  for (float derivative = -1000.0f; derivative <= 1000.0f;
+       derivative += 0.0625f) {
+    const int expected = static_cast<int>(atan(derivative) / kAngleScale);
+    EXPECT_NEAR(expected, CompactSplineNode::CompactDerivative(derivative), 1);
+  }
+
+  // Vertical slopes, in either direction, clamp to the steepest finite angle.
+  const float kInfinity = std::numeric_limits<float>::infinity();
+  EXPECT_EQ(kQuarterTurn - 1, CompactSplineNode::CompactDerivative(kInfinity));
+  EXPECT_EQ(1 - kQuarterTurn, CompactSplineNode::CompactDerivative(-kInfinity));
+  EXPECT_EQ(kQuarterTurn - 1, CompactSplineNode::CompactDerivative(1e30f));
+  EXPECT_EQ(1 - kQuarterTurn, CompactSplineNode::CompactDerivative(-1e30f));
+  const CompactSplineNode up(0, 0, CompactSplineNode::CompactDerivative(
+                                       kInfinity));
+  const CompactSplineNode down(0, 0, CompactSplineNode::CompactDerivative(
+                                         -kInfinity));
+  EXPECT_GT(up.Derivative(), 1e4f);
+  EXPECT_EQ(-up.Derivative(), down.Derivative());
+}
+
+// Ensure a guess that's a few segments behind still finds the right index.
+TEST_F(SplineTests, IndexForXGuessBehind) {
+  EXPECT_EQ(3, short_spline_.IndexForX(50.0f, 0));
+  EXPECT_EQ(3, short_spline_.IndexForX(50.0f, 1));
+  EXPECT_EQ(2, short_spline_.IndexForX(4.1f, 0));
+}
+
+// Ensure the x lookup grid gives the same indices as the binary search, for
+// any number of cells.
+TEST_F(SplineTests, IndexForXLookup) {
+  static const int kNumNodes = 200;
+  static const CompactSplineIndex kNumCells[] = {1, 3, 16, 199, 1000};
+  for (size_t i = 0; i < MOTIVE_ARRAY_SIZE(kNumCells); ++i) {
+    CompactSpline* spline = CompactSpline::Create(kNumNodes, kNumCells[i]);
+    spline->Init(Range(0.0f, 1.0f), 0.5f);
+
+    // Irregularly spaced nodes, so that some cells hold several nodes.
+    float x = 0.0f;
+    for (int j = 0; j < kNumNodes; ++j) {
+      spline->AddNode(x, 0.5f, 0.0f, motive::kAddWithoutModification);
+      x += j % 7 == 0 ? 100.0f : static_cast<float>(1 + j % 5);
+    }
+    spline->InitXLookup();
+    EXPECT_TRUE(spline->HasXLookup());
+
+    for (float check_x = -1.0f; check_x <= spline->EndX() + 1.0f;
+         check_x += 0.25f) {
+      const CompactSplineIndex with_lookup =
+          spline->IndexForX(check_x, kRidiculousSplineIndex);
+      spline->ClearXLookup();
+      const CompactSplineIndex with_search =
+          spline->IndexForX(check_x, kRidiculousSplineIndex);
+      spline->InitXLookup();
+      EXPECT_EQ(with_search, with_lookup);
+    }
+
+    // Clearing the nodes removes the grid.
+    spline->Clear();
+    EXPECT_FALSE(spline->HasXLookup());
+    CompactSpline::Destroy(spline);
+  }
+}
+
+// Ensure the x lookup grid only costs memory when there is room for one.
+TEST_F(SplineTests, XLookupSize) {
+  static const CompactSplineIndex kNumNodes = 100;
+  static const CompactSplineIndex kNumCells =
+      CompactSpline::RecommendXLookupCells(kNumNodes);
+  EXPECT_EQ(kNumNodes - 1, kNumCells);
+  EXPECT_EQ(0u, CompactSpline::Size(kNumNodes) % sizeof(float));
+  // Each cell adds one index, less any padding that the grid fills.
+  const size_t grid_size = CompactSpline::Size(kNumNodes, kNumCells) -
+                           CompactSpline::Size(kNumNodes);
+  EXPECT_LE(grid_size, kNumCells * sizeof(CompactSplineIndex));
+  EXPECT_GT(grid_size + sizeof(float),
+            kNumCells * sizeof(CompactSplineIndex));
+
+  CompactSpline* spline = CompactSpline::Create(kNumNodes, kNumCells);
+  EXPECT_EQ(kNumCells, spline->max_x_lookup_cells());
+  EXPECT_EQ(CompactSpline::Size(kNumNodes, kNumCells), spline->Size());
+  CompactSpline::Destroy(spline);
+}
+
 // Ensure the splines don't overshoot their mark.
 TEST_F(SplineTests, Overshoot) {
   for (int i = 0; i < kNumSimpleSplines; ++i) {
@@ -536,6 +631,508 @@ TEST_F(SplineTests, InitFromSplineInPlace) {
                          MOTIVE_ARRAY_SIZE(kUniformSpline));
 }
 
+// Look-ahead mode should only change how segments are initialized, not the
+// results.
+TEST_F(SplineTests, LookAheadMatches) {
+  static const int kNumNodes = 50;
+  static const int kNumIndices = 8;
+  static const int kNumFrames = 600;
+  static const int kBlendFrame = 300;
+  CompactSpline* spline = CompactSpline::Create(kNumNodes);
+  spline->Init(Range(-2.0f, 2.0f), 0.1f);
+  float x = 0.0f;
+  for (int i = 0; i < kNumNodes; ++i) {
+    spline->AddNode(x, sin(0.3f * i), 0.5f * cos(0.7f * i),
+                    motive::kAddWithoutModification);
+    x += static_cast<float>(1 + (i * 7) % 11);
+  }
+
+  BulkSplineEvaluator evaluators[2];
+  evaluators[1].set_look_ahead(true);
+  for (int j = 0; j < 2; ++j) {
+    BulkSplineEvaluator& e = evaluators[j];
+    e.SetNumIndices(kNumIndices);
+    for (int i = 0; i < kNumIndices; ++i) {
+      motive::SplinePlayback playback(13.0f * i, true, 0.5f + 0.25f * i);
+      e.SetSplines(i, 1, spline, playback);
+    }
+  }
+
+  for (int frame = 0; frame < kNumFrames; ++frame) {
+    if (frame == kBlendFrame) {
+      motive::SplinePlayback playback(7.0f, true, 1.0f, 20.0f);
+      for (int i = 0; i < kNumIndices; ++i) {
+        evaluators[0].SetSplines(i, 1, spline, playback);
+        evaluators[1].SetSplines(i, 1, spline, playback);
+      }
+    }
+    // Precompute only a few segments at a time, so that some transitions
+    // use precomputed segments and others do not.
+    if (frame % 3 == 0) {
+      evaluators[1].PrecomputeNextSegments(3);
+    }
+    evaluators[0].AdvanceFrame(1.0f);
+    evaluators[1].AdvanceFrame(1.0f);
+    for (int i = 0; i < kNumIndices; ++i) {
+      EXPECT_EQ(evaluators[0].X(i), evaluators[1].X(i));
+      EXPECT_EQ(evaluators[0].Y(i), evaluators[1].Y(i));
+      EXPECT_EQ(evaluators[0].Derivative(i), evaluators[1].Derivative(i));
+    }
+  }
+  EXPECT_EQ(evaluators[0].NumSegmentTransitions(),
+            evaluators[1].NumSegmentTransitions());
+  EXPECT_EQ(0u, evaluators[0].NumLookAheadHits());
+  EXPECT_LT(0u, evaluators[1].NumLookAheadHits());
+
+  CompactSpline::Destroy(spline);
+}
+
+// ParallelBulkYs() should give the same results on any number of threads, and
+// when the caller splits the blocks between its own threads. It should match
+// BulkYs() exactly for the first block of points, and stay close to it
+// afterwards. Use enough splines and points to span several blocks of each.
+TEST_F(SplineTests, ParallelBulkYs) {
+  static const int kNumNodes = 20;
+  static const int kNumSplines = 300;
+  static const size_t kNumPoints = 1200;
+  static const size_t kFirstBlockPoints = 512;
+  CompactSpline* splines = CompactSpline::CreateArray(kNumNodes, kNumSplines);
+  for (int j = 0; j < kNumSplines; ++j) {
+    CompactSpline* spline = splines->NextAtIdx(j);
+    spline->Init(Range(-2.0f, 2.0f), 0.1f);
+    float x = 0.0f;
+    for (int i = 0; i < kNumNodes; ++i) {
+      spline->AddNode(x, sin(0.3f * i + j), 0.5f * cos(0.7f * i),
+                      motive::kAddWithoutModification);
+      x += static_cast<float>(1 + (i * 7 + j) % 11);
+    }
+  }
+  const float delta_x = 0.25f;
+  const size_t num_values = kNumSplines * kNumPoints;
+
+  std::vector<float> ys(num_values);
+  std::vector<float> derivatives(num_values);
+  CompactSpline::BulkYs(splines, kNumSplines, 0.0f, delta_x, kNumPoints,
+                        &ys[0], &derivatives[0]);
+
+  // Store one thread's results point-major, like BulkYs(), and the other's
+  // spline-major, to check both strides.
+  std::vector<float> ys_one(num_values);
+  std::vector<float> derivatives_one(num_values);
+  CompactSpline::BulkYsOutput out_one;
+  out_one.ys = &ys_one[0];
+  out_one.derivatives = &derivatives_one[0];
+  out_one.point_stride = kNumSplines;
+  out_one.spline_stride = 1;
+  CompactSpline::ParallelBulkYs(splines, kNumSplines, 0.0f, delta_x,
+                                kNumPoints, out_one, 1);
+
+  std::vector<float> ys_many(num_values);
+  std::vector<float> derivatives_many(num_values);
+  CompactSpline::BulkYsOutput out_many;
+  out_many.ys = &ys_many[0];
+  out_many.derivatives = &derivatives_many[0];
+  out_many.point_stride = 1;
+  out_many.spline_stride = kNumPoints;
+  CompactSpline::ParallelBulkYs(splines, kNumSplines, 0.0f, delta_x,
+                                kNumPoints, out_many, 4);
+
+  // Split the blocks as three threads of the caller's own would.
+  static const size_t kNumCallerThreads = 3;
+  std::vector<float> ys_caller(num_values);
+  CompactSpline::BulkYsOutput out_caller;
+  out_caller.ys = &ys_caller[0];
+  out_caller.point_stride = kNumSplines;
+  out_caller.spline_stride = 1;
+  EXPECT_LT(kNumCallerThreads,
+            CompactSpline::NumBulkYsBlocks(kNumSplines, kNumPoints));
+  for (size_t t = 0; t < kNumCallerThreads; ++t) {
+    CompactSpline::BulkYsBlocks(splines, kNumSplines, 0.0f, delta_x,
+                                kNumPoints, out_caller, t, kNumCallerThreads);
+  }
+
+  for (size_t p = 0; p < kNumPoints; ++p) {
+    for (size_t s = 0; s < kNumSplines; ++s) {
+      const size_t i = p * kNumSplines + s;
+      const size_t transposed = s * kNumPoints + p;
+      EXPECT_EQ(ys_one[i], ys_many[transposed]);
+      EXPECT_EQ(derivatives_one[i], derivatives_many[transposed]);
+      EXPECT_EQ(ys_one[i], ys_caller[i]);
+      if (p < kFirstBlockPoints) {
+        EXPECT_EQ(ys[i], ys_one[i]);
+        EXPECT_EQ(derivatives[i], derivatives_one[i]);
+      } else {
+        EXPECT_NEAR(ys[i], ys_one[i], kNodeYPrecision);
+        EXPECT_NEAR(derivatives[i], derivatives_one[i], kDerivativePrecision);
+      }
+    }
+  }
+
+  CompactSpline::DestroyArray(splines, kNumSplines);
+}
+
+// AddNodes() should create exactly the same spline as calling AddNode() on
+// each node, including the inserted mid-nodes, repeated nodes, and
+// discontinuities.
+TEST_F(SplineTests, AddNodesMatchesAddNode) {
+  static const int kNumNodes = 200;
+  std::vector<motive::UncompressedNode> nodes;
+  float x = 1.0f;
+  for (int i = 0; i < kNumNodes; ++i) {
+    motive::UncompressedNode n;
+    n.x = x;
+    n.y = sin(0.3f * i);
+    n.derivative = 0.5f * cos(0.7f * i);
+    nodes.push_back(n);
+
+    // Repeat some nodes exactly, and some at the same x with a different y.
+    if (i % 17 == 5) nodes.push_back(n);
+    if (i % 23 == 7) {
+      n.y = -n.y;
+      nodes.push_back(n);
+      nodes.push_back(n);
+    }
+    x += static_cast<float>(1 + (i * 7) % 11);
+  }
+
+  const CompactSplineIndex max_nodes =
+      static_cast<CompactSplineIndex>(2 * nodes.size() + 1);
+  CompactSpline* one = CompactSpline::Create(max_nodes);
+  CompactSpline* bulk = CompactSpline::Create(max_nodes);
+  one->Init(Range(-4.0f, 4.0f), 0.1f);
+  bulk->Init(Range(-4.0f, 4.0f), 0.1f);
+  one->AddNode(0.0f, 0.0f, -3.0f);
+  bulk->AddNode(0.0f, 0.0f, -3.0f);
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    one->AddNode(nodes[i].x, nodes[i].y, nodes[i].derivative);
+  }
+  bulk->AddNodes(&nodes[0], nodes.size());
+
+  // Ensure the test actually exercises the mid-nodes.
+  EXPECT_GT(one->num_nodes(), kNumNodes + 50);
+  ASSERT_EQ(one->num_nodes(), bulk->num_nodes());
+  for (CompactSplineIndex i = 0; i < one->num_nodes(); ++i) {
+    EXPECT_EQ(one->NodeX(i), bulk->NodeX(i));
+    EXPECT_EQ(one->NodeY(i), bulk->NodeY(i));
+    EXPECT_EQ(one->NodeDerivative(i), bulk->NodeDerivative(i));
+  }
+
+  CompactSpline::Destroy(one);
+  CompactSpline::Destroy(bulk);
+}
+
+// SetXs() on many indices at once should match setting each spline with
+// the same start x.
+TEST_F(SplineTests, SetXsMatchesSetSplines) {
+  static const int kNumNodes = 30;
+  static const int kNumIndices = 5;
+  static const float kXs[] = {0.0f, 3.5f, 40.0f, 150.0f, 500.0f};
+  CompactSpline* splines = CompactSpline::CreateArray(kNumNodes, kNumIndices);
+  for (int j = 0; j < kNumIndices; ++j) {
+    CompactSpline* spline = splines->NextAtIdx(j);
+    spline->Init(Range(-2.0f, 2.0f), 0.1f);
+    float x = 0.0f;
+    for (int i = 0; i < kNumNodes; ++i) {
+      spline->AddNode(x, sin(0.3f * i + j), 0.5f * cos(0.7f * i),
+                      motive::kAddWithoutModification);
+      x += static_cast<float>(1 + (i * 7 + j) % 11);
+    }
+  }
+
+  for (size_t k = 0; k < MOTIVE_ARRAY_SIZE(kXs); ++k) {
+    const float x = kXs[k];
+    BulkSplineEvaluator seek;
+    seek.SetNumIndices(kNumIndices);
+    seek.SetSplines(0, kNumIndices, splines,
+                    motive::SplinePlayback(0.0f, true, 1.0f, 0.0f, 2.0f, 1.0f));
+    seek.AdvanceFrame(10.0f);
+    seek.SetXs(0, kNumIndices, x);
+
+    BulkSplineEvaluator set;
+    set.SetNumIndices(kNumIndices);
+    set.SetSplines(0, kNumIndices, splines,
+                   motive::SplinePlayback(x, true, 1.0f, 0.0f, 2.0f, 1.0f));
+
+    for (int i = 0; i < kNumIndices; ++i) {
+      EXPECT_EQ(set.X(i), seek.X(i));
+      EXPECT_EQ(set.Y(i), seek.Y(i));
+      EXPECT_EQ(set.Derivative(i), seek.Derivative(i));
+    }
+  }
+
+  CompactSpline::DestroyArray(splines, kNumIndices);
+}
+
+// SetSplines() on many indices at once should match setting each index on
+// its own, when some indices blend and others jump.
+TEST_F(SplineTests, SetSplinesMatchesOneAtATime) {
+  static const int kNumNodes = 30;
+  static const int kNumIndices = 5;
+  CompactSpline* splines = CompactSpline::CreateArray(kNumNodes, kNumIndices);
+  for (int j = 0; j < kNumIndices; ++j) {
+    CompactSpline* spline = splines->NextAtIdx(j);
+    spline->Init(Range(-2.0f, 2.0f), 0.1f);
+    float x = 0.0f;
+    for (int i = 0; i < kNumNodes; ++i) {
+      spline->AddNode(x, sin(0.3f * i + j), 0.5f * cos(0.7f * i),
+                      motive::kAddWithoutModification);
+      x += static_cast<float>(1 + (i * 7 + j) % 11);
+    }
+  }
+
+  // Only the even indices are playing a spline, so only they blend.
+  BulkSplineEvaluator evaluators[2];
+  for (int k = 0; k < 2; ++k) {
+    BulkSplineEvaluator& e = evaluators[k];
+    e.SetNumIndices(kNumIndices);
+    e.ClearSplines(0, kNumIndices);
+    for (int i = 0; i < kNumIndices; i += 2) {
+      e.SetSplines(i, 1, splines->NextAtIdx(kNumIndices - 1 - i),
+                   motive::SplinePlayback(20.0f, true));
+    }
+    e.AdvanceFrame(10.0f);
+  }
+
+  const motive::SplinePlayback playback(50.0f, true, 1.5f, 5.0f);
+  evaluators[0].SetSplines(0, kNumIndices, splines, playback);
+  for (int i = 0; i < kNumIndices; ++i) {
+    evaluators[1].SetSplines(i, 1, splines->NextAtIdx(i), playback);
+  }
+  EXPECT_EQ(3u, evaluators[0].NumBlends());
+  EXPECT_EQ(3u, evaluators[1].NumBlends());
+
+  for (int frame = 0; frame < 10; ++frame) {
+    for (int i = 0; i < kNumIndices; ++i) {
+      EXPECT_EQ(evaluators[0].X(i), evaluators[1].X(i));
+      EXPECT_EQ(evaluators[0].Y(i), evaluators[1].Y(i));
+      EXPECT_EQ(evaluators[0].Derivative(i), evaluators[1].Derivative(i));
+    }
+    evaluators[0].AdvanceFrame(1.0f);
+    evaluators[1].AdvanceFrame(1.0f);
+  }
+
+  CompactSpline::DestroyArray(splines, kNumIndices);
+}
+
+// Cached outputs should be identical to calculating them on demand, even
+// when caching is enabled after the splines are set.
+TEST_F(SplineTests, CacheOutputsMatches) {
+  static const int kNumNodes = 30;
+  static const int kNumIndices = 6;
+  static const int kNumFrames = 300;
+  static const int kBlendFrame = 100;
+  static const int kRateFrame = 200;
+  CompactSpline* spline = CompactSpline::Create(kNumNodes);
+  spline->Init(Range(-4.0f, 4.0f), 0.1f);
+  float x = 0.0f;
+  for (int i = 0; i < kNumNodes; ++i) {
+    spline->AddNode(x, 3.0f * sin(0.3f * i), 0.5f * cos(0.7f * i),
+                    motive::kAddWithoutModification);
+    x += static_cast<float>(1 + (i * 7) % 11);
+  }
+
+  BulkSplineEvaluator evaluators[2];
+  for (int j = 0; j < 2; ++j) {
+    BulkSplineEvaluator& e = evaluators[j];
+    e.SetNumIndices(kNumIndices);
+    e.SetYRanges(0, kNumIndices / 2, motive::kAngleRange);
+    for (int i = 0; i < kNumIndices; ++i) {
+      e.SetSplines(i, 1, spline,
+                   motive::SplinePlayback(13.0f * i, true, 0.5f + 0.25f * i));
+    }
+  }
+  evaluators[1].set_cache_outputs(true);
+
+  float expected[kNumIndices];
+  float actual[kNumIndices];
+  for (int frame = 0; frame < kNumFrames; ++frame) {
+    if (frame == kBlendFrame) {
+      motive::SplinePlayback playback(7.0f, true, 1.0f, 20.0f);
+      evaluators[0].SetSplines(0, 1, spline, playback);
+      evaluators[1].SetSplines(0, 1, spline, playback);
+    }
+    if (frame == kRateFrame) {
+      evaluators[0].SetPlaybackRates(1, 2, 2.0f);
+      evaluators[1].SetPlaybackRates(1, 2, 2.0f);
+    }
+    evaluators[0].AdvanceFrame(1.0f);
+    evaluators[1].AdvanceFrame(1.0f);
+
+    evaluators[0].Derivatives(0, kNumIndices, expected);
+    evaluators[1].Derivatives(0, kNumIndices, actual);
+    for (int i = 0; i < kNumIndices; ++i) EXPECT_EQ(expected[i], actual[i]);
+
+    evaluators[0].DerivativesWithoutPlayback(0, kNumIndices, expected);
+    evaluators[1].DerivativesWithoutPlayback(0, kNumIndices, actual);
+    for (int i = 0; i < kNumIndices; ++i) EXPECT_EQ(expected[i], actual[i]);
+
+    evaluators[0].EndYs(0, kNumIndices, expected);
+    evaluators[1].EndYs(0, kNumIndices, actual);
+    for (int i = 0; i < kNumIndices; ++i) EXPECT_EQ(expected[i], actual[i]);
+
+    evaluators[0].EndDerivatives(0, kNumIndices, expected);
+    evaluators[1].EndDerivatives(0, kNumIndices, actual);
+    for (int i = 0; i < kNumIndices; ++i) EXPECT_EQ(expected[i], actual[i]);
+
+    evaluators[0].YDifferencesToEnd(0, kNumIndices, expected);
+    evaluators[1].YDifferencesToEnd(0, kNumIndices, actual);
+    for (int i = 0; i < kNumIndices; ++i) EXPECT_EQ(expected[i], actual[i]);
+  }
+
+  CompactSpline::Destroy(spline);
+}
+
+// Half-precision mode rounds only the segment ends, so it should play at the
+// same rates, and give the same results.
+TEST_F(SplineTests, HalfPrecisionMatches) {
+  static const int kNumNodes = 50;
+  static const int kNumFrames = 200;
+  static const float kDeltaX = 1.0f;
+  static const float kRates[] = {1.0f, 0.5f, 1.1f, 0.3f};
+  static const int kNumIndices = static_cast<int>(MOTIVE_ARRAY_SIZE(kRates));
+
+  // Without F16C, the mode stays disabled.
+  if (!motive::HalfPrecisionAvailable()) {
+    BulkSplineEvaluator e;
+    e.set_half_precision(true);
+    EXPECT_FALSE(e.half_precision());
+    return;
+  }
+
+  CompactSpline* spline = CompactSpline::Create(kNumNodes);
+  spline->Init(Range(-2.0f, 2.0f), 0.1f);
+  float x = 0.0f;
+  for (int i = 0; i < kNumNodes; ++i) {
+    spline->AddNode(x, sin(0.3f * i), 0.5f * cos(0.7f * i),
+                    motive::kAddWithoutModification);
+    x += static_cast<float>(1 + (i * 7) % 11);
+  }
+
+  BulkSplineEvaluator evaluators[2];
+  evaluators[1].set_half_precision(true);
+  EXPECT_TRUE(evaluators[1].half_precision());
+  for (int j = 0; j < 2; ++j) {
+    BulkSplineEvaluator& e = evaluators[j];
+    e.SetNumIndices(kNumIndices);
+    for (int i = 0; i < kNumIndices; ++i) {
+      e.SetSplines(i, 1, spline, motive::SplinePlayback(3.0f * i, false,
+                                                        kRates[i]));
+    }
+  }
+
+  for (int frame = 1; frame <= kNumFrames; ++frame) {
+    evaluators[0].AdvanceFrame(kDeltaX);
+    evaluators[1].AdvanceFrame(kDeltaX);
+    for (int i = 0; i < kNumIndices; ++i) {
+      EXPECT_EQ(evaluators[0].X(i), evaluators[1].X(i));
+      EXPECT_EQ(evaluators[0].Y(i), evaluators[1].Y(i));
+      EXPECT_EQ(kRates[i], evaluators[1].PlaybackRate(i));
+    }
+  }
+
+  // The half-precision segment ends replace the full-precision ones.
+  EXPECT_LT(evaluators[1].MemoryUsage().TotalUsed(),
+            evaluators[0].MemoryUsage().TotalUsed());
+
+  // Switching back to full precision keeps the current state.
+  evaluators[1].set_half_precision(false);
+  EXPECT_EQ(evaluators[0].X(0), evaluators[1].X(0));
+
+  CompactSpline::Destroy(spline);
+}
+
+static void CheckSameNodes(const CompactSpline& a, const CompactSpline& b) {
+  ASSERT_EQ(a.num_nodes(), b.num_nodes());
+  for (CompactSplineIndex i = 0; i < a.num_nodes(); ++i) {
+    EXPECT_TRUE(a.Node(i) == b.Node(i));
+  }
+}
+
+// Packing is lossless, so the packed spline should evaluate identically.
+TEST_F(SplineTests, PackedMatchesSource) {
+  static const int kNumNodes = 100;
+  CompactSpline* spline = CompactSpline::Create(kNumNodes);
+  spline->Init(Range(-2.0f, 2.0f), 0.1f);
+  float x = 0.0f;
+  for (int i = 0; i < kNumNodes; ++i) {
+    spline->AddNode(x, sin(0.3f * i), 0.5f * cos(0.7f * i),
+                    motive::kAddWithoutModification);
+    x += static_cast<float>(1 + (i * 7) % 11);
+  }
+
+  CompactSpline* packed = CompactSpline::CreatePacked(*spline);
+  EXPECT_TRUE(packed->packed());
+  EXPECT_FALSE(spline->packed());
+  EXPECT_EQ(CompactSpline::PackedSize(*spline), packed->Size());
+  EXPECT_LT(packed->Size(), spline->Size());
+  CheckSameNodes(*spline, *packed);
+
+  CompactSplineIndex index = 0;
+  for (float check_x = -1.0f; check_x <= spline->EndX() + 1.0f;
+       check_x += 0.5f) {
+    EXPECT_EQ(spline->YCalculatedSlowly(check_x),
+              packed->YCalculatedSlowly(check_x));
+    const CompactSplineIndex expected = spline->IndexForX(check_x, index);
+    index = packed->IndexForX(check_x, index);
+    EXPECT_EQ(expected, index);
+  }
+
+  // Serialized data should create the same spline.
+  CompactSpline* loaded = CompactSpline::CreateFromPackedData(
+      packed->y_range(), packed->x_granularity(), packed->num_nodes(),
+      packed->packed_data(), packed->packed_data_size());
+  EXPECT_TRUE(loaded->packed());
+  CheckSameNodes(*spline, *loaded);
+
+  // Assignment unpacks.
+  CompactSpline* unpacked = CompactSpline::Create(kNumNodes);
+  *unpacked = *loaded;
+  EXPECT_FALSE(unpacked->packed());
+  CheckSameNodes(*spline, *unpacked);
+
+  CompactSpline::Destroy(unpacked);
+  CompactSpline::Destroy(loaded);
+  CompactSpline::Destroy(packed);
+  CompactSpline::Destroy(spline);
+}
+
+// Evenly-spaced nodes with few distinct derivatives, like sampled animation
+// data, should pack much smaller than their unpacked size.
+TEST_F(SplineTests, PackedEvenlySpaced) {
+  static const int kNumNodes = 200;
+  static const float kDerivatives[] = {-0.1f, 0.0f, 0.1f};
+  CompactSpline* spline = CompactSpline::Create(kNumNodes);
+  spline->Init(Range(0.0f, 1.0f), 1.0f);
+  for (int i = 0; i < kNumNodes; ++i) {
+    spline->AddNode(static_cast<float>(33 * i), 0.5f + 0.4f * sin(0.1f * i),
+                    kDerivatives[i % MOTIVE_ARRAY_SIZE(kDerivatives)],
+                    motive::kAddWithoutModification);
+  }
+
+  CompactSpline* packed = CompactSpline::CreatePacked(*spline);
+  CheckSameNodes(*spline, *packed);
+  EXPECT_LT(packed->Size() * 2, spline->Size());
+
+  CompactSpline::Destroy(packed);
+  CompactSpline::Destroy(spline);
+}
+
+// Packing should work on splines with a single node, even though it saves
+// nothing.
+TEST_F(SplineTests, PackedSingleNode) {
+  CompactSpline* spline = CompactSpline::Create(1);
+  spline->Init(Range(0.0f, 1.0f), 0.5f);
+  spline->AddNode(2.0f, 0.25f, 0.0f, motive::kAddWithoutModification);
+
+  CompactSpline* packed = CompactSpline::CreatePacked(*spline);
+  CheckSameNodes(*spline, *packed);
+  EXPECT_EQ(spline->EndX(), packed->EndX());
+  EXPECT_EQ(spline->EndY(), packed->EndY());
+
+  CompactSpline::Destroy(packed);
+  CompactSpline::Destroy(spline);
+}
+
 TEST_F(SplineTests, YScaleAndOffset) {
   static const float kOffsets[] = {0.0f, 2.0f, 0.111f, 10.0f, -1.5f, -1.0f};
   static const float kScales[] = {1.0f, 2.0f, 0.1f, 1.1f, 0.0f, -1.0f, -1.3f};
@@ -15,12 +15,21 @@
 #include "anim_generated.h"
 #include "anim_table_generated.h"
 #include "gtest/gtest.h"
+#include "motive/anim.h"
 #include "motive/anim_table.h"
+#include "motive/init.h"
+#include "motive/io/flatbuffers.h"
+#include "motive/math/compact_spline.h"
 
 using motive::AnimTable;
 using motive::AnimListFb;
 using motive::AnimTableFb;
 using motive::AnimSource;
+using motive::CompactSpline;
+using motive::CompactSplineIndex;
+using motive::MatrixOperationInit;
+using motive::Range;
+using motive::RigAnim;
 
 enum AnimTableInitMethod {
   kInitFromNames,
@@ -305,6 +314,70 @@ void TableInvalids(AnimTableInitMethod method) {
 }
 TEST_ALL_INIT_METHODS(TableInvalids)
 
+// Write `spline` the way anim_pipeline does, as the only op of a one-bone
+// RigAnimFb. Then load it back with RigAnimFromFlatBuffers().
+static void SplineRoundTrip(const CompactSpline& spline, bool packed,
+                            size_t* buffer_size, RigAnim* anim) {
+  flatbuffers::FlatBufferBuilder fbb;
+  auto spline_fb = motive::CompactSplineToFlatBuffers(spline, packed, fbb);
+  auto op_fb = motive::CreateMatrixOpFb(
+      fbb, 0, motive::MatrixOperationTypeFb_kTranslateX,
+      motive::MatrixOpValueFb_CompactSplineFb, spline_fb.Union());
+  std::vector<flatbuffers::Offset<motive::MatrixOpFb>> ops(1, op_fb);
+  std::vector<flatbuffers::Offset<motive::MatrixAnimFb>> matrix_anims(
+      1, motive::CreateMatrixAnimFb(fbb, fbb.CreateVector(ops)));
+  std::vector<uint8_t> bone_parents(1, motive::kInvalidBoneIdx);
+  auto rig_anim_fb = motive::CreateRigAnimFb(
+      fbb, fbb.CreateVector(matrix_anims), fbb.CreateVector(bone_parents), 0,
+      false, fbb.CreateString("round_trip"));
+  motive::FinishRigAnimFbBuffer(fbb, rig_anim_fb);
+  *buffer_size = fbb.GetSize();
+
+  motive::RigAnimFromFlatBuffers(*motive::GetRigAnimFb(fbb.GetBufferPointer()),
+                                 anim);
+}
+
+// Splines written by the pipeline, packed or not, should load with the same
+// nodes that were written.
+TEST_F(TableTests, SplineFlatBufferRoundTrip) {
+  static const int kNumNodes = 100;
+  CompactSpline* spline = CompactSpline::Create(kNumNodes);
+  spline->Init(Range(-2.0f, 2.0f), 0.1f);
+  float x = 0.0f;
+  for (int i = 0; i < kNumNodes; ++i) {
+    spline->AddNode(x, sin(0.3f * i), 0.5f * cos(0.7f * i),
+                    motive::kAddWithoutModification);
+    x += static_cast<float>(1 + (i * 7) % 11);
+  }
+
+  size_t sizes[2];
+  for (int packed = 0; packed < 2; ++packed) {
+    RigAnim anim;
+    SplineRoundTrip(*spline, packed != 0, &sizes[packed], &anim);
+    ASSERT_EQ(anim.NumBones(), 1);
+    const MatrixOperationInit& op = anim.Anim(0).ops().ops()[0];
+    ASSERT_EQ(op.union_type, MatrixOperationInit::kUnionSpline);
+    const CompactSpline& loaded = *op.spline;
+
+    EXPECT_EQ(loaded.packed(), packed != 0);
+    EXPECT_EQ(loaded.y_range().start(), spline->y_range().start());
+    EXPECT_EQ(loaded.y_range().end(), spline->y_range().end());
+    EXPECT_EQ(loaded.x_granularity(), spline->x_granularity());
+    ASSERT_EQ(loaded.num_nodes(), spline->num_nodes());
+    for (CompactSplineIndex i = 0; i < spline->num_nodes(); ++i) {
+      EXPECT_TRUE(loaded.Node(i) == spline->Node(i));
+    }
+    for (float check_x = 0.0f; check_x <= spline->EndX(); check_x += 0.5f) {
+      EXPECT_EQ(loaded.YCalculatedSlowly(check_x),
+                spline->YCalculatedSlowly(check_x));
+    }
+  }
+
+  // Packing is only worth it if the file is smaller.
+  EXPECT_LT(sizes[1], sizes[0]);
+  CompactSpline::Destroy(spline);
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();